@@ -2,22 +2,89 @@
 #define MODBUS_PROTOCOL_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// MBAP header: transaction id, protocol id, length, unit id
+#define MODBUS_TCP_MBAP_SIZE 7
+
+// Largest PDU (function code and data) and the ADU that carries it
+#define MODBUS_TCP_MAX_PDU_SIZE 253
+#define MODBUS_TCP_MAX_ADU_SIZE (MODBUS_TCP_MBAP_SIZE + MODBUS_TCP_MAX_PDU_SIZE)
+
+/**
+ * @brief How a request accesses the assemblies
+ *
+ * Writes are queued for the OpENer thread and applied later, see
+ * modbus_register_map_writes_pending().
+ */
+typedef enum {
+    MODBUS_TCP_REQUEST_READ,        // Reads only, or no assembly access
+    MODBUS_TCP_REQUEST_WRITE,       // Writes, the response does not depend on the written data
+    MODBUS_TCP_REQUEST_WRITE_READ,  // Writes, then reads back (FC 23)
+} modbus_tcp_request_kind_t;
+
+/**
+ * @brief Length of the ModbusTCP request at the start of a receive buffer
+ *
+ * @param data Received bytes, starting at an MBAP header
+ * @param length Number of received bytes
+ * @return Length of the complete request, 0 if more bytes are needed,
+ *         -1 if the header is invalid and the connection must be closed
+ */
+int modbus_tcp_frame_length(const uint8_t *data, size_t length);
+
+/**
+ * @brief Process one complete ModbusTCP request
+ *
+ * @param request Request as delimited by modbus_tcp_frame_length()
+ * @param request_length Length of the request
+ * @param response Buffer for the response, MODBUS_TCP_MAX_ADU_SIZE bytes
+ * @return Length of the response written to response
+ */
+size_t modbus_tcp_process_request(const uint8_t *request, size_t request_length, uint8_t *response);
+
+/**
+ * @brief Get how a complete ModbusTCP request accesses the assemblies
+ *
+ * @param request Request as delimited by modbus_tcp_frame_length()
+ * @param request_length Length of the request
+ * @return Kind of the request
+ */
+modbus_tcp_request_kind_t modbus_tcp_request_kind(const uint8_t *request, size_t request_length);
+
 /**
- * @brief Handle ModbusTCP request from client
- * 
- * @param client_socket Client socket file descriptor
- * @return true if connection should remain open, false to close
+ * @brief Process the write of a MODBUS_TCP_REQUEST_WRITE_READ request
+ *
+ * Together with modbus_tcp_process_read() the same as
+ * modbus_tcp_process_request(), so the read can wait until the write has been
+ * applied.
+ *
+ * @param request Request as delimited by modbus_tcp_frame_length()
+ * @param request_length Length of the request
+ * @param response Buffer for the response, MODBUS_TCP_MAX_ADU_SIZE bytes
+ * @return 0 if the write has been queued, otherwise the length of the
+ *         exception response written to response
  */
-bool modbus_tcp_handle_request(int client_socket);
+size_t modbus_tcp_process_write(const uint8_t *request, size_t request_length, uint8_t *response);
+
+/**
+ * @brief Process the read of a MODBUS_TCP_REQUEST_WRITE_READ request after
+ *        modbus_tcp_process_write()
+ *
+ * @param request Request as delimited by modbus_tcp_frame_length()
+ * @param request_length Length of the request
+ * @param response Buffer for the response, MODBUS_TCP_MAX_ADU_SIZE bytes
+ * @return Length of the response written to response
+ */
+size_t modbus_tcp_process_read(const uint8_t *request, size_t request_length, uint8_t *response);
 
 #ifdef __cplusplus
 }
 #endif
 
 #endif // MODBUS_PROTOCOL_H
-
@@ -2,16 +2,114 @@
 #define MODBUS_REGISTER_MAP_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// Largest mapping table
+#define MODBUS_REGISTER_MAP_MAX_ENTRIES 16
+
+// Modbus data tables a mapping serves
+typedef enum {
+    MODBUS_TABLE_INPUT_REGISTERS = 0,
+    MODBUS_TABLE_HOLDING_REGISTERS,
+    MODBUS_TABLE_COILS,
+    MODBUS_TABLE_DISCRETE_INPUTS,
+    MODBUS_TABLE_COUNT
+} modbus_table_t;
+
+// Type of the assembly values behind a register mapping. Assembly values are
+// little-endian, registers are big-endian. 32-bit values take a register pair
+// and are only accessed as a whole.
+typedef enum {
+    MODBUS_DATA_UINT16 = 0,
+    MODBUS_DATA_INT16,
+    MODBUS_DATA_UINT32,
+    MODBUS_DATA_INT32,
+    MODBUS_DATA_FLOAT32,
+    MODBUS_DATA_TYPE_COUNT
+} modbus_data_type_t;
+
+// Register order of 32-bit values
+typedef enum {
+    MODBUS_WORD_ORDER_HIGH_FIRST = 0, // High word in the first register (ABCD)
+    MODBUS_WORD_ORDER_LOW_FIRST,      // Low word in the first register (CDAB)
+    MODBUS_WORD_ORDER_COUNT
+} modbus_word_order_t;
+
+/**
+ * @brief One mapping of a Modbus address range to assembly bytes
+ *
+ * Registers map 2 bytes each from offset on. Coils and discrete inputs map
+ * bit n of the range to byte offset + n / 8, bit n % 8. The layout is fixed,
+ * the table is stored as is in NVS.
+ */
+typedef struct {
+    uint8_t table;      // modbus_table_t
+    uint8_t data_type;  // modbus_data_type_t, registers only
+    uint8_t word_order; // modbus_word_order_t, 32-bit types only
+    uint8_t reserved;
+    uint16_t start;     // First register or bit address
+    uint16_t count;     // Number of registers or bits
+    uint32_t assembly;  // Assembly instance
+    uint16_t offset;    // First assembly byte
+    uint16_t reserved2;
+} modbus_register_mapping_t;
+
+/**
+ * @brief Check a mapping table
+ *
+ * Entries must have a valid table, type and word order, a 32-bit type needs
+ * an even count, and the ranges of one table must not overlap.
+ *
+ * @param entries Mapping table
+ * @param count Number of entries (1-MODBUS_REGISTER_MAP_MAX_ENTRIES)
+ * @return true if the table is valid
+ */
+bool modbus_register_map_validate(const modbus_register_mapping_t *entries, size_t count);
+
+/**
+ * @brief Apply a mapping table
+ *
+ * Requests in progress finish with the previous table.
+ *
+ * @param entries Mapping table, NULL to apply the built-in default table
+ * @param count Number of entries
+ * @return true on success, false if the table is invalid
+ */
+bool modbus_register_map_configure(const modbus_register_mapping_t *entries, size_t count);
+
 /**
- * @brief Read input registers (read-only, maps to Input Assembly 100)
+ * @brief Copy the applied mapping table
+ *
+ * @param entries Buffer for MODBUS_REGISTER_MAP_MAX_ENTRIES entries
+ * @return Number of entries
+ */
+size_t modbus_register_map_get(modbus_register_mapping_t *entries);
+
+/**
+ * @brief Apply the mapping table saved in NVS, or the default table
+ *
+ * @return true if the saved table was applied, false if the default is used
+ */
+bool modbus_register_map_load(void);
+
+/**
+ * @brief Save a mapping table to NVS, applied from the next load
+ *
+ * @param entries Mapping table, NULL to remove the saved table
+ * @param count Number of entries
+ * @return true on success, false if the table is invalid or on NVS error
+ */
+bool modbus_register_map_save(const modbus_register_mapping_t *entries, size_t count);
+
+/**
+ * @brief Read input registers (read-only, default: Input Assembly 100)
  * 
- * @param start_addr Starting register address (0-15)
+ * @param start_addr Starting register address (default 0-15)
  * @param quantity Number of registers to read (1-125)
  * @param data Buffer to store register values (big-endian, 2 bytes per register)
  * @return true on success, false on invalid address/quantity
@@ -19,7 +117,7 @@ extern "C" {
 bool modbus_read_input_registers(uint16_t start_addr, uint16_t quantity, uint8_t *data);
 
 /**
- * @brief Read holding registers (read-write, maps to Output Assembly 150 and Config Assembly 151)
+ * @brief Read holding registers (read-write, default: Output Assembly 150 and Config Assembly 151)
  * 
  * @param start_addr Starting register address
  * @param quantity Number of registers to read (1-125)
@@ -47,6 +145,65 @@ bool modbus_write_holding_register(uint16_t address, uint16_t value);
  */
 bool modbus_write_holding_registers(uint16_t start_addr, uint16_t quantity, const uint8_t *data);
 
+/**
+ * @brief Read coils (default: bits of Output Assembly 150, coil n = byte n / 8, bit n % 8)
+ * 
+ * @param start_addr Starting coil address (default 0-255)
+ * @param quantity Number of coils to read (1-2000)
+ * @param data Buffer for the coil values, packed 8 per byte, first coil in bit 0
+ * @return true on success, false on invalid address/quantity
+ */
+bool modbus_read_coils(uint16_t start_addr, uint16_t quantity, uint8_t *data);
+
+/**
+ * @brief Read discrete inputs (default: bits of Input Assembly 100, input n = byte n / 8, bit n % 8)
+ * 
+ * @param start_addr Starting input address (default 0-255)
+ * @param quantity Number of inputs to read (1-2000)
+ * @param data Buffer for the input values, packed 8 per byte, first input in bit 0
+ * @return true on success, false on invalid address/quantity
+ */
+bool modbus_read_discrete_inputs(uint16_t start_addr, uint16_t quantity, uint8_t *data);
+
+/**
+ * @brief Write single coil
+ * 
+ * @param address Coil address (coil 0 drives the status LED)
+ * @param value Coil value
+ * @return true on success, false on invalid address
+ */
+bool modbus_write_coil(uint16_t address, bool value);
+
+/**
+ * @brief Write multiple coils, one assembly update per mapping
+ * 
+ * @param start_addr Starting coil address
+ * @param quantity Number of coils to write
+ * @param data Coil values, packed 8 per byte, first coil in bit 0
+ * @return true on success, false on invalid address/quantity
+ */
+bool modbus_write_coils(uint16_t start_addr, uint16_t quantity, const uint8_t *data);
+
+/**
+ * @brief Check for writes of earlier requests not yet applied
+ *
+ * Assembly writes are queued for the OpENer thread. Until they are applied,
+ * reads return the previous data and a partial write of bits would undo
+ * them. Must be called from the task processing the requests.
+ *
+ * @return true while writes are pending
+ */
+bool modbus_register_map_writes_pending(void);
+
+/**
+ * @brief Get a Read Device Identification object (FC 43 / MEI 14)
+ * 
+ * @param object_id Object id: 0 VendorName, 1 ProductCode, 2 MajorMinorRevision,
+ *                  4 ProductName, 5 ModelName
+ * @return Object value, NULL if the device does not have the object
+ */
+const char *modbus_get_device_identification(uint8_t object_id);
+
 #ifdef __cplusplus
 }
 #endif
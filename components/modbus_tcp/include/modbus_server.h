@@ -0,0 +1,99 @@
+#ifndef MODBUS_SERVER_H
+#define MODBUS_SERVER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Period of the request rate accounting and of the published statistics
+#define MODBUS_SERVER_RATE_WINDOW_MS 1000
+
+/**
+ * @brief ModbusTCP server core settings
+ */
+typedef struct {
+    uint16_t port;              // TCP port to listen on
+    uint16_t max_connections;   // Concurrent clients
+    uint32_t idle_timeout_ms;   // Close clients without a request for this long, 0 never
+    uint32_t evict_idle_ms;     // At the limit, a new connection takes the slot of the least
+                                // recently used client if it has been idle this long
+} modbus_server_config_t;
+
+/**
+ * @brief Server statistics, published once per rate window
+ */
+typedef struct {
+    uint16_t connections;       // Open connections
+    uint16_t max_connections;   // Connection limit
+    uint32_t accepted;          // Connections accepted
+    uint32_t rejected;          // Connections refused at the limit
+    uint32_t evicted;           // Idle connections closed for a new one
+    uint32_t timed_out;         // Connections closed after the idle timeout
+    uint32_t protocol_errors;   // Connections closed for an invalid MBAP header
+    uint64_t requests;          // Requests processed
+    uint32_t request_rate;      // Requests per second in the last window
+} modbus_server_stats_t;
+
+/**
+ * @brief Statistics of one client, published once per rate window
+ */
+typedef struct {
+    uint32_t address;           // IPv4 address, network byte order
+    uint16_t port;              // Client port
+    uint32_t requests;          // Requests processed
+    uint32_t request_rate;      // Requests per second in the last window
+    uint32_t idle_ms;           // Time since the last request
+    uint32_t connected_ms;      // Time since the connection was accepted
+} modbus_server_client_info_t;
+
+/**
+ * @brief Open the listening socket and allocate the client table
+ *
+ * @param config Server settings
+ * @return true on success, false on error or if the server is already open
+ */
+bool modbus_server_open(const modbus_server_config_t *config);
+
+/**
+ * @brief Run one event loop iteration
+ *
+ * Waits for socket events at most timeout_ms, then serves the clients,
+ * closes idle ones and updates the request rates. Must be called from one
+ * task only.
+ *
+ * @param timeout_ms Longest wait for events
+ * @return true to continue, false on a fatal error
+ */
+bool modbus_server_poll(uint32_t timeout_ms);
+
+/**
+ * @brief Close all connections and the listening socket
+ */
+void modbus_server_close(void);
+
+/**
+ * @brief Get the server statistics, any task
+ *
+ * @param stats Filled with the last published statistics
+ * @return true on success, false if the server is not open
+ */
+bool modbus_server_get_stats(modbus_server_stats_t *stats);
+
+/**
+ * @brief Get the statistics of the connected clients, any task
+ *
+ * @param clients Buffer for the client statistics
+ * @param max Number of entries in clients
+ * @return Number of clients written
+ */
+size_t modbus_server_get_clients(modbus_server_client_info_t *clients, size_t max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MODBUS_SERVER_H
@@ -1,27 +1,30 @@
 #include "modbus_protocol.h"
 #include "modbus_register_map.h"
 #include "esp_log.h"
-#include "lwip/sockets.h"
 #include <string.h>
-#include <errno.h>
 
 static const char *TAG = "modbus_protocol";
 
-// ModbusTCP ADU structure
-typedef struct {
-    uint16_t transaction_id;
-    uint16_t protocol_id;      // Always 0 for Modbus
-    uint16_t length;           // Length of unit identifier + PDU
-    uint8_t unit_id;           // Slave address
-    uint8_t function_code;
-    uint8_t data[256];         // PDU data
-} modbus_tcp_adu_t;
-
 // Modbus function codes
+#define MODBUS_FC_READ_COILS               0x01
+#define MODBUS_FC_READ_DISCRETE_INPUTS     0x02
 #define MODBUS_FC_READ_HOLDING_REGISTERS   0x03
 #define MODBUS_FC_READ_INPUT_REGISTERS     0x04
+#define MODBUS_FC_WRITE_SINGLE_COIL        0x05
 #define MODBUS_FC_WRITE_SINGLE_REGISTER    0x06
+#define MODBUS_FC_WRITE_MULTIPLE_COILS     0x0F
 #define MODBUS_FC_WRITE_MULTIPLE_REGISTERS 0x10
+#define MODBUS_FC_READ_WRITE_REGISTERS     0x17
+#define MODBUS_FC_ENCAPSULATED_INTERFACE   0x2B
+
+// Encapsulated interface transport: Read Device Identification
+#define MODBUS_MEI_READ_DEVICE_ID          0x0E
+#define MODBUS_READ_DEVICE_ID_BASIC        0x01
+#define MODBUS_READ_DEVICE_ID_REGULAR      0x02
+#define MODBUS_READ_DEVICE_ID_EXTENDED     0x03
+#define MODBUS_READ_DEVICE_ID_INDIVIDUAL   0x04
+#define MODBUS_DEVICE_ID_CONFORMITY        0x82 // regular, stream and individual access
+#define MODBUS_DEVICE_ID_LAST_OBJECT       0x06 // last regular object
 
 // Exception codes
 #define MODBUS_EX_ILLEGAL_FUNCTION          0x01
@@ -29,310 +32,407 @@ typedef struct {
 #define MODBUS_EX_ILLEGAL_DATA_VALUE        0x03
 #define MODBUS_EX_SLAVE_DEVICE_FAILURE      0x04
 
+// The handlers get the request data after the function code and write the
+// response PDU, function code first, returning its length
+
+static size_t exception_response(uint8_t *response, uint8_t function_code, uint8_t exception_code)
+{
+    response[0] = function_code | 0x80; // Exception flag
+    response[1] = exception_code;
+    return 2;
+}
 
-static void send_exception(int client_socket, uint16_t transaction_id, uint8_t unit_id, 
-                          uint8_t function_code, uint8_t exception_code)
+// FC 01 and 02 share the request and response layout
+static size_t handle_read_bits(uint8_t function_code, const uint8_t *pdu, size_t pdu_len, uint8_t *response)
 {
-    uint8_t response[9];
-    response[0] = (transaction_id >> 8) & 0xFF;
-    response[1] = transaction_id & 0xFF;
-    response[2] = 0x00; // Protocol ID
-    response[3] = 0x00;
-    response[4] = 0x00; // Length
-    response[5] = 0x03;
-    response[6] = unit_id;
-    response[7] = function_code | 0x80; // Exception flag
-    response[8] = exception_code;
-    
-    send(client_socket, response, sizeof(response), 0);
+    // Read Coils / Discrete Inputs requires: start_addr (2 bytes) + quantity (2 bytes) = 4 bytes
+    if (pdu_len < 4) {
+        return exception_response(response, function_code, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+
+    uint16_t start_addr = (pdu[0] << 8) | pdu[1];
+    uint16_t quantity = (pdu[2] << 8) | pdu[3];
+
+    // Validate quantity (Modbus spec: 1-2000 bits, 250 bytes)
+    if (quantity == 0 || quantity > 2000) {
+        return exception_response(response, function_code, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+
+    uint8_t byte_count = (quantity + 7) / 8;
+    response[0] = function_code;
+    response[1] = byte_count;
+
+    bool ok = function_code == MODBUS_FC_READ_COILS
+                  ? modbus_read_coils(start_addr, quantity, &response[2])
+                  : modbus_read_discrete_inputs(start_addr, quantity, &response[2]);
+    if (!ok) {
+        return exception_response(response, function_code, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+    }
+    return 2 + byte_count;
 }
 
-static bool handle_read_holding_registers(int client_socket, uint16_t transaction_id, 
-                                         uint8_t unit_id, const uint8_t *pdu, int pdu_len)
+static size_t handle_read_holding_registers(const uint8_t *pdu, size_t pdu_len, uint8_t *response)
 {
     // Read Holding Registers requires: start_addr (2 bytes) + quantity (2 bytes) = 4 bytes
     if (pdu_len < 4) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_VALUE);
-        return true;
+        return exception_response(response, MODBUS_FC_READ_HOLDING_REGISTERS, MODBUS_EX_ILLEGAL_DATA_VALUE);
     }
-    
+
     uint16_t start_addr = (pdu[0] << 8) | pdu[1];
     uint16_t quantity = (pdu[2] << 8) | pdu[3];
-    
-    // Validate quantity (Modbus spec: 1-125 registers)
+
+    // Validate quantity (Modbus spec: 1-125 registers, 250 bytes)
     if (quantity == 0 || quantity > 125) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_VALUE);
-        return true;
-    }
-    
-    // Check response buffer size
-    size_t response_data_size = quantity * 2;
-    if (response_data_size > 250) { // Max 125 registers * 2 bytes = 250 bytes
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_VALUE);
-        return true;
-    }
-    
-    uint8_t response[256];
-    int response_len = 9 + response_data_size;
-    response[0] = (transaction_id >> 8) & 0xFF;
-    response[1] = transaction_id & 0xFF;
-    response[2] = 0x00; // Protocol ID
-    response[3] = 0x00;
-    response[4] = ((response_len - 6) >> 8) & 0xFF; // Length
-    response[5] = (response_len - 6) & 0xFF;
-    response[6] = unit_id;
-    response[7] = MODBUS_FC_READ_HOLDING_REGISTERS;
-    response[8] = response_data_size; // Byte count
-    
+        return exception_response(response, MODBUS_FC_READ_HOLDING_REGISTERS, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+
+    response[0] = MODBUS_FC_READ_HOLDING_REGISTERS;
+    response[1] = quantity * 2; // Byte count
+
     // Read registers from map
-    if (!modbus_read_holding_registers(start_addr, quantity, &response[9])) {
-        ESP_LOGE(TAG, "Failed to read holding registers: start_addr=%d, quantity=%d", 
+    if (!modbus_read_holding_registers(start_addr, quantity, &response[2])) {
+        ESP_LOGE(TAG, "Failed to read holding registers: start_addr=%d, quantity=%d",
                  start_addr, quantity);
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_HOLDING_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_ADDRESS);
-        return true;
+        return exception_response(response, MODBUS_FC_READ_HOLDING_REGISTERS, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
     }
-    
-    int sent = send(client_socket, response, response_len, 0);
-    if (sent != response_len) {
-        ESP_LOGE(TAG, "Failed to send full response: sent %d of %d bytes", sent, response_len);
-    }
-    return true;
+    return 2 + quantity * 2;
 }
 
-static bool handle_read_input_registers(int client_socket, uint16_t transaction_id, 
-                                        uint8_t unit_id, const uint8_t *pdu, int pdu_len)
+static size_t handle_read_input_registers(const uint8_t *pdu, size_t pdu_len, uint8_t *response)
 {
     // Read Input Registers requires: start_addr (2 bytes) + quantity (2 bytes) = 4 bytes
     if (pdu_len < 4) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_VALUE);
-        return true;
+        return exception_response(response, MODBUS_FC_READ_INPUT_REGISTERS, MODBUS_EX_ILLEGAL_DATA_VALUE);
     }
-    
+
     uint16_t start_addr = (pdu[0] << 8) | pdu[1];
     uint16_t quantity = (pdu[2] << 8) | pdu[3];
-    
-    // Validate quantity (Modbus spec: 1-125 registers)
+
+    // Validate quantity (Modbus spec: 1-125 registers, 250 bytes)
     if (quantity == 0 || quantity > 125) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_VALUE);
-        return true;
-    }
-    
-    // Check response buffer size
-    size_t response_data_size = quantity * 2;
-    if (response_data_size > 250) { // Max 125 registers * 2 bytes = 250 bytes
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_VALUE);
-        return true;
-    }
-    
-    uint8_t response[256];
-    int response_len = 9 + response_data_size;
-    response[0] = (transaction_id >> 8) & 0xFF;
-    response[1] = transaction_id & 0xFF;
-    response[2] = 0x00; // Protocol ID
-    response[3] = 0x00;
-    response[4] = ((response_len - 6) >> 8) & 0xFF; // Length
-    response[5] = (response_len - 6) & 0xFF;
-    response[6] = unit_id;
-    response[7] = MODBUS_FC_READ_INPUT_REGISTERS;
-    response[8] = response_data_size; // Byte count
-    
+        return exception_response(response, MODBUS_FC_READ_INPUT_REGISTERS, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+
+    response[0] = MODBUS_FC_READ_INPUT_REGISTERS;
+    response[1] = quantity * 2; // Byte count
+
     // Read registers from map
-    if (!modbus_read_input_registers(start_addr, quantity, &response[9])) {
-        ESP_LOGE(TAG, "Failed to read input registers: start_addr=%d, quantity=%d", 
+    if (!modbus_read_input_registers(start_addr, quantity, &response[2])) {
+        ESP_LOGE(TAG, "Failed to read input registers: start_addr=%d, quantity=%d",
                  start_addr, quantity);
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_READ_INPUT_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_ADDRESS);
-        return true;
+        return exception_response(response, MODBUS_FC_READ_INPUT_REGISTERS, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
     }
-    
-    int sent = send(client_socket, response, response_len, 0);
-    if (sent != response_len) {
-        ESP_LOGE(TAG, "Failed to send full response: sent %d of %d bytes", sent, response_len);
-    }
-    return true;
+    return 2 + quantity * 2;
 }
 
-static bool handle_write_single_register(int client_socket, uint16_t transaction_id, 
-                                         uint8_t unit_id, const uint8_t *pdu, int pdu_len)
+static size_t handle_write_single_register(const uint8_t *pdu, size_t pdu_len, uint8_t *response)
 {
     // Write Single Register requires: address (2 bytes) + value (2 bytes) = 4 bytes
     if (pdu_len < 4) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_WRITE_SINGLE_REGISTER, 
-                      MODBUS_EX_ILLEGAL_DATA_VALUE);
-        return true;
+        return exception_response(response, MODBUS_FC_WRITE_SINGLE_REGISTER, MODBUS_EX_ILLEGAL_DATA_VALUE);
     }
-    
+
     uint16_t address = (pdu[0] << 8) | pdu[1];
     uint16_t value = (pdu[2] << 8) | pdu[3];
-    
+
     // Write register to map
     if (!modbus_write_holding_register(address, value)) {
         ESP_LOGE(TAG, "Failed to write holding register: address=%d, value=%d", address, value);
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_WRITE_SINGLE_REGISTER, 
-                      MODBUS_EX_ILLEGAL_DATA_ADDRESS);
-        return true;
+        return exception_response(response, MODBUS_FC_WRITE_SINGLE_REGISTER, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+    }
+
+    // Echo back the request
+    response[0] = MODBUS_FC_WRITE_SINGLE_REGISTER;
+    memcpy(&response[1], pdu, 4);
+    return 5;
+}
+
+static size_t handle_write_single_coil(const uint8_t *pdu, size_t pdu_len, uint8_t *response)
+{
+    // Write Single Coil requires: address (2 bytes) + value (2 bytes) = 4 bytes
+    if (pdu_len < 4) {
+        return exception_response(response, MODBUS_FC_WRITE_SINGLE_COIL, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+
+    uint16_t address = (pdu[0] << 8) | pdu[1];
+    uint16_t value = (pdu[2] << 8) | pdu[3];
+
+    // Only 0xFF00 (on) and 0x0000 (off) are valid
+    if (value != 0xFF00 && value != 0x0000) {
+        return exception_response(response, MODBUS_FC_WRITE_SINGLE_COIL, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+
+    if (!modbus_write_coil(address, value == 0xFF00)) {
+        return exception_response(response, MODBUS_FC_WRITE_SINGLE_COIL, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
     }
-    
+
     // Echo back the request
-    uint8_t response[12];
-    response[0] = (transaction_id >> 8) & 0xFF;
-    response[1] = transaction_id & 0xFF;
-    response[2] = 0x00; // Protocol ID
-    response[3] = 0x00;
-    response[4] = 0x00; // Length
-    response[5] = 0x06;
-    response[6] = unit_id;
-    response[7] = MODBUS_FC_WRITE_SINGLE_REGISTER;
-    response[8] = (address >> 8) & 0xFF;
-    response[9] = address & 0xFF;
-    response[10] = (value >> 8) & 0xFF;
-    response[11] = value & 0xFF;
-    
-    int sent = send(client_socket, response, sizeof(response), 0);
-    if (sent != sizeof(response)) {
-        ESP_LOGE(TAG, "Failed to send write response: sent %d of %d bytes", sent, sizeof(response));
-    }
-    return true;
+    response[0] = MODBUS_FC_WRITE_SINGLE_COIL;
+    memcpy(&response[1], pdu, 4);
+    return 5;
 }
 
-static bool handle_write_multiple_registers(int client_socket, uint16_t transaction_id, 
-                                           uint8_t unit_id, const uint8_t *pdu, int pdu_len)
+static size_t handle_write_multiple_coils(const uint8_t *pdu, size_t pdu_len, uint8_t *response)
+{
+    // Write Multiple Coils requires: start_addr (2) + quantity (2) + byte_count (1) + data (N) = at least 6 bytes
+    if (pdu_len < 6) {
+        return exception_response(response, MODBUS_FC_WRITE_MULTIPLE_COILS, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+
+    uint16_t start_addr = (pdu[0] << 8) | pdu[1];
+    uint16_t quantity = (pdu[2] << 8) | pdu[3];
+    uint8_t byte_count = pdu[4];
+
+    // Validate parameters (Modbus spec: 1-1968 coils)
+    if (quantity == 0 || quantity > 1968 || byte_count != (quantity + 7) / 8 || pdu_len < 5 + (size_t)byte_count) {
+        return exception_response(response, MODBUS_FC_WRITE_MULTIPLE_COILS, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+
+    if (!modbus_write_coils(start_addr, quantity, &pdu[5])) {
+        return exception_response(response, MODBUS_FC_WRITE_MULTIPLE_COILS, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+    }
+
+    // Response: start address and quantity
+    response[0] = MODBUS_FC_WRITE_MULTIPLE_COILS;
+    memcpy(&response[1], pdu, 4);
+    return 5;
+}
+
+static size_t handle_write_multiple_registers(const uint8_t *pdu, size_t pdu_len, uint8_t *response)
 {
     // Write Multiple Registers requires: start_addr (2) + quantity (2) + byte_count (1) + data (N) = at least 6 bytes
     if (pdu_len < 6) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_VALUE);
-        return true;
+        return exception_response(response, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, MODBUS_EX_ILLEGAL_DATA_VALUE);
     }
-    
+
     uint16_t start_addr = (pdu[0] << 8) | pdu[1];
     uint16_t quantity = (pdu[2] << 8) | pdu[3];
     uint8_t byte_count = pdu[4];
-    
+
     // Validate parameters
-    if (quantity == 0 || quantity > 123 || byte_count != quantity * 2 || pdu_len < 5 + byte_count) {
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_VALUE);
-        return true;
+    if (quantity == 0 || quantity > 123 || byte_count != quantity * 2 || pdu_len < 5 + (size_t)byte_count) {
+        return exception_response(response, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, MODBUS_EX_ILLEGAL_DATA_VALUE);
     }
-    
+
     // Write registers to map
     if (!modbus_write_holding_registers(start_addr, quantity, &pdu[5])) {
         ESP_LOGE(TAG, "Failed to write holding registers: start_addr=%d, quantity=%d", start_addr, quantity);
-        send_exception(client_socket, transaction_id, unit_id, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, 
-                      MODBUS_EX_ILLEGAL_DATA_ADDRESS);
-        return true;
-    }
-    
-    // Response
-    uint8_t response[12];
-    response[0] = (transaction_id >> 8) & 0xFF;
-    response[1] = transaction_id & 0xFF;
-    response[2] = 0x00; // Protocol ID
-    response[3] = 0x00;
-    response[4] = 0x00; // Length
-    response[5] = 0x06;
-    response[6] = unit_id;
-    response[7] = MODBUS_FC_WRITE_MULTIPLE_REGISTERS;
-    response[8] = (start_addr >> 8) & 0xFF;
-    response[9] = start_addr & 0xFF;
-    response[10] = (quantity >> 8) & 0xFF;
-    response[11] = quantity & 0xFF;
-    
-    int sent = send(client_socket, response, sizeof(response), 0);
-    if (sent != sizeof(response)) {
-        ESP_LOGE(TAG, "Failed to send write response: sent %d of %d bytes", sent, sizeof(response));
-    }
-    return true;
+        return exception_response(response, MODBUS_FC_WRITE_MULTIPLE_REGISTERS, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+    }
+
+    // Response: start address and quantity
+    response[0] = MODBUS_FC_WRITE_MULTIPLE_REGISTERS;
+    memcpy(&response[1], pdu, 4);
+    return 5;
 }
 
-bool modbus_tcp_handle_request(int client_socket)
+// Writes, then reads, so one transaction exchanges outputs and inputs. The
+// write is done first, returning 0, the read once the write has been applied.
+static size_t handle_read_write_registers(const uint8_t *pdu, size_t pdu_len, uint8_t *response, bool write)
 {
-    uint8_t mbap_header[6];
-    
-    // Read MBAP header (6 bytes)
-    int received = recv(client_socket, mbap_header, sizeof(mbap_header), 0);
-    
-    if (received <= 0) {
-        if (received == 0 || errno == ECONNRESET) {
-            return false; // Connection closed
+    // Read/Write Multiple Registers requires: read start (2) + read quantity (2) + write start (2) +
+    // write quantity (2) + byte_count (1) + data (N) = at least 11 bytes
+    if (pdu_len < 11) {
+        return exception_response(response, MODBUS_FC_READ_WRITE_REGISTERS, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+
+    uint16_t read_addr = (pdu[0] << 8) | pdu[1];
+    uint16_t read_quantity = (pdu[2] << 8) | pdu[3];
+    uint16_t write_addr = (pdu[4] << 8) | pdu[5];
+    uint16_t write_quantity = (pdu[6] << 8) | pdu[7];
+    uint8_t byte_count = pdu[8];
+
+    // Validate parameters (Modbus spec: read 1-125, write 1-121 registers)
+    if (read_quantity == 0 || read_quantity > 125 || write_quantity == 0 || write_quantity > 121 ||
+        byte_count != write_quantity * 2 || pdu_len < 9 + (size_t)byte_count) {
+        return exception_response(response, MODBUS_FC_READ_WRITE_REGISTERS, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+
+    if (write) {
+        if (!modbus_write_holding_registers(write_addr, write_quantity, &pdu[9])) {
+            ESP_LOGE(TAG, "Failed to write holding registers: start_addr=%d, quantity=%d", write_addr, write_quantity);
+            return exception_response(response, MODBUS_FC_READ_WRITE_REGISTERS, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
         }
-        return true; // Try again
-    }
-    
-    if (received < 6) {
-        return true; // Wait for more data
-    }
-    
-    uint16_t transaction_id = (mbap_header[0] << 8) | mbap_header[1];
-    uint16_t protocol_id = (mbap_header[2] << 8) | mbap_header[3];
-    uint16_t length = (mbap_header[4] << 8) | mbap_header[5];
-    
-    if (protocol_id != 0 || length < 2 || length > 253) {
-        return false;
-    }
-    
-    // Read PDU (unit_id + function_code + data)
-    // MBAP length field includes unit_id byte, so PDU is length bytes total
-    uint8_t pdu[256];
-    if (length > sizeof(pdu)) {
-        return false;
-    }
-    
-    // Read the full PDU - may need multiple recv calls for large PDUs
-    size_t total_received = 0;
-    while (total_received < length) {
-        received = recv(client_socket, pdu + total_received, length - total_received, 0);
-        if (received <= 0) {
-            if (received == 0 || errno == ECONNRESET) {
-                return false;
-            }
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                // Would block, try again
-                continue;
+        return 0;
+    }
+
+    response[0] = MODBUS_FC_READ_WRITE_REGISTERS;
+    response[1] = read_quantity * 2; // Byte count
+    if (!modbus_read_holding_registers(read_addr, read_quantity, &response[2])) {
+        ESP_LOGE(TAG, "Failed to read holding registers: start_addr=%d, quantity=%d", read_addr, read_quantity);
+        return exception_response(response, MODBUS_FC_READ_WRITE_REGISTERS, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
+    }
+    return 2 + read_quantity * 2;
+}
+
+// FC 43 / MEI 14, stream access of the basic and regular objects and
+// individual access. All objects fit one response.
+static size_t handle_read_device_identification(const uint8_t *pdu, size_t pdu_len, uint8_t *response)
+{
+    // Read Device Identification requires: MEI type (1) + ReadDevId code (1) + object id (1) = 3 bytes
+    if (pdu_len < 3) {
+        return exception_response(response, MODBUS_FC_ENCAPSULATED_INTERFACE, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+    if (pdu[0] != MODBUS_MEI_READ_DEVICE_ID) {
+        return exception_response(response, MODBUS_FC_ENCAPSULATED_INTERFACE, MODBUS_EX_ILLEGAL_FUNCTION);
+    }
+
+    uint8_t code = pdu[1];
+    uint8_t object_id = pdu[2];
+    uint8_t last_object;
+    switch (code) {
+        case MODBUS_READ_DEVICE_ID_BASIC:
+            last_object = 0x02;
+            break;
+        case MODBUS_READ_DEVICE_ID_REGULAR:
+        case MODBUS_READ_DEVICE_ID_EXTENDED: // no extended objects, the regular ones are returned
+            last_object = MODBUS_DEVICE_ID_LAST_OBJECT;
+            break;
+        case MODBUS_READ_DEVICE_ID_INDIVIDUAL:
+            if (modbus_get_device_identification(object_id) == NULL) {
+                return exception_response(response, MODBUS_FC_ENCAPSULATED_INTERFACE, MODBUS_EX_ILLEGAL_DATA_ADDRESS);
             }
-            ESP_LOGE(TAG, "Error reading PDU: %s", strerror(errno));
-            return false;
+            last_object = object_id;
+            break;
+        default:
+            return exception_response(response, MODBUS_FC_ENCAPSULATED_INTERFACE, MODBUS_EX_ILLEGAL_DATA_VALUE);
+    }
+    // Stream access restarts at the first object for an object it does not have
+    if (object_id > last_object) {
+        object_id = 0;
+    }
+
+    response[0] = MODBUS_FC_ENCAPSULATED_INTERFACE;
+    response[1] = MODBUS_MEI_READ_DEVICE_ID;
+    response[2] = code;
+    response[3] = MODBUS_DEVICE_ID_CONFORMITY;
+    response[4] = 0x00; // More follows: no
+    response[5] = 0x00; // Next object id
+    response[6] = 0;    // Number of objects
+    size_t length = 7;
+    for (uint16_t id = object_id; id <= last_object; id++) {
+        const char *value = modbus_get_device_identification(id);
+        if (value == NULL) {
+            continue;
+        }
+        size_t value_len = strlen(value);
+        if (value_len > MODBUS_TCP_MAX_PDU_SIZE - length - 2) {
+            value_len = MODBUS_TCP_MAX_PDU_SIZE - length - 2;
         }
-        total_received += received;
-    }
-    
-    if (total_received != length || length < 2) {
-        return false;
-    }
-    
-    uint8_t unit_id = pdu[0];
-    uint8_t function_code = pdu[1];
-    const uint8_t *pdu_data = &pdu[2];
-    int pdu_data_len = length - 2; // Data portion after unit_id and function_code
-    
-    bool result = true;
+        response[length++] = id;
+        response[length++] = value_len;
+        memcpy(&response[length], value, value_len);
+        length += value_len;
+        response[6]++;
+    }
+    return length;
+}
+
+int modbus_tcp_frame_length(const uint8_t *data, size_t length)
+{
+    // MBAP header up to the length field
+    if (length < 6) {
+        return 0;
+    }
+
+    uint16_t protocol_id = (data[2] << 8) | data[3];
+    uint16_t mbap_length = (data[4] << 8) | data[5]; // unit_id + PDU
+
+    if (protocol_id != 0 || mbap_length < 2 || mbap_length > MODBUS_TCP_MAX_PDU_SIZE + 1) {
+        return -1;
+    }
+    if (length < 6 + (size_t)mbap_length) {
+        return 0;
+    }
+    return 6 + mbap_length;
+}
+
+modbus_tcp_request_kind_t modbus_tcp_request_kind(const uint8_t *request, size_t request_length)
+{
+    (void)request_length;
+    switch (request[7]) {
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+        case MODBUS_FC_WRITE_SINGLE_REGISTER:
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+        case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
+            return MODBUS_TCP_REQUEST_WRITE;
+        case MODBUS_FC_READ_WRITE_REGISTERS:
+            return MODBUS_TCP_REQUEST_WRITE_READ;
+        default:
+            return MODBUS_TCP_REQUEST_READ;
+    }
+}
+
+// MBAP header: transaction id and unit id echoed, length covers unit_id + PDU
+static size_t finish_response(const uint8_t *request, uint8_t *response, size_t response_pdu_len)
+{
+    memcpy(response, request, 4);
+    response[4] = ((response_pdu_len + 1) >> 8) & 0xFF;
+    response[5] = (response_pdu_len + 1) & 0xFF;
+    response[6] = request[6];
+    return MODBUS_TCP_MBAP_SIZE + response_pdu_len;
+}
+
+size_t modbus_tcp_process_write(const uint8_t *request, size_t request_length, uint8_t *response)
+{
+    size_t response_pdu_len = handle_read_write_registers(&request[MODBUS_TCP_MBAP_SIZE + 1],
+                                                          request_length - MODBUS_TCP_MBAP_SIZE - 1,
+                                                          &response[MODBUS_TCP_MBAP_SIZE], true);
+    return response_pdu_len > 0 ? finish_response(request, response, response_pdu_len) : 0;
+}
+
+size_t modbus_tcp_process_read(const uint8_t *request, size_t request_length, uint8_t *response)
+{
+    size_t response_pdu_len = handle_read_write_registers(&request[MODBUS_TCP_MBAP_SIZE + 1],
+                                                          request_length - MODBUS_TCP_MBAP_SIZE - 1,
+                                                          &response[MODBUS_TCP_MBAP_SIZE], false);
+    return finish_response(request, response, response_pdu_len);
+}
+
+size_t modbus_tcp_process_request(const uint8_t *request, size_t request_length, uint8_t *response)
+{
+    const uint8_t function_code = request[7];
+    const uint8_t *pdu_data = &request[MODBUS_TCP_MBAP_SIZE + 1];
+    size_t pdu_data_len = request_length - MODBUS_TCP_MBAP_SIZE - 1; // Data after unit_id and function_code
+    uint8_t *response_pdu = &response[MODBUS_TCP_MBAP_SIZE];
+    size_t response_pdu_len;
+
     switch (function_code) {
+        case MODBUS_FC_READ_COILS:
+        case MODBUS_FC_READ_DISCRETE_INPUTS:
+            response_pdu_len = handle_read_bits(function_code, pdu_data, pdu_data_len, response_pdu);
+            break;
         case MODBUS_FC_READ_HOLDING_REGISTERS:
-            result = handle_read_holding_registers(client_socket, transaction_id, unit_id, pdu_data, pdu_data_len);
+            response_pdu_len = handle_read_holding_registers(pdu_data, pdu_data_len, response_pdu);
             break;
         case MODBUS_FC_READ_INPUT_REGISTERS:
-            result = handle_read_input_registers(client_socket, transaction_id, unit_id, pdu_data, pdu_data_len);
+            response_pdu_len = handle_read_input_registers(pdu_data, pdu_data_len, response_pdu);
             break;
         case MODBUS_FC_WRITE_SINGLE_REGISTER:
-            result = handle_write_single_register(client_socket, transaction_id, unit_id, pdu_data, pdu_data_len);
+            response_pdu_len = handle_write_single_register(pdu_data, pdu_data_len, response_pdu);
+            break;
+        case MODBUS_FC_WRITE_SINGLE_COIL:
+            response_pdu_len = handle_write_single_coil(pdu_data, pdu_data_len, response_pdu);
+            break;
+        case MODBUS_FC_WRITE_MULTIPLE_COILS:
+            response_pdu_len = handle_write_multiple_coils(pdu_data, pdu_data_len, response_pdu);
             break;
         case MODBUS_FC_WRITE_MULTIPLE_REGISTERS:
-            result = handle_write_multiple_registers(client_socket, transaction_id, unit_id, pdu_data, pdu_data_len);
+            response_pdu_len = handle_write_multiple_registers(pdu_data, pdu_data_len, response_pdu);
+            break;
+        case MODBUS_FC_READ_WRITE_REGISTERS:
+            response_pdu_len = handle_read_write_registers(pdu_data, pdu_data_len, response_pdu, true);
+            if (response_pdu_len == 0) {
+                response_pdu_len = handle_read_write_registers(pdu_data, pdu_data_len, response_pdu, false);
+            }
+            break;
+        case MODBUS_FC_ENCAPSULATED_INTERFACE:
+            response_pdu_len = handle_read_device_identification(pdu_data, pdu_data_len, response_pdu);
             break;
         default:
-            send_exception(client_socket, transaction_id, unit_id, function_code, MODBUS_EX_ILLEGAL_FUNCTION);
-            result = true;
+            response_pdu_len = exception_response(response_pdu, function_code, MODBUS_EX_ILLEGAL_FUNCTION);
             break;
     }
-    
-    return result;
-}
 
+    return finish_response(request, response, response_pdu_len);
+}
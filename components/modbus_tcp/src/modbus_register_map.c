@@ -1,232 +1,619 @@
 #include "modbus_register_map.h"
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/semphr.h"
+#include "nvs_flash.h"
+#include "nvs.h"
+#include <pthread.h>
+#include <stdatomic.h>
 #include <string.h>
+#include <unistd.h>
 
-// Forward declarations for assembly buffers
-extern uint8_t g_assembly_data064[32];  // Input Assembly 100
-extern uint8_t g_assembly_data096[32];  // Output Assembly 150
-extern uint8_t g_assembly_data097[10];  // Config Assembly 151
+// Forward declarations for assembly access (provided by the OpENer sample application)
+extern uint16_t sample_application_get_assembly_size(uint32_t instance);
+extern bool sample_application_read_assembly(uint32_t instance, uint16_t offset,
+                                             uint8_t *data, uint16_t length);
+extern bool sample_application_write_assembly(uint32_t instance, uint16_t offset,
+                                              const uint8_t *data, uint16_t length);
+extern bool sample_application_assembly_write_pending(uint32_t instance);
 
-// Forward declaration for shared assembly mutex
-extern SemaphoreHandle_t sample_application_get_assembly_mutex(void);
+#define INPUT_ASSEMBLY_NUM     100
+#define OUTPUT_ASSEMBLY_NUM    150
+#define CONFIG_ASSEMBLY_NUM    151
+
+// Largest assembly span one mapping access copies, a full request PDU
+#define MAX_ACCESS_BYTES       256
 
 static const char *TAG = "modbus_regmap";
+static const char *NVS_NAMESPACE = "modbus";
+static const char *NVS_KEY_REGISTER_MAP = "regmap";
+
+// Default mapping table, the registers and bits of the sample application
+// assemblies. Input registers 200-201 also give the 32-bit sample timestamp of
+// Input Assembly 100 (bytes 28-31) as one value.
+#ifndef MODBUS_REGISTER_MAP_DEFAULT
+#define MODBUS_REGISTER_MAP_DEFAULT                                                                     \
+    { .table = MODBUS_TABLE_INPUT_REGISTERS, .data_type = MODBUS_DATA_UINT16,                           \
+      .start = 0, .count = 16, .assembly = INPUT_ASSEMBLY_NUM, .offset = 0 },                           \
+    { .table = MODBUS_TABLE_INPUT_REGISTERS, .data_type = MODBUS_DATA_UINT32,                           \
+      .word_order = MODBUS_WORD_ORDER_HIGH_FIRST,                                                       \
+      .start = 200, .count = 2, .assembly = INPUT_ASSEMBLY_NUM, .offset = 28 },                         \
+    { .table = MODBUS_TABLE_HOLDING_REGISTERS, .data_type = MODBUS_DATA_UINT16,                         \
+      .start = 100, .count = 16, .assembly = OUTPUT_ASSEMBLY_NUM, .offset = 0 },                        \
+    { .table = MODBUS_TABLE_HOLDING_REGISTERS, .data_type = MODBUS_DATA_UINT16,                         \
+      .start = 150, .count = 5, .assembly = CONFIG_ASSEMBLY_NUM, .offset = 0 },                         \
+    { .table = MODBUS_TABLE_COILS, .start = 0, .count = 256, .assembly = OUTPUT_ASSEMBLY_NUM, .offset = 0 }, \
+    { .table = MODBUS_TABLE_DISCRETE_INPUTS, .start = 0, .count = 256, .assembly = INPUT_ASSEMBLY_NUM, .offset = 0 }
+#endif
+
+// Read Device Identification objects, the same identity as the EtherNet/IP
+// Identity object (devicedata.h)
+#ifndef MODBUS_DEVICE_VENDOR_NAME
+#define MODBUS_DEVICE_VENDOR_NAME     "ESP32P4-EIP"
+#endif
+#ifndef MODBUS_DEVICE_PRODUCT_CODE
+#define MODBUS_DEVICE_PRODUCT_CODE    "1"
+#endif
+#ifndef MODBUS_DEVICE_REVISION
+#define MODBUS_DEVICE_REVISION        "1.0"
+#endif
+#ifndef MODBUS_DEVICE_PRODUCT_NAME
+#define MODBUS_DEVICE_PRODUCT_NAME    "ESP32P4-EIP"
+#endif
+#ifndef MODBUS_DEVICE_MODEL_NAME
+#define MODBUS_DEVICE_MODEL_NAME      "ESP32-P4 VL53L1X"
+#endif
+
+typedef struct {
+    modbus_register_mapping_t entries[MODBUS_REGISTER_MAP_MAX_ENTRIES];
+    size_t count;
+    atomic_uint readers;    // Requests using the table, see map_acquire()
+} register_map_t;
+
+#define DEFAULT_ENTRY_COUNT \
+    (sizeof((modbus_register_mapping_t[]){ MODBUS_REGISTER_MAP_DEFAULT }) / sizeof(modbus_register_mapping_t))
+
+_Static_assert(DEFAULT_ENTRY_COUNT <= MODBUS_REGISTER_MAP_MAX_ENTRIES, "Default register map has too many entries");
+
+static register_map_t s_default_map = {
+    .entries = { MODBUS_REGISTER_MAP_DEFAULT },
+    .count = DEFAULT_ENTRY_COUNT,
+};
 
-// Register address ranges
-#define INPUT_REG_START        0
-#define INPUT_REG_END          15
-#define HOLDING_REG_OUTPUT_START 100
-#define HOLDING_REG_OUTPUT_END   115
-#define HOLDING_REG_CONFIG_START  150
-#define HOLDING_REG_CONFIG_END    154
+// Configured tables are built in the one not in use and then published, so
+// requests never take a lock. Requests count themselves as readers of the
+// table they use, a configuration waits for the readers of the table it
+// reuses to finish.
+static register_map_t s_configured_maps[2];
+static _Atomic(register_map_t *) s_active_map = &s_default_map;
+static pthread_mutex_t s_configure_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static uint16_t bytes_to_big_endian_uint16(const uint8_t *bytes)
+// Period of the check for readers of a table to reuse
+#define MAP_READERS_POLL_US    1000
+
+// Pins the active table until map_release(). A table that stopped being the
+// active one before the reader was counted is left again.
+static const register_map_t *map_acquire(void)
 {
-    return (bytes[0] << 8) | bytes[1];
+    register_map_t *map = atomic_load(&s_active_map);
+    while (true) {
+        atomic_fetch_add(&map->readers, 1);
+        register_map_t *active = atomic_load(&s_active_map);
+        if (active == map) {
+            return map;
+        }
+        atomic_fetch_sub(&map->readers, 1);
+        map = active;
+    }
 }
 
-static void uint16_to_big_endian_bytes(uint16_t value, uint8_t *bytes)
+static void map_release(const register_map_t *map)
 {
-    bytes[0] = (value >> 8) & 0xFF;
-    bytes[1] = value & 0xFF;
+    atomic_fetch_sub(&((register_map_t *)map)->readers, 1);
 }
 
-static uint16_t big_endian_to_little_endian(uint16_t be_value)
+// Assemblies written by requests and not yet seen without pending writes,
+// only touched by the Modbus task. A mapping table references at most
+// MODBUS_REGISTER_MAP_MAX_ENTRIES assemblies.
+static uint32_t s_written_assemblies[MODBUS_REGISTER_MAP_MAX_ENTRIES];
+static size_t s_written_count;
+
+static bool is_register_table(uint8_t table)
 {
-    return ((be_value & 0xFF) << 8) | ((be_value >> 8) & 0xFF);
+    return table == MODBUS_TABLE_INPUT_REGISTERS || table == MODBUS_TABLE_HOLDING_REGISTERS;
 }
 
-static SemaphoreHandle_t get_assembly_mutex(void)
+static bool is_32bit(const modbus_register_mapping_t *mapping)
 {
-    return sample_application_get_assembly_mutex();
+    return is_register_table(mapping->table) && mapping->data_type >= MODBUS_DATA_UINT32;
 }
 
-bool modbus_read_input_registers(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+bool modbus_register_map_validate(const modbus_register_mapping_t *entries, size_t count)
 {
-    // Check bounds: start_addr must be within range and quantity must not overflow
-    if (start_addr > INPUT_REG_END || quantity == 0 || start_addr + quantity > INPUT_REG_END + 1) {
-        ESP_LOGE(TAG, "Invalid input register range: %d-%d", start_addr, start_addr + quantity - 1);
+    if (entries == NULL || count == 0 || count > MODBUS_REGISTER_MAP_MAX_ENTRIES) {
+        ESP_LOGE(TAG, "Invalid register map size: %u", (unsigned)count);
         return false;
     }
+    for (size_t i = 0; i < count; i++) {
+        const modbus_register_mapping_t *mapping = &entries[i];
+        // Assembly bytes behind the mapping, must not wrap the 16 bit offset
+        const uint32_t bytes = is_register_table(mapping->table) ? (uint32_t)mapping->count * 2
+                                                                 : ((uint32_t)mapping->count + 7) / 8;
+        if (mapping->table >= MODBUS_TABLE_COUNT || mapping->data_type >= MODBUS_DATA_TYPE_COUNT ||
+            mapping->word_order >= MODBUS_WORD_ORDER_COUNT || mapping->count == 0 ||
+            (uint32_t)mapping->start + mapping->count > 0x10000 ||
+            (uint32_t)mapping->offset + bytes > 0xFFFF ||
+            (is_32bit(mapping) && (mapping->count & 1))) {
+            ESP_LOGE(TAG, "Invalid register map entry %u", (unsigned)i);
+            return false;
+        }
+        for (size_t j = 0; j < i; j++) {
+            const modbus_register_mapping_t *other = &entries[j];
+            if (other->table == mapping->table &&
+                mapping->start < other->start + other->count &&
+                other->start < mapping->start + mapping->count) {
+                ESP_LOGE(TAG, "Register map entries %u and %u overlap", (unsigned)j, (unsigned)i);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool modbus_register_map_configure(const modbus_register_mapping_t *entries, size_t count)
+{
+    if (entries != NULL && !modbus_register_map_validate(entries, count)) {
+        return false;
+    }
+
+    pthread_mutex_lock(&s_configure_mutex);
+    register_map_t *map = &s_default_map;
+    if (entries != NULL) {
+        map = atomic_load(&s_active_map) == &s_configured_maps[0] ? &s_configured_maps[1] : &s_configured_maps[0];
+        // Requests that pinned the table before it was replaced finish first
+        while (atomic_load(&map->readers) != 0) {
+            usleep(MAP_READERS_POLL_US);
+        }
+        memcpy(map->entries, entries, count * sizeof(entries[0]));
+        map->count = count;
+    }
+    atomic_store(&s_active_map, map);
+    pthread_mutex_unlock(&s_configure_mutex);
+    if (entries != NULL) {
+        ESP_LOGI(TAG, "Register map with %u entries applied", (unsigned)count);
+    }
+    return true;
+}
+
+size_t modbus_register_map_get(modbus_register_mapping_t *entries)
+{
+    const register_map_t *map = map_acquire();
+    size_t count = map->count;
+    memcpy(entries, map->entries, count * sizeof(entries[0]));
+    map_release(map);
+    return count;
+}
+
+bool modbus_register_map_load(void)
+{
+    if (!modbus_register_map_validate(s_default_map.entries, s_default_map.count)) {
+        ESP_LOGE(TAG, "Default register map is invalid");
+    }
     
-    SemaphoreHandle_t assembly_mutex = get_assembly_mutex();
-    if (assembly_mutex == NULL) {
-        ESP_LOGE(TAG, "Assembly mutex not initialized");
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to open NVS namespace: %s", esp_err_to_name(err));
+        }
+        modbus_register_map_configure(NULL, 0);
         return false;
     }
     
-    xSemaphoreTake(assembly_mutex, portMAX_DELAY);
+    modbus_register_mapping_t entries[MODBUS_REGISTER_MAP_MAX_ENTRIES];
+    size_t required_size = sizeof(entries);
+    err = nvs_get_blob(handle, NVS_KEY_REGISTER_MAP, entries, &required_size);
+    nvs_close(handle);
     
-    // Map Input Assembly 100 (32 bytes = 16 registers) to Modbus Input Registers 0-15
-    // Assembly data is stored as little-endian bytes [low_byte, high_byte]
-    // Modbus requires big-endian bytes [high_byte, low_byte]
-    for (uint16_t i = 0; i < quantity; i++) {
-        uint16_t reg_addr = start_addr + i;
-        uint16_t byte_offset = reg_addr * 2;
-        
-        if (byte_offset + 1 < sizeof(g_assembly_data064)) {
-            // Read little-endian from assembly: [low_byte, high_byte]
-            uint8_t low_byte = g_assembly_data064[byte_offset];
-            uint8_t high_byte = g_assembly_data064[byte_offset + 1];
-            
-            // Write as big-endian for Modbus: [high_byte, low_byte]
-            data[i * 2] = high_byte;
-            data[i * 2 + 1] = low_byte;
-            
-        } else {
-            // Out of range, return zero
-            data[i * 2] = 0;
-            data[i * 2 + 1] = 0;
+    if (err != ESP_OK || required_size % sizeof(entries[0]) != 0 ||
+        !modbus_register_map_configure(entries, required_size / sizeof(entries[0]))) {
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            ESP_LOGW(TAG, "Saved register map not usable, using the default");
         }
+        modbus_register_map_configure(NULL, 0);
+        return false;
     }
-    
-    xSemaphoreGive(assembly_mutex);
     return true;
 }
 
-bool modbus_read_holding_registers(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+bool modbus_register_map_save(const modbus_register_mapping_t *entries, size_t count)
 {
-    // Check if address is in output assembly range (100-115)
-    if (start_addr >= HOLDING_REG_OUTPUT_START && start_addr + quantity <= HOLDING_REG_OUTPUT_END + 1) {
-        SemaphoreHandle_t assembly_mutex = get_assembly_mutex();
-        if (assembly_mutex == NULL) {
-            return false;
+    if (entries != NULL && !modbus_register_map_validate(entries, count)) {
+        return false;
+    }
+    
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open NVS namespace: %s", esp_err_to_name(err));
+        return false;
+    }
+    
+    if (entries == NULL) {
+        err = nvs_erase_key(handle, NVS_KEY_REGISTER_MAP);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
         }
-        
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-        
-        // Map Output Assembly 150 (32 bytes = 16 registers) to Modbus Holding Registers 100-115
-        // Assembly data is stored as little-endian bytes [low_byte, high_byte]
-        // Modbus requires big-endian bytes [high_byte, low_byte]
-        uint16_t reg_offset = start_addr - HOLDING_REG_OUTPUT_START;
-        for (uint16_t i = 0; i < quantity; i++) {
-            uint16_t byte_offset = (reg_offset + i) * 2;
-            
-            if (byte_offset + 1 < sizeof(g_assembly_data096)) {
-                // Read little-endian from assembly: [low_byte, high_byte]
-                uint8_t low_byte = g_assembly_data096[byte_offset];
-                uint8_t high_byte = g_assembly_data096[byte_offset + 1];
-                
-                // Write as big-endian for Modbus: [high_byte, low_byte]
-                data[i * 2] = high_byte;
-                data[i * 2 + 1] = low_byte;
-                
-            } else {
-                // Out of range, return zero
-                data[i * 2] = 0;
-                data[i * 2 + 1] = 0;
-            }
+    } else {
+        err = nvs_set_blob(handle, NVS_KEY_REGISTER_MAP, entries, count * sizeof(entries[0]));
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to save register map: %s", esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+// Swaps the bytes of every 16-bit word, two words per step. Converts
+// little-endian assembly words to big-endian registers and back.
+static void swap_words(uint8_t *data, size_t length)
+{
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint32_t value;
+        memcpy(&value, &data[i], sizeof(value));
+        value = ((value & 0x00FF00FFu) << 8) | ((value >> 8) & 0x00FF00FFu);
+        memcpy(&data[i], &value, sizeof(value));
+    }
+    if (i + 2 <= length) {
+        uint8_t low = data[i];
+        data[i] = data[i + 1];
+        data[i + 1] = low;
+    }
+}
+
+// Reverses every 32-bit value, a little-endian assembly value becomes a
+// register pair with the high word first and back
+static void swap_dwords(uint8_t *data, size_t length)
+{
+    for (size_t i = 0; i + 4 <= length; i += 4) {
+        uint32_t value;
+        memcpy(&value, &data[i], sizeof(value));
+        value = __builtin_bswap32(value);
+        memcpy(&data[i], &value, sizeof(value));
+    }
+}
+
+// The conversion is its own inverse, reads and writes use the same one
+static void convert_registers(const modbus_register_mapping_t *mapping, uint8_t *data, size_t length)
+{
+    if (is_32bit(mapping) && mapping->word_order == MODBUS_WORD_ORDER_HIGH_FIRST) {
+        swap_dwords(data, length);
+    } else {
+        swap_words(data, length);
+    }
+}
+
+// Finds the mapping of address and the part of a request of remaining
+// addresses it serves. Fails for unmapped addresses and for a split 32-bit
+// value, the assembly access itself fails for bytes that do not exist.
+static bool next_access(const register_map_t *map, uint8_t table, uint16_t address, uint16_t remaining,
+                        const modbus_register_mapping_t **mapping, uint16_t *count,
+                        uint16_t *first_byte, uint16_t *length)
+{
+    const modbus_register_mapping_t *found = NULL;
+    for (size_t i = 0; i < map->count; i++) {
+        const modbus_register_mapping_t *entry = &map->entries[i];
+        if (entry->table == table && address >= entry->start && address - entry->start < entry->count) {
+            found = entry;
+            break;
         }
-        
-        xSemaphoreGive(assembly_mutex);
-        return true;
+    }
+    if (found == NULL) {
+        return false;
     }
     
-    // Check if address is in config assembly range (150-154)
-    if (start_addr >= HOLDING_REG_CONFIG_START && start_addr + quantity <= HOLDING_REG_CONFIG_END + 1) {
-        SemaphoreHandle_t assembly_mutex = get_assembly_mutex();
-        if (assembly_mutex == NULL) {
+    uint16_t index = address - found->start;
+    uint16_t available = found->count - index;
+    *count = remaining < available ? remaining : available;
+    if (is_32bit(found) && ((index & 1) || (*count & 1))) {
+        return false;
+    }
+    
+    uint32_t byte;
+    if (is_register_table(table)) {
+        byte = (uint32_t)found->offset + (uint32_t)index * 2;
+        *length = *count * 2;
+    } else {
+        byte = (uint32_t)found->offset + index / 8;
+        *length = (index % 8 + *count + 7) / 8;
+    }
+    if (*length > MAX_ACCESS_BYTES || byte + *length > 0xFFFF) {
+        return false;
+    }
+    *first_byte = (uint16_t)byte;
+    *mapping = found;
+    return true;
+}
+
+// Checks a whole request served by several mappings before anything is written
+static bool validate_access(const register_map_t *map, uint8_t table, uint16_t start_addr, uint16_t quantity)
+{
+    if (quantity == 0 || (uint32_t)start_addr + quantity > 0x10000) {
+        return false;
+    }
+    uint16_t done = 0;
+    while (done < quantity) {
+        const modbus_register_mapping_t *mapping;
+        uint16_t count, first_byte, length;
+        if (!next_access(map, table, start_addr + done, quantity - done, &mapping, &count, &first_byte, &length) ||
+            (uint32_t)first_byte + length > sample_application_get_assembly_size(mapping->assembly)) {
             return false;
         }
-        
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-        
-        // Map Config Assembly 151 (10 bytes = 5 registers) to Modbus Holding Registers 150-154
-        // Assembly data is stored as little-endian bytes [low_byte, high_byte]
-        // Modbus requires big-endian bytes [high_byte, low_byte]
-        uint16_t reg_offset = start_addr - HOLDING_REG_CONFIG_START;
-        for (uint16_t i = 0; i < quantity; i++) {
-            uint16_t byte_offset = (reg_offset + i) * 2;
-            
-            if (byte_offset + 1 < sizeof(g_assembly_data097)) {
-                // Read little-endian from assembly: [low_byte, high_byte]
-                uint8_t low_byte = g_assembly_data097[byte_offset];
-                uint8_t high_byte = g_assembly_data097[byte_offset + 1];
-                
-                // Write as big-endian for Modbus: [high_byte, low_byte]
-                data[i * 2] = high_byte;
-                data[i * 2 + 1] = low_byte;
-            } else {
-                // Out of range, return zero
-                data[i * 2] = 0;
-                data[i * 2 + 1] = 0;
-            }
+        done += count;
+    }
+    return true;
+}
+
+// Reads the assembly bytes straight into the response and converts them
+// there, one lock-free assembly read per mapping
+static bool read_registers_in(const register_map_t *map, uint8_t table, uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    if (quantity == 0 || (uint32_t)start_addr + quantity > 0x10000) {
+        return false;
+    }
+    uint16_t done = 0;
+    while (done < quantity) {
+        const modbus_register_mapping_t *mapping;
+        uint16_t count, first_byte, length;
+        if (!next_access(map, table, start_addr + done, quantity - done, &mapping, &count, &first_byte, &length) ||
+            !sample_application_read_assembly(mapping->assembly, first_byte, &data[done * 2], length)) {
+            return false;
         }
-        
-        xSemaphoreGive(assembly_mutex);
-        return true;
+        convert_registers(mapping, &data[done * 2], length);
+        done += count;
+    }
+    return true;
+}
+
+// Writes are queued for the OpENer thread, remember the assembly for
+// modbus_register_map_writes_pending()
+static bool write_assembly(uint32_t assembly, uint16_t offset, const uint8_t *data, uint16_t length)
+{
+    if (!sample_application_write_assembly(assembly, offset, data, length)) {
+        return false;
+    }
+    for (size_t i = 0; i < s_written_count; i++) {
+        if (s_written_assemblies[i] == assembly) {
+            return true;
+        }
+    }
+    if (s_written_count < MODBUS_REGISTER_MAP_MAX_ENTRIES) {
+        s_written_assemblies[s_written_count++] = assembly;
+    }
+    return true;
+}
+
+bool modbus_register_map_writes_pending(void)
+{
+    while (s_written_count > 0) {
+        if (sample_application_assembly_write_pending(s_written_assemblies[s_written_count - 1])) {
+            return true;
+        }
+        s_written_count--;
     }
-    
-        ESP_LOGE(TAG, "Invalid holding register range: %d-%d", start_addr, start_addr + quantity - 1);
     return false;
 }
 
-bool modbus_write_holding_register(uint16_t address, uint16_t value)
+static bool write_registers_in(const register_map_t *map, uint8_t table, uint16_t start_addr, uint16_t quantity, const uint8_t *data)
 {
-    uint8_t data[2];
-    uint16_to_big_endian_bytes(value, data);
-    return modbus_write_holding_registers(address, 1, data);
+    if (quantity == 0 || (uint32_t)start_addr + quantity > 0x10000) {
+        return false;
+    }
+    uint16_t done = 0;
+    while (done < quantity) {
+        const modbus_register_mapping_t *mapping;
+        uint16_t count, first_byte, length;
+        uint8_t assembly_bytes[MAX_ACCESS_BYTES];
+        if (!next_access(map, table, start_addr + done, quantity - done, &mapping, &count, &first_byte, &length)) {
+            return false;
+        }
+        // A request spanning mappings is checked as a whole before the first write
+        if (done == 0 && count < quantity && !validate_access(map, table, start_addr, quantity)) {
+            return false;
+        }
+        memcpy(assembly_bytes, &data[done * 2], length);
+        convert_registers(mapping, assembly_bytes, length);
+        if (!write_assembly(mapping->assembly, first_byte, assembly_bytes, length)) {
+            return false;
+        }
+        done += count;
+    }
+    return true;
 }
 
-bool modbus_write_holding_registers(uint16_t start_addr, uint16_t quantity, const uint8_t *data)
+// Bits are packed from bit 0 of data, the first bit of a mapping may be
+// anywhere in its first byte
+static bool read_bits_in(const register_map_t *map, uint8_t table, uint16_t start_addr, uint16_t quantity, uint8_t *data)
 {
-    // Check if address is in output assembly range (100-115)
-    if (start_addr >= HOLDING_REG_OUTPUT_START && start_addr + quantity <= HOLDING_REG_OUTPUT_END + 1) {
-        SemaphoreHandle_t assembly_mutex = get_assembly_mutex();
-        if (assembly_mutex == NULL) {
+    if (!validate_access(map, table, start_addr, quantity)) {
+        return false;
+    }
+    memset(data, 0, (quantity + 7) / 8);
+    uint16_t done = 0;
+    while (done < quantity) {
+        const modbus_register_mapping_t *mapping;
+        uint16_t count, first_byte, length;
+        uint8_t assembly_bytes[MAX_ACCESS_BYTES];
+        uint16_t address = start_addr + done;
+        next_access(map, table, address, quantity - done, &mapping, &count, &first_byte, &length);
+        if (!sample_application_read_assembly(mapping->assembly, first_byte, assembly_bytes, length)) {
             return false;
         }
-        
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-        
-        // Map Modbus Holding Registers 100-115 to Output Assembly 150 (32 bytes = 16 registers)
-        uint16_t reg_offset = start_addr - HOLDING_REG_OUTPUT_START;
-        for (uint16_t i = 0; i < quantity; i++) {
-            uint16_t byte_offset = (reg_offset + i) * 2;
-            
-            if (byte_offset + 1 < sizeof(g_assembly_data096)) {
-                // Convert big-endian from Modbus to little-endian for assembly
-                uint16_t be_value = bytes_to_big_endian_uint16(&data[i * 2]);
-                uint16_t le_value = big_endian_to_little_endian(be_value);
-                g_assembly_data096[byte_offset] = le_value & 0xFF;
-                g_assembly_data096[byte_offset + 1] = (le_value >> 8) & 0xFF;
+        uint16_t first_bit = (address - mapping->start) % 8;
+        for (uint16_t i = 0; i < count; i++) {
+            uint16_t bit = first_bit + i;
+            uint16_t out = done + i;
+            if (assembly_bytes[bit / 8] & (1 << (bit % 8))) {
+                data[out / 8] |= 1 << (out % 8);
             }
         }
-        
-        xSemaphoreGive(assembly_mutex);
-        
-        return true;
+        done += count;
     }
-    
-    // Check if address is in config assembly range (150-154)
-    if (start_addr >= HOLDING_REG_CONFIG_START && start_addr + quantity <= HOLDING_REG_CONFIG_END + 1) {
-        SemaphoreHandle_t assembly_mutex = get_assembly_mutex();
-        if (assembly_mutex == NULL) {
+    return true;
+}
+
+// Only the bytes holding the bits are written, the other bits keep their value
+static bool write_bits_in(const register_map_t *map, uint8_t table, uint16_t start_addr, uint16_t quantity, const uint8_t *data)
+{
+    if (quantity == 0 || (uint32_t)start_addr + quantity > 0x10000) {
+        return false;
+    }
+    uint16_t done = 0;
+    while (done < quantity) {
+        const modbus_register_mapping_t *mapping;
+        uint16_t count, first_byte, length;
+        uint8_t assembly_bytes[MAX_ACCESS_BYTES];
+        uint16_t address = start_addr + done;
+        if (!next_access(map, table, address, quantity - done, &mapping, &count, &first_byte, &length)) {
+            return false;
+        }
+        // A request spanning mappings is checked as a whole before the first write
+        if (done == 0 && count < quantity && !validate_access(map, table, start_addr, quantity)) {
+            return false;
+        }
+        if (!sample_application_read_assembly(mapping->assembly, first_byte, assembly_bytes, length)) {
             return false;
         }
-        
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-        
-        // Map Modbus Holding Registers 150-154 to Config Assembly 151 (10 bytes = 5 registers)
-        uint16_t reg_offset = start_addr - HOLDING_REG_CONFIG_START;
-        for (uint16_t i = 0; i < quantity; i++) {
-            uint16_t byte_offset = (reg_offset + i) * 2;
-            
-            if (byte_offset + 1 < sizeof(g_assembly_data097)) {
-                uint16_t be_value = bytes_to_big_endian_uint16(&data[i * 2]);
-                uint16_t le_value = big_endian_to_little_endian(be_value);
-                g_assembly_data097[byte_offset] = le_value & 0xFF;
-                g_assembly_data097[byte_offset + 1] = (le_value >> 8) & 0xFF;
+        uint16_t first_bit = (address - mapping->start) % 8;
+        for (uint16_t i = 0; i < count; i++) {
+            uint16_t bit = first_bit + i;
+            uint16_t in = done + i;
+            if (data[in / 8] & (1 << (in % 8))) {
+                assembly_bytes[bit / 8] |= 1 << (bit % 8);
+            } else {
+                assembly_bytes[bit / 8] &= ~(1 << (bit % 8));
             }
         }
-        
-        xSemaphoreGive(assembly_mutex);
-        return true;
+        if (!write_assembly(mapping->assembly, first_byte, assembly_bytes, length)) {
+            return false;
+        }
+        done += count;
     }
-    
-    ESP_LOGE(TAG, "Invalid holding register range for write: %d-%d", start_addr, start_addr + quantity - 1);
-    return false;
+    return true;
+}
+
+// Each request uses one table from start to end
+
+static bool read_registers(uint8_t table, uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    const register_map_t *map = map_acquire();
+    bool ok = read_registers_in(map, table, start_addr, quantity, data);
+    map_release(map);
+    return ok;
+}
+
+static bool write_registers(uint8_t table, uint16_t start_addr, uint16_t quantity, const uint8_t *data)
+{
+    const register_map_t *map = map_acquire();
+    bool ok = write_registers_in(map, table, start_addr, quantity, data);
+    map_release(map);
+    return ok;
+}
+
+static bool read_bits(uint8_t table, uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    const register_map_t *map = map_acquire();
+    bool ok = read_bits_in(map, table, start_addr, quantity, data);
+    map_release(map);
+    return ok;
+}
+
+static bool write_bits(uint8_t table, uint16_t start_addr, uint16_t quantity, const uint8_t *data)
+{
+    const register_map_t *map = map_acquire();
+    bool ok = write_bits_in(map, table, start_addr, quantity, data);
+    map_release(map);
+    return ok;
 }
 
+bool modbus_read_input_registers(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    if (!read_registers(MODBUS_TABLE_INPUT_REGISTERS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid input register range: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
+    }
+    return true;
+}
+
+bool modbus_read_holding_registers(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    if (!read_registers(MODBUS_TABLE_HOLDING_REGISTERS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid holding register range: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
+    }
+    return true;
+}
+
+bool modbus_write_holding_register(uint16_t address, uint16_t value)
+{
+    uint8_t data[2] = { (value >> 8) & 0xFF, value & 0xFF };
+    return modbus_write_holding_registers(address, 1, data);
+}
+
+bool modbus_write_holding_registers(uint16_t start_addr, uint16_t quantity, const uint8_t *data)
+{
+    if (!write_registers(MODBUS_TABLE_HOLDING_REGISTERS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid holding register range for write: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
+    }
+    return true;
+}
+
+bool modbus_read_coils(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    if (!read_bits(MODBUS_TABLE_COILS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid coil range: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
+    }
+    return true;
+}
+
+bool modbus_read_discrete_inputs(uint16_t start_addr, uint16_t quantity, uint8_t *data)
+{
+    if (!read_bits(MODBUS_TABLE_DISCRETE_INPUTS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid discrete input range: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
+    }
+    return true;
+}
+
+bool modbus_write_coil(uint16_t address, bool value)
+{
+    uint8_t data = value ? 1 : 0;
+    return modbus_write_coils(address, 1, &data);
+}
+
+bool modbus_write_coils(uint16_t start_addr, uint16_t quantity, const uint8_t *data)
+{
+    if (!write_bits(MODBUS_TABLE_COILS, start_addr, quantity, data)) {
+        ESP_LOGE(TAG, "Invalid coil range for write: %d-%d", start_addr, start_addr + quantity - 1);
+        return false;
+    }
+    return true;
+}
+
+const char *modbus_get_device_identification(uint8_t object_id)
+{
+    switch (object_id) {
+        case 0x00: return MODBUS_DEVICE_VENDOR_NAME;
+        case 0x01: return MODBUS_DEVICE_PRODUCT_CODE;
+        case 0x02: return MODBUS_DEVICE_REVISION;
+        case 0x04: return MODBUS_DEVICE_PRODUCT_NAME;
+        case 0x05: return MODBUS_DEVICE_MODEL_NAME;
+        default: return NULL;
+    }
+}
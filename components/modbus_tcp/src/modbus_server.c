@@ -0,0 +1,655 @@
+#include "modbus_server.h"
+#include "modbus_protocol.h"
+#include "modbus_register_map.h"
+#include "esp_log.h"
+#include <sys/socket.h>
+#include <sys/poll.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+// Event loop core of the ModbusTCP server. Only POSIX sockets and poll(), so
+// the same code runs in the ESP task and in the host build
+// (tools/modbus_tcp_host).
+
+static const char *TAG = "modbus_server";
+
+// Receive buffer of a client: the request being received and the pipelined
+// ones behind it
+#ifndef MODBUS_TCP_RX_BUFFER_SIZE
+#define MODBUS_TCP_RX_BUFFER_SIZE 512
+#endif
+
+// Transmit buffer of a client: the responses to the requests of one receive
+// are sent with one send()
+#ifndef MODBUS_TCP_TX_BUFFER_SIZE
+#define MODBUS_TCP_TX_BUFFER_SIZE 1024
+#endif
+
+// Connections taken from the listen backlog per event loop iteration
+#define MODBUS_SERVER_ACCEPT_BATCH 16
+
+// Assembly writes are queued for the OpENer thread. The response to a write
+// goes out once it has been applied, checked every poll period, or after the
+// timeout with a warning.
+#ifndef MODBUS_SERVER_WRITE_APPLY_TIMEOUT_MS
+#define MODBUS_SERVER_WRITE_APPLY_TIMEOUT_MS 50
+#endif
+#define MODBUS_SERVER_WRITE_POLL_MS 1
+
+_Static_assert(MODBUS_TCP_RX_BUFFER_SIZE >= MODBUS_TCP_MAX_ADU_SIZE, "a request must fit the receive buffer");
+_Static_assert(MODBUS_TCP_TX_BUFFER_SIZE >= MODBUS_TCP_MAX_ADU_SIZE, "a response must fit the transmit buffer");
+
+typedef struct {
+    int socket;             // -1 if the slot is free
+    int lru_prev;           // Less recently active client, -1 at the head
+    int lru_next;           // More recently active client, -1 at the tail
+    uint32_t address;       // IPv4 address, network byte order
+    uint16_t port;
+    uint32_t connected_ms;
+    uint32_t last_active_ms; // Accept or last request
+    uint32_t requests;
+    uint32_t window_requests;
+    uint32_t request_rate;
+    size_t rx_length;       // bytes received, not processed yet
+    size_t tx_start;        // bytes of tx already sent
+    size_t tx_length;       // bytes of responses in tx
+    bool held;              // Requests wait until the pending writes are applied
+    bool reply_held;        // tx holds the response to a write not applied yet
+    bool read_back;         // The write of the first request in rx is done (FC 23)
+    bool released;          // Released by the current apply check
+    uint8_t rx[MODBUS_TCP_RX_BUFFER_SIZE];
+    uint8_t tx[MODBUS_TCP_TX_BUFFER_SIZE];
+} modbus_client_t;
+
+// Only touched by the event loop
+static modbus_server_config_t s_config;
+static int s_listen_socket = -1;
+static modbus_client_t *s_clients;
+static struct pollfd *s_poll_fds;   // [0] listen socket, [i + 1] client i
+static int s_lru_head = -1;         // Least recently active client
+static int s_lru_tail = -1;         // Most recently active client
+static uint32_t s_window_start_ms;
+static uint32_t s_window_requests;
+static modbus_server_stats_t s_stats;
+static bool s_write_pending;        // Clients hold for a queued write
+static uint32_t s_write_queued_ms;
+
+// Published once per rate window for other tasks
+static pthread_mutex_t s_published_mutex = PTHREAD_MUTEX_INITIALIZER;
+static modbus_server_stats_t s_published_stats;
+static modbus_server_client_info_t *s_published_clients;
+static uint16_t s_published_count;
+
+static uint32_t now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)now.tv_sec * 1000u + (uint32_t)(now.tv_nsec / 1000000);
+}
+
+static void lru_remove(int index)
+{
+    modbus_client_t *client = &s_clients[index];
+    if (client->lru_prev >= 0) {
+        s_clients[client->lru_prev].lru_next = client->lru_next;
+    } else {
+        s_lru_head = client->lru_next;
+    }
+    if (client->lru_next >= 0) {
+        s_clients[client->lru_next].lru_prev = client->lru_prev;
+    } else {
+        s_lru_tail = client->lru_prev;
+    }
+    client->lru_prev = -1;
+    client->lru_next = -1;
+}
+
+static void lru_append(int index)
+{
+    modbus_client_t *client = &s_clients[index];
+    client->lru_prev = s_lru_tail;
+    client->lru_next = -1;
+    if (s_lru_tail >= 0) {
+        s_clients[s_lru_tail].lru_next = index;
+    } else {
+        s_lru_head = index;
+    }
+    s_lru_tail = index;
+}
+
+// Marks a client as the most recently active one
+static void lru_touch(int index, uint32_t now)
+{
+    s_clients[index].last_active_ms = now;
+    if (index != s_lru_tail) {
+        lru_remove(index);
+        lru_append(index);
+    }
+}
+
+static void client_open(int index, int socket, const struct sockaddr_in *addr, uint32_t now)
+{
+    // Never block the event loop on one client
+    int flags = fcntl(socket, F_GETFL, 0);
+    fcntl(socket, F_SETFL, flags | O_NONBLOCK);
+
+    // Responses are sent as soon as a receive is processed
+    int opt = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+
+    modbus_client_t *client = &s_clients[index];
+    client->socket = socket;
+    client->address = addr->sin_addr.s_addr;
+    client->port = ntohs(addr->sin_port);
+    client->connected_ms = now;
+    client->last_active_ms = now;
+    client->requests = 0;
+    client->window_requests = 0;
+    client->request_rate = 0;
+    client->rx_length = 0;
+    client->tx_start = 0;
+    client->tx_length = 0;
+    client->held = false;
+    client->reply_held = false;
+    client->read_back = false;
+    client->released = false;
+    lru_append(index);
+    s_stats.connections++;
+
+    // Events of this poll() belong to the socket the slot had before
+    s_poll_fds[index + 1].fd = socket;
+    s_poll_fds[index + 1].events = POLLIN;
+    s_poll_fds[index + 1].revents = 0;
+}
+
+static void client_close(int index)
+{
+    modbus_client_t *client = &s_clients[index];
+    close(client->socket);
+    client->socket = -1;
+    lru_remove(index);
+    s_stats.connections--;
+    s_poll_fds[index + 1].fd = -1;
+    s_poll_fds[index + 1].revents = 0;
+}
+
+// Receives what fits the buffer, false if the connection is closed
+static bool client_receive(modbus_client_t *client)
+{
+    int received = recv(client->socket, &client->rx[client->rx_length],
+                        sizeof(client->rx) - client->rx_length, 0);
+    if (received > 0) {
+        client->rx_length += received;
+        return true;
+    }
+    if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+        return true;
+    }
+    return false; // Closed by the client or error
+}
+
+// Stops processing the requests of a client until the queued writes are
+// applied, see release_clients()
+static void client_hold(modbus_client_t *client, bool reply, uint32_t now)
+{
+    client->held = true;
+    client->reply_held = reply;
+    if (!s_write_pending) {
+        s_write_pending = true;
+        s_write_queued_ms = now;
+    }
+}
+
+// Processes the complete requests while their responses fit, keeps a partial
+// one for the next receive. Sets *more if requests wait for transmit space and
+// returns the number of requests processed, -1 on an invalid header.
+// Requests that write wait for the writes of earlier requests to be applied,
+// the requests of a client after its write wait for its response.
+static int client_process(modbus_client_t *client, bool *more, uint32_t now)
+{
+    size_t consumed = 0;
+    int processed = 0;
+
+    *more = false;
+    while (!client->held) {
+        int frame_length = modbus_tcp_frame_length(&client->rx[consumed], client->rx_length - consumed);
+        if (frame_length < 0) {
+            ESP_LOGW(TAG, "Invalid MBAP header, closing connection");
+            return -1;
+        }
+        if (frame_length == 0) {
+            break;
+        }
+        if (sizeof(client->tx) - client->tx_length < MODBUS_TCP_MAX_ADU_SIZE) {
+            *more = true;
+            break;
+        }
+        const uint8_t *request = &client->rx[consumed];
+        uint8_t *response = &client->tx[client->tx_length];
+        modbus_tcp_request_kind_t kind = modbus_tcp_request_kind(request, frame_length);
+        size_t response_length;
+        if (client->read_back) {
+            client->read_back = false;
+            response_length = modbus_tcp_process_read(request, frame_length, response);
+        } else if (kind != MODBUS_TCP_REQUEST_READ && s_write_pending) {
+            client_hold(client, false, now);
+            break;
+        } else if (kind == MODBUS_TCP_REQUEST_WRITE_READ) {
+            response_length = modbus_tcp_process_write(request, frame_length, response);
+            if (response_length == 0) {
+                // Read back once the write is applied, the request stays in rx
+                client->read_back = true;
+                if (modbus_register_map_writes_pending()) {
+                    client_hold(client, false, now);
+                    break;
+                }
+                continue;
+            }
+        } else {
+            response_length = modbus_tcp_process_request(request, frame_length, response);
+        }
+        client->tx_length += response_length;
+        consumed += frame_length;
+        processed++;
+        if (kind == MODBUS_TCP_REQUEST_WRITE && modbus_register_map_writes_pending()) {
+            client_hold(client, true, now);
+        }
+    }
+
+    if (consumed > 0) {
+        client->rx_length -= consumed;
+        memmove(client->rx, &client->rx[consumed], client->rx_length);
+    }
+    return processed;
+}
+
+// Sends the pending responses without blocking, false on error
+static bool client_flush(modbus_client_t *client)
+{
+    while (client->tx_start < client->tx_length) {
+        int sent = send(client->socket, &client->tx[client->tx_start],
+                        client->tx_length - client->tx_start, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                break; // Rest goes out once the socket is writable
+            }
+            return false;
+        }
+        client->tx_start += sent;
+    }
+
+    if (client->tx_start == client->tx_length) {
+        client->tx_start = 0;
+        client->tx_length = 0;
+    } else if (client->tx_start > 0) {
+        client->tx_length -= client->tx_start;
+        memmove(client->tx, &client->tx[client->tx_start], client->tx_length);
+        client->tx_start = 0;
+    }
+    return true;
+}
+
+// Handles a readable or writable client, false to close the connection
+static bool client_service(int index, bool readable, uint32_t now)
+{
+    modbus_client_t *client = &s_clients[index];
+    if (readable && !client_receive(client)) {
+        return false;
+    }
+
+    // Requests that did not fit the transmit buffer go once it drained
+    bool more;
+    int processed = 0;
+    do {
+        int count = client_process(client, &more, now);
+        if (count < 0) {
+            s_stats.protocol_errors++;
+            return false;
+        }
+        processed += count;
+        if (!client->reply_held && !client_flush(client)) {
+            return false;
+        }
+    } while (more && client->tx_length == 0);
+
+    if (processed > 0) {
+        client->requests += processed;
+        client->window_requests += processed;
+        s_window_requests += processed;
+        s_stats.requests += processed;
+        lru_touch(index, now);
+    }
+
+    // Clients with buffer space are read, clients with unsent responses wait
+    // for the socket to become writable
+    s_poll_fds[index + 1].events = (client->rx_length < sizeof(client->rx) ? POLLIN : 0) |
+                                   (client->tx_length > 0 && !client->reply_held ? POLLOUT : 0);
+    return true;
+}
+
+// Takes the connections waiting in the listen backlog. At the limit the least
+// recently used client gives up its slot if it has been idle long enough,
+// otherwise the new connection is refused.
+static void accept_clients(uint32_t now)
+{
+    for (int n = 0; n < MODBUS_SERVER_ACCEPT_BATCH; n++) {
+        struct sockaddr_in addr;
+        socklen_t addr_len = sizeof(addr);
+        int socket = accept(s_listen_socket, (struct sockaddr *)&addr, &addr_len);
+        if (socket < 0) {
+            return; // Backlog empty
+        }
+
+        int slot = -1;
+        if (s_stats.connections < s_config.max_connections) {
+            for (int i = 0; i < s_config.max_connections; i++) {
+                if (s_clients[i].socket < 0) {
+                    slot = i;
+                    break;
+                }
+            }
+        } else if (s_lru_head >= 0 && now - s_clients[s_lru_head].last_active_ms >= s_config.evict_idle_ms) {
+            slot = s_lru_head;
+            ESP_LOGI(TAG, "Closing idle connection %d for a new one", slot);
+            client_close(slot);
+            s_stats.evicted++;
+        }
+
+        if (slot < 0) {
+            ESP_LOGW(TAG, "Max connections reached, closing new connection");
+            close(socket);
+            s_stats.rejected++;
+            continue;
+        }
+        client_open(slot, socket, &addr, now);
+        s_stats.accepted++;
+    }
+}
+
+// Serves the held clients again once the queued writes are applied
+static void release_clients(uint32_t now)
+{
+    if (!s_write_pending) {
+        return;
+    }
+    if (modbus_register_map_writes_pending()) {
+        if (now - s_write_queued_ms < MODBUS_SERVER_WRITE_APPLY_TIMEOUT_MS) {
+            return;
+        }
+        ESP_LOGW(TAG, "Assembly write not applied after %lu ms", (unsigned long)(now - s_write_queued_ms));
+    }
+    s_write_pending = false;
+
+    // Released clients may queue new writes and hold the others again
+    for (int i = 0; i < s_config.max_connections; i++) {
+        modbus_client_t *client = &s_clients[i];
+        client->released = client->socket >= 0 && client->held;
+        client->held = false;
+        client->reply_held = false;
+    }
+    for (int i = 0; i < s_config.max_connections; i++) {
+        if (s_clients[i].released && !client_service(i, false, now)) {
+            client_close(i);
+        }
+    }
+}
+
+// Closes the clients without a request for the idle timeout, oldest first
+static void expire_idle_clients(uint32_t now)
+{
+    if (s_config.idle_timeout_ms == 0) {
+        return;
+    }
+    while (s_lru_head >= 0 && now - s_clients[s_lru_head].last_active_ms >= s_config.idle_timeout_ms) {
+        ESP_LOGI(TAG, "Closing connection %d after %lu ms without a request", s_lru_head,
+                 (unsigned long)(now - s_clients[s_lru_head].last_active_ms));
+        client_close(s_lru_head);
+        s_stats.timed_out++;
+    }
+}
+
+// Copies the statistics for other tasks
+static void publish_stats(uint32_t now)
+{
+    pthread_mutex_lock(&s_published_mutex);
+    s_published_stats = s_stats;
+    s_published_count = 0;
+    for (int i = 0; i < s_config.max_connections; i++) {
+        const modbus_client_t *client = &s_clients[i];
+        if (client->socket < 0) {
+            continue;
+        }
+        modbus_server_client_info_t *info = &s_published_clients[s_published_count++];
+        info->address = client->address;
+        info->port = client->port;
+        info->requests = client->requests;
+        info->request_rate = client->request_rate;
+        info->idle_ms = now - client->last_active_ms;
+        info->connected_ms = now - client->connected_ms;
+    }
+    pthread_mutex_unlock(&s_published_mutex);
+}
+
+// Closes the rate window once it has passed
+static void update_rates(uint32_t now)
+{
+    uint32_t elapsed = now - s_window_start_ms;
+    if (elapsed < MODBUS_SERVER_RATE_WINDOW_MS) {
+        return;
+    }
+    for (int i = 0; i < s_config.max_connections; i++) {
+        modbus_client_t *client = &s_clients[i];
+        if (client->socket >= 0) {
+            client->request_rate = (uint32_t)((uint64_t)client->window_requests * 1000 / elapsed);
+            client->window_requests = 0;
+        }
+    }
+    s_stats.request_rate = (uint32_t)((uint64_t)s_window_requests * 1000 / elapsed);
+    s_window_requests = 0;
+    s_window_start_ms = now;
+    publish_stats(now);
+}
+
+// Time until the next idle timeout, rate window or apply check, at most
+// timeout_ms
+static int poll_timeout(uint32_t timeout_ms, uint32_t now)
+{
+    uint32_t wait = timeout_ms;
+    if (s_write_pending && MODBUS_SERVER_WRITE_POLL_MS < wait) {
+        wait = MODBUS_SERVER_WRITE_POLL_MS;
+    }
+    uint32_t window_left = MODBUS_SERVER_RATE_WINDOW_MS - (now - s_window_start_ms);
+    if (now - s_window_start_ms >= MODBUS_SERVER_RATE_WINDOW_MS) {
+        window_left = 0;
+    }
+    if (window_left < wait) {
+        wait = window_left;
+    }
+    if (s_config.idle_timeout_ms != 0 && s_lru_head >= 0) {
+        uint32_t idle = now - s_clients[s_lru_head].last_active_ms;
+        uint32_t idle_left = idle < s_config.idle_timeout_ms ? s_config.idle_timeout_ms - idle : 0;
+        if (idle_left < wait) {
+            wait = idle_left;
+        }
+    }
+    return (int)wait;
+}
+
+bool modbus_server_open(const modbus_server_config_t *config)
+{
+    if (s_listen_socket >= 0) {
+        ESP_LOGE(TAG, "ModbusTCP server already open");
+        return false;
+    }
+    if (config->max_connections == 0) {
+        ESP_LOGE(TAG, "Invalid connection limit");
+        return false;
+    }
+
+    modbus_client_t *clients = calloc(config->max_connections, sizeof(modbus_client_t));
+    struct pollfd *poll_fds = calloc(config->max_connections + 1, sizeof(struct pollfd));
+    modbus_server_client_info_t *published = calloc(config->max_connections, sizeof(modbus_server_client_info_t));
+    if (clients == NULL || poll_fds == NULL || published == NULL) {
+        ESP_LOGE(TAG, "Failed to allocate %u client slots", config->max_connections);
+        free(clients);
+        free(poll_fds);
+        free(published);
+        return false;
+    }
+
+    int listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_socket < 0) {
+        ESP_LOGE(TAG, "Failed to create socket: %s", strerror(errno));
+        free(clients);
+        free(poll_fds);
+        free(published);
+        return false;
+    }
+
+    int opt = 1;
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    server_addr.sin_port = htons(config->port);
+
+    // The backlog holds the connections of a burst until the next accept
+    int backlog = config->max_connections < 128 ? config->max_connections : 128;
+    if (setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0 ||
+        bind(listen_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0 ||
+        listen(listen_socket, backlog) < 0) {
+        ESP_LOGE(TAG, "Failed to listen on port %u: %s", config->port, strerror(errno));
+        close(listen_socket);
+        free(clients);
+        free(poll_fds);
+        free(published);
+        return false;
+    }
+    int flags = fcntl(listen_socket, F_GETFL, 0);
+    fcntl(listen_socket, F_SETFL, flags | O_NONBLOCK);
+
+    for (int i = 0; i < config->max_connections; i++) {
+        clients[i].socket = -1;
+        clients[i].lru_prev = -1;
+        clients[i].lru_next = -1;
+        poll_fds[i + 1].fd = -1;
+    }
+    poll_fds[0].fd = listen_socket;
+    poll_fds[0].events = POLLIN;
+
+    s_config = *config;
+    s_listen_socket = listen_socket;
+    s_clients = clients;
+    s_poll_fds = poll_fds;
+    s_lru_head = -1;
+    s_lru_tail = -1;
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stats.max_connections = config->max_connections;
+    s_window_start_ms = now_ms();
+    s_window_requests = 0;
+    s_write_pending = false;
+
+    pthread_mutex_lock(&s_published_mutex);
+    s_published_clients = published;
+    s_published_count = 0;
+    s_published_stats = s_stats;
+    pthread_mutex_unlock(&s_published_mutex);
+    return true;
+}
+
+bool modbus_server_poll(uint32_t timeout_ms)
+{
+    if (s_listen_socket < 0) {
+        return false;
+    }
+
+    int ready = poll(s_poll_fds, s_config.max_connections + 1, poll_timeout(timeout_ms, now_ms()));
+    if (ready < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+        ESP_LOGE(TAG, "Poll error: %s", strerror(errno));
+        return false;
+    }
+
+    uint32_t now = now_ms();
+    if (ready > 0) {
+        // Service client sockets, then take new connections so a slot given
+        // up here is not served with the events of its previous socket
+        for (int i = 0; i < s_config.max_connections; i++) {
+            short revents = s_poll_fds[i + 1].revents;
+            if (s_clients[i].socket < 0 || revents == 0) {
+                continue;
+            }
+            // A hangup or error shows as a failing recv()
+            bool readable = (revents & (POLLIN | POLLHUP | POLLERR | POLLNVAL)) != 0;
+            if (!client_service(i, readable, now)) {
+                // Connection closed or error
+                client_close(i);
+            }
+        }
+        if (s_poll_fds[0].revents & POLLIN) {
+            accept_clients(now);
+        }
+    }
+
+    release_clients(now);
+    expire_idle_clients(now);
+    update_rates(now);
+    return true;
+}
+
+void modbus_server_close(void)
+{
+    if (s_listen_socket < 0) {
+        return;
+    }
+    for (int i = 0; i < s_config.max_connections; i++) {
+        if (s_clients[i].socket >= 0) {
+            client_close(i);
+        }
+    }
+    close(s_listen_socket);
+    s_listen_socket = -1;
+
+    pthread_mutex_lock(&s_published_mutex);
+    free(s_published_clients);
+    s_published_clients = NULL;
+    s_published_count = 0;
+    pthread_mutex_unlock(&s_published_mutex);
+
+    free(s_clients);
+    free(s_poll_fds);
+    s_clients = NULL;
+    s_poll_fds = NULL;
+}
+
+bool modbus_server_get_stats(modbus_server_stats_t *stats)
+{
+    pthread_mutex_lock(&s_published_mutex);
+    bool open = s_published_clients != NULL;
+    if (open) {
+        *stats = s_published_stats;
+    }
+    pthread_mutex_unlock(&s_published_mutex);
+    return open;
+}
+
+size_t modbus_server_get_clients(modbus_server_client_info_t *clients, size_t max)
+{
+    pthread_mutex_lock(&s_published_mutex);
+    size_t count = s_published_count < max ? s_published_count : max;
+    if (count > 0) {
+        memcpy(clients, s_published_clients, count * sizeof(clients[0]));
+    }
+    pthread_mutex_unlock(&s_published_mutex);
+    return count;
+}
@@ -1,118 +1,62 @@
 #include "modbus_tcp.h"
-#include "modbus_protocol.h"
+#include "modbus_server.h"
 #include "esp_log.h"
-#include "lwip/sockets.h"
-#include "lwip/netdb.h"
-#include "lwip/inet.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include <string.h>
-#include <errno.h>
 
 static const char *TAG = "modbus_tcp";
-static int s_listen_socket = -1;
+static bool s_initialized = false;
 static TaskHandle_t s_server_task_handle = NULL;
 static bool s_running = false;
 static SemaphoreHandle_t s_modbus_mutex = NULL;
 
+#ifndef MODBUS_TCP_PORT
 #define MODBUS_TCP_PORT 502
-#define MODBUS_TCP_MAX_CONNECTIONS 5
+#endif
+
+// Concurrent clients, each takes about 1.6 KB of buffers and one socket of
+// CONFIG_LWIP_MAX_SOCKETS
+#ifndef MODBUS_TCP_MAX_CONNECTIONS
+#define MODBUS_TCP_MAX_CONNECTIONS 16
+#endif
+
+// Clients without a request for this long are closed, 0 keeps them open
+#ifndef MODBUS_TCP_IDLE_TIMEOUT_MS
+#define MODBUS_TCP_IDLE_TIMEOUT_MS 60000
+#endif
+
+// At the connection limit a new client takes the slot of the least recently
+// used one if that has been idle this long, otherwise it is refused
+#ifndef MODBUS_TCP_EVICT_IDLE_MS
+#define MODBUS_TCP_EVICT_IDLE_MS 5000
+#endif
+
+// Longest event loop wait, bounds the time modbus_tcp_stop() waits
+#define MODBUS_TCP_POLL_INTERVAL_MS 100
 
 static void modbus_tcp_server_task(void *pvParameters)
 {
-    struct sockaddr_in client_addr;
-    socklen_t client_addr_len = sizeof(client_addr);
-    int client_sockets[MODBUS_TCP_MAX_CONNECTIONS];
-    int max_fd;
-    fd_set read_fds;
     bool running = true;
     
-    memset(client_sockets, -1, sizeof(client_sockets));
-    
     while (running) {
         // Check running flag with mutex protection
-        if (s_modbus_mutex != NULL) {
-            xSemaphoreTake(s_modbus_mutex, portMAX_DELAY);
-            running = s_running;
-            xSemaphoreGive(s_modbus_mutex);
-        }
-        
-        if (!running) {
-            break;
-        }
-        FD_ZERO(&read_fds);
-        FD_SET(s_listen_socket, &read_fds);
-        max_fd = s_listen_socket;
-        
-        // Add client sockets to set
-        for (int i = 0; i < MODBUS_TCP_MAX_CONNECTIONS; i++) {
-            if (client_sockets[i] >= 0) {
-                FD_SET(client_sockets[i], &read_fds);
-                if (client_sockets[i] > max_fd) {
-                    max_fd = client_sockets[i];
-                }
-            }
-        }
-        
-        struct timeval timeout = {.tv_sec = 1, .tv_usec = 0};
-        int activity = select(max_fd + 1, &read_fds, NULL, NULL, &timeout);
+        xSemaphoreTake(s_modbus_mutex, portMAX_DELAY);
+        running = s_running;
+        xSemaphoreGive(s_modbus_mutex);
         
-        if (activity < 0 && errno != EINTR) {
-            ESP_LOGE(TAG, "Select error: %s", strerror(errno));
+        if (running && !modbus_server_poll(MODBUS_TCP_POLL_INTERVAL_MS)) {
             break;
         }
-        
-        // Check for new connections
-        if (FD_ISSET(s_listen_socket, &read_fds)) {
-            int new_socket = accept(s_listen_socket, (struct sockaddr *)&client_addr, &client_addr_len);
-            if (new_socket >= 0) {
-                // New ModbusTCP connection
-                
-                // Find empty slot
-                bool added = false;
-                for (int i = 0; i < MODBUS_TCP_MAX_CONNECTIONS; i++) {
-                    if (client_sockets[i] < 0) {
-                        client_sockets[i] = new_socket;
-                        added = true;
-                        break;
-                    }
-                }
-                
-                if (!added) {
-                    ESP_LOGE(TAG, "Max connections reached, closing new connection");
-                    close(new_socket);
-                }
-            }
-        }
-        
-        // Check client sockets for data
-        for (int i = 0; i < MODBUS_TCP_MAX_CONNECTIONS; i++) {
-            if (client_sockets[i] >= 0 && FD_ISSET(client_sockets[i], &read_fds)) {
-                if (!modbus_tcp_handle_request(client_sockets[i])) {
-                    // Connection closed or error
-                    // Closing ModbusTCP connection
-                    close(client_sockets[i]);
-                    client_sockets[i] = -1;
-                }
-            }
-        }
     }
     
     // Cleanup
-    for (int i = 0; i < MODBUS_TCP_MAX_CONNECTIONS; i++) {
-        if (client_sockets[i] >= 0) {
-            close(client_sockets[i]);
-        }
-    }
-    
-    if (s_modbus_mutex != NULL) {
-        xSemaphoreTake(s_modbus_mutex, portMAX_DELAY);
-        s_server_task_handle = NULL;
-        xSemaphoreGive(s_modbus_mutex);
-    } else {
-        s_server_task_handle = NULL;
-    }
+    xSemaphoreTake(s_modbus_mutex, portMAX_DELAY);
+    modbus_server_close();
+    s_initialized = false;
+    s_running = false;
+    s_server_task_handle = NULL;
+    xSemaphoreGive(s_modbus_mutex);
     vTaskDelete(NULL);
 }
 
@@ -127,53 +71,22 @@ bool modbus_tcp_init(void)
     }
     
     xSemaphoreTake(s_modbus_mutex, portMAX_DELAY);
-    if (s_listen_socket >= 0) {
+    if (s_initialized) {
         xSemaphoreGive(s_modbus_mutex);
         ESP_LOGE(TAG, "ModbusTCP already initialized");
         return true;
     }
     
-    s_listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (s_listen_socket < 0) {
-        xSemaphoreGive(s_modbus_mutex);
-        ESP_LOGE(TAG, "Failed to create socket: %s", strerror(errno));
-        return false;
-    }
-    
-    int opt = 1;
-    if (setsockopt(s_listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt)) < 0) {
-        xSemaphoreGive(s_modbus_mutex);
-        ESP_LOGE(TAG, "Failed to set socket options: %s", strerror(errno));
-        close(s_listen_socket);
-        s_listen_socket = -1;
-        return false;
-    }
-    
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(MODBUS_TCP_PORT);
-    
-    if (bind(s_listen_socket, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
-        xSemaphoreGive(s_modbus_mutex);
-        ESP_LOGE(TAG, "Failed to bind socket: %s", strerror(errno));
-        close(s_listen_socket);
-        s_listen_socket = -1;
-        return false;
-    }
-    
-    if (listen(s_listen_socket, MODBUS_TCP_MAX_CONNECTIONS) < 0) {
-        xSemaphoreGive(s_modbus_mutex);
-        ESP_LOGE(TAG, "Failed to listen: %s", strerror(errno));
-        close(s_listen_socket);
-        s_listen_socket = -1;
-        return false;
-    }
-    
+    const modbus_server_config_t config = {
+        .port = MODBUS_TCP_PORT,
+        .max_connections = MODBUS_TCP_MAX_CONNECTIONS,
+        .idle_timeout_ms = MODBUS_TCP_IDLE_TIMEOUT_MS,
+        .evict_idle_ms = MODBUS_TCP_EVICT_IDLE_MS,
+    };
+    s_initialized = modbus_server_open(&config);
     xSemaphoreGive(s_modbus_mutex);
     // ModbusTCP server initialized
-    return true;
+    return s_initialized;
 }
 
 bool modbus_tcp_start(void)
@@ -184,7 +97,7 @@ bool modbus_tcp_start(void)
     }
     
     xSemaphoreTake(s_modbus_mutex, portMAX_DELAY);
-    if (s_listen_socket < 0) {
+    if (!s_initialized) {
         xSemaphoreGive(s_modbus_mutex);
         ESP_LOGE(TAG, "ModbusTCP not initialized");
         return false;
@@ -220,22 +133,21 @@ void modbus_tcp_stop(void)
     s_running = false;
     TaskHandle_t task_handle = s_server_task_handle;
     
-    // Close socket with mutex protection
-    if (s_listen_socket >= 0) {
-        close(s_listen_socket);
-        s_listen_socket = -1;
+    // Without a server task the sockets are closed here
+    if (task_handle == NULL && s_initialized) {
+        modbus_server_close();
+        s_initialized = false;
     }
     
     xSemaphoreGive(s_modbus_mutex);
     
-    if (task_handle != NULL) {
-        // Wait for task to finish (with timeout)
-        vTaskDelay(pdMS_TO_TICKS(1000));
+    // The task closes the sockets within one poll interval
+    for (int waited = 0; task_handle != NULL && waited < 2 * MODBUS_TCP_POLL_INTERVAL_MS; waited += 10) {
+        vTaskDelay(pdMS_TO_TICKS(10));
         xSemaphoreTake(s_modbus_mutex, portMAX_DELAY);
-        s_server_task_handle = NULL;
+        task_handle = s_server_task_handle;
         xSemaphoreGive(s_modbus_mutex);
     }
     
     // ModbusTCP server stopped
 }
-
@@ -0,0 +1,91 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+
+#include "ciparena.h"
+
+#include "opener_api.h"
+#include "trace.h"
+
+/** @brief Allocation granule, aligned for every type stored in CIP objects */
+typedef union {
+  void *pointer;
+  CipUlint ulint;
+  CipLreal lreal;
+} CipArenaUnit;
+
+#if 0 < OPENER_CIP_OBJECT_ARENA_SIZE
+/** @brief Number of units of the arena */
+enum {
+  kCipArenaUnits = (OPENER_CIP_OBJECT_ARENA_SIZE + sizeof(CipArenaUnit) - 1) /
+                   sizeof(CipArenaUnit)
+};
+
+static CipArenaUnit s_arena[kCipArenaUnits];
+#else
+static CipArenaUnit *const s_arena = NULL;
+enum {
+  kCipArenaUnits = 0
+};
+#endif
+
+static size_t s_arena_used_units = 0;
+static size_t s_heap_fallbacks = 0;
+
+/** @brief Checks whether data lies within the arena */
+static CipBool CipArenaContains(const void *const data) {
+  const uintptr_t address = (uintptr_t) data;
+  const uintptr_t begin = (uintptr_t) s_arena;
+  return address >= begin &&
+         address < begin + kCipArenaUnits * sizeof(CipArenaUnit);
+}
+
+void *CipArenaCalloc(const size_t number_of_elements,
+                     const size_t size_of_element) {
+  if(0 != size_of_element && number_of_elements > SIZE_MAX / size_of_element) {
+    return NULL;
+  }
+  const size_t size = number_of_elements * size_of_element;
+  /* empty allocations take one unit to stay distinct and inside the arena */
+  const size_t units =
+    (0 == size) ? 1 : (size + sizeof(CipArenaUnit) - 1) / sizeof(CipArenaUnit);
+
+  if(units <= kCipArenaUnits - s_arena_used_units) {
+    void *const data = &s_arena[s_arena_used_units];
+    s_arena_used_units += units;
+    memset(data, 0, units * sizeof(CipArenaUnit) ); /* reused after a reset */
+    return data;
+  }
+
+  if(0 != kCipArenaUnits) { /* not intended if the arena is disabled */
+    if(0 == s_heap_fallbacks) {
+      OPENER_TRACE_WARN(
+        "CIP object arena of %u bytes exhausted, increase OPENER_CIP_OBJECT_ARENA_SIZE\n",
+        (unsigned) OPENER_CIP_OBJECT_ARENA_SIZE);
+    }
+    s_heap_fallbacks++;
+  }
+  return CipCalloc(number_of_elements, size_of_element);
+}
+
+void CipArenaFree(void *data) {
+  if(!CipArenaContains(data) ) {
+    CipFree(data);
+  }
+}
+
+void CipArenaReset(void) {
+  s_arena_used_units = 0;
+  s_heap_fallbacks = 0;
+}
+
+void CipArenaGetStatistics(CipArenaStatistics *const statistics) {
+  statistics->size = kCipArenaUnits * sizeof(CipArenaUnit);
+  statistics->used = s_arena_used_units * sizeof(CipArenaUnit);
+  statistics->heap_fallbacks = s_heap_fallbacks;
+}
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_CIPARENA_H_
+#define OPENER_CIPARENA_H_
+
+/** @file ciparena.h
+ *  @brief Static arena holding the CIP object model
+ *
+ *  Classes, meta classes, instances, attribute and service arrays, attribute
+ *  masks and the assembly data descriptors are allocated from one statically
+ *  sized arena instead of individual CipCalloc() calls. The object dictionary
+ *  is contiguous in internal RAM, allocation cannot fragment the heap, and
+ *  ShutdownCipStack() releases all of it with CipArenaReset().
+ *
+ *  Allocations are never freed individually. If the arena is exhausted the
+ *  allocation falls back to CipCalloc() with a warning, CipArenaFree() frees
+ *  those and ignores memory of the arena.
+ */
+
+#include <stddef.h>
+
+#include "typedefs.h"
+#include "opener_user_conf.h"
+
+/** @brief Size of the object model arena in bytes, 0 allocates everything
+ *  with CipCalloc() */
+#ifndef OPENER_CIP_OBJECT_ARENA_SIZE
+  #define OPENER_CIP_OBJECT_ARENA_SIZE 16384
+#endif
+
+/** @brief Usage of the arena */
+typedef struct {
+  size_t size; /**< capacity of the arena in bytes */
+  size_t used; /**< bytes allocated from the arena, including padding */
+  size_t heap_fallbacks; /**< allocations that did not fit into the arena,
+                            not counted if the arena is disabled */
+} CipArenaStatistics;
+
+/** @brief Allocates zeroed memory from the arena
+ *
+ *  @param number_of_elements Number of elements
+ *  @param size_of_element Size of one element in bytes
+ *  @return The memory, aligned for pointers and 64 bit types, NULL if out of
+ *  memory
+ */
+void *CipArenaCalloc(const size_t number_of_elements,
+                     const size_t size_of_element);
+
+/** @brief Frees memory allocated with CipArenaCalloc()
+ *
+ *  Memory of the arena is only released by CipArenaReset(), only heap
+ *  fallback allocations are freed.
+ *
+ *  @param data The memory, may be NULL
+ */
+void CipArenaFree(void *data);
+
+/** @brief Releases all memory of the arena, called after all classes have
+ *  been deleted */
+void CipArenaReset(void);
+
+/** @brief Reports the usage of the arena
+ *
+ *  @param statistics Destination of the usage
+ */
+void CipArenaGetStatistics(CipArenaStatistics *const statistics);
+
+#endif /* OPENER_CIPARENA_H_ */
@@ -13,6 +13,9 @@
 #include "opener_api.h"
 #include "trace.h"
 #include "cipconnectionmanager.h"
+#include "cipperf.h"
+#include "ciparena.h"
+#include "cipobjectindex.h"
 
 /** @brief Retrieve the given data according to CIP encoding from the
  *              message buffer.
@@ -30,6 +33,14 @@ int DecodeCipAssemblyAttribute3(void *const data,
                                 CipMessageRouterRequest *const message_router_request,
                                 CipMessageRouterResponse *const message_router_response);
 
+/** @brief Per instance data of an assembly object, CipInstance::data */
+typedef struct {
+  CipByteArray byte_array; /**< attribute 3, first member as it is freed through
+                              the attribute */
+  EipUint32 data_generation; /**< number of data changes reported by
+                                BeforeAssemblyDataSend() */
+} AssemblyInstanceData;
+
 static EipStatus AssemblyPreGetCallback(CipInstance *const instance,
                                         CipAttributeStruct *const attribute,
                                         CipByte service);
@@ -50,7 +61,7 @@ CipClass *CreateAssemblyClass(void) {
                                             1, /* # class services*/
                                             2, /* # instance attributes*/
                                             4, /* # highest instance attribute number*/
-                                            2, /* # instance services*/
+                                            4, /* # instance services*/
                                             0, /* # instances*/
                                             "assembly", /* name */
                                             2, /* Revision, according to the CIP spec currently this has to be 2 */
@@ -66,6 +77,16 @@ CipClass *CreateAssemblyClass(void) {
                   &SetAttributeSingle,
                   "SetAttributeSingle");
 
+    InsertService(assembly_class,
+                  kGetAttributeList,
+                  &GetAttributeList,
+                  "GetAttributeList");
+
+    InsertService(assembly_class,
+                  kSetAttributeList,
+                  &SetAttributeList,
+                  "SetAttributeList");
+
     InsertGetSetCallback(assembly_class, AssemblyPreGetCallback, kPreGetFunc);
     InsertGetSetCallback(assembly_class, AssemblyPostSetCallback, kPostSetFunc);
   }
@@ -88,13 +109,37 @@ void ShutdownAssemblies(void) {
     while(NULL != instance) {
       const CipAttributeStruct *const attribute = GetCipAttribute(instance, 3);
       if(NULL != attribute) {
-        CipFree(attribute->data);
+        CipArenaFree(attribute->data);
       }
       instance = instance->next;
     }
   }
 }
 
+/** @brief Undoes AddCipInstance() for an instance that was just added
+ *
+ *  Unlinks the instance from its class and removes it from the object index.
+ *  Memory taken from the arena stays allocated until CipArenaReset().
+ *  @param assembly_class class the instance was added to
+ *  @param instance instance to remove
+ */
+static void RemoveAssemblyInstance(CipClass *const assembly_class,
+                                   CipInstance *const instance) {
+  CipInstance **link = &assembly_class->instances;
+  while(NULL != *link && instance != *link) {
+    link = &(*link)->next;
+  }
+  if(NULL == *link) {
+    return;
+  }
+  *link = instance->next;
+  ObjectIndexRemoveInstance(instance);
+  CipArenaFree(instance->attributes);
+  CipArenaFree(instance);
+  assembly_class->number_of_instances--;
+  assembly_class->max_instance = GetMaxInstanceNumber(assembly_class);
+}
+
 CipInstance *CreateAssemblyObject(const CipInstanceNum instance_id,
                                   EipByte *const data,
                                   const EipUint16 data_length) {
@@ -107,14 +152,23 @@ CipInstance *CreateAssemblyObject(const CipInstanceNum instance_id,
     return NULL;
   }
 
-  CipInstance *const instance = AddCipInstance(assembly_class, instance_id); /* add instances (always succeeds (or asserts))*/
+  const bool is_new_instance =
+    (NULL == GetCipInstance(assembly_class, instance_id) );
+  CipInstance *const instance = AddCipInstance(assembly_class, instance_id);
+  if(NULL == instance) {
+    return NULL;
+  }
 
-  CipByteArray *const assembly_byte_array = (CipByteArray *) CipCalloc(1,
-                                                                       sizeof(
-                                                                         CipByteArray) );
-  if(assembly_byte_array == NULL) {
-    return NULL; /*TODO remove assembly instance in case of error*/
+  AssemblyInstanceData *const assembly_data =
+    (AssemblyInstanceData *) CipArenaCalloc(1, sizeof(AssemblyInstanceData) );
+  if(assembly_data == NULL) {
+    if(is_new_instance) {
+      RemoveAssemblyInstance(assembly_class, instance);
+    }
+    return NULL;
   }
+  instance->data = assembly_data;
+  CipByteArray *const assembly_byte_array = &assembly_data->byte_array;
 
   assembly_byte_array->length = data_length;
   assembly_byte_array->data = data;
@@ -134,6 +188,16 @@ CipInstance *CreateAssemblyObject(const CipInstanceNum instance_id,
   return instance;
 }
 
+EipUint32 PrepareAssemblyDataSend(CipInstance *const instance) {
+  AssemblyInstanceData *const assembly_data =
+    (AssemblyInstanceData *) instance->data;
+
+  if(BeforeAssemblyDataSend(instance) ) {
+    assembly_data->data_generation++;
+  }
+  return assembly_data->data_generation;
+}
+
 EipStatus NotifyAssemblyConnectedDataReceived(CipInstance *const instance,
                                               const EipUint8 *const data,
                                               const size_t data_length) {
@@ -149,7 +213,10 @@ EipStatus NotifyAssemblyConnectedDataReceived(CipInstance *const instance,
     /* call the application that new data arrived */
   }
 
-  return AfterAssemblyDataReceived(instance);
+  OPENER_PERF_BEGIN(after_received_start);
+  EipStatus status = AfterAssemblyDataReceived(instance);
+  OPENER_PERF_END(kPerfStageAfterAssemblyDataReceived, after_received_start);
+  return status;
 }
 
 int DecodeCipAssemblyAttribute3(void *const data,
@@ -171,7 +238,9 @@ int DecodeCipAssemblyAttribute3(void *const data,
     message_router_response->general_status = kCipErrorNotEnoughData;
     return number_of_decoded_bytes;
   }
-  if(message_router_request->request_data_size > cip_byte_array->length) {
+  /* in an attribute list, the data of further attributes follows */
+  if(kSetAttributeList != message_router_request->service &&
+     message_router_request->request_data_size > cip_byte_array->length) {
     OPENER_TRACE_INFO(
       "DecodeCipByteArray: too much data received.\n");
     message_router_response->general_status = kCipErrorTooMuchData;
@@ -205,13 +274,12 @@ int DecodeCipAssemblyAttribute3(void *const data,
 static EipStatus AssemblyPreGetCallback(CipInstance *const instance,
                                         CipAttributeStruct *const attribute,
                                         CipByte service) {
-  int rc;
   (void) attribute;
   (void) service; /* no unused parameter warnings */
 
-  rc = BeforeAssemblyDataSend(instance);
+  PrepareAssemblyDataSend(instance);
 
-  return rc;
+  return kEipStatusOk;
 }
 
 static EipStatus AssemblyPostSetCallback(CipInstance *const instance,
@@ -42,6 +42,20 @@ EipStatus CipAssemblyInitialize(void);
  */
 void ShutdownAssemblies(void);
 
+/** @brief Lets the application update the data of an Assembly object before
+ *  it is sent
+ *
+ *  Calls BeforeAssemblyDataSend() and counts the data changes it reports. The
+ *  application reports a change only once, to whichever caller comes first,
+ *  so a producer compares the returned generation with the one it sent last
+ *  instead of using the result of BeforeAssemblyDataSend().
+ *
+ *  @param instance the assembly object instance
+ *  @return generation of the assembly data, changes with every reported
+ *  data change
+ */
+EipUint32 PrepareAssemblyDataSend(CipInstance *const instance);
+
 /** @brief notify an Assembly object that data has been received for it.
  *
  *  The data will be copied into the assembly objects attribute 3 and
@@ -0,0 +1,190 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "cipassemblybuffer.h"
+
+#include "opener_api.h"
+#include "trace.h"
+
+/** @brief Bit in AssemblyBuffer::middle marking data not yet acquired */
+#define kAssemblyBufferFresh 0x4U
+#define kAssemblyBufferIndexMask 0x3U
+
+#if 0 != (OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH & \
+          (OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH - 1) )
+#error "OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH must be a power of two"
+#endif
+
+static EipUint8 *AssemblyBufferData(const AssemblyBuffer *const assembly_buffer,
+                                    const unsigned int index) {
+  return assembly_buffer->storage +
+         (size_t) index * assembly_buffer->data_length;
+}
+
+/** @brief Data slot of a queued write, behind the three data buffers */
+static EipUint8 *AssemblyBufferWriteRequestData(
+  const AssemblyBuffer *const assembly_buffer,
+  const unsigned int slot) {
+  return AssemblyBufferData(assembly_buffer, 3U + slot);
+}
+
+static bool AssemblyBufferRangeValid(
+  const AssemblyBuffer *const assembly_buffer,
+  const size_t offset,
+  const size_t length) {
+  return offset <= assembly_buffer->data_length &&
+         length <= assembly_buffer->data_length - offset;
+}
+
+CipInstance *CreateAssemblyBufferObject(AssemblyBuffer *const assembly_buffer,
+                                        const CipInstanceNum instance_id,
+                                        EipUint8 *const storage,
+                                        const EipUint16 data_length,
+                                        const AssemblyBufferDirection direction)
+{
+  assembly_buffer->direction = direction;
+  assembly_buffer->storage = storage;
+  assembly_buffer->data_length = data_length;
+  assembly_buffer->back = 0;
+  assembly_buffer->front = 2;
+  atomic_init(&assembly_buffer->middle, 1U);
+  atomic_init(&assembly_buffer->latest, 1U);
+  atomic_init(&assembly_buffer->sequence, 0U);
+  atomic_init(&assembly_buffer->write_request_head, 0U);
+  atomic_init(&assembly_buffer->write_request_tail, 0U);
+
+  /* attribute 3 follows the buffer owned by the OpENer thread */
+  EipUint8 *const opener_data =
+    AssemblyBufferData(assembly_buffer,
+                       kAssemblyBufferProducedByApplication == direction ?
+                       assembly_buffer->front : assembly_buffer->back);
+  CipInstance *const instance = CreateAssemblyObject(instance_id,
+                                                     opener_data,
+                                                     data_length);
+  if(NULL == instance) {
+    OPENER_TRACE_ERR("Could not create buffered assembly %u\n",
+                     (unsigned) instance_id);
+    return NULL;
+  }
+  assembly_buffer->byte_array =
+    (CipByteArray *) GetCipAttribute(instance, 3)->data;
+  return instance;
+}
+
+void AssemblyBufferPublish(AssemblyBuffer *const assembly_buffer) {
+  const unsigned int published = assembly_buffer->back;
+
+  atomic_store(&assembly_buffer->latest, published);
+  atomic_fetch_add(&assembly_buffer->sequence, 1U);
+  assembly_buffer->back =
+    atomic_exchange(&assembly_buffer->middle,
+                    published | kAssemblyBufferFresh) &
+    kAssemblyBufferIndexMask;
+  /* the old contents of the new back buffer may still be copied by
+   * AssemblyBufferRead(), which detects this by the changed sequence */
+  atomic_thread_fence(memory_order_seq_cst);
+
+  memcpy(AssemblyBufferData(assembly_buffer, assembly_buffer->back),
+         AssemblyBufferData(assembly_buffer, published),
+         assembly_buffer->data_length);
+  if(kAssemblyBufferConsumedByApplication == assembly_buffer->direction) {
+    assembly_buffer->byte_array->data =
+      AssemblyBufferData(assembly_buffer, assembly_buffer->back);
+  }
+}
+
+EipBool8 AssemblyBufferAcquire(AssemblyBuffer *const assembly_buffer) {
+  if(0 == (atomic_load(&assembly_buffer->middle) & kAssemblyBufferFresh) ) {
+    return false;
+  }
+  assembly_buffer->front =
+    atomic_exchange(&assembly_buffer->middle, assembly_buffer->front) &
+    kAssemblyBufferIndexMask;
+  if(kAssemblyBufferProducedByApplication == assembly_buffer->direction) {
+    assembly_buffer->byte_array->data =
+      AssemblyBufferData(assembly_buffer, assembly_buffer->front);
+  }
+  return true;
+}
+
+EipBool8 AssemblyBufferService(AssemblyBuffer *const assembly_buffer) {
+  unsigned int tail = atomic_load(&assembly_buffer->write_request_tail);
+  const unsigned int head = atomic_load(&assembly_buffer->write_request_head);
+
+  if(tail == head) {
+    return false;
+  }
+  EipUint8 *const back_data = AssemblyBufferData(assembly_buffer,
+                                                 assembly_buffer->back);
+  for(; tail != head; tail++) {
+    const unsigned int slot = tail % OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH;
+    const AssemblyBufferWriteRequest *const request =
+      &assembly_buffer->write_requests[slot];
+    memcpy(back_data + request->offset,
+           AssemblyBufferWriteRequestData(assembly_buffer, slot),
+           request->length);
+  }
+  AssemblyBufferPublish(assembly_buffer);
+  /* release the slots only after the writes are visible */
+  atomic_store(&assembly_buffer->write_request_tail, tail);
+  return true;
+}
+
+EipStatus AssemblyBufferRead(AssemblyBuffer *const assembly_buffer,
+                             const size_t offset,
+                             EipUint8 *const data,
+                             const size_t length) {
+  if(!AssemblyBufferRangeValid(assembly_buffer, offset, length) ) {
+    return kEipStatusError;
+  }
+  /* the latest buffer is only reused by the writer after a further publish,
+   * retry if that happened during the copy */
+  unsigned int sequence = 0;
+  do {
+    sequence = atomic_load(&assembly_buffer->sequence);
+    const unsigned int latest = atomic_load(&assembly_buffer->latest);
+    memcpy(data, AssemblyBufferData(assembly_buffer, latest) + offset, length);
+    atomic_thread_fence(memory_order_seq_cst);
+  } while(sequence != atomic_load(&assembly_buffer->sequence) );
+  return kEipStatusOk;
+}
+
+EipStatus AssemblyBufferWrite(AssemblyBuffer *const assembly_buffer,
+                              const size_t offset,
+                              const EipUint8 *const data,
+                              const size_t length) {
+  if(!AssemblyBufferRangeValid(assembly_buffer, offset, length) ) {
+    return kEipStatusError;
+  }
+
+  if(kAssemblyBufferProducedByApplication == assembly_buffer->direction) {
+    memcpy(AssemblyBufferData(assembly_buffer, assembly_buffer->back) + offset,
+           data,
+           length);
+    AssemblyBufferPublish(assembly_buffer);
+    return kEipStatusOk;
+  }
+
+  const unsigned int head = atomic_load(&assembly_buffer->write_request_head);
+  if(head - atomic_load(&assembly_buffer->write_request_tail) >=
+     OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH) {
+    OPENER_TRACE_WARN("Assembly write queue full\n");
+    return kEipStatusError;
+  }
+  const unsigned int slot = head % OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH;
+  assembly_buffer->write_requests[slot].offset = (EipUint16) offset;
+  assembly_buffer->write_requests[slot].length = (EipUint16) length;
+  memcpy(AssemblyBufferWriteRequestData(assembly_buffer, slot), data, length);
+  atomic_store(&assembly_buffer->write_request_head, head + 1U);
+  return kEipStatusOk;
+}
+
+EipBool8 AssemblyBufferWritePending(AssemblyBuffer *const assembly_buffer) {
+  return atomic_load(&assembly_buffer->write_request_head) !=
+         atomic_load(&assembly_buffer->write_request_tail);
+}
@@ -0,0 +1,168 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_CIPASSEMBLYBUFFER_H_
+#define OPENER_CIPASSEMBLYBUFFER_H_
+
+/** @file cipassemblybuffer.h
+ *  @brief Triple buffered assembly data shared between application tasks and
+ *  the OpENer thread
+ *
+ *  An assembly buffer holds three copies of the assembly data. One side
+ *  writes into its private back buffer and publishes it with one atomic
+ *  exchange, the other side picks up the latest published buffer with one
+ *  atomic exchange. Neither side ever waits for the other, and the side
+ *  reading always sees a complete snapshot.
+ *
+ *  The OpENer thread takes one side, depending on the direction:
+ *  - kAssemblyBufferProducedByApplication (input assemblies): the
+ *    application writes, OpENer acquires the latest data before sending.
+ *    Attribute 3 of the assembly points to the acquired buffer.
+ *  - kAssemblyBufferConsumedByApplication (output and configuration
+ *    assemblies): OpENer writes received data and publishes it with
+ *    AssemblyBufferPublish() from AfterAssemblyDataReceived(). Attribute 3
+ *    points to the back buffer. Application writes are queued and applied by
+ *    AssemblyBufferService() on the OpENer thread.
+ *
+ *  Any task may take a copy of the latest published data with
+ *  AssemblyBufferRead(). Application side writers of one buffer have to be
+ *  serialized by the application, this never involves the OpENer thread.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+
+#include "typedefs.h"
+#include "ciptypes.h"
+#include "opener_user_conf.h"
+
+/** @brief Number of application writes that can be queued for an assembly
+ *  written by the OpENer thread, a power of two */
+#ifndef OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH
+  #define OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH 4
+#endif
+
+/** @brief Size of the storage needed for an assembly buffer
+ *
+ *  @param data_length Size of the assembly data in bytes
+ */
+#define ASSEMBLY_BUFFER_STORAGE_SIZE(data_length) \
+  ( (3U + OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH) * (data_length) )
+
+typedef enum {
+  kAssemblyBufferProducedByApplication, /**< application writes, OpENer sends */
+  kAssemblyBufferConsumedByApplication /**< OpENer receives, application reads */
+} AssemblyBufferDirection;
+
+/** @brief Queued application write of an assembly written by OpENer */
+typedef struct {
+  EipUint16 offset;
+  EipUint16 length;
+} AssemblyBufferWriteRequest;
+
+typedef struct {
+  CipByteArray *byte_array; /**< attribute 3 of the assembly instance */
+  AssemblyBufferDirection direction;
+  EipUint8 *storage; /**< ASSEMBLY_BUFFER_STORAGE_SIZE(data_length) bytes */
+  EipUint16 data_length;
+  unsigned int back; /**< buffer index owned by the writing side */
+  unsigned int front; /**< buffer index owned by the acquiring side */
+  atomic_uint middle; /**< published buffer index and fresh flag */
+  atomic_uint latest; /**< index of the most recently published buffer */
+  atomic_uint sequence; /**< incremented on every publish */
+  AssemblyBufferWriteRequest write_requests[
+    OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH];
+  atomic_uint write_request_head; /**< advanced by the application */
+  atomic_uint write_request_tail; /**< advanced by the OpENer thread */
+} AssemblyBuffer;
+
+/** @brief Creates an assembly object backed by a triple buffer
+ *
+ *  Must be called from ApplicationInitialization(), like CreateAssemblyObject().
+ *
+ *  @param assembly_buffer The assembly buffer to initialize
+ *  @param instance_id Instance number of the assembly object
+ *  @param storage Zero initialized memory of
+ *  ASSEMBLY_BUFFER_STORAGE_SIZE(data_length) bytes, owned by the buffer
+ *  @param data_length Size of the assembly data in bytes
+ *  @param direction Which side writes the assembly data
+ *  @return The assembly instance, or NULL on error
+ */
+CipInstance *CreateAssemblyBufferObject(AssemblyBuffer *const assembly_buffer,
+                                        const CipInstanceNum instance_id,
+                                        EipUint8 *const storage,
+                                        const EipUint16 data_length,
+                                        const AssemblyBufferDirection direction);
+
+/** @brief Publishes the back buffer of the writing side
+ *
+ *  Called by the OpENer thread from AfterAssemblyDataReceived() for buffers
+ *  consumed by the application. The new back buffer starts as a copy of the
+ *  published data.
+ *
+ *  @param assembly_buffer The assembly buffer
+ */
+void AssemblyBufferPublish(AssemblyBuffer *const assembly_buffer);
+
+/** @brief Picks up the latest published data on the acquiring side
+ *
+ *  Called by the OpENer thread from BeforeAssemblyDataSend() for buffers
+ *  produced by the application.
+ *
+ *  @param assembly_buffer The assembly buffer
+ *  @return true if new data has been published since the last call
+ */
+EipBool8 AssemblyBufferAcquire(AssemblyBuffer *const assembly_buffer);
+
+/** @brief Applies queued application writes, called by the OpENer thread
+ *  from HandleApplication() for buffers consumed by the application
+ *
+ *  @param assembly_buffer The assembly buffer
+ *  @return true if writes have been applied
+ */
+EipBool8 AssemblyBufferService(AssemblyBuffer *const assembly_buffer);
+
+/** @brief Copies a range of the latest published data, from any task
+ *
+ *  @param assembly_buffer The assembly buffer
+ *  @param offset First byte to copy
+ *  @param data Destination of length bytes
+ *  @param length Number of bytes to copy
+ *  @return kEipStatusError if the range exceeds the assembly data
+ */
+EipStatus AssemblyBufferRead(AssemblyBuffer *const assembly_buffer,
+                             const size_t offset,
+                             EipUint8 *const data,
+                             const size_t length);
+
+/** @brief Writes a range of the assembly data from the application
+ *
+ *  For buffers produced by the application the data is published right away.
+ *  For buffers consumed by the application the write is queued for the OpENer
+ *  thread, see AssemblyBufferWritePending(). Calls for the same buffer must
+ *  be serialized by the application.
+ *
+ *  @param assembly_buffer The assembly buffer
+ *  @param offset First byte to write
+ *  @param data Source of length bytes
+ *  @param length Number of bytes to write
+ *  @return kEipStatusError if the range exceeds the assembly data or the
+ *  write queue is full
+ */
+EipStatus AssemblyBufferWrite(AssemblyBuffer *const assembly_buffer,
+                              const size_t offset,
+                              const EipUint8 *const data,
+                              const size_t length);
+
+/** @brief Checks for queued application writes not yet applied by the
+ *  OpENer thread
+ *
+ *  @param assembly_buffer The assembly buffer
+ *  @return true if writes are pending
+ */
+EipBool8 AssemblyBufferWritePending(AssemblyBuffer *const assembly_buffer);
+
+#endif /* OPENER_CIPASSEMBLYBUFFER_H_ */
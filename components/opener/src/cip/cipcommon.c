@@ -20,10 +20,13 @@
 #include "ciperror.h"
 #include "cipassembly.h"
 #include "cipmessagerouter.h"
+#include "cipobjectindex.h"
+#include "ciparena.h"
 #if defined(OPENER_IS_DLR_DEVICE) && 0 != OPENER_IS_DLR_DEVICE
   #include "cipdlr.h"
 #endif
 #include "cipqos.h"
+#include "cipperf.h"
 #include "cpf.h"
 #include "trace.h"
 #include "appcontype.h"
@@ -63,6 +66,10 @@ EipStatus CipStackInit(const EipUint16 unique_connection_id) {
 #endif
   eip_status = CipQoSInit();
   OPENER_ASSERT(kEipStatusOk == eip_status);
+#if defined(OPENER_PERF_TRACE) && 0 != OPENER_PERF_TRACE
+  eip_status = CipPerfTraceInit();
+  OPENER_ASSERT(kEipStatusOk == eip_status);
+#endif
 
 #if defined(CIP_FILE_OBJECT) && 0 != CIP_FILE_OBJECT
   eip_status = CipFileInit();
@@ -82,6 +89,15 @@ EipStatus CipStackInit(const EipUint16 unique_connection_id) {
   eip_status = ApplicationInitialization();
   OPENER_ASSERT(kEipStatusOk == eip_status);
 
+  CipArenaStatistics arena_statistics;
+  CipArenaGetStatistics(&arena_statistics);
+  OPENER_TRACE_INFO("CIP object arena: %zu of %zu bytes used\n",
+                    arena_statistics.used, arena_statistics.size);
+  if(0 != arena_statistics.heap_fallbacks) {
+    OPENER_TRACE_WARN("CIP object arena: %zu allocations on the heap\n",
+                      arena_statistics.heap_fallbacks);
+  }
+
   return eip_status;
 }
 
@@ -97,6 +113,8 @@ void ShutdownCipStack(void) {
 
   /*no clear all the instances and classes */
   DeleteAllClasses();
+  /* and release the memory they were allocated from */
+  CipArenaReset();
 }
 
 EipStatus NotifyClass(const CipClass *RESTRICT const cip_class,
@@ -115,25 +133,17 @@ EipStatus NotifyClass(const CipClass *RESTRICT const cip_class,
                       instance_number,
                       instance_number == 0 ? " (class object)" : "");
 
-    CipServiceStruct *service = instance->cip_class->services; /* get pointer to array of services */
-    if(NULL != service) /* if services are defined */
+    CipServiceStruct *service = ObjectIndexFindService(instance->cip_class,
+                                                       message_router_request->service);
+    if(NULL != service) /* if match is found */
     {
-      for(size_t i = 0; i < instance->cip_class->number_of_services; i++) /* seach the services list */
-      {
-        if(message_router_request->service == service->service_number) /* if match is found */
-        {
-          /* call the service, and return what it returns */
-          OPENER_TRACE_INFO("notify: calling %s service\n", service->name);
-          OPENER_ASSERT(NULL != service->service_function);
-          return service->service_function(instance,
-                                           message_router_request,
-                                           message_router_response,
-                                           originator_address,
-                                           encapsulation_session);
-        } else {
-          service++;
-        }
-      }
+      /* call the service, and return what it returns */
+      OPENER_TRACE_INFO("notify: calling %s service\n", service->name);
+      return service->service_function(instance,
+                                       message_router_request,
+                                       message_router_response,
+                                       originator_address,
+                                       encapsulation_session);
     } OPENER_TRACE_WARN(
       "notify: service 0x%x not supported\n", message_router_request->service);
     message_router_response->general_status = kCipErrorServiceNotSupported; /* if no services or service not found, return an error reply*/
@@ -177,35 +187,20 @@ CipInstance *AddCipInstances(CipClass *RESTRICT const cip_class,
                     cip_class->class_name);
 
   /* Allocate and initialize all needed instances one by one. */
+  next_instance = &cip_class->instances; /* set pointer to head of existing instances chain */
+  while(*next_instance) { /* as long as what next_instance points to is not zero */
+    next_instance = &(*next_instance)->next; /* get next instance in instances chain*/
+  }
+
   for(new_instances = 0; new_instances < number_of_instances; new_instances++) {
 
     /* Find next free instance number */
-    CipBool found_free_number = false;
-
-    while (!found_free_number) {
-      next_instance = &cip_class->instances;           /* set pointer to head of existing instances chain */
-
-      found_free_number = true; /* anticipate instance_number is not in use*/
-
-      /* loop through existing instances */
-      while (*next_instance)           /* as long as what next_instance points to is not zero */
-      {
-        /* check if instance number in use */
-        if(instance_number == (*next_instance)->instance_number) {
-          found_free_number = false;  /* instance number exists already */
-          break;
-        }
-        next_instance = &(*next_instance)->next;                /* get next instance in instances chain*/
-      }
-
-      if(!found_free_number) {
-        instance_number++;                         /* try next instance_number and loop again through existing instances */
-      }
-
+    while( NULL != GetCipInstance(cip_class, instance_number) ) {
+      instance_number++; /* try next instance_number */
     }
 
     CipInstance *current_instance =
-      (CipInstance *) CipCalloc( 1, sizeof(CipInstance) );
+      (CipInstance *) CipArenaCalloc( 1, sizeof(CipInstance) );
     OPENER_ASSERT(NULL != current_instance); /* fail if run out of memory */
     if(NULL == current_instance) {
       break;
@@ -219,15 +214,21 @@ CipInstance *AddCipInstances(CipClass *RESTRICT const cip_class,
 
     if(cip_class->number_of_attributes) /* if the class calls for instance attributes */
     { /* then allocate storage for the attribute array */
-      current_instance->attributes = (CipAttributeStruct *) CipCalloc(
+      current_instance->attributes = (CipAttributeStruct *) CipArenaCalloc(
         cip_class->number_of_attributes,
         sizeof(CipAttributeStruct) );
       OPENER_ASSERT(NULL != current_instance->attributes);/* fail if run out of memory */
       if(NULL == current_instance->attributes) {
+        CipArenaFree(current_instance); /* not linked into the chain yet */
         break;
       }
     }
 
+    if(kEipStatusOk != ObjectIndexInsertInstance(current_instance) ) {
+      CipArenaFree(current_instance->attributes); /* not linked into the chain yet */
+      CipArenaFree(current_instance);
+      break;
+    }
     *next_instance = current_instance; /* link the previous pointer to this new node */
     next_instance = &current_instance->next; /* update pp to point to the next link of the current node */
     cip_class->number_of_instances += 1; /* update the total number of instances recorded by the class */
@@ -254,7 +255,15 @@ CipInstance *AddCipInstance(CipClass *RESTRICT const cip_class,
 
   if(NULL == instance) { /*we have no instance with given id*/
     instance = AddCipInstances(cip_class, 1);
+    if(NULL == instance) {
+      return NULL;
+    }
+    ObjectIndexRemoveInstance(instance); /* re-sort under the new number */
     instance->instance_number = instance_id;
+    if(kEipStatusOk != ObjectIndexInsertInstance(instance) ) {
+      OPENER_TRACE_ERR("instance %" PRIu32 " of class %s not indexed\n",
+                       (EipUint32)instance_id, cip_class->class_name);
+    }
   }
 
   cip_class->max_instance = GetMaxInstanceNumber(cip_class); /* update largest instance number (class Attribute 2) */
@@ -286,8 +295,8 @@ CipClass *CreateCipClass(const CipUdint class_code,
      and contains a pointer to a metaclass
      CIP never explicitly addresses a metaclass*/
 
-  CipClass *const cip_class = (CipClass *) CipCalloc( 1, sizeof(CipClass) ); /* create the class object*/
-  CipClass *const meta_class = (CipClass *) CipCalloc( 1, sizeof(CipClass) ); /* create the metaclass object*/
+  CipClass *const cip_class = (CipClass *) CipArenaCalloc( 1, sizeof(CipClass) ); /* create the class object*/
+  CipClass *const meta_class = (CipClass *) CipArenaCalloc( 1, sizeof(CipClass) ); /* create the metaclass object*/
 
   /* initialize the class-specific fields of the Class struct*/
   cip_class->class_code = class_code; /* the class remembers the class ID */
@@ -304,7 +313,7 @@ CipClass *CreateCipClass(const CipUdint class_code,
   OPENER_ASSERT(NULL != name);
   const size_t name_len = strlen(name); /* Length does not include termination byte. */
   OPENER_ASSERT(0 < name_len); /* Cannot be an empty string. */
-  cip_class->class_name = CipCalloc(name_len + 1, 1); /* Allocate length plus termination byte. */
+  cip_class->class_name = CipArenaCalloc(name_len + 1, 1); /* Allocate length plus termination byte. */
   OPENER_ASSERT(NULL != cip_class->class_name);
 
   /*
@@ -323,7 +332,7 @@ CipClass *CreateCipClass(const CipUdint class_code,
   meta_class->number_of_attributes = number_of_class_attributes + 7; /* the metaclass remembers how many class attributes exist*/
   meta_class->highest_attribute_number = highest_class_attribute_number; /* indicate which attributes are included in class getAttributeAll*/
   meta_class->number_of_services = number_of_class_services; /* the metaclass manages the behavior of the class itself */
-  meta_class->class_name = (char *) CipCalloc(1, strlen(name) + 6); /* fabricate the name "meta<classname>"*/
+  meta_class->class_name = (char *) CipArenaCalloc(1, strlen(name) + 6); /* fabricate the name "meta<classname>"*/
   snprintf(meta_class->class_name, strlen(name) + 6, "meta-%s", name);
 
   /* initialize the instance-specific fields of the Class struct*/
@@ -339,16 +348,16 @@ CipClass *CreateCipClass(const CipUdint class_code,
 
   /* further initialization of the class object*/
 
-  cip_class->class_instance.attributes = (CipAttributeStruct *) CipCalloc(
+  cip_class->class_instance.attributes = (CipAttributeStruct *) CipArenaCalloc(
     meta_class->number_of_attributes,
     sizeof(CipAttributeStruct) );
   /* TODO -- check that we didn't run out of memory?*/
 
-  meta_class->services = (CipServiceStruct *) CipCalloc(
+  meta_class->services = (CipServiceStruct *) CipArenaCalloc(
     meta_class->number_of_services,
     sizeof(CipServiceStruct) );
 
-  cip_class->services = (CipServiceStruct *) CipCalloc(
+  cip_class->services = (CipServiceStruct *) CipArenaCalloc(
     cip_class->number_of_services,
     sizeof(CipServiceStruct) );
 
@@ -428,6 +437,7 @@ void InsertAttribute(CipInstance *const instance,
       attribute->data = data;
 
       OPENER_ASSERT(attribute_number <= cip_class->highest_attribute_number);
+      ObjectIndexInsertAttribute(cip_class, attribute_number, i);
 
       size_t index = CalculateIndex(attribute_number);
 
@@ -456,26 +466,35 @@ void InsertService(const CipClass *const cip_class,
                    const CipServiceFunction service_function,
                    char *const service_name) {
 
-  CipServiceStruct *service = cip_class->services; /* get a pointer to the service array*/
+  CipServiceStruct *services = cip_class->services; /* get a pointer to the service array*/
   OPENER_TRACE_INFO("%s, number of services:%d, service number:%d\n",
                     cip_class->class_name, cip_class->number_of_services,
                     service_number);
-  OPENER_ASSERT(service != NULL);
+  OPENER_ASSERT(services != NULL);
   /* adding a service to a class that was not declared to have services is not allowed*/
-  for(int i = 0; i < cip_class->number_of_services; i++) /* Iterate over all service slots attached to the class */
-  {
-    if(service->service_number == service_number ||
-       service->service_function == NULL)                                              /* found undefined service slot*/
-    {
-      service->service_number = service_number; /* fill in service number*/
-      service->service_function = service_function; /* fill in function address*/
-      service->name = service_name;
+  OPENER_ASSERT(NULL != service_function);
+  /* the array is kept sorted by service number for ObjectIndexFindService() */
+  const size_t position = ObjectIndexServicePosition(cip_class, service_number);
+  if(position >= cip_class->number_of_services) {
+    OPENER_ASSERT(false);
+    /* adding more services than were declared is a no-no*/
+    return;
+  }
+  CipServiceStruct *service = &services[position];
+  if(NULL != service->service_function &&
+     service->service_number != service_number) { /* make room for the service */
+    if(NULL != services[cip_class->number_of_services - 1].service_function) {
+      OPENER_ASSERT(false);
+      /* adding more services than were declared is a no-no*/
       return;
     }
-    ++service;
+    memmove( service + 1, service,
+             (cip_class->number_of_services - 1 - position) *
+             sizeof(CipServiceStruct) );
   }
-  OPENER_ASSERT(false);
-  /* adding more services than were declared is a no-no*/
+  service->service_number = service_number; /* fill in service number*/
+  service->service_function = service_function; /* fill in function address*/
+  service->name = service_name;
 }
 
 void InsertGetSetCallback(CipClass *const cip_class,
@@ -500,18 +519,12 @@ void InsertGetSetCallback(CipClass *const cip_class,
 CipAttributeStruct *GetCipAttribute(const CipInstance *const instance,
                                     const EipUint16 attribute_number) {
 
-  CipAttributeStruct *attribute = instance->attributes; /* init pointer to array of attributes*/
-  for(int i = 0; i < instance->cip_class->number_of_attributes; i++) {
-    if(attribute_number == attribute->attribute_number) {
-      return attribute;
-    } else {
-      ++attribute;
-    }
+  CipAttributeStruct *attribute = ObjectIndexFindAttribute(instance,
+                                                         attribute_number);
+  if(NULL == attribute) {
+    OPENER_TRACE_WARN("attribute %d not defined\n", attribute_number);
   }
-
-  OPENER_TRACE_WARN("attribute %d not defined\n", attribute_number);
-
-  return NULL;
+  return attribute;
 }
 
 void GenerateGetAttributeSingleHeader(
@@ -876,7 +889,9 @@ int DecodeCipByteArray(CipByteArray *const data,
     message_router_response->general_status = kCipErrorNotEnoughData;
     return number_of_decoded_bytes;
   }
-  if(message_router_request->request_data_size > data->length) {
+  /* in an attribute list, the data of further attributes follows */
+  if(kSetAttributeList != message_router_request->service &&
+     message_router_request->request_data_size > data->length) {
     OPENER_TRACE_INFO(
       "DecodeCipByteArray: too much data received.\n");
     message_router_response->general_status = kCipErrorTooMuchData;
@@ -1060,15 +1075,7 @@ int DecodeCipShortString(CipShortString *data,
 
 CipServiceStruct *GetCipService(const CipInstance *const instance,
                                 CipUsint service_number) {
-  CipServiceStruct *service = instance->cip_class->services;
-  for(size_t i = 0; i < instance->cip_class->number_of_services; i++) /* hunt for the GET_ATTRIBUTE_SINGLE service*/
-  {
-    if(service->service_number == service_number) {
-      return service; /* found the service */
-    }
-    service++;
-  }
-  return NULL; /* didn't find the service */
+  return ObjectIndexFindService(instance->cip_class, service_number);
 }
 
 EipStatus GetAttributeAll(CipInstance *instance,
@@ -1114,6 +1121,29 @@ EipStatus GetAttributeAll(CipInstance *instance,
   return kEipStatusOkSend;
 }
 
+size_t RemainingResponseSpace(const ENIPMessage *const message) {
+  const size_t reserved = message->used_message_length + 33U;
+  return reserved < PC_OPENER_ETHERNET_BUFFER_SIZE ?
+         PC_OPENER_ETHERNET_BUFFER_SIZE - reserved : 0;
+}
+
+/** @brief Writes the attribute count of an attribute list response into the
+ *  space reserved at its start
+ *
+ * @param count_position Start of the reserved space
+ * @param count Number of attributes in the response
+ * @param message The response message
+ */
+static void AddAttributeListCount(CipOctet *const count_position,
+                                  const CipUint count,
+                                  ENIPMessage *const message) {
+  CipOctet *const save_current_position = message->current_message_position;
+  message->current_message_position = count_position;
+  message->used_message_length -= 2; /* already counted by the reservation */
+  AddIntToMessage(count, message);
+  message->current_message_position = save_current_position;
+}
+
 EipStatus GetAttributeList(CipInstance *instance,
                            CipMessageRouterRequest *message_router_request,
                            CipMessageRouterResponse *message_router_response,
@@ -1123,53 +1153,75 @@ EipStatus GetAttributeList(CipInstance *instance,
   (void)originator_address;
   (void)encapsulation_session;
 
+  /* attribute data is encoded here first, so an attribute exceeding the
+   * response is detected before it is copied */
+  static ENIPMessage attribute_data;
+
   InitializeENIPMessage(&message_router_response->message);
   message_router_response->reply_service =
     (0x80 | message_router_request->service);
   message_router_response->general_status = kCipErrorSuccess;
   message_router_response->size_of_additional_status = 0;
 
+  if(message_router_request->request_data_size < sizeof(CipUint) ) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
   CipUint attribute_count_request = GetUintFromMessage(
     &message_router_request->data);
+  if(message_router_request->request_data_size <
+     sizeof(CipUint) * (1U + (size_t) attribute_count_request) ) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
 
   if(0 != attribute_count_request) {
-
-    EipUint16 attribute_number = 0;
-    CipAttributeStruct *attribute = NULL;
-
-    CipOctet *attribute_count_responst_position =
+    CipOctet *attribute_count_response_position =
       message_router_response->message.current_message_position;
 
     MoveMessageNOctets(sizeof(CipInt), &message_router_response->message);  // move the message pointer to reserve memory
 
     for(size_t j = 0; j < attribute_count_request; j++) {
-      attribute_number = GetUintFromMessage(&message_router_request->data);
-      attribute = GetCipAttribute(instance, attribute_number);
-
-      const int_fast64_t needed_message_space = NULL != attribute
-          ? (int_fast64_t) GetCipDataTypeLength(attribute->type,
-                                                attribute->data) : (int_fast64_t) (
-        2
-        *
-        sizeof(
-          CipSint) );
-
-      const int_fast64_t remaining_message_space =
-        (int_fast64_t) PC_OPENER_ETHERNET_BUFFER_SIZE -
-        (int_fast64_t)  message_router_response->message.used_message_length -
-        33LL;                                                                                                                                                                   //need 33 bytes extra space for the rest of the ENIP message
-      if (needed_message_space > remaining_message_space) {
-        message_router_response->message.used_message_length -= 2;  // Correct count from Move above
-        CipOctet *const save_current_position =
-          message_router_response->message.current_message_position;
-        message_router_response->message.current_message_position =
-          attribute_count_responst_position;
-        AddIntToMessage(attribute_count_request,
-                        &message_router_response
-                        ->message);       // Add current amount of attributes
-        message_router_response->message.current_message_position =
-          save_current_position;
-        // If there was not alreay an attribute list error, resturn partial
+      EipUint16 attribute_number =
+        GetUintFromMessage(&message_router_request->data);
+      CipAttributeStruct *attribute = GetCipAttribute(instance,
+                                                      attribute_number);
+      CipUsint attribute_status = kCipErrorAttributeNotSupported;
+
+      InitializeENIPMessage(&attribute_data);
+      if(NULL != attribute && NULL != attribute->data) {
+        uint8_t get_bit_mask =
+          (instance->cip_class->get_single_bit_mask[CalculateIndex(
+                                                      attribute_number)]);
+        if( 0 != ( get_bit_mask & ( 1 << (attribute_number % 8) ) ) ) { //check if attribute is gettable
+          /* Call the PreGetCallback if enabled for this attribute and the class provides one. */
+          if( (attribute->attribute_flags & kPreGetFunc) &&
+              NULL != instance->cip_class->PreGetCallback ) {
+            instance->cip_class->PreGetCallback(instance,
+                                                attribute,
+                                                message_router_request->service);
+          }
+          attribute->encode(attribute->data, &attribute_data);
+          attribute_status = kCipErrorSuccess;
+          /* Call the PostGetCallback if enabled for this attribute and the class provides one. */
+          if( (attribute->attribute_flags & kPostGetFunc) &&
+              NULL != instance->cip_class->PostGetCallback ) {
+            instance->cip_class->PostGetCallback(instance,
+                                                 attribute,
+                                                 message_router_request->service);
+          }
+        } else {
+          attribute_status = kCipErrorAttributeNotGettable;
+        }
+      }
+
+      /* Attribute-ID, status, reserved byte and data */
+      if(4U + attribute_data.used_message_length >
+         RemainingResponseSpace(&message_router_response->message) ) {
+        AddAttributeListCount(attribute_count_response_position,
+                              (CipUint) j,
+                              &message_router_response->message);
+        // If there was not already an attribute list error, return partial
         // transfer
         if (message_router_response->general_status !=
             kCipErrorAttributeListError) {
@@ -1179,40 +1231,22 @@ EipStatus GetAttributeList(CipInstance *instance,
       }
 
       AddIntToMessage(attribute_number, &message_router_response->message);  // Attribute-ID
-
-      if(NULL != attribute) {
-        uint8_t get_bit_mask =
-          (instance->cip_class->get_single_bit_mask[CalculateIndex(
-                                                      attribute_number)]);
-        if( 0 != ( get_bit_mask & ( 1 << (attribute_number % 8) ) ) ) { //check if attribute is gettable
-          AddSintToMessage(kCipErrorSuccess, &message_router_response->message); // Attribute status
-          AddSintToMessage(0, &message_router_response->message); // Reserved, shall be 0
-          attribute->encode(attribute->data, &message_router_response->message); // write Attribute data to response
-        } else {
-          AddSintToMessage(kCipErrorAttributeNotGettable,
-                           &message_router_response->message);                                // Attribute status
-          AddSintToMessage(0, &message_router_response->message); // Reserved, shall be 0
-          message_router_response->general_status = kCipErrorAttributeListError;
-        }
-
+      AddSintToMessage(attribute_status, &message_router_response->message); // Attribute status
+      AddSintToMessage(0, &message_router_response->message); // Reserved, shall be 0
+      if(kCipErrorSuccess == attribute_status) {
+        memcpy(message_router_response->message.current_message_position,
+               attribute_data.message_buffer,
+               attribute_data.used_message_length);
+        MoveMessageNOctets( (int) attribute_data.used_message_length,
+                            &message_router_response->message );
       } else {
-        AddSintToMessage(kCipErrorAttributeNotSupported,
-                         &message_router_response->message);                                 // status
-        AddSintToMessage(0, &message_router_response->message); // Reserved, shall be 0
         message_router_response->general_status = kCipErrorAttributeListError;
       }
     }
     // If we are there, we returned all elements
-    message_router_response->message.used_message_length -= 2;  // Correct count from Move above
-    CipOctet *const save_current_position =
-      message_router_response->message.current_message_position;
-    message_router_response->message.current_message_position =
-      attribute_count_responst_position;
-    AddIntToMessage(
-      attribute_count_request,
-      &message_router_response->message);    // Add current amount of attributes
-    message_router_response->message.current_message_position =
-      save_current_position;
+    AddAttributeListCount(attribute_count_response_position,
+                          attribute_count_request,
+                          &message_router_response->message);
   } else {
     message_router_response->general_status = kCipErrorAttributeListError;
   }
@@ -1220,6 +1254,32 @@ EipStatus GetAttributeList(CipInstance *instance,
   return kEipStatusOkSend;
 }
 
+/** @brief Returns the number of request bytes the value of an attribute
+ *  takes, 0 if the type does not tell
+ *
+ * @param attribute The attribute to be set
+ * @param data The attribute value in the request
+ * @param remaining Number of request bytes from data on
+ */
+static size_t AttributeRequestLength(const CipAttributeStruct *const attribute,
+                                     const CipOctet *const data,
+                                     const size_t remaining) {
+  switch(attribute->type) {
+    case kCipByteArray:
+      return GetCipDataTypeLength(attribute->type, attribute->data);
+    case kCipString:
+    case kCipString2:
+    case kCipStringN:
+    case kCipEpath:
+      /* the length field itself has to be there before it is read */
+      return remaining < 2U ? 2U : GetCipDataTypeLength(attribute->type, data);
+    case kCipShortString:
+      return remaining < 1U ? 1U : GetCipDataTypeLength(attribute->type, data);
+    default:
+      return GetCipDataTypeLength(attribute->type, data);
+  }
+}
+
 EipStatus SetAttributeList(CipInstance *instance,
                            CipMessageRouterRequest *message_router_request,
                            CipMessageRouterResponse *message_router_response,
@@ -1235,48 +1295,36 @@ EipStatus SetAttributeList(CipInstance *instance,
   message_router_response->general_status = kCipErrorSuccess;
   message_router_response->size_of_additional_status = 0;
 
+  if(message_router_request->request_data_size < sizeof(CipUint) ) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
+  const CipOctet *const request_end = message_router_request->data +
+                                      message_router_request->request_data_size;
   CipUint attribute_count_request = GetUintFromMessage(
     &message_router_request->data);
 
   if(0 != attribute_count_request) {
-
-    EipUint16 attribute_number = 0;
-    CipAttributeStruct *attribute = NULL;
-
-    CipOctet *attribute_count_responst_position =
+    CipOctet *attribute_count_response_position =
       message_router_response->message.current_message_position;
 
     MoveMessageNOctets(sizeof(CipInt), &message_router_response->message);  // move the message pointer to reserve memory
 
     for(size_t j = 0; j < attribute_count_request; j++) {
-      attribute_number = GetUintFromMessage(&message_router_request->data);
-      attribute = GetCipAttribute(instance, attribute_number);
-
-      const int_fast64_t needed_message_space = NULL != attribute
-          ? (int_fast64_t) GetCipDataTypeLength(attribute->type,
-                                                attribute->data) : (int_fast64_t) (
-        2
-        *
-        sizeof(
-          CipSint) );
-
-      const int_fast64_t remaining_message_space =
-        (int_fast64_t) PC_OPENER_ETHERNET_BUFFER_SIZE -
-        (int_fast64_t)  message_router_response->message.used_message_length -
-        33LL;                                                                                                                                                                   //need 33 bytes extra space for the rest of the ENIP message
-      if (needed_message_space > remaining_message_space) {
-        message_router_response->message.used_message_length -= 2;   // Correct count from Move above
-        CipOctet *const save_current_position =
-          message_router_response->message.current_message_position;
-        message_router_response->message.current_message_position =
-          attribute_count_responst_position;
-        AddIntToMessage(attribute_count_request,
-                        &message_router_response
-                        ->message);       // Add current amount of attributes
-        message_router_response->message.current_message_position =
-          save_current_position;
-        // If there was not alreay an attribute list error, resturn partial
-        // transfer
+      size_t remaining = request_end > message_router_request->data ?
+                         (size_t) (request_end - message_router_request->data) :
+                         0U;
+      if(remaining < sizeof(CipUint) ) {
+        AddAttributeListCount(attribute_count_response_position,
+                              (CipUint) j,
+                              &message_router_response->message);
+        message_router_response->general_status = kCipErrorNotEnoughData;
+        return kEipStatusOkSend;
+      }
+      if(4U > RemainingResponseSpace(&message_router_response->message) ) {
+        AddAttributeListCount(attribute_count_response_position,
+                              (CipUint) j,
+                              &message_router_response->message);
         if (message_router_response->general_status !=
             kCipErrorAttributeListError) {
           message_router_response->general_status = kCipErrorPartialTransfer;
@@ -1284,54 +1332,93 @@ EipStatus SetAttributeList(CipInstance *instance,
         return kEipStatusOkSend;
       }
 
-      AddIntToMessage(attribute_number, &message_router_response->message); // Attribute-ID
+      EipUint16 attribute_number =
+        GetUintFromMessage(&message_router_request->data);
+      remaining -= sizeof(CipUint);
+      CipAttributeStruct *attribute = GetCipAttribute(instance,
+                                                      attribute_number);
 
-      if(NULL != attribute) {
+      AddIntToMessage(attribute_number, &message_router_response->message); // Attribute-ID
 
+      /* the data of an unknown attribute or of a failed decode cannot be
+       * skipped, so the remaining attributes are not processed */
+      bool stop_processing = false;
+      CipUsint attribute_status = kCipErrorSuccess;
+      if(NULL == attribute || NULL == attribute->data) {
+        attribute_status = kCipErrorAttributeNotSupported;
+        stop_processing = true;
+      } else if(AttributeRequestLength(attribute, message_router_request->data,
+                                       remaining) > remaining) {
+        attribute_status = kCipErrorNotEnoughData;
+        stop_processing = true;
+      } else {
         uint8_t set_bit_mask =
           (instance->cip_class->set_bit_mask[CalculateIndex(attribute_number)]);
         if( 0 != ( set_bit_mask & ( 1 << (attribute_number % 8) ) ) ) { //check if attribute is settable
-          AddSintToMessage(kCipErrorSuccess, &message_router_response->message); // Attribute status
-          AddSintToMessage(0, &message_router_response->message); // Reserved, shall be 0
-          attribute->decode(attribute->data,
-                            message_router_request,
-                            message_router_response);                                          // write data to attribute
-        } else {
-          AddSintToMessage(kCipErrorAttributeNotSetable,
-                           &message_router_response->message);                               // Attribute status
-          AddSintToMessage(0, &message_router_response->message); // Reserved, shall be 0
+          /* Call the PreSetCallback if enabled for this attribute and the class provides one. */
+          if( (attribute->attribute_flags & kPreSetFunc) &&
+              NULL != instance->cip_class->PreSetCallback ) {
+            instance->cip_class->PreSetCallback(instance,
+                                                attribute,
+                                                message_router_request->service);
+          }
 
+          /* the decoder sees the request from its value on and reports
+           * its result in the general status. Not all decoders advance the
+           * data pointer, so it is moved by the decoded bytes here. */
+          const CipUsint list_status = message_router_response->general_status;
+          const CipOctet *const attribute_data = message_router_request->data;
+          message_router_request->request_data_size = remaining;
+          const int decoded_bytes = attribute->decode(attribute->data,
+                                                      message_router_request,
+                                                      message_router_response);                                          // write data to attribute
+          attribute_status = message_router_response->general_status;
+          message_router_response->general_status = list_status;
+          if(decoded_bytes >= 0) {
+            message_router_request->data = attribute_data + decoded_bytes;
+          }
+
+          if(kCipErrorSuccess == attribute_status) {
+            /* Call the PostSetCallback if enabled for this attribute and the class provides one. */
+            if( ( attribute->attribute_flags & (kPostSetFunc | kNvDataFunc) ) &&
+                NULL != instance->cip_class->PostSetCallback ) {
+              instance->cip_class->PostSetCallback(instance,
+                                                   attribute,
+                                                   message_router_request->service);
+            }
+          } else if(decoded_bytes < 0) {
+            stop_processing = true;
+          }
+        } else {
+          attribute_status = kCipErrorAttributeNotSetable;
           //move request message pointer
-          size_t attribute_data_length = GetCipDataTypeLength(attribute->type,
-                                                              message_router_request->data);
+          size_t attribute_data_length = AttributeRequestLength(attribute,
+                                                                message_router_request->data,
+                                                                remaining);
           if(0 != attribute_data_length) {
             message_router_request->data += attribute_data_length;
-            message_router_response->general_status =
-              kCipErrorAttributeListError;
           } else {
-            message_router_response->general_status = kCipErrorPartialTransfer;
-            return kEipStatusOkSend;
+            stop_processing = true;
           }
         }
-      } else {
-        AddSintToMessage(kCipErrorAttributeNotSupported,
-                         &message_router_response->message);                                 // status
-        AddSintToMessage(0, &message_router_response->message); // Reserved, shall be 0
+      }
+
+      AddSintToMessage(attribute_status, &message_router_response->message); // Attribute status
+      AddSintToMessage(0, &message_router_response->message); // Reserved, shall be 0
+      if(kCipErrorSuccess != attribute_status) {
         message_router_response->general_status = kCipErrorAttributeListError;
       }
+      if(stop_processing) {
+        AddAttributeListCount(attribute_count_response_position,
+                              (CipUint) (j + 1),
+                              &message_router_response->message);
+        return kEipStatusOkSend;
+      }
     }
     // If we are there, we returned all elements
-    message_router_response->message.used_message_length -=
-      2;    // Correct count from Move above
-    CipOctet *const save_current_position =
-      message_router_response->message.current_message_position;
-    message_router_response->message.current_message_position =
-      attribute_count_responst_position;
-    AddIntToMessage(
-      attribute_count_request,
-      &message_router_response->message);    // Add current amount of attributes
-    message_router_response->message.current_message_position =
-      save_current_position;
+    AddAttributeListCount(attribute_count_response_position,
+                          attribute_count_request,
+                          &message_router_response->message);
   } else {
     message_router_response->general_status = kCipErrorAttributeListError;
   }
@@ -1557,13 +1644,15 @@ EipStatus CipDeleteService(CipInstance *RESTRICT const instance,
       }
     }
 
+    ObjectIndexRemoveInstance(instance);
+
     /* Call the PostDeleteCallback if the class provides one. */
     if (NULL != class->PostDeleteCallback) {
       class->PostDeleteCallback(instance, message_router_request,
                                 message_router_response);
     }
 
-    CipFree(instance);  // delete instance
+    CipArenaFree(instance);  // delete instance
 
     class->number_of_instances--; /* update the total number of instances
                                             recorded by the class - Attr. 3 */
@@ -1615,9 +1704,10 @@ void AllocateAttributeMasks(CipClass *target_class) {
   OPENER_TRACE_INFO(
     ">>> Allocate memory for %s %zu bytes times 3 for masks\n",
     target_class->class_name, size);
-  target_class->get_single_bit_mask = CipCalloc( size, sizeof(uint8_t) );
-  target_class->set_bit_mask = CipCalloc( size, sizeof(uint8_t) );
-  target_class->get_all_bit_mask = CipCalloc( size, sizeof(uint8_t) );
+  target_class->get_single_bit_mask = CipArenaCalloc( size, sizeof(uint8_t) );
+  target_class->set_bit_mask = CipArenaCalloc( size, sizeof(uint8_t) );
+  target_class->get_all_bit_mask = CipArenaCalloc( size, sizeof(uint8_t) );
+  ObjectIndexAllocateAttributeSlots(target_class);
 }
 
 size_t CalculateIndex(EipUint16 attribute_number) {
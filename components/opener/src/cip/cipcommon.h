@@ -108,6 +108,14 @@ EipStatus GetAttributeAll(CipInstance *instance,
                           const struct sockaddr *originator_address,
                           const CipSessionHandle encapsulation_session);
 
+/** @brief Bytes left in an explicit message response
+ *
+ * Keeps 33 bytes for the encapsulation, CPF and message router headers.
+ * @param message The message router response message
+ * @return Number of bytes that can still be added
+ */
+size_t RemainingResponseSpace(const ENIPMessage *const message);
+
 /** @brief Generic implementation of the GetAttributeList CIP service
  *
  * Copy the contents of the selected gettable attributes of the specified
@@ -0,0 +1,174 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "cipconnectionindex.h"
+
+#include "opener_user_conf.h"
+#include "trace.h"
+
+/** @brief Number of slots per table, a power of two with a load factor of at
+ *  most one half */
+enum {
+  kConnectionIndexMinimumSize = 2 * OPENER_CIP_NUM_ACTIVE_CONNECTIONS,
+  kConnectionIndexSize =
+    (kConnectionIndexMinimumSize <= 16) ? 16 :
+    (kConnectionIndexMinimumSize <= 32) ? 32 :
+    (kConnectionIndexMinimumSize <= 64) ? 64 :
+    (kConnectionIndexMinimumSize <= 128) ? 128 :
+    (kConnectionIndexMinimumSize <= 256) ? 256 : 512,
+  kConnectionIndexMask = kConnectionIndexSize - 1
+};
+
+typedef struct {
+  const CipConnectionObject *connection_object; /**< NULL marks a free slot */
+  uint32_t hash; /**< hash of the key at insertion time */
+} ConnectionIndexSlot;
+
+typedef struct {
+  ConnectionIndexSlot slots[kConnectionIndexSize];
+} ConnectionIndexTable;
+
+static ConnectionIndexTable s_consumed_connection_id_index;
+static ConnectionIndexTable s_triad_index;
+
+/** @brief Mixes a 32 bit key (finalizer of MurmurHash3) */
+static uint32_t ConnectionIndexMix(uint32_t key) {
+  key ^= key >> 16;
+  key *= 0x85EBCA6BU;
+  key ^= key >> 13;
+  key *= 0xC2B2AE35U;
+  key ^= key >> 16;
+  return key;
+}
+
+static uint32_t ConnectionIndexHashTriad(
+  const CipConnectionObject *const connection_object) {
+  uint32_t key = ConnectionIndexMix(connection_object->originator_serial_number);
+  key ^= ( (uint32_t) connection_object->originator_vendor_id << 16 ) |
+         connection_object->connection_serial_number;
+  return ConnectionIndexMix(key);
+}
+
+static void ConnectionIndexTableInsert(ConnectionIndexTable *const table,
+                                       const CipConnectionObject *const connection_object,
+                                       const uint32_t hash) {
+  size_t slot = hash & kConnectionIndexMask;
+  for(size_t probes = 0; probes < kConnectionIndexSize; probes++) {
+    if(NULL == table->slots[slot].connection_object) {
+      table->slots[slot].connection_object = connection_object;
+      table->slots[slot].hash = hash;
+      return;
+    }
+    if(connection_object == table->slots[slot].connection_object) {
+      return; /* already indexed */
+    }
+    slot = (slot + 1) & kConnectionIndexMask;
+  }
+  OPENER_TRACE_ERR("Connection index full, connection not indexed\n");
+}
+
+/** @brief Removes a connection, shifting back following entries of the probe
+ *  sequence so no tombstones are needed
+ *
+ *  The slot is searched by pointer, so removal works even if the key fields of
+ *  the connection were changed while it was indexed.
+ */
+static void ConnectionIndexTableRemove(ConnectionIndexTable *const table,
+                                       const CipConnectionObject *const connection_object)
+{
+  size_t hole = 0;
+  while(hole < kConnectionIndexSize &&
+        connection_object != table->slots[hole].connection_object) {
+    hole++;
+  }
+  if(kConnectionIndexSize == hole) {
+    return;
+  }
+  table->slots[hole].connection_object = NULL;
+
+  size_t slot = (hole + 1) & kConnectionIndexMask;
+  for(size_t probes = 1;
+      probes < kConnectionIndexSize &&
+      NULL != table->slots[slot].connection_object;
+      probes++) {
+    size_t home = table->slots[slot].hash & kConnectionIndexMask;
+    /* move the entry if the hole lies cyclically between its home slot and
+     * its current slot */
+    if( ( (slot - home) & kConnectionIndexMask ) >=
+        ( (slot - hole) & kConnectionIndexMask ) ) {
+      table->slots[hole] = table->slots[slot];
+      table->slots[slot].connection_object = NULL;
+      hole = slot;
+    }
+    slot = (slot + 1) & kConnectionIndexMask;
+  }
+}
+
+void ConnectionIndexInit(void) {
+  memset(&s_consumed_connection_id_index, 0,
+         sizeof(s_consumed_connection_id_index) );
+  memset(&s_triad_index, 0, sizeof(s_triad_index) );
+}
+
+void ConnectionIndexInsert(const CipConnectionObject *const connection_object)
+{
+  ConnectionIndexTableInsert(&s_consumed_connection_id_index,
+                             connection_object,
+                             ConnectionIndexMix(
+                               connection_object->cip_consumed_connection_id) );
+  ConnectionIndexTableInsert(&s_triad_index, connection_object,
+                             ConnectionIndexHashTriad(connection_object) );
+}
+
+void ConnectionIndexRemove(const CipConnectionObject *const connection_object)
+{
+  ConnectionIndexTableRemove(&s_consumed_connection_id_index,
+                             connection_object);
+  ConnectionIndexTableRemove(&s_triad_index, connection_object);
+}
+
+CipConnectionObject *ConnectionIndexFindByConsumedConnectionId(
+  const CipUdint connection_id) {
+  const uint32_t hash = ConnectionIndexMix(connection_id);
+  size_t slot = hash & kConnectionIndexMask;
+  for(size_t probes = 0; probes < kConnectionIndexSize; probes++) {
+    const ConnectionIndexSlot *entry =
+      &s_consumed_connection_id_index.slots[slot];
+    if(NULL == entry->connection_object) {
+      break;
+    }
+    if(hash == entry->hash &&
+       connection_id == entry->connection_object->cip_consumed_connection_id &&
+       kConnectionObjectStateEstablished ==
+       ConnectionObjectGetState(entry->connection_object) ) {
+      return (CipConnectionObject *) entry->connection_object;
+    }
+    slot = (slot + 1) & kConnectionIndexMask;
+  }
+  return NULL;
+}
+
+CipConnectionObject *ConnectionIndexFindByTriad(
+  const CipConnectionObject *const connection_object) {
+  const uint32_t hash = ConnectionIndexHashTriad(connection_object);
+  size_t slot = hash & kConnectionIndexMask;
+  for(size_t probes = 0; probes < kConnectionIndexSize; probes++) {
+    const ConnectionIndexSlot *entry = &s_triad_index.slots[slot];
+    if(NULL == entry->connection_object) {
+      break;
+    }
+    if(hash == entry->hash &&
+       EqualConnectionTriad(connection_object, entry->connection_object) &&
+       kConnectionObjectStateEstablished ==
+       ConnectionObjectGetState(entry->connection_object) ) {
+      return (CipConnectionObject *) entry->connection_object;
+    }
+    slot = (slot + 1) & kConnectionIndexMask;
+  }
+  return NULL;
+}
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_CIPCONNECTIONINDEX_H_
+#define OPENER_CIPCONNECTIONINDEX_H_
+
+/** @file cipconnectionindex.h
+ *  @brief Hash indexes over the active connection list
+ *
+ *  Two open addressing hash tables with linear probing, one keyed by the
+ *  consumed connection ID used on the I/O receive path, one keyed by the
+ *  connection triad used on Forward_Open. Both are maintained by
+ *  AddNewActiveConnection() and RemoveFromActiveConnections(), so every
+ *  connection in connection_list is indexed exactly once per table.
+ *  Several connections may share a key, lookups return the first match
+ *  that is established.
+ */
+
+#include "typedefs.h"
+#include "cipconnectionobject.h"
+
+/** @brief Clears both indexes, called at stack initialization */
+void ConnectionIndexInit(void);
+
+/** @brief Adds a connection to both indexes
+ *
+ *  @param connection_object The connection to add, its consumed connection ID
+ *  and triad must not change while it is indexed
+ */
+void ConnectionIndexInsert(const CipConnectionObject *const connection_object);
+
+/** @brief Removes a connection from both indexes
+ *
+ *  @param connection_object The connection to remove, no-op if not indexed
+ */
+void ConnectionIndexRemove(const CipConnectionObject *const connection_object);
+
+/** @brief Finds the established connection consuming the given connection ID
+ *
+ *  @param connection_id The consumed connection ID
+ *  @return The connection, or NULL if there is none
+ */
+CipConnectionObject *ConnectionIndexFindByConsumedConnectionId(
+  const CipUdint connection_id);
+
+/** @brief Finds the established connection with the same triad
+ *
+ *  @param connection_object Connection holding the triad to search for
+ *  @return The connection, or NULL if there is none
+ */
+CipConnectionObject *ConnectionIndexFindByTriad(
+  const CipConnectionObject *const connection_object);
+
+#endif /* OPENER_CIPCONNECTIONINDEX_H_ */
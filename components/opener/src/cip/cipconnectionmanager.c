@@ -4,6 +4,7 @@
  *
  ******************************************************************************/
 #include <string.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <inttypes.h>
 
@@ -21,6 +22,8 @@
 #include "cipconnectionobject.h"
 #include "cipclass3connection.h"
 #include "cipioconnection.h"
+#include "cipconnectionscheduler.h"
+#include "cipconnectionindex.h"
 #include "cipassembly.h"
 #include "cpf.h"
 #include "appcontype.h"
@@ -28,6 +31,7 @@
 #include "cipepath.h"
 #include "cipelectronickey.h"
 #include "cipqos.h"
+#include "cipperf.h"
 #include "xorshiftrandom.h"
 
 #if defined(__ESP_PLATFORM__) || defined(ESP_PLATFORM)
@@ -78,6 +82,10 @@ typedef struct {
 
 static ConnectionManagerStatistics g_connection_manager_stats = {0};
 
+/** @brief Input assemblies passed to TriggerAssemblyProduction() and not yet
+ *  served, 0 marks a free entry */
+static atomic_uint s_production_requests[OPENER_PRODUCTION_REQUEST_QUEUE_LENGTH];
+
 /* Dummy data pointer for attribute 9 (Connection Entry List) - dynamically encoded, not used */
 static CipUint g_connection_entry_list_dummy = 0;
 
@@ -187,6 +195,13 @@ void InitializeConnectionManagerData(void);
 void AddNullAddressItem(
   CipCommonPacketFormatData *common_data_packet_format_data);
 
+/** @brief Marks the connections producing the requested input assemblies
+ *
+ *  Only change of state and application triggered connections are marked,
+ *  cyclic connections produce with their RPI only.
+ */
+static void TakeProductionRequests(void);
+
 /** @brief gets the padded logical path TODO: enhance documentation
  * @param logical_path_segment TheLogical Path Segment
  *
@@ -1069,7 +1084,7 @@ void AssembleConnectionDataResponseMessage(
   AddDintToMessage(connection_object->o_to_t_requested_packet_interval,
                    &message_router_response->message);
   // Originator API O->T UDINT
-  AddDintToMessage(connection_object->transmission_trigger_timer,
+  AddDintToMessage(connection_object->o_to_t_requested_packet_interval,
                    &message_router_response->message);
   // Originator T->O CID UDINT
   AddDintToMessage(connection_object->cip_produced_connection_id,
@@ -1090,15 +1105,28 @@ void AssembleConnectionDataResponseMessage(
   AddDintToMessage(connection_object->t_to_o_requested_packet_interval,
                    &message_router_response->message);
   // Originator API T->O UDINT
-  AddDintToMessage(connection_object->transmission_trigger_timer,
+  AddDintToMessage(ConnectionObjectGetRequestedPacketInterval(connection_object),
                    &message_router_response->message);
 }
 
-EipStatus ManageConnections(MilliSeconds elapsed_time) {
+EipStatus ManageConnections(MicroSeconds elapsed_time) {
+  /* the encapsulation layer works in milliseconds, carry the sub-millisecond rest */
+  static MicroSeconds encapsulation_elapsed_time = 0;
+
   //OPENER_TRACE_INFO("Entering ManageConnections\n");
+#if defined(OPENER_PERF_TRACE) && 0 != OPENER_PERF_TRACE
+  /* busy share of the OpENer thread in the last second */
+  g_connection_manager_stats.cpu_utilization =
+    (CipUint) (PerfGetLoadPermille(kPerfStageSelectWake) / 10U);
+#endif
   /*Inform application that it can execute */
   HandleApplication();
-  ManageEncapsulationMessages(elapsed_time);
+  TakeProductionRequests();
+  encapsulation_elapsed_time += elapsed_time;
+  ManageEncapsulationMessages(
+    (MilliSeconds) (encapsulation_elapsed_time / 1000ULL) );
+  encapsulation_elapsed_time %= 1000ULL;
+  ConnectionSchedulerAdvance(elapsed_time);
 
   DoublyLinkedListNode *node = connection_list.first;
 
@@ -1135,11 +1163,23 @@ EipStatus ManageConnections(MilliSeconds elapsed_time) {
              ConnectionObjectGetTransportClassTriggerProductionTrigger(
                connection_object) ) {
             /* non cyclic connections have to decrement production inhibit timer */
-            if(elapsed_time <= connection_object->production_inhibit_timer) {
-              //The connection is allowed to send again
+            if(elapsed_time >= connection_object->production_inhibit_timer) {
+              /* the connection is allowed to send again */
+              connection_object->production_inhibit_timer = 0;
             } else {
               connection_object->production_inhibit_timer -= elapsed_time;
             }
+            if(connection_object->production_trigger_pending) {
+              /* produce as soon as the production inhibit timer expires, the
+               * trigger timer is decremented by elapsed_time below */
+              connection_object->production_trigger_pending = false;
+              const uint64_t inhibit_expiry =
+                connection_object->production_inhibit_timer + elapsed_time;
+              if(connection_object->transmission_trigger_timer >
+                 inhibit_expiry) {
+                connection_object->transmission_trigger_timer = inhibit_expiry;
+              }
+            }
           }
 
           if(connection_object->transmission_trigger_timer <= elapsed_time) { /* need to send package */
@@ -1159,9 +1199,10 @@ EipStatus ManageConnections(MilliSeconds elapsed_time) {
               connection_object->transmission_trigger_timer -= elapsed_time;
             } else {  /* elapsed time was longer than RPI */
               connection_object->transmission_trigger_timer = 0;
-              OPENER_TRACE_INFO("elapsed time: %lu ms was longer than RPI: %u ms\n",
-                                elapsed_time,
-                                ConnectionObjectGetRequestedPacketInterval(connection_object));
+              OPENER_TRACE_INFO(
+                "elapsed time: %" PRIu64 " us was longer than RPI: %" PRIu32 " us\n",
+                (EipUint64)elapsed_time,
+                ConnectionObjectGetRequestedPacketInterval(connection_object) );
             }
             if(kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
                ConnectionObjectGetTransportClassTriggerProductionTrigger(
@@ -1175,6 +1216,8 @@ EipStatus ManageConnections(MilliSeconds elapsed_time) {
         }
       }
     }
+    /* re-schedule with the updated timers, removes timed out connections */
+    ConnectionSchedulerUpdate(connection_object);
     node = node->next;
   }
   return kEipStatusOk;
@@ -1371,18 +1414,7 @@ EipStatus AssembleForwardCloseResponse(EipUint16 connection_serial_number,
 }
 
 CipConnectionObject *GetConnectedObject(const EipUint32 connection_id) {
-  DoublyLinkedListNode *iterator = connection_list.first;
-
-  while(NULL != iterator) {
-    if(kConnectionObjectStateEstablished ==
-       ConnectionObjectGetState(iterator->data)
-       && connection_id ==
-       ConnectionObjectGetCipConsumedConnectionID(iterator->data) ) {
-      return iterator->data;
-    }
-    iterator = iterator->next;
-  }
-  return NULL;
+  return ConnectionIndexFindByConsumedConnectionId(connection_id);
 }
 
 CipConnectionObject *GetConnectedOutputAssembly(
@@ -1407,20 +1439,7 @@ CipConnectionObject *GetConnectedOutputAssembly(
 
 CipConnectionObject *CheckForExistingConnection(
   const CipConnectionObject *const connection_object) {
-
-  DoublyLinkedListNode *iterator = connection_list.first;
-
-  while(NULL != iterator) {
-    if(kConnectionObjectStateEstablished ==
-       ConnectionObjectGetState(iterator->data) ) {
-      if(EqualConnectionTriad(connection_object, iterator->data) ) {
-        return iterator->data;
-      }
-    }
-    iterator = iterator->next;
-  }
-
-  return NULL;
+  return ConnectionIndexFindByTriad(connection_object);
 }
 
 EipStatus CheckElectronicKeyData(EipUint8 key_format,
@@ -1867,11 +1886,15 @@ void CloseConnection(CipConnectionObject *RESTRICT connection_object) {
 
 void AddNewActiveConnection(CipConnectionObject *const connection_object) {
   DoublyLinkedListInsertAtHead(&connection_list, connection_object);
+  ConnectionIndexInsert(connection_object);
   ConnectionObjectSetState(connection_object,
                            kConnectionObjectStateEstablished);
+  ConnectionSchedulerUpdate(connection_object);
 }
 
 void RemoveFromActiveConnections(CipConnectionObject *const connection_object) {
+  ConnectionSchedulerRemove(connection_object);
+  ConnectionIndexRemove(connection_object);
   for(DoublyLinkedListNode *iterator = connection_list.first; iterator != NULL;
       iterator = iterator->next) {
     if(iterator->data == connection_object) {
@@ -1948,8 +1971,9 @@ EipStatus TriggerConnections(unsigned int output_assembly,
         == ConnectionObjectGetTransportClassTriggerProductionTrigger(
           connection_object) ) {
         /* produce at the next allowed occurrence */
-        connection_object->transmission_trigger_timer =
-          connection_object->production_inhibit_time;
+        connection_object->production_trigger_pending = true;
+        /* served right away if not called from HandleApplication() */
+        OpenerRequestService(kOpenerServiceProduction);
         status = kEipStatusOk;
       }
       break;
@@ -1959,6 +1983,48 @@ EipStatus TriggerConnections(unsigned int output_assembly,
   return status;
 }
 
+EipStatus TriggerAssemblyProduction(const CipInstanceNum input_assembly_id) {
+  if(0 == input_assembly_id) {
+    return kEipStatusError;
+  }
+  EipStatus status = kEipStatusError;
+  for(size_t i = 0;
+      i < OPENER_PRODUCTION_REQUEST_QUEUE_LENGTH && kEipStatusOk != status;
+      i++) {
+    unsigned int request = 0;
+    /* claims a free entry, or finds the assembly already requested */
+    if(atomic_compare_exchange_strong(&s_production_requests[i], &request,
+                                      input_assembly_id) ||
+       input_assembly_id == request) {
+      status = kEipStatusOk;
+    }
+  }
+  if(kEipStatusOk == status) {
+    OpenerRequestService(kOpenerServiceProduction);
+  }
+  return status;
+}
+
+static void TakeProductionRequests(void) {
+  for(size_t i = 0; i < OPENER_PRODUCTION_REQUEST_QUEUE_LENGTH; i++) {
+    if(0 == atomic_load(&s_production_requests[i]) ) {
+      continue; /* no need for the more expensive exchange */
+    }
+    const unsigned int input_assembly =
+      atomic_exchange(&s_production_requests[i], 0U);
+    for(DoublyLinkedListNode *node = connection_list.first; NULL != node;
+        node = node->next) {
+      CipConnectionObject *const connection_object = node->data;
+      if(input_assembly == connection_object->produced_path.instance_id &&
+         kConnectionObjectTransportClassTriggerProductionTriggerCyclic !=
+         ConnectionObjectGetTransportClassTriggerProductionTrigger(
+           connection_object) ) {
+        connection_object->production_trigger_pending = true;
+      }
+    }
+  }
+}
+
 void CheckForTimedOutConnectionsAndCloseTCPConnections(
   const CipConnectionObject *const connection_object,
   CloseSessionFunction CloseSessions)
@@ -1989,6 +2055,8 @@ void InitializeConnectionManagerData() {
          g_kNumberOfConnectableObjects * sizeof(ConnectionManagementHandling) );
   InitializeClass3ConnectionData();
   InitializeIoConnectionData();
+  ConnectionSchedulerInit();
+  ConnectionIndexInit();
   
   /* Initialize buffer sizes */
   /* Estimate based on typical EtherNet/IP buffer requirements */
@@ -159,6 +159,13 @@ typedef enum {
 #define SEQ_LEQ16(a, b) ( (short)( (a) - (b) ) <= 0 )
 #define SEQ_GEQ16(a, b) ( (short)( (a) - (b) ) >= 0 )
 
+/** @brief Number of distinct input assemblies whose production can be
+ *  requested by TriggerAssemblyProduction() before the OpENer thread serves
+ *  them */
+#ifndef OPENER_PRODUCTION_REQUEST_QUEUE_LENGTH
+  #define OPENER_PRODUCTION_REQUEST_QUEUE_LENGTH 4
+#endif
+
 /** @brief Connection Manager class code */
 static const CipUint kCipConnectionManagerClassCode = 0x06U;
 
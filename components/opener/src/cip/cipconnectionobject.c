@@ -53,6 +53,19 @@
 #define CIP_CONNECTION_OBJECT_PRIORITY_SCHEDULED 2
 #define CIP_CONNECTION_OBJECT_PRIORITY_URGENT 3
 
+/** @brief Resolution of the connection production timers in microseconds
+ *
+ *  With the connection scheduler the network handler wakes at each connection
+ *  deadline, so RPIs are honoured with microsecond resolution instead of being
+ *  rounded to multiples of kOpenerTimerTickInMilliSeconds.
+ */
+#if defined(OPENER_CONNECTION_SCHEDULER) && 0 != OPENER_CONNECTION_SCHEDULER
+#define OPENER_CONNECTION_TIMER_RESOLUTION_US 1U
+#else
+#define OPENER_CONNECTION_TIMER_RESOLUTION_US \
+  (kOpenerTimerTickInMilliSeconds * 1000U)
+#endif
+
 /** @brief Definition of the global connection list */
 DoublyLinkedList connection_list;
 
@@ -62,10 +75,7 @@ CipConnectionObject explicit_connection_object_pool[
 
 DoublyLinkedListNode *CipConnectionObjectListArrayAllocator() {
   enum {
-    kNodesAmount = OPENER_CIP_NUM_EXPLICIT_CONNS +
-                   OPENER_CIP_NUM_INPUT_ONLY_CONNS +
-                   OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS +
-                   OPENER_CIP_NUM_LISTEN_ONLY_CONNS
+    kNodesAmount = OPENER_CIP_NUM_ACTIVE_CONNECTIONS
   };
   static DoublyLinkedListNode nodes[kNodesAmount] = { 0 };
   for(size_t i = 0; i < kNodesAmount; ++i) {
@@ -442,34 +452,35 @@ CipUint ConnectionObjectGetExpectedPacketRate(
   return connection_object->expected_packet_rate;
 }
 
-CipUint ConnectionObjectGetRequestedPacketInterval(
+CipUdint ConnectionObjectGetRequestedPacketInterval(
   const CipConnectionObject *const connection_object) {
   CipUdint remainder_to_resolution =
     (connection_object->t_to_o_requested_packet_interval) %
-    (kOpenerTimerTickInMilliSeconds * 1000);
-  if(0 == remainder_to_resolution) { /* Value can be represented in multiples of the timer resolution */
-    return (CipUint) (connection_object->t_to_o_requested_packet_interval /
-                      1000);
-  } else {
-    return (CipUint) (connection_object->t_to_o_requested_packet_interval /
-                      1000 - remainder_to_resolution / 1000);
+    (OPENER_CONNECTION_TIMER_RESOLUTION_US);
+  CipUdint requested_packet_interval =
+    connection_object->t_to_o_requested_packet_interval -
+    remainder_to_resolution;
+  /* never go below one timer increment, a zero interval would produce on every call */
+  if(0 == requested_packet_interval) {
+    requested_packet_interval = OPENER_CONNECTION_TIMER_RESOLUTION_US;
   }
+  return requested_packet_interval;
 }
 
 void ConnectionObjectSetExpectedPacketRate(
   CipConnectionObject *const connection_object) {
   CipUdint remainder_to_resolution =
     (connection_object->t_to_o_requested_packet_interval) %
-    (kOpenerTimerTickInMilliSeconds * 1000);
-  if(0 == remainder_to_resolution) { /* Value can be represented in multiples of the timer resolution */
-    connection_object->expected_packet_rate =
-      connection_object->t_to_o_requested_packet_interval / 1000;
-  } else {
-    connection_object->expected_packet_rate =
-      connection_object->t_to_o_requested_packet_interval / 1000
-      + ( (CipUdint)
-          kOpenerTimerTickInMilliSeconds - remainder_to_resolution / 1000 );
+    (OPENER_CONNECTION_TIMER_RESOLUTION_US);
+  CipUdint rate_in_microseconds =
+    connection_object->t_to_o_requested_packet_interval;
+  if(0 != remainder_to_resolution) { /* Value cannot be represented in multiples of the timer resolution */
+    rate_in_microseconds += OPENER_CONNECTION_TIMER_RESOLUTION_US -
+                            remainder_to_resolution;
   }
+  /* attribute 9 has a resolution of milliseconds, round up */
+  connection_object->expected_packet_rate =
+    (CipUint) ( (rate_in_microseconds + 999U) / 1000U );
 }
 
 CipUdint ConnectionObjectGetCipProducedConnectionID(
@@ -584,7 +595,7 @@ void ConnectionObjectSetProductionInhibitTime(
 /*setup the preconsumption timer: max(ConnectionTimeoutMultiplier * ExpectedPacketRate, 10s) */
 void ConnectionObjectSetInitialInactivityWatchdogTimerValue(
   CipConnectionObject *const connection_object) {
-  const uint64_t kMinimumInitialTimeoutValue = 10000;
+  const uint64_t kMinimumInitialTimeoutValue = 10000000; /* 10 s in microseconds */
   const uint64_t calculated_timeout_value =
     ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
       connection_object);
@@ -610,8 +621,7 @@ void ConnectionObjectResetLastPackageInactivityTimerValue(
 
 uint64_t ConnectionObjectCalculateRegularInactivityWatchdogTimerValue(
   const CipConnectionObject *const connection_object) {
-  return ( ( (uint64_t)(connection_object->o_to_t_requested_packet_interval) /
-             (uint64_t) 1000 ) <<
+  return ( (uint64_t)(connection_object->o_to_t_requested_packet_interval) <<
            (2 + connection_object->connection_timeout_multiplier) );
 }
 
@@ -913,7 +923,7 @@ void ConnectionObjectResetSequenceCounts(
 void ConnectionObjectResetProductionInhibitTimer(
   CipConnectionObject *const connection_object) {
   connection_object->production_inhibit_timer =
-    connection_object->production_inhibit_time;
+    (uint64_t)connection_object->production_inhibit_time * 1000U;
 }
 
 void ConnectionObjectGeneralConfiguration(
@@ -946,6 +956,7 @@ void ConnectionObjectGeneralConfiguration(
                                            kConnectionObjectWatchdogTimeoutActionInvalid);                    /* Correct value not know at this point */
 
   ConnectionObjectResetProductionInhibitTimer(connection_object);
+  connection_object->production_trigger_pending = false;
 
   connection_object->transmission_trigger_timer = 0;
 }
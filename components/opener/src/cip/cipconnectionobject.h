@@ -17,6 +17,20 @@
 
 #define CIP_CONNECTION_OBJECT_CODE 0x05
 
+/** @brief Maximum number of simultaneously active connections
+ *
+ *  Sizes the connection list node pool and the connection lookup structures.
+ *  Input only and listen only connection points can carry several connections
+ *  each, therefore the per connection path counts are taken into account.
+ */
+#define OPENER_CIP_NUM_ACTIVE_CONNECTIONS                     \
+  (OPENER_CIP_NUM_EXPLICIT_CONNS +                            \
+   OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS +                      \
+   OPENER_CIP_NUM_INPUT_ONLY_CONNS *                          \
+   OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH +             \
+   OPENER_CIP_NUM_LISTEN_ONLY_CONNS *                         \
+   OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH)
+
 typedef enum {
   kConnectionObjectStateNonExistent = 0, /**< Connection is non existent */
   kConnectionObjectStateConfiguring, /**< Waiting for both to be configured and to apply the configuration */
@@ -135,10 +149,14 @@ struct cip_connection_object {
   CipUint requested_produced_connection_size;
   CipUint requested_consumed_connection_size;
 
+  /* connection timers, all in microseconds */
   uint64_t transmission_trigger_timer;
   uint64_t inactivity_watchdog_timer;
   uint64_t last_package_watchdog_timer;
   uint64_t production_inhibit_timer;
+  CipBool production_trigger_pending; /**< application or change of state
+                                         production requested, sent when the
+                                         production inhibit timer allows */
 
   CipUint connection_serial_number;
   CipUint originator_vendor_id;
@@ -154,6 +172,9 @@ struct cip_connection_object {
 
   CipUint sequence_count_producing; /**< sequence Count for Class 1 Producing
                                          Connections */
+  EipUint32 produced_data_generation; /**< generation of the assembly data
+                                          last sent, see
+                                          PrepareAssemblyDataSend() */
   CipUint sequence_count_consuming; /**< sequence Count for Class 1 Producing
                                          Connections */
 
@@ -194,6 +215,16 @@ struct cip_connection_object {
 
   ENIPMessage last_reply_sent;
   CipBool is_large_forward_open;
+
+  /* Pre-assembled T->O frame of producing I/O connections, built when the
+   * connection is established. Only the sequence numbers and the assembly
+   * data are patched in before each send. Offsets are relative to
+   * produced_frame.message_buffer, 0 if the field is not present. */
+  ENIPMessage produced_frame;
+  size_t produced_frame_eip_sequence_offset; /**< sequenced address item sequence number */
+  size_t produced_frame_sequence_offset; /**< class 1 sequence count */
+  size_t produced_frame_data_offset; /**< first octet of the assembly data */
+  size_t produced_frame_data_length; /**< length of the assembly data */
 };
 
 /** @brief Extern declaration of the global connection list */
@@ -268,7 +299,12 @@ void ConnectionObjectSetConsumedConnectionSize(
 CipUint ConnectionObjectGetExpectedPacketRate(
   const CipConnectionObject *const connection_object);
 
-CipUint ConnectionObjectGetRequestedPacketInterval(
+/**
+ * @brief Gets the T->O requested packet interval used for production
+ *
+ * @return The RPI in microseconds, rounded down to the connection timer resolution
+ */
+CipUdint ConnectionObjectGetRequestedPacketInterval(
   const CipConnectionObject *const connection_object);
 
 /**
@@ -0,0 +1,185 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "cipconnectionscheduler.h"
+
+#include "opener_user_conf.h"
+#include "trace.h"
+
+/** @brief Maximum number of simultaneously scheduled connections, matches the
+ *  connection list node pool */
+enum {
+  kConnectionSchedulerCapacity = OPENER_CIP_NUM_ACTIVE_CONNECTIONS
+};
+
+typedef struct {
+  const CipConnectionObject *connection_object;
+  uint64_t deadline; /**< absolute deadline on the scheduler time line */
+} ConnectionSchedulerEntry;
+
+static ConnectionSchedulerEntry s_heap[kConnectionSchedulerCapacity];
+static size_t s_heap_size = 0;
+static uint64_t s_scheduler_time = 0;
+
+static void ConnectionSchedulerSwap(const size_t first,
+                                    const size_t second) {
+  ConnectionSchedulerEntry temp = s_heap[first];
+  s_heap[first] = s_heap[second];
+  s_heap[second] = temp;
+}
+
+static void ConnectionSchedulerSiftUp(size_t index) {
+  while(index > 0) {
+    size_t parent = (index - 1) / 2;
+    if(s_heap[parent].deadline <= s_heap[index].deadline) {
+      break;
+    }
+    ConnectionSchedulerSwap(parent, index);
+    index = parent;
+  }
+}
+
+static void ConnectionSchedulerSiftDown(size_t index) {
+  for(;;) {
+    size_t smallest = index;
+    size_t left = 2 * index + 1;
+    size_t right = left + 1;
+    if(left < s_heap_size &&
+       s_heap[left].deadline < s_heap[smallest].deadline) {
+      smallest = left;
+    }
+    if(right < s_heap_size &&
+       s_heap[right].deadline < s_heap[smallest].deadline) {
+      smallest = right;
+    }
+    if(smallest == index) {
+      break;
+    }
+    ConnectionSchedulerSwap(smallest, index);
+    index = smallest;
+  }
+}
+
+/** @brief Finds the heap slot of a connection
+ *
+ *  A linear search over the heap is sufficient as only connections with a
+ *  changed deadline are looked up, and it avoids storing a heap index in the
+ *  connection object which gets copied around when connections are established.
+ *
+ *  @return heap index, or kConnectionSchedulerCapacity if not found
+ */
+static size_t ConnectionSchedulerFind(
+  const CipConnectionObject *const connection_object) {
+  for(size_t i = 0; i < s_heap_size; i++) {
+    if(s_heap[i].connection_object == connection_object) {
+      return i;
+    }
+  }
+  return kConnectionSchedulerCapacity;
+}
+
+static void ConnectionSchedulerRemoveAt(const size_t index) {
+  s_heap_size--;
+  if(index != s_heap_size) {
+    s_heap[index] = s_heap[s_heap_size];
+    ConnectionSchedulerSiftUp(index);
+    ConnectionSchedulerSiftDown(index);
+  }
+}
+
+/** @brief Computes the relative time of the next event of a connection
+ *
+ *  @param connection_object The connection to inspect
+ *  @param next_event Set to the time until the next event in microseconds
+ *  @return true if the connection has a running timer
+ */
+static bool ConnectionSchedulerGetNextEvent(
+  const CipConnectionObject *const connection_object,
+  uint64_t *const next_event) {
+  bool has_event = false;
+  uint64_t event = UINT64_MAX;
+
+  if(kConnectionObjectStateEstablished !=
+     ConnectionObjectGetState(connection_object) ) {
+    return false;
+  }
+
+  /* same conditions as in ManageConnections */
+  if( (NULL != connection_object->consuming_instance) ||
+      (kConnectionObjectTransportClassTriggerDirectionServer ==
+       ConnectionObjectGetTransportClassTriggerDirection(connection_object) ) )
+  {
+    event = connection_object->inactivity_watchdog_timer;
+    has_event = true;
+  }
+
+  if( (0 != ConnectionObjectGetExpectedPacketRate(connection_object) ) &&
+      (kEipInvalidSocket !=
+       connection_object->socket[kUdpCommuncationDirectionProducing]) ) {
+    if(connection_object->transmission_trigger_timer < event) {
+      event = connection_object->transmission_trigger_timer;
+    }
+    has_event = true;
+  }
+
+  *next_event = event;
+  return has_event;
+}
+
+void ConnectionSchedulerInit(void) {
+  memset(s_heap, 0, sizeof(s_heap) );
+  s_heap_size = 0;
+  s_scheduler_time = 0;
+}
+
+void ConnectionSchedulerAdvance(const MicroSeconds elapsed_time) {
+  s_scheduler_time += elapsed_time;
+}
+
+void ConnectionSchedulerUpdate(const CipConnectionObject *const connection_object)
+{
+  uint64_t next_event = 0;
+  size_t index = ConnectionSchedulerFind(connection_object);
+
+  if(false == ConnectionSchedulerGetNextEvent(connection_object, &next_event) ) {
+    if(kConnectionSchedulerCapacity != index) {
+      ConnectionSchedulerRemoveAt(index);
+    }
+    return;
+  }
+
+  if(kConnectionSchedulerCapacity == index) {
+    if(kConnectionSchedulerCapacity == s_heap_size) {
+      OPENER_TRACE_ERR("Connection scheduler full, connection not scheduled\n");
+      return;
+    }
+    index = s_heap_size++;
+    s_heap[index].connection_object = connection_object;
+  }
+  s_heap[index].deadline = s_scheduler_time + next_event;
+  ConnectionSchedulerSiftUp(index);
+  ConnectionSchedulerSiftDown(index);
+}
+
+void ConnectionSchedulerRemove(const CipConnectionObject *const connection_object)
+{
+  size_t index = ConnectionSchedulerFind(connection_object);
+  if(kConnectionSchedulerCapacity != index) {
+    ConnectionSchedulerRemoveAt(index);
+  }
+}
+
+MicroSeconds ConnectionSchedulerGetTimeToNextDeadline(void) {
+  if(0 == s_heap_size) {
+    return kConnectionSchedulerNoDeadline;
+  }
+  if(s_heap[0].deadline <= s_scheduler_time) {
+    return 0;
+  }
+  return s_heap[0].deadline - s_scheduler_time;
+}
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_CIPCONNECTIONSCHEDULER_H_
+#define OPENER_CIPCONNECTIONSCHEDULER_H_
+
+/** @file cipconnectionscheduler.h
+ *  @brief Deadline scheduler for established connections
+ *
+ *  Every established connection that has to produce data or maintain an
+ *  inactivity watchdog is kept in a binary min-heap keyed by its next
+ *  deadline. The deadlines are expressed on the scheduler time line, which
+ *  is advanced by ManageConnections() with the same elapsed time that is
+ *  used to decrement the connection timers. The network handler uses the
+ *  earliest deadline as select() timeout, so connections with an RPI shorter
+ *  than kOpenerTimerTickInMilliSeconds are serviced on time.
+ */
+
+#include "typedefs.h"
+#include "cipconnectionobject.h"
+
+/** @brief Value returned by ConnectionSchedulerGetTimeToNextDeadline() if no
+ *  connection is scheduled */
+#define kConnectionSchedulerNoDeadline ( (MicroSeconds) -1 )
+
+/** @brief Clears the scheduler, called at stack initialization */
+void ConnectionSchedulerInit(void);
+
+/** @brief Advances the scheduler time line
+ *
+ *  @param elapsed_time Time in microseconds the connection timers are
+ *  decremented by in the current ManageConnections() run
+ */
+void ConnectionSchedulerAdvance(const MicroSeconds elapsed_time);
+
+/** @brief (Re-)schedules a connection according to its current timers
+ *
+ *  Connections which are not established or do not have any running timer are
+ *  removed from the scheduler.
+ *
+ *  @param connection_object The connection to be scheduled
+ */
+void ConnectionSchedulerUpdate(const CipConnectionObject *const connection_object);
+
+/** @brief Removes a connection from the scheduler
+ *
+ *  @param connection_object The connection to be removed, no-op if the
+ *  connection is not scheduled
+ */
+void ConnectionSchedulerRemove(const CipConnectionObject *const connection_object);
+
+/** @brief Gets the time until the earliest scheduled connection deadline
+ *
+ *  @return Time in microseconds relative to the last ConnectionSchedulerAdvance()
+ *  call, 0 if the deadline has already passed, or kConnectionSchedulerNoDeadline
+ *  if no connection is scheduled
+ */
+MicroSeconds ConnectionSchedulerGetTimeToNextDeadline(void);
+
+#endif /* OPENER_CIPCONNECTIONSCHEDULER_H_ */
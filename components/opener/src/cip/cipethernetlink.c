@@ -283,7 +283,7 @@ EipStatus CipEthernetLinkInit(void) {
                                                  11,
                                                  /* # highest instance attribute number*/
                                                  /* # instance services follow */
-                                                 2 + OPENER_ETHLINK_CNTRS_ENABLE + OPENER_ETHLINK_IFACE_CTRL_ENABLE,
+                                                 3 + OPENER_ETHLINK_CNTRS_ENABLE + 2 * OPENER_ETHLINK_IFACE_CTRL_ENABLE,
                                                  OPENER_ETHLINK_INSTANCE_CNT,
                                                  /* # instances*/
                                                  "Ethernet Link",
@@ -326,6 +326,9 @@ EipStatus CipEthernetLinkInit(void) {
     InsertService(ethernet_link_class, kGetAttributeAll,
                   &GetAttributeAllEthernetLink,
                   "GetAttributeAll");
+    InsertService(ethernet_link_class, kGetAttributeList,
+                  &GetAttributeList,
+                  "GetAttributeList");
 
 #if defined(OPENER_ETHLINK_CNTRS_ENABLE) && 0 != OPENER_ETHLINK_CNTRS_ENABLE
     InsertService(ethernet_link_class, kEthLinkGetAndClear,
@@ -336,6 +339,9 @@ EipStatus CipEthernetLinkInit(void) {
     InsertService(ethernet_link_class, kSetAttributeSingle,
     				&SetAttributeSingle,
                       "SetAttributeSingle");
+    InsertService(ethernet_link_class, kSetAttributeList,
+                  &SetAttributeList,
+                  "SetAttributeList");
 #endif
 
     /* bind attributes to the instance */
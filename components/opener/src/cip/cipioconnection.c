@@ -12,6 +12,8 @@
 
 #include "generic_networkhandler.h"
 #include "cipconnectionmanager.h"
+#include "cipconnectionscheduler.h"
+#include "cipperf.h"
 #include "cipassembly.h"
 #include "cipidentity.h"
 #include "ciptcpipinterface.h"
@@ -62,6 +64,15 @@ void HandleIoConnectionTimeOut(CipConnectionObject *connection_object);
  */
 EipStatus SendConnectedData(CipConnectionObject *connection_object);
 
+/** @brief Pre-assembles the T->O frame of a producing connection
+ *
+ *  Builds the CPF items of the produced frame once, so SendConnectedData()
+ *  only has to patch the sequence numbers and copy the assembly data.
+ *
+ *  @param connection_object The producing connection
+ */
+void BuildProducedFrameTemplate(CipConnectionObject *connection_object);
+
 EipStatus HandleReceivedIoConnectionData(CipConnectionObject *connection_object,
                                          const EipUint8 *data,
                                          EipUint16 data_length);
@@ -102,27 +113,24 @@ bool CipRunIdleHeaderGetT2O(void) {
 
 EipUint16 ProcessProductionInhibitTime(
   CipConnectionObject *io_connection_object) {
-  if( kConnectionObjectTransportClassTriggerProductionTriggerCyclic ==
-      ConnectionObjectGetTransportClassTriggerProductionTrigger(
-        io_connection_object) )
-  {
-    if( 256 ==
-        ConnectionObjectGetProductionInhibitTime(io_connection_object) ) {
-      OPENER_TRACE_INFO("No PIT segment available\n");
-      /* there was no PIT segment in the connection path; set PIT to one fourth of RPI */
-      ConnectionObjectSetProductionInhibitTime(io_connection_object,
-                                               ConnectionObjectGetTToORequestedPacketInterval(
-                                                 io_connection_object) / 4000);
-    } else {
-      /* If a production inhibit time is provided, it needs to be smaller than the Requested Packet Interval */
-      if( ConnectionObjectGetProductionInhibitTime(io_connection_object) >
-          (ConnectionObjectGetTToORequestedPacketInterval(io_connection_object)
-           /
-           1000) ) {
-        /* see section C-1.4.3.3 */
-        return
-          kConnectionManagerExtendedStatusCodeProductionInhibitTimerGreaterThanRpi;
-      }
+  /* checked for every trigger, it takes effect for change of state and
+   * application triggered production only */
+  if( 256 ==
+      ConnectionObjectGetProductionInhibitTime(io_connection_object) ) {
+    OPENER_TRACE_INFO("No PIT segment available\n");
+    /* there was no PIT segment in the connection path; set PIT to one fourth of RPI */
+    ConnectionObjectSetProductionInhibitTime(io_connection_object,
+                                             ConnectionObjectGetTToORequestedPacketInterval(
+                                               io_connection_object) / 4000);
+  } else {
+    /* If a production inhibit time is provided, it needs to be smaller than the Requested Packet Interval */
+    if( ConnectionObjectGetProductionInhibitTime(io_connection_object) >
+        (ConnectionObjectGetTToORequestedPacketInterval(io_connection_object)
+         /
+         1000) ) {
+      /* see section C-1.4.3.3 */
+      return
+        kConnectionManagerExtendedStatusCodeProductionInhibitTimerGreaterThanRpi;
     }
   }
   return kConnectionManagerExtendedStatusCodeSuccess;
@@ -395,6 +403,10 @@ CipError EstablishIoConnection(
     return cip_error;
   }
 
+  if(NULL != io_connection_object->producing_instance) {
+    BuildProducedFrameTemplate(io_connection_object);
+  }
+
   AddNewActiveConnection(io_connection_object);
   CheckIoConnectionEvent(io_connection_object->consumed_path.instance_id,
                          io_connection_object->produced_path.instance_id,
@@ -755,8 +767,12 @@ static int transfer_master_connection(CipConnectionObject *connection_object) {
     connection_object->eip_level_sequence_count_producing;
   active->sequence_count_producing =
     connection_object->sequence_count_producing;
+  active->produced_data_generation =
+    connection_object->produced_data_generation;
   active->transmission_trigger_timer =
     connection_object->transmission_trigger_timer;
+  BuildProducedFrameTemplate(active);
+  ConnectionSchedulerUpdate(active);
 
   return 0;
 }
@@ -850,83 +866,120 @@ void HandleIoConnectionTimeOut(CipConnectionObject *connection_object) {
   ConnectionObjectSetState(connection_object, kConnectionObjectStateTimedOut);
 }
 
-EipStatus SendConnectedData(CipConnectionObject *connection_object) {
+void BuildProducedFrameTemplate(CipConnectionObject *connection_object) {
+  CipCommonPacketFormatData common_packet_format_data;
+  memset(&common_packet_format_data, 0, sizeof(common_packet_format_data) );
 
-  /* TODO think of adding an own send buffer to each connection object in order to preset up the whole message on connection opening and just change the variable data items e.g., sequence number */
+  ENIPMessage *const frame = &connection_object->produced_frame;
+  InitializeENIPMessage(frame);
+  connection_object->produced_frame_eip_sequence_offset = 0;
+  connection_object->produced_frame_sequence_offset = 0;
 
-  CipCommonPacketFormatData *common_packet_format_data =
-    &g_common_packet_format_data_item;
-  /* TODO think on adding a CPF data item to the S_CIP_ConnectionObject in order to remove the code here or even better allocate memory in the connection object for storing the message to send and just change the application data*/
-
-  connection_object->eip_level_sequence_count_producing++;
-
-  /* assembleCPFData */
-  common_packet_format_data->item_count = 2;
+  common_packet_format_data.item_count = 2;
   if( kConnectionObjectTransportClassTriggerTransportClass0 !=
       ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
   /* use Sequenced Address Items if not Connection Class 0 */
   {
-    common_packet_format_data->address_item.type_id =
+    common_packet_format_data.address_item.type_id =
       kCipItemIdSequencedAddressItem;
-    common_packet_format_data->address_item.length = 8;
-    common_packet_format_data->address_item.data.sequence_number =
-      connection_object->eip_level_sequence_count_producing;
+    common_packet_format_data.address_item.length = 8;
   } else {
-    common_packet_format_data->address_item.type_id =
+    common_packet_format_data.address_item.type_id =
       kCipItemIdConnectionAddress;
-    common_packet_format_data->address_item.length = 4;
-
+    common_packet_format_data.address_item.length = 4;
   }
-  common_packet_format_data->address_item.data.connection_identifier =
+  common_packet_format_data.address_item.data.connection_identifier =
     connection_object->cip_produced_connection_id;
+  common_packet_format_data.data_item.type_id = kCipItemIdConnectedDataItem;
+  common_packet_format_data.data_item.length = 0;
 
-  common_packet_format_data->data_item.type_id = kCipItemIdConnectedDataItem;
+  AssembleIOMessage(&common_packet_format_data, frame);
+  if( kConnectionObjectTransportClassTriggerTransportClass0 !=
+      ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
+  {
+    /* sequence number is the last field of the address item, followed by the
+     * data item type and length */
+    connection_object->produced_frame_eip_sequence_offset =
+      frame->used_message_length - 8;
+  }
 
   CipByteArray *producing_instance_attributes =
     (CipByteArray *) connection_object->producing_instance->attributes->data;
-  common_packet_format_data->data_item.length = 0;
-
-  /* notify the application that data will be sent immediately after the call */
-  if( BeforeAssemblyDataSend(connection_object->producing_instance) ) {
-    /* the data has changed increase sequence counter */
-    connection_object->sequence_count_producing++;
-  }
-
-  /* set AddressInfo Items to invalid Type */
-  common_packet_format_data->address_info_item[0].type_id = 0;
-  common_packet_format_data->address_info_item[1].type_id = 0;
-
-  ENIPMessage outgoing_message;
-  InitializeENIPMessage(&outgoing_message);
-  AssembleIOMessage(common_packet_format_data, &outgoing_message);
-
-  MoveMessageNOctets(-2, &outgoing_message);
-  common_packet_format_data->data_item.length =
+  connection_object->produced_frame_data_length =
     producing_instance_attributes->length;
 
+  /* overwrite the zero data item length with the real one */
+  MoveMessageNOctets(-2, frame);
+  EipUint16 data_item_length = producing_instance_attributes->length;
   if( kConnectionObjectTransportClassTriggerTransportClass1 ==
       ConnectionObjectGetTransportClassTriggerTransportClass(connection_object) )
   {
-    common_packet_format_data->data_item.length += 2;
-    AddIntToMessage(common_packet_format_data->data_item.length,
-                    &outgoing_message);
-    AddIntToMessage(connection_object->sequence_count_producing,
-                    &outgoing_message);
+    data_item_length += 2;
+    AddIntToMessage(data_item_length, frame);
+    connection_object->produced_frame_sequence_offset =
+      frame->used_message_length;
+    AddIntToMessage(0, frame);
   } else {
-    AddIntToMessage(common_packet_format_data->data_item.length,
-                    &outgoing_message);
+    AddIntToMessage(data_item_length, frame);
+  }
+
+  connection_object->produced_frame_data_offset = frame->used_message_length;
+  frame->used_message_length += producing_instance_attributes->length;
+}
+
+EipStatus SendConnectedData(CipConnectionObject *connection_object) {
+  OPENER_PERF_BEGIN(send_start);
+  CipByteArray *producing_instance_attributes =
+    (CipByteArray *) connection_object->producing_instance->attributes->data;
+
+  if(producing_instance_attributes->length !=
+     connection_object->produced_frame_data_length) {
+    /* template missing or assembly size changed */
+    BuildProducedFrameTemplate(connection_object);
   }
 
-  memcpy(outgoing_message.current_message_position,
+  CipOctet *const frame =
+    connection_object->produced_frame.message_buffer;
+
+  connection_object->eip_level_sequence_count_producing++;
+  if(0 != connection_object->produced_frame_eip_sequence_offset) {
+    CipOctet *sequence_number =
+      frame + connection_object->produced_frame_eip_sequence_offset;
+    EipUint32 value = connection_object->eip_level_sequence_count_producing;
+    sequence_number[0] = (CipOctet) value;
+    sequence_number[1] = (CipOctet) (value >> 8);
+    sequence_number[2] = (CipOctet) (value >> 16);
+    sequence_number[3] = (CipOctet) (value >> 24);
+  }
+
+  /* notify the application that data will be sent immediately after the call */
+  const EipUint32 data_generation =
+    PrepareAssemblyDataSend(connection_object->producing_instance);
+  if(data_generation != connection_object->produced_data_generation) {
+    /* the data has changed since this connection sent it last, increase
+     * sequence counter */
+    connection_object->produced_data_generation = data_generation;
+    connection_object->sequence_count_producing++;
+  }
+
+  if(0 != connection_object->produced_frame_sequence_offset) {
+    CipOctet *sequence_count =
+      frame + connection_object->produced_frame_sequence_offset;
+    sequence_count[0] = (CipOctet) connection_object->sequence_count_producing;
+    sequence_count[1] =
+      (CipOctet) (connection_object->sequence_count_producing >> 8);
+  }
+
+  memcpy(frame + connection_object->produced_frame_data_offset,
          producing_instance_attributes->data,
          producing_instance_attributes->length);
 
-  outgoing_message.current_message_position +=
-    producing_instance_attributes->length;
-  outgoing_message.used_message_length += producing_instance_attributes->length;
-
-  return SendUdpData(&connection_object->remote_address,
-                     &outgoing_message);
+  OPENER_PERF_BEGIN(send_udp_start);
+  EipStatus status = SendUdpData(&connection_object->remote_address,
+                                 &connection_object->produced_frame);
+  OPENER_PERF_END(kPerfStageSendUdpData, send_udp_start);
+  OPENER_PERF_END(kPerfStageSendConnectedData, send_start);
+  return status;
 }
 
 EipStatus HandleReceivedIoConnectionData(CipConnectionObject *connection_object,
@@ -979,9 +1032,14 @@ EipStatus HandleReceivedIoConnectionData(CipConnectionObject *connection_object,
       data_length -= 4;
     }
 
-    if(NotifyAssemblyConnectedDataReceived(connection_object->consuming_instance,
-                                           (EipUint8 *const ) data,
-                                           data_length) != 0) {
+    OPENER_PERF_BEGIN(notify_start);
+    EipStatus status = NotifyAssemblyConnectedDataReceived(
+      connection_object->consuming_instance,
+      (EipUint8 *const ) data,
+      data_length);
+    OPENER_PERF_END(kPerfStageNotifyAssemblyConnectedDataReceived,
+                    notify_start);
+    if(kEipStatusOk != status) {
       return kEipStatusError;
     }
   }
@@ -3,6 +3,8 @@
  * All rights reserved.
  *
  ******************************************************************************/
+#include <string.h>
+
 #include "opener_api.h"
 #include "cipcommon.h"
 #include "endianconv.h"
@@ -11,15 +13,16 @@
 #include "enipmessage.h"
 
 #include "cipmessagerouter.h"
+#include "cipobjectindex.h"
+#include "ciparena.h"
 
 CipMessageRouterRequest g_message_router_request;
 
 /** @brief A class registry list node
  *
  * A linked list of this  object is the registry of classes known to the message router
- * for small devices with very limited memory it could make sense to change this list into an
- * array with a given max size for removing the need for having to dynamically allocate
- * memory. The size of the array could be a parameter in the platform config file.
+ * in registration order. Class lookups use the sorted class index of
+ * cipobjectindex.h instead of walking this list.
  */
 typedef struct cip_message_router_object {
   struct cip_message_router_object *next; /**< link */
@@ -48,6 +51,18 @@ CipError CreateMessageRouterRequestStructure(const EipUint8 *data,
                                              EipInt16 data_length,
                                              CipMessageRouterRequest *message_router_request);
 
+/** @brief Multiple Service Packet service of the message router instance
+ *
+ * Dispatches the embedded requests through NotifyClass() and collects their
+ * replies in one response, so a client reads many attributes in one round
+ * trip.
+ */
+static EipStatus MultipleServicePacket(CipInstance *const instance,
+                                       CipMessageRouterRequest *const message_router_request,
+                                       CipMessageRouterResponse *const message_router_response,
+                                       const struct sockaddr *originator_address,
+                                       const CipSessionHandle encapsulation_session);
+
 void InitializeCipMessageRouterClass(CipClass *cip_class) {
 
   CipClass *meta_class = cip_class->class_instance.cip_class;
@@ -87,7 +102,7 @@ EipStatus CipMessageRouterInit() {
                                             2, /* # of class services */
                                             0, /* # of instance attributes */
                                             0, /* # highest instance attribute number */
-                                            1, /* # of instance services */
+                                            2, /* # of instance services */
                                             1, /* # of instances */
                                             "message router", /* class name */
                                             1, /* # class revision*/
@@ -99,41 +114,17 @@ EipStatus CipMessageRouterInit() {
                 kGetAttributeSingle,
                 &GetAttributeSingle,
                 "GetAttributeSingle");
+  InsertService(message_router,
+                kMultipleServicePacket,
+                &MultipleServicePacket,
+                "MultipleServicePacket");
 
   /* reserved for future use -> set to zero */
   return kEipStatusOk;
 }
 
-/** @brief Get the registered MessageRouter object corresponding to ClassID.
- *  given a class ID, return a pointer to the registration node for that object
- *
- *  @param class_id Class code to be searched for.
- *  @return Pointer to registered message router object
- *      NULL .. Class not registered
- */
-CipMessageRouterObject *GetRegisteredObject(EipUint32 class_id) {
-  CipMessageRouterObject *object = g_first_object; /* get pointer to head of class registration list */
-
-  while(NULL != object) /* for each entry in list*/
-  {
-    OPENER_ASSERT(NULL != object->cip_class);
-    if(object->cip_class->class_code == class_id) {
-      return object; /* return registration node if it matches class ID*/
-    }
-    object = object->next;
-  }
-  return NULL;
-}
-
 CipClass *GetCipClass(const CipUdint class_code) {
-  CipMessageRouterObject *message_router_object =
-    GetRegisteredObject(class_code);
-
-  if(message_router_object) {
-    return message_router_object->cip_class;
-  } else {
-    return NULL;
-  }
+  return ObjectIndexFindClass(class_code);
 }
 
 CipInstance *GetCipInstance(const CipClass *RESTRICT const cip_class,
@@ -143,16 +134,7 @@ CipInstance *GetCipInstance(const CipClass *RESTRICT const cip_class,
     return (CipInstance *) cip_class; /* if the instance number is zero, return the class object itself*/
 
   }
-  /* pointer to linked list of instances from the class object*/
-  for(CipInstance *instance = cip_class->instances; instance;
-      instance = instance->next)                                                         /* follow the list*/
-  {
-    if(instance->instance_number == instance_number) {
-      return instance; /* if the number matches, return the instance*/
-    }
-  }
-
-  return NULL;
+  return ObjectIndexFindInstance(cip_class, instance_number);
 }
 
 EipStatus RegisterCipClass(CipClass *cip_class) {
@@ -163,7 +145,7 @@ EipStatus RegisterCipClass(CipClass *cip_class) {
 
   }
   *message_router_object =
-    (CipMessageRouterObject *) CipCalloc(1, sizeof(CipMessageRouterObject) );                      /* create a new node at the end of the list*/
+    (CipMessageRouterObject *) CipArenaCalloc(1, sizeof(CipMessageRouterObject) );                      /* create a new node at the end of the list*/
   if(*message_router_object == 0) {
     return kEipStatusError; /* check for memory error*/
 
@@ -171,7 +153,7 @@ EipStatus RegisterCipClass(CipClass *cip_class) {
   (*message_router_object)->cip_class = cip_class; /* fill in the new node*/
   (*message_router_object)->next = NULL;
 
-  return kEipStatusOk;
+  return ObjectIndexInsertClass(cip_class);
 }
 
 EipStatus NotifyMessageRouter(EipUint8 *data,
@@ -196,9 +178,9 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
       (0x80 | g_message_router_request.service);
   } else {
     /* forward request to appropriate Object if it is registered*/
-    CipMessageRouterObject *registered_object = GetRegisteredObject(
+    CipClass *const registered_class = GetCipClass(
       g_message_router_request.request_path.class_id);
-    if(registered_object == 0) {
+    if(registered_class == 0) {
       OPENER_TRACE_ERR(
         "NotifyMessageRouter: sending CIP_ERROR_OBJECT_DOES_NOT_EXIST reply, class id 0x%x is not registered\n",
         (unsigned ) g_message_router_request.request_path.class_id);
@@ -211,10 +193,10 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
       /* call notify function from Object with ClassID (gMRRequest.RequestPath.ClassID)
          object will or will not make an reply into gMRResponse*/
       message_router_response->reserved = 0;
-      OPENER_ASSERT(NULL != registered_object->cip_class); OPENER_TRACE_INFO(
+      OPENER_TRACE_INFO(
         "NotifyMessageRouter: calling notify function of class '%s'\n",
-        registered_object->cip_class->class_name);
-      eip_status = NotifyClass(registered_object->cip_class,
+        registered_class->class_name);
+      eip_status = NotifyClass(registered_class,
                                &g_message_router_request,
                                message_router_response,
                                originator_address,
@@ -224,15 +206,15 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
       if (eip_status == kEipStatusError) {
         OPENER_TRACE_ERR(
           "notifyMR: notify function of class '%s' returned an error\n",
-          registered_object->cip_class->class_name);
+          registered_class->class_name);
       } else if (eip_status == kEipStatusOk) {
         OPENER_TRACE_INFO(
           "notifyMR: notify function of class '%s' returned no reply\n",
-          registered_object->cip_class->class_name);
+          registered_class->class_name);
       } else {
         OPENER_TRACE_INFO(
           "notifyMR: notify function of class '%s' returned a reply\n",
-          registered_object->cip_class->class_name);
+          registered_class->class_name);
       }
 #endif
     }
@@ -240,6 +222,151 @@ EipStatus NotifyMessageRouter(EipUint8 *data,
   return eip_status;
 }
 
+/** @brief Dispatches one embedded request of a Multiple Service Packet
+ *
+ * @param data Start of the embedded request
+ * @param data_length Length of the embedded request
+ * @param embedded_request Request structure to be used
+ * @param embedded_response Receives the reply of the embedded request
+ * @param originator_address The address of the originator as received
+ * @param encapsulation_session The associated encapsulation session
+ */
+static void NotifyEmbeddedRequest(const EipUint8 *const data,
+                                  const size_t data_length,
+                                  CipMessageRouterRequest *const embedded_request,
+                                  CipMessageRouterResponse *const embedded_response,
+                                  const struct sockaddr *originator_address,
+                                  const CipSessionHandle encapsulation_session) {
+  InitializeENIPMessage(&embedded_response->message);
+  embedded_response->reply_service = (0x80 | *data);
+  embedded_response->reserved = 0;
+  embedded_response->general_status = kCipErrorSuccess;
+  embedded_response->size_of_additional_status = 0;
+
+  CipError status = CreateMessageRouterRequestStructure(data,
+                                                        (EipInt16) data_length,
+                                                        embedded_request);
+  if(kCipErrorSuccess != status) {
+    embedded_response->general_status = status;
+    return;
+  }
+  if(kMultipleServicePacket == embedded_request->service) {
+    /* the embedded request and response buffers are not reentrant */
+    embedded_response->general_status = kCipErrorServiceNotSupported;
+    return;
+  }
+  CipClass *const registered_class = GetCipClass(
+    embedded_request->request_path.class_id);
+  if(NULL == registered_class) {
+    embedded_response->general_status = kCipErrorPathDestinationUnknown;
+    return;
+  }
+  (void) NotifyClass(registered_class,
+                     embedded_request,
+                     embedded_response,
+                     originator_address,
+                     encapsulation_session);
+}
+
+static EipStatus MultipleServicePacket(CipInstance *const instance,
+                                       CipMessageRouterRequest *const message_router_request,
+                                       CipMessageRouterResponse *const message_router_response,
+                                       const struct sockaddr *originator_address,
+                                       const CipSessionHandle encapsulation_session)
+{
+  (void) instance;
+
+  /* services initialize the message of the response they are given, so
+   * every embedded reply is built here and then appended */
+  static CipMessageRouterRequest embedded_request;
+  static CipMessageRouterResponse embedded_response;
+
+  ENIPMessage *const message = &message_router_response->message;
+  InitializeENIPMessage(message);
+  message_router_response->reply_service =
+    (0x80 | message_router_request->service);
+  message_router_response->general_status = kCipErrorSuccess;
+  message_router_response->size_of_additional_status = 0;
+
+  const EipUint8 *const request_data = message_router_request->data;
+  const size_t request_data_size = message_router_request->request_data_size;
+  const EipUint8 *offsets = request_data;
+  if(request_data_size < sizeof(CipUint) ) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
+  const CipUint number_of_services = GetUintFromMessage(&offsets);
+  const size_t header_size = sizeof(CipUint) * (1U + number_of_services);
+  if(0 == number_of_services || request_data_size < header_size) {
+    message_router_response->general_status = kCipErrorNotEnoughData;
+    return kEipStatusOkSend;
+  }
+  if(header_size > RemainingResponseSpace(message) ) {
+    message_router_response->general_status = kCipErrorReplyDataTooLarge;
+    return kEipStatusOkSend;
+  }
+
+  AddIntToMessage(number_of_services, message);
+  CipOctet *const reply_offsets = message->current_message_position;
+  MoveMessageNOctets( (int) (header_size - sizeof(CipUint) ), message );
+
+  for(size_t i = 0; i < number_of_services; i++) {
+    const CipUint start = GetUintFromMessage(&offsets);
+    size_t end = request_data_size;
+    if(i + 1 < number_of_services) {
+      const EipUint8 *next_offset = offsets;
+      end = GetUintFromMessage(&next_offset);
+    }
+    if(start < header_size || start >= end || end > request_data_size) {
+      InitializeENIPMessage(message);
+      message_router_response->general_status = kCipErrorInvalidParameter;
+      return kEipStatusOkSend;
+    }
+
+    NotifyEmbeddedRequest(request_data + start,
+                          end - start,
+                          &embedded_request,
+                          &embedded_response,
+                          originator_address,
+                          encapsulation_session);
+
+    const size_t additional_status_count =
+      embedded_response.size_of_additional_status < MAX_SIZE_OF_ADD_STATUS ?
+      embedded_response.size_of_additional_status : MAX_SIZE_OF_ADD_STATUS;
+    const size_t reply_size = 4U +
+                              sizeof(CipUint) * additional_status_count +
+                              embedded_response.message.used_message_length;
+    if(reply_size > RemainingResponseSpace(message) ) {
+      InitializeENIPMessage(message);
+      message_router_response->general_status = kCipErrorReplyDataTooLarge;
+      return kEipStatusOkSend;
+    }
+
+    /* reply offsets count from the number of replies */
+    const size_t reply_offset = message->used_message_length;
+    reply_offsets[2 * i] = (CipOctet) reply_offset;
+    reply_offsets[2 * i + 1] = (CipOctet) (reply_offset >> 8);
+
+    AddSintToMessage(embedded_response.reply_service, message);
+    AddSintToMessage(0, message);
+    AddSintToMessage(embedded_response.general_status, message);
+    AddSintToMessage( (EipUint8) additional_status_count, message );
+    for(size_t j = 0; j < additional_status_count; j++) {
+      AddIntToMessage(embedded_response.additional_status[j], message);
+    }
+    memcpy(message->current_message_position,
+           embedded_response.message.message_buffer,
+           embedded_response.message.used_message_length);
+    MoveMessageNOctets( (int) embedded_response.message.used_message_length,
+                        message );
+
+    if(kCipErrorSuccess != embedded_response.general_status) {
+      message_router_response->general_status = kCipErrorEmbeddedServiceError;
+    }
+  }
+  return kEipStatusOkSend;
+}
+
 CipError CreateMessageRouterRequestStructure(const EipUint8 *data,
                                              EipInt16 data_length,
                                              CipMessageRouterRequest *message_router_request)
@@ -284,32 +411,36 @@ void DeleteAllClasses(void) {
       instance = instance->next;
       if(message_router_object_to_delete->cip_class->number_of_attributes) /* if the class has instance attributes */
       { /* then free storage for the attribute array */
-        CipFree(instance_to_delete->attributes);
+        CipArenaFree(instance_to_delete->attributes);
       }
-      CipFree(instance_to_delete);
+      CipArenaFree(instance_to_delete);
     }
 
     /* free meta class data*/
     CipClass *meta_class =
       message_router_object_to_delete->cip_class->class_instance.cip_class;
-    CipFree(meta_class->class_name);
-    CipFree(meta_class->services);
-    CipFree(meta_class->get_single_bit_mask);
-    CipFree(meta_class->set_bit_mask);
-    CipFree(meta_class->get_all_bit_mask);
-    CipFree(meta_class);
+    CipArenaFree(meta_class->class_name);
+    CipArenaFree(meta_class->services);
+    CipArenaFree(meta_class->attribute_slots);
+    CipArenaFree(meta_class->get_single_bit_mask);
+    CipArenaFree(meta_class->set_bit_mask);
+    CipArenaFree(meta_class->get_all_bit_mask);
+    CipArenaFree(meta_class);
 
     /* free class data*/
     CipClass *cip_class = message_router_object_to_delete->cip_class;
-    CipFree(cip_class->class_name);
-    CipFree(cip_class->get_single_bit_mask);
-    CipFree(cip_class->set_bit_mask);
-    CipFree(cip_class->get_all_bit_mask);
-    CipFree(cip_class->class_instance.attributes);
-    CipFree(cip_class->services);
-    CipFree(cip_class);
+    CipArenaFree(cip_class->class_name);
+    CipArenaFree(cip_class->get_single_bit_mask);
+    CipArenaFree(cip_class->set_bit_mask);
+    CipArenaFree(cip_class->get_all_bit_mask);
+    CipArenaFree(cip_class->class_instance.attributes);
+    CipArenaFree(cip_class->services);
+    CipFree(cip_class->instance_index);
+    CipArenaFree(cip_class->attribute_slots);
+    CipArenaFree(cip_class);
     /* free message router object */
-    CipFree(message_router_object_to_delete);
+    CipArenaFree(message_router_object_to_delete);
   }
   g_first_object = NULL;
+  ObjectIndexDeleteAll();
 }
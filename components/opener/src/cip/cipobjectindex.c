@@ -0,0 +1,251 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "cipobjectindex.h"
+
+#include "opener_api.h"
+#include "ciparena.h"
+#include "trace.h"
+
+/** @brief Initial number of entries of the class and instance arrays */
+enum {
+  kObjectIndexInitialCapacity = 8
+};
+
+static CipClass **s_class_index = NULL; /**< classes sorted by class code */
+static size_t s_class_index_count = 0;
+static size_t s_class_index_capacity = 0;
+
+/** @brief Doubles the capacity of a pointer array
+ *
+ *  The index arrays live on the heap rather than in the object arena, which
+ *  cannot free the outgrown copies.
+ *
+ *  @param array The array, freed on success
+ *  @param count Number of used entries
+ *  @param capacity Allocated entries, updated on success
+ *  @return The larger copy, NULL if out of memory
+ */
+static void *ObjectIndexGrow(void *const array,
+                             const size_t count,
+                             size_t *const capacity) {
+  const size_t new_capacity =
+    (0 == *capacity) ? kObjectIndexInitialCapacity : 2 * *capacity;
+  void *const new_array = CipCalloc( new_capacity, sizeof(void *) );
+  if(NULL == new_array) {
+    return NULL;
+  }
+  if(NULL != array) {
+    memcpy( new_array, array, count * sizeof(void *) );
+    CipFree(array);
+  }
+  *capacity = new_capacity;
+  return new_array;
+}
+
+/** @brief Position of the first class with a class code not lower than
+ *  class_code */
+static size_t ObjectIndexClassPosition(const CipUdint class_code) {
+  size_t low = 0;
+  size_t high = s_class_index_count;
+  while(low < high) {
+    const size_t middle = low + (high - low) / 2;
+    if(s_class_index[middle]->class_code < class_code) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+EipStatus ObjectIndexInsertClass(CipClass *const cip_class) {
+  if(s_class_index_count == s_class_index_capacity) {
+    CipClass **const class_index = ObjectIndexGrow(s_class_index,
+                                                   s_class_index_count,
+                                                   &s_class_index_capacity);
+    if(NULL == class_index) {
+      OPENER_TRACE_ERR("Class index: out of memory\n");
+      return kEipStatusError;
+    }
+    s_class_index = class_index;
+  }
+  const size_t position = ObjectIndexClassPosition(cip_class->class_code);
+  memmove( &s_class_index[position + 1], &s_class_index[position],
+           (s_class_index_count - position) * sizeof(CipClass *) );
+  s_class_index[position] = cip_class;
+  s_class_index_count++;
+  return kEipStatusOk;
+}
+
+CipClass *ObjectIndexFindClass(const CipUdint class_code) {
+  const size_t position = ObjectIndexClassPosition(class_code);
+  if(position < s_class_index_count &&
+     class_code == s_class_index[position]->class_code) {
+    return s_class_index[position];
+  }
+  return NULL;
+}
+
+void ObjectIndexDeleteAll(void) {
+  CipFree(s_class_index);
+  s_class_index = NULL;
+  s_class_index_count = 0;
+  s_class_index_capacity = 0;
+}
+
+/** @brief Position of the first instance with an instance number not lower
+ *  than instance_number */
+static size_t ObjectIndexInstancePosition(const CipClass *const cip_class,
+                                          const CipInstanceNum instance_number)
+{
+  size_t low = 0;
+  size_t high = cip_class->instance_index_count;
+  while(low < high) {
+    const size_t middle = low + (high - low) / 2;
+    if(cip_class->instance_index[middle]->instance_number < instance_number) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+EipStatus ObjectIndexInsertInstance(CipInstance *const instance) {
+  CipClass *const cip_class = instance->cip_class;
+  if(cip_class->instance_index_count == cip_class->instance_index_capacity) {
+    size_t capacity = cip_class->instance_index_capacity;
+    CipInstance **const instance_index = ObjectIndexGrow(
+      cip_class->instance_index, cip_class->instance_index_count, &capacity);
+    if(NULL == instance_index) {
+      OPENER_TRACE_ERR("Instance index of class %s: out of memory\n",
+                       cip_class->class_name);
+      return kEipStatusError;
+    }
+    cip_class->instance_index = instance_index;
+    cip_class->instance_index_capacity = (EipUint32) capacity;
+  }
+  const size_t position = ObjectIndexInstancePosition(cip_class,
+                                                      instance->instance_number);
+  memmove( &cip_class->instance_index[position + 1],
+           &cip_class->instance_index[position],
+           (cip_class->instance_index_count - position) *
+           sizeof(CipInstance *) );
+  cip_class->instance_index[position] = instance;
+  cip_class->instance_index_count++;
+  return kEipStatusOk;
+}
+
+void ObjectIndexRemoveInstance(const CipInstance *const instance) {
+  CipClass *const cip_class = instance->cip_class;
+  /* searched by pointer, the instance number may have changed since */
+  for(size_t position = 0; position < cip_class->instance_index_count;
+      position++) {
+    if(instance == cip_class->instance_index[position]) {
+      cip_class->instance_index_count--;
+      memmove( &cip_class->instance_index[position],
+               &cip_class->instance_index[position + 1],
+               (cip_class->instance_index_count - position) *
+               sizeof(CipInstance *) );
+      return;
+    }
+  }
+}
+
+CipInstance *ObjectIndexFindInstance(const CipClass *const cip_class,
+                                     const CipInstanceNum instance_number) {
+  const size_t position = ObjectIndexInstancePosition(cip_class,
+                                                      instance_number);
+  if(position < cip_class->instance_index_count &&
+     instance_number ==
+     cip_class->instance_index[position]->instance_number) {
+    return cip_class->instance_index[position];
+  }
+  return NULL;
+}
+
+void ObjectIndexAllocateAttributeSlots(CipClass *const cip_class) {
+  cip_class->attribute_slots =
+    CipArenaCalloc( (size_t) cip_class->highest_attribute_number + 1,
+                    sizeof(EipUint16) );
+}
+
+void ObjectIndexInsertAttribute(CipClass *const cip_class,
+                                const EipUint16 attribute_number,
+                                const size_t slot) {
+  if(NULL != cip_class->attribute_slots &&
+     attribute_number <= cip_class->highest_attribute_number &&
+     0 == cip_class->attribute_slots[attribute_number]) {
+    cip_class->attribute_slots[attribute_number] = (EipUint16) (slot + 1);
+  }
+}
+
+CipAttributeStruct *ObjectIndexFindAttribute(const CipInstance *const instance,
+                                             const EipUint16 attribute_number)
+{
+  const CipClass *const cip_class = instance->cip_class;
+  if(NULL != cip_class->attribute_slots &&
+     attribute_number <= cip_class->highest_attribute_number) {
+    const EipUint16 slot = cip_class->attribute_slots[attribute_number];
+    if(0 == slot) {
+      return NULL; /* not inserted in any instance of the class */
+    }
+    CipAttributeStruct *const attribute = &instance->attributes[slot - 1];
+    if(attribute_number == attribute->attribute_number &&
+       NULL != attribute->data) {
+      return attribute;
+    }
+  }
+
+  /* instances that inserted their attributes in a different order */
+  CipAttributeStruct *attribute = instance->attributes;
+  for(size_t i = 0; i < cip_class->number_of_attributes; i++) {
+    if(attribute_number == attribute->attribute_number &&
+       NULL != attribute->data) {
+      return attribute;
+    }
+    attribute++;
+  }
+  return NULL;
+}
+
+size_t ObjectIndexServicePosition(const CipClass *const cip_class,
+                                  const CipUsint service_number) {
+  /* the used slots are sorted and precede the free ones */
+  size_t low = 0;
+  size_t high = cip_class->number_of_services;
+  while(low < high) {
+    const size_t middle = low + (high - low) / 2;
+    const CipServiceStruct *const service = &cip_class->services[middle];
+    if(NULL != service->service_function &&
+       service->service_number < service_number) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+  return low;
+}
+
+CipServiceStruct *ObjectIndexFindService(const CipClass *const cip_class,
+                                         const CipUsint service_number) {
+  if(NULL == cip_class->services) {
+    return NULL;
+  }
+  const size_t position = ObjectIndexServicePosition(cip_class,
+                                                     service_number);
+  if(position < cip_class->number_of_services) {
+    CipServiceStruct *const service = &cip_class->services[position];
+    if(NULL != service->service_function &&
+       service_number == service->service_number) {
+      return service;
+    }
+  }
+  return NULL;
+}
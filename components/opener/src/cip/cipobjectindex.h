@@ -0,0 +1,113 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_CIPOBJECTINDEX_H_
+#define OPENER_CIPOBJECTINDEX_H_
+
+/** @file cipobjectindex.h
+ *  @brief Lookup indexes of the CIP object model used by explicit messaging
+ *
+ *  - Classes are kept in an array sorted by class code.
+ *  - Each class keeps its instances in an array sorted by instance number.
+ *  - Each class maps attribute numbers to the position of the attribute in
+ *  the attribute arrays of its instances.
+ *  - The service array of each class is kept sorted by service number.
+ *
+ *  Classes, instances and services are found by binary search, attributes by
+ *  a single table access, so the dispatch cost of a request does not grow
+ *  with the number of registered objects. The indexes are maintained when
+ *  classes are registered and instances are added or deleted, which also
+ *  covers objects created by the application after CipStackInit().
+ */
+
+#include "typedefs.h"
+#include "ciptypes.h"
+
+/** @brief Adds a class to the class index
+ *
+ *  @param cip_class The class to add, its class code must be unique
+ *  @return kEipStatusOk on success, kEipStatusError if out of memory
+ */
+EipStatus ObjectIndexInsertClass(CipClass *const cip_class);
+
+/** @brief Finds a registered class
+ *
+ *  @param class_code The class code
+ *  @return The class, or NULL if it is not registered
+ */
+CipClass *ObjectIndexFindClass(const CipUdint class_code);
+
+/** @brief Empties the class index and frees it, the indexes of the classes
+ *  are freed with the classes */
+void ObjectIndexDeleteAll(void);
+
+/** @brief Adds an instance to the instance index of its class
+ *
+ *  @param instance The instance, its number must be unique within the class
+ *  @return kEipStatusOk on success, kEipStatusError if out of memory
+ */
+EipStatus ObjectIndexInsertInstance(CipInstance *const instance);
+
+/** @brief Removes an instance from the instance index of its class
+ *
+ *  @param instance The instance, no-op if not indexed
+ */
+void ObjectIndexRemoveInstance(const CipInstance *const instance);
+
+/** @brief Finds an instance of a class
+ *
+ *  @param cip_class The class
+ *  @param instance_number The instance number, must not be 0
+ *  @return The instance, or NULL if there is none
+ */
+CipInstance *ObjectIndexFindInstance(const CipClass *const cip_class,
+                                     const CipInstanceNum instance_number);
+
+/** @brief Allocates the attribute number table of a class
+ *
+ *  @param cip_class The class, its highest_attribute_number must be set
+ */
+void ObjectIndexAllocateAttributeSlots(CipClass *const cip_class);
+
+/** @brief Records the position of an attribute in the attribute arrays
+ *
+ *  @param cip_class The class of the instance the attribute was inserted in
+ *  @param attribute_number The attribute number
+ *  @param slot Position of the attribute in the attribute array
+ */
+void ObjectIndexInsertAttribute(CipClass *const cip_class,
+                                const EipUint16 attribute_number,
+                                const size_t slot);
+
+/** @brief Finds an attribute of an instance
+ *
+ *  @param instance The instance
+ *  @param attribute_number The attribute number
+ *  @return The attribute, or NULL if the instance does not have it
+ */
+CipAttributeStruct *ObjectIndexFindAttribute(const CipInstance *const instance,
+                                             const EipUint16 attribute_number);
+
+/** @brief Finds a service of a class
+ *
+ *  @param cip_class The class providing the services
+ *  @param service_number The service code
+ *  @return The service, or NULL if the class does not provide it
+ */
+CipServiceStruct *ObjectIndexFindService(const CipClass *const cip_class,
+                                         const CipUsint service_number);
+
+/** @brief Position a service is inserted at, to keep the array sorted
+ *
+ *  @param cip_class The class providing the services
+ *  @param service_number The service code
+ *  @return Position of the service with this number if already present,
+ *  otherwise of the first service with a higher number or the first free slot
+ */
+size_t ObjectIndexServicePosition(const CipClass *const cip_class,
+                                  const CipUsint service_number);
+
+#endif /* OPENER_CIPOBJECTINDEX_H_ */
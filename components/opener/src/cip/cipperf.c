@@ -0,0 +1,342 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "cipperf.h"
+
+#include "opener_api.h"
+#include "cipcommon.h"
+#include "endianconv.h"
+#include "trace.h"
+
+#if 0 != (OPENER_PERF_TRACE_RING_LENGTH & (OPENER_PERF_TRACE_RING_LENGTH - 1) )
+#error "OPENER_PERF_TRACE_RING_LENGTH must be a power of two"
+#endif
+
+/** @brief Statistics of a stage, guarded by a sequence lock */
+typedef struct {
+  atomic_uint sequence; /**< odd while the OpENer thread updates statistics */
+  PerfStageStatistics statistics;
+} PerfStageSlot;
+
+/** @brief Ring buffer slot */
+typedef struct {
+  atomic_uint sequence; /**< record number plus one, 0 while being written */
+  PerfTraceRecord record;
+} PerfTraceSlot;
+
+/** @brief Attribute values of a Performance Trace instance, filled from a
+ *  snapshot by the pre get callback */
+typedef struct {
+  CipShortString name; /**< Attr. #1 */
+  CipUdint count; /**< Attr. #2 */
+  CipUdint min_ns; /**< Attr. #3 */
+  CipUdint mean_ns; /**< Attr. #4 */
+  CipUdint max_ns; /**< Attr. #5 */
+  CipUdint histogram[PERF_HISTOGRAM_BUCKETS]; /**< Attr. #6 */
+  CipUdint counter_frequency; /**< Attr. #7 */
+  CipUint load_permille; /**< Attr. #8 */
+} PerfTraceInstanceAttributes;
+
+static const char *const kPerfStageNames[kPerfStageCount] = {
+  [kPerfStageSelectWake] = "select_wake",
+  [kPerfStageHandleReceivedConnectedData] = "handle_received_connected_data",
+  [kPerfStageNotifyAssemblyConnectedDataReceived] =
+    "notify_assembly_connected_data_received",
+  [kPerfStageAfterAssemblyDataReceived] = "after_assembly_data_received",
+  [kPerfStageSendConnectedData] = "send_connected_data",
+  [kPerfStageSendUdpData] = "send_udp_data",
+};
+
+static PerfStageSlot s_stages[kPerfStageCount];
+static PerfTraceSlot s_trace_ring[OPENER_PERF_TRACE_RING_LENGTH];
+static atomic_uint s_trace_head; /**< number of records written */
+static atomic_bool s_reset_requested;
+static atomic_uint s_load_permille[kPerfStageCount];
+
+static CipUdint s_counter_frequency;
+
+/* load window, OpENer thread only */
+static PerfTicks s_window_start;
+static CipUlint s_window_start_totals[kPerfStageCount];
+
+static PerfTraceInstanceAttributes s_instance_attributes[kPerfStageCount];
+
+static unsigned int PerfHistogramBucket(const PerfTicks duration) {
+  if(0 == duration) {
+    return 0;
+  }
+  return 31U - (unsigned int) __builtin_clz(duration);
+}
+
+static void PerfStageBeginUpdate(PerfStageSlot *const slot) {
+  atomic_store_explicit(&slot->sequence,
+                        atomic_load_explicit(&slot->sequence,
+                                             memory_order_relaxed) + 1U,
+                        memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+}
+
+static void PerfStageEndUpdate(PerfStageSlot *const slot) {
+  atomic_store_explicit(&slot->sequence,
+                        atomic_load_explicit(&slot->sequence,
+                                             memory_order_relaxed) + 1U,
+                        memory_order_release);
+}
+
+/** @brief Clears statistics and ring buffer, OpENer thread only */
+static void PerfApplyReset(const PerfTicks now) {
+  for(size_t i = 0; i < kPerfStageCount; i++) {
+    PerfStageBeginUpdate(&s_stages[i]);
+    memset(&s_stages[i].statistics, 0, sizeof(s_stages[i].statistics) );
+    PerfStageEndUpdate(&s_stages[i]);
+    s_window_start_totals[i] = 0;
+    atomic_store(&s_load_permille[i], 0U);
+  }
+  /* invalidate the slots first, so no old record matches a new number */
+  for(size_t i = 0; i < OPENER_PERF_TRACE_RING_LENGTH; i++) {
+    atomic_store(&s_trace_ring[i].sequence, 0U);
+  }
+  atomic_store(&s_trace_head, 0U);
+  s_window_start = now;
+}
+
+/** @brief Computes the share of each stage in the elapsed load window, once
+ *  per second */
+static void PerfUpdateLoad(const PerfTicks now) {
+  const PerfTicks elapsed = now - s_window_start;
+  if(elapsed < s_counter_frequency) {
+    return;
+  }
+  for(size_t i = 0; i < kPerfStageCount; i++) {
+    /* only the OpENer thread writes the statistics, no lock needed here */
+    const CipUlint total = s_stages[i].statistics.total;
+    CipUlint permille = (total - s_window_start_totals[i]) * 1000ULL / elapsed;
+    atomic_store(&s_load_permille[i],
+                 (unsigned int) (permille > 1000ULL ? 1000ULL : permille) );
+    s_window_start_totals[i] = total;
+  }
+  s_window_start = now;
+}
+
+void PerfRecord(const PerfStage stage,
+                const PerfTicks start) {
+  const PerfTicks now = GetPerfCounter();
+  const PerfTicks duration = now - start;
+
+  PerfStageSlot *const slot = &s_stages[stage];
+  PerfStageBeginUpdate(slot);
+  PerfStageStatistics *const statistics = &slot->statistics;
+  if(0 == statistics->count || duration < statistics->min) {
+    statistics->min = duration;
+  }
+  if(duration > statistics->max) {
+    statistics->max = duration;
+  }
+  statistics->count++;
+  statistics->total += duration;
+  statistics->histogram[PerfHistogramBucket(duration)]++;
+  PerfStageEndUpdate(slot);
+
+  const unsigned int head = atomic_load_explicit(&s_trace_head,
+                                                 memory_order_relaxed);
+  PerfTraceSlot *const trace_slot =
+    &s_trace_ring[head & (OPENER_PERF_TRACE_RING_LENGTH - 1)];
+  atomic_store_explicit(&trace_slot->sequence, 0U, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  trace_slot->record.stage = stage;
+  trace_slot->record.start = start;
+  trace_slot->record.duration = duration;
+  atomic_store_explicit(&trace_slot->sequence, head + 1U,
+                        memory_order_release);
+  atomic_store_explicit(&s_trace_head, head + 1U, memory_order_release);
+
+  /* the loop stage ends every select() wakeup, at least once per tick */
+  if(kPerfStageSelectWake == stage) {
+    if(atomic_exchange(&s_reset_requested, false) ) {
+      PerfApplyReset(now);
+    } else {
+      PerfUpdateLoad(now);
+    }
+  }
+}
+
+void PerfRequestReset(void) {
+  atomic_store(&s_reset_requested, true);
+}
+
+void PerfGetStageStatistics(const PerfStage stage,
+                            PerfStageStatistics *const statistics) {
+  PerfStageSlot *const slot = &s_stages[stage];
+  unsigned int sequence = 0;
+  do {
+    sequence = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if(0 != (sequence & 1U) ) {
+      continue; /* update in progress */
+    }
+    *statistics = slot->statistics;
+    atomic_thread_fence(memory_order_acquire);
+  } while(0 != (sequence & 1U) ||
+          sequence != atomic_load_explicit(&slot->sequence,
+                                           memory_order_relaxed) );
+}
+
+size_t PerfGetRecentRecords(PerfTraceRecord *const records,
+                            const size_t max_records) {
+  const unsigned int head = atomic_load_explicit(&s_trace_head,
+                                                 memory_order_acquire);
+  size_t available = head < OPENER_PERF_TRACE_RING_LENGTH ?
+                     head : OPENER_PERF_TRACE_RING_LENGTH;
+  if(available > max_records) {
+    available = max_records;
+  }
+
+  size_t copied = 0;
+  for(unsigned int number = head - (unsigned int) available; number != head;
+      number++) {
+    PerfTraceSlot *const slot =
+      &s_trace_ring[number & (OPENER_PERF_TRACE_RING_LENGTH - 1)];
+    const unsigned int sequence =
+      atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    if(number + 1U != sequence) {
+      continue; /* already overwritten */
+    }
+    PerfTraceRecord record = slot->record;
+    atomic_thread_fence(memory_order_acquire);
+    if(sequence != atomic_load_explicit(&slot->sequence,
+                                        memory_order_relaxed) ) {
+      continue;
+    }
+    records[copied++] = record;
+  }
+  return copied;
+}
+
+CipUint PerfGetLoadPermille(const PerfStage stage) {
+  return (CipUint) atomic_load(&s_load_permille[stage]);
+}
+
+CipUlint PerfTicksToNanoSeconds(const CipUlint ticks) {
+  if(0 == s_counter_frequency) {
+    return 0;
+  }
+  /* split to avoid overflowing 64 bits for large totals */
+  return (ticks / s_counter_frequency) * 1000000000ULL +
+         (ticks % s_counter_frequency) * 1000000000ULL / s_counter_frequency;
+}
+
+const char *PerfGetStageName(const PerfStage stage) {
+  return kPerfStageNames[stage];
+}
+
+static CipUdint PerfNanoSecondsToUdint(const CipUlint ticks) {
+  const CipUlint nano_seconds = PerfTicksToNanoSeconds(ticks);
+  return nano_seconds > UINT32_MAX ? UINT32_MAX : (CipUdint) nano_seconds;
+}
+
+/** @brief Fills the attributes of an instance from a fresh snapshot */
+static EipStatus PerfTracePreGetCallback(CipInstance *const instance,
+                                         CipAttributeStruct *const attribute,
+                                         CipByte service) {
+  (void) attribute;
+  (void) service;
+
+  const size_t index = instance->instance_number - 1U;
+  PerfTraceInstanceAttributes *const attributes =
+    &s_instance_attributes[index];
+  PerfStageStatistics statistics;
+  PerfGetStageStatistics( (PerfStage) index, &statistics );
+
+  attributes->count = statistics.count;
+  attributes->min_ns = PerfNanoSecondsToUdint(statistics.min);
+  attributes->mean_ns = 0 == statistics.count ? 0 :
+                        PerfNanoSecondsToUdint(statistics.total /
+                                               statistics.count);
+  attributes->max_ns = PerfNanoSecondsToUdint(statistics.max);
+  memcpy(attributes->histogram, statistics.histogram,
+         sizeof(attributes->histogram) );
+  attributes->load_permille = PerfGetLoadPermille( (PerfStage) index );
+  return kEipStatusOk;
+}
+
+static EipStatus PerfTracePostResetCallback(
+  CipInstance *const instance,
+  const CipMessageRouterRequest *const message_router_request,
+  CipMessageRouterResponse *const message_router_response) {
+  (void) instance;
+  (void) message_router_request;
+  (void) message_router_response;
+
+  PerfRequestReset();
+  return kEipStatusOk;
+}
+
+static void EncodePerfHistogram(const void *const data,
+                                ENIPMessage *const outgoing_message) {
+  const CipUdint *const histogram = data;
+  for(size_t i = 0; i < PERF_HISTOGRAM_BUCKETS; i++) {
+    AddDintToMessage(histogram[i], outgoing_message);
+  }
+}
+
+EipStatus CipPerfTraceInit(void) {
+  CipClass *perf_class = NULL;
+
+  if( ( perf_class = CreateCipClass(kCipPerfTraceClassCode,
+                                    7, /* # class attributes */
+                                    7, /* # highest class attribute number */
+                                    2, /* # class services */
+                                    8, /* # instance attributes */
+                                    8, /* # highest instance attribute number */
+                                    2, /* # instance services */
+                                    kPerfStageCount, /* # instances */
+                                    "Performance Trace",
+                                    1, /* # class revision */
+                                    NULL /* # function pointer for initialization */
+                                    ) ) == 0 ) {
+    return kEipStatusError;
+  }
+
+  s_counter_frequency = GetPerfCounterFrequency();
+  atomic_store(&s_reset_requested, false);
+  PerfApplyReset(GetPerfCounter() );
+
+  for(size_t i = 0; i < kPerfStageCount; i++) {
+    PerfTraceInstanceAttributes *const attributes = &s_instance_attributes[i];
+    attributes->name.length = (EipUint8) strlen(kPerfStageNames[i]);
+    attributes->name.string = (EipByte *) kPerfStageNames[i];
+    attributes->counter_frequency = s_counter_frequency;
+
+    CipInstance *instance = GetCipInstance(perf_class,
+                                           (CipInstanceNum) (i + 1U) );
+    InsertAttribute(instance, 1, kCipShortString, EncodeCipShortString, NULL,
+                    &attributes->name, kGetableSingle);
+    InsertAttribute(instance, 2, kCipUdint, EncodeCipUdint, NULL,
+                    &attributes->count, kGetableSingle | kPreGetFunc);
+    InsertAttribute(instance, 3, kCipUdint, EncodeCipUdint, NULL,
+                    &attributes->min_ns, kGetableSingle | kPreGetFunc);
+    InsertAttribute(instance, 4, kCipUdint, EncodeCipUdint, NULL,
+                    &attributes->mean_ns, kGetableSingle | kPreGetFunc);
+    InsertAttribute(instance, 5, kCipUdint, EncodeCipUdint, NULL,
+                    &attributes->max_ns, kGetableSingle | kPreGetFunc);
+    InsertAttribute(instance, 6, kCipAny, EncodePerfHistogram, NULL,
+                    attributes->histogram, kGetableSingle | kPreGetFunc);
+    InsertAttribute(instance, 7, kCipUdint, EncodeCipUdint, NULL,
+                    &attributes->counter_frequency, kGetableSingle);
+    InsertAttribute(instance, 8, kCipUint, EncodeCipUint, NULL,
+                    &attributes->load_permille, kGetableSingle | kPreGetFunc);
+  }
+
+  InsertGetSetCallback(perf_class, PerfTracePreGetCallback, kPreGetFunc);
+  perf_class->PostResetCallback = PerfTracePostResetCallback;
+
+  InsertService(perf_class, kGetAttributeSingle, &GetAttributeSingle,
+                "GetAttributeSingle");
+  InsertService(perf_class, kReset, &CipResetService, "Reset");
+
+  return kEipStatusOk;
+}
@@ -0,0 +1,160 @@
+/*******************************************************************************
+ * Copyright (c) 2026, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_CIPPERF_H_
+#define OPENER_CIPPERF_H_
+
+/** @file cipperf.h
+ *  @brief Per-stage timing of the implicit I/O path and the vendor specific
+ *  Performance Trace object exposing it
+ *
+ *  The OpENer thread timestamps the stages of the I/O path with the platform
+ *  performance counter (see GetPerfCounter()). Every measurement is written to
+ *  a ring buffer of recent records and aggregated into per-stage statistics:
+ *  count, min, mean, max and a histogram with power of two buckets. Stages
+ *  nest, the time of a stage includes the stages called from it.
+ *
+ *  The OpENer thread is the only writer. Other tasks read consistent snapshots
+ *  with PerfGetStageStatistics() and PerfGetRecentRecords() without ever
+ *  blocking it.
+ *
+ *  The Performance Trace object has one instance per stage (instance number
+ *  is the PerfStage plus one) with the Get_Attribute_Single attributes:
+ *  1 stage name (SHORT_STRING), 2 count (UDINT), 3 min, 4 mean and 5 max
+ *  duration in ns (UDINT), 6 histogram (ARRAY of 32 UDINT, in counter ticks),
+ *  7 counter frequency in Hz (UDINT), 8 load in the last second in tenths of
+ *  a percent (UINT). The Reset service clears the statistics of all stages.
+ */
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "typedefs.h"
+#include "ciptypes.h"
+#include "opener_user_conf.h"
+#include "networkhandler.h"
+
+/** @brief Performance Trace object class code (vendor specific) */
+static const CipUint kCipPerfTraceClassCode = 0x64U;
+
+/** @brief Enables the per-stage timing of the I/O path */
+#ifndef OPENER_PERF_TRACE
+  #define OPENER_PERF_TRACE 1
+#endif
+
+/** @brief Number of records kept in the trace ring buffer, a power of two */
+#ifndef OPENER_PERF_TRACE_RING_LENGTH
+  #define OPENER_PERF_TRACE_RING_LENGTH 256
+#endif
+
+/** @brief Number of histogram buckets, bucket n counts durations of
+ *  [2^n, 2^(n+1)) counter ticks, bucket 0 also counts zero durations */
+#define PERF_HISTOGRAM_BUCKETS 32
+
+/** @brief Timed stages of the I/O path, also the Performance Trace instance
+ *  number minus one */
+typedef enum {
+  kPerfStageSelectWake, /**< all work of one select() wakeup */
+  kPerfStageHandleReceivedConnectedData, /**< one received I/O datagram */
+  kPerfStageNotifyAssemblyConnectedDataReceived, /**< consumed data copy */
+  kPerfStageAfterAssemblyDataReceived, /**< application callback */
+  kPerfStageSendConnectedData, /**< one produced I/O frame */
+  kPerfStageSendUdpData, /**< sendto() of a produced frame */
+  kPerfStageCount
+} PerfStage;
+
+/** @brief Aggregated timing of one stage, durations in counter ticks */
+typedef struct {
+  CipUdint count; /**< number of measurements */
+  CipUlint total; /**< sum of all durations */
+  CipUdint min; /**< shortest duration, 0 if count is 0 */
+  CipUdint max; /**< longest duration */
+  CipUdint histogram[PERF_HISTOGRAM_BUCKETS];
+} PerfStageStatistics;
+
+/** @brief One measurement of the trace ring buffer */
+typedef struct {
+  PerfStage stage;
+  PerfTicks start; /**< performance counter at the start of the stage */
+  PerfTicks duration; /**< in counter ticks */
+} PerfTraceRecord;
+
+#if defined(OPENER_PERF_TRACE) && 0 != OPENER_PERF_TRACE
+/** @brief Declares @p start and stores the performance counter in it */
+  #define OPENER_PERF_BEGIN(start) const PerfTicks start = GetPerfCounter()
+/** @brief Records the time since OPENER_PERF_BEGIN(start) for @p stage */
+  #define OPENER_PERF_END(stage, start) PerfRecord( (stage), (start) )
+#else
+  #define OPENER_PERF_BEGIN(start)
+  #define OPENER_PERF_END(stage, start)
+#endif
+
+/** @brief Creates the Performance Trace object and clears all statistics
+ *
+ *  @return kEipStatusOk on success
+ */
+EipStatus CipPerfTraceInit(void);
+
+/** @brief Records one measurement, OpENer thread only
+ *
+ *  @param stage The measured stage
+ *  @param start Performance counter at the start of the stage
+ */
+void PerfRecord(const PerfStage stage,
+                const PerfTicks start);
+
+/** @brief Requests clearing all statistics and the trace ring buffer, from
+ *  any task
+ *
+ *  The OpENer thread applies the request at the end of the next select()
+ *  wakeup.
+ */
+void PerfRequestReset(void);
+
+/** @brief Copies a consistent snapshot of the statistics of a stage, from any
+ *  task
+ *
+ *  @param stage The stage
+ *  @param statistics Destination of the snapshot
+ */
+void PerfGetStageStatistics(const PerfStage stage,
+                            PerfStageStatistics *const statistics);
+
+/** @brief Copies the most recent trace records, from any task
+ *
+ *  @param records Destination, oldest record first
+ *  @param max_records Capacity of records
+ *  @return Number of records copied
+ */
+size_t PerfGetRecentRecords(PerfTraceRecord *const records,
+                            const size_t max_records);
+
+/** @brief Share of the wall time spent in a stage during the last full
+ *  second, from any task
+ *
+ *  For kPerfStageSelectWake this is the busy time of the OpENer thread.
+ *
+ *  @param stage The stage
+ *  @return Time in tenths of a percent (0 to 1000)
+ */
+CipUint PerfGetLoadPermille(const PerfStage stage);
+
+/** @brief Converts performance counter ticks to nanoseconds
+ *
+ *  @param ticks Counter ticks
+ *  @return Nanoseconds
+ */
+CipUlint PerfTicksToNanoSeconds(const CipUlint ticks);
+
+/** @brief Short name of a stage, as used in the trace output
+ *
+ *  @param stage The stage
+ *  @return The stage name
+ */
+const char *PerfGetStageName(const PerfStage stage);
+
+#endif /* OPENER_CIPPERF_H_ */
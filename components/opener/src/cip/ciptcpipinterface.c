@@ -664,7 +664,7 @@ EipStatus CipTcpIpInterfaceInit() {
                                        2, /* # class services */
                                        13, /* # instance attributes */
                                        13, /* # highest instance attribute number */
-                                       3, /* # instance services */
+                                       5, /* # instance services */
                                        1, /* # instances */
                                        "TCP/IP interface", 4, /* # class revision */
                                        NULL /* # function pointer for initialization */
@@ -798,6 +798,12 @@ EipStatus CipTcpIpInterfaceInit() {
                 &SetAttributeSingle,
                 "SetAttributeSingle");
 
+  InsertService(tcp_ip_class, kGetAttributeList, &GetAttributeList,
+                "GetAttributeList");
+
+  InsertService(tcp_ip_class, kSetAttributeList, &SetAttributeList,
+                "SetAttributeList");
+
   return kEipStatusOk;
 }
 
@@ -383,7 +383,13 @@ typedef struct cip_class {
 
   EipUint16 number_of_services;   /**< number of services supported */
   CipInstance *instances;   /**< pointer to the list of instances */
-  struct cip_service_struct *services;   /**< pointer to the array of services */
+  struct cip_service_struct *services;   /**< pointer to the array of services,
+                                            sorted by service number */
+  CipInstance **instance_index;   /**< instances sorted by instance number */
+  EipUint16 instance_index_count;   /**< number of entries in instance_index */
+  EipUint32 instance_index_capacity;   /**< allocated entries of instance_index */
+  EipUint16 *attribute_slots;   /**< per attribute number the position in the
+                                   attribute array plus one, 0 if not inserted */
   char *class_name;   /**< class name */
   /** Is called in GetAttributeSingle* before the response is assembled from
    * the object's attributes */
@@ -784,12 +784,14 @@ EipStatus HandleReceivedConnectedData(const EipUint8 *const received_data,
  * function should be called periodically once every @ref kOpenerTimerTickInMilliSeconds
  * milliseconds. In order to simplify the algorithm if more time was lapsed, the elapsed
  * time since the last call of the function is given as a parameter.
+ * With OPENER_CONNECTION_SCHEDULER enabled it should additionally be called when
+ * ConnectionSchedulerGetTimeToNextDeadline() has expired.
  *
- * @param elapsed_time Elapsed time in milliseconds since the last call of ManageConnections
+ * @param elapsed_time Elapsed time in microseconds since the last call of ManageConnections
  *
  * @return EIP_OK on success
  */
-EipStatus ManageConnections(MilliSeconds elapsed_time);
+EipStatus ManageConnections(MicroSeconds elapsed_time);
 
 /** @ingroup CIP_API
  * @brief Trigger the production of an application triggered connection.
@@ -799,7 +801,7 @@ EipStatus ManageConnections(MilliSeconds elapsed_time);
  * inhibit timer. The application is informed via the
  * EIP_BOOL8 BeforeAssemblyDataSend(S_CIP_Instance *pa_pstInstance)
  * callback function when the production will happen. This function should only
- * be invoked from void HandleApplication(void).
+ * be invoked from the OpENer thread, e.g., from void HandleApplication(void).
  *
  * The connection can only be triggered if the application is established and it
  * is of application application triggered type.
@@ -813,6 +815,25 @@ EipStatus ManageConnections(MilliSeconds elapsed_time);
 EipStatus TriggerConnections(unsigned int output_assembly_id,
                              unsigned int input_assembly_id);
 
+/** @ingroup CIP_API
+ * @brief Request the production of all connections producing an input assembly
+ *
+ * Marks the data of the input assembly as changed. Each established change of
+ * state or application triggered connection producing the assembly sends it
+ * as soon as its production inhibit timer allows, cyclic connections are not
+ * affected. The OpENer thread is woken up to serve the request immediately
+ * instead of at the next timer tick, see OpenerRequestService().
+ *
+ * In contrast to TriggerConnections() this function may be called from any
+ * task, e.g., right after publishing new data with AssemblyBufferWrite().
+ * Requests for the same assembly are coalesced until they are served.
+ *
+ * @param input_assembly_id the input assembly connection point
+ * @return kEipStatusOk if the request was queued, kEipStatusError if
+ * OPENER_PRODUCTION_REQUEST_QUEUE_LENGTH other assemblies are already pending
+ */
+EipStatus TriggerAssemblyProduction(const CipInstanceNum input_assembly_id);
+
 /** @ingroup CIP_API
  * @brief Inform the encapsulation layer that the remote host has closed the
  * connection.
@@ -893,6 +914,9 @@ EipStatus AfterAssemblyDataReceived(CipInstance *instance);
  * Within this function the user can update the data of the assembly object
  * before it gets sent. The application can inform the application if data has
  * changed.
+ * The function is called for every producing connection and for explicit
+ * reads of attribute 3. A change only has to be reported once, the stack
+ * keeps track of which connections have sent it.
  * @param instance instance of assembly object that should send data.
  * @return data has changed:
  *          - true assembly data has changed
@@ -978,6 +1002,26 @@ void CloseSocket(const int socket_handle);
  */
 void RegisterTimeoutChecker(TimeoutCheckerFunction timeout_checker_function);
 
+/** @brief Services of the OpENer thread that can be requested with
+ *  OpenerRequestService() */
+typedef enum {
+  kOpenerServiceProduction = 0x01U, /**< serve production requests, see TriggerAssemblyProduction() */
+  kOpenerServiceApplication = 0x02U /**< call HandleApplication(), e.g., to apply queued writes to received assemblies */
+} OpenerServiceFlag;
+
+/** @ingroup CIP_CALLBACK_API
+ * @brief Asks the OpENer thread to perform services right away
+ *
+ * Wakes the OpENer thread from select() instead of leaving the request to the
+ * next timer tick. May be called from any task. Requests made before the
+ * thread runs are merged and cost a single wakeup. Without a wakeup channel
+ * (see NetworkHandlerInitialize()) the services are performed at the next
+ * tick.
+ *
+ * @param service_flags OpenerServiceFlag values or'ed together
+ */
+void OpenerRequestService(const unsigned int service_flags);
+
 /** @mainpage OpENer - Open Source EtherNet/IP(TM) Communication Stack
  * Documentation
  *
@@ -12,9 +12,28 @@
 #include "opener_user_conf.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
+#include "sdkconfig.h"
+
+MicroSeconds GetMicroSeconds(void) {
+  /* esp_timer instead of the FreeRTOS tick count, so connection deadlines are
+   *  not quantized to the tick period */
+  return (MicroSeconds)esp_timer_get_time();
+}
 
 MilliSeconds GetMilliSeconds(void) {
-  return (MilliSeconds)(xTaskGetTickCount() * portTICK_PERIOD_MS);
+  return (MilliSeconds)(GetMicroSeconds() / 1000ULL);
+}
+
+PerfTicks GetPerfCounter(void) {
+  /* CPU cycle counter, wraps after about 12 s at 360 MHz */
+  return (PerfTicks)esp_cpu_get_cycle_count();
+}
+
+CipUdint GetPerfCounterFrequency(void) {
+  /* no dynamic frequency scaling, the CPU clock is fixed */
+  return (CipUdint)CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ * 1000000U;
 }
 
 EipStatus NetworkHandlerInitializePlatform(void) {
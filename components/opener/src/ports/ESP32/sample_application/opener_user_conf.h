@@ -86,8 +86,50 @@
 
 #define PC_OPENER_ETHERNET_BUFFER_SIZE 512
 
+/** @brief Number of preallocated receive buffers for the implicit I/O socket
+ *
+ *  All datagrams pending on the I/O socket are drained into these buffers in
+ *  one select() wakeup, up to this number, before being dispatched.
+ */
+#ifndef OPENER_UDP_IO_RECEIVE_BATCH_SIZE
+  #define OPENER_UDP_IO_RECEIVE_BATCH_SIZE 8
+#endif
+
 static const MilliSeconds kOpenerTimerTickInMilliSeconds = 10;
 
+/** @brief Wake the network handler at the earliest connection deadline
+ *
+ *  When enabled, select() sleeps until the next connection production or
+ *  watchdog deadline (at most kOpenerTimerTickInMilliSeconds) instead of
+ *  always sleeping a full tick, so RPIs shorter than the tick are produced
+ *  on time. Requires a FreeRTOS tick rate of 1 kHz for millisecond accuracy.
+ */
+#ifndef OPENER_CONNECTION_SCHEDULER
+  #define OPENER_CONNECTION_SCHEDULER 1
+#endif
+
+/** @brief Time the stages of the I/O path with the performance counter
+ *
+ *  Aggregated per-stage statistics and the most recent measurements are
+ *  exposed by the vendor specific Performance Trace object (class 0x64),
+ *  see cipperf.h. Costs two counter reads per stage.
+ */
+#ifndef OPENER_PERF_TRACE
+  #define OPENER_PERF_TRACE 1
+#endif
+
+/** @brief Size in bytes of the static arena holding the CIP object model
+ *
+ *  Classes, instances and their attribute and service tables are allocated
+ *  from it instead of the heap, see ciparena.h. CipStackInit() traces the
+ *  bytes used, allocations that do not fit fall back to CipCalloc(). The
+ *  POSIX sample needs about 14 kB on a 64 bit host, 32 bit pointers make the
+ *  object model smaller here. 0 disables the arena.
+ */
+#ifndef OPENER_CIP_OBJECT_ARENA_SIZE
+  #define OPENER_CIP_OBJECT_ARENA_SIZE 16384
+#endif
+
 #define OPENER_WITH_TRACES
 #define OPENER_TRACE_LEVEL (OPENER_TRACE_LEVEL_ERROR | OPENER_TRACE_LEVEL_WARNING)
 
@@ -16,6 +16,7 @@
 #include "cipqos.h"
 #include "cipstring.h"
 #include "ciptypes.h"
+#include "cipassemblybuffer.h"
 #include "typedefs.h"
 #include "driver/gpio.h"
 #include "esp_system.h"
@@ -25,7 +26,10 @@
 #include "cipethernetlink.h"
 #include "generic_networkhandler.h"
 #include "vl53l1x.h"
+#include "vl53l1x_array.h"
 #include "VL53L1X_api.h"
+#include "vl53l1x_config.h"
+#include "vl53l1x_filter.h"
 #include "sdkconfig.h"
 #include "system_config.h"
 
@@ -38,33 +42,305 @@ static void ConfigureStatusLed(void);
 #define DEMO_APP_INPUT_ASSEMBLY_NUM                100
 #define DEMO_APP_OUTPUT_ASSEMBLY_NUM               150
 #define DEMO_APP_CONFIG_ASSEMBLY_NUM               151
-EipUint8 g_assembly_data064[32];
-EipUint8 g_assembly_data096[32];
-EipUint8 g_assembly_data097[10];
+#define DEMO_APP_INPUT_ASSEMBLY_SIZE               32
+#define DEMO_APP_OUTPUT_ASSEMBLY_SIZE              32
+#define DEMO_APP_CONFIG_ASSEMBLY_SIZE              10
+
+/* Size of a VL53L1x record in the input assembly, the records of all sensors
+ * follow each other from the configured start byte. A compact record is the
+ * distance and range status of the full one. */
+#define SENSOR_FULL_RECORD_SIZE                    9
+#define SENSOR_COMPACT_RECORD_SIZE                 3
+#ifdef CONFIG_OPENER_VL53L1X_COMPACT_RECORDS
+#define SENSOR_RECORD_SIZE                         SENSOR_COMPACT_RECORD_SIZE
+#else
+#define SENSOR_RECORD_SIZE                         SENSOR_FULL_RECORD_SIZE
+#endif
+
+/* Range status of a sensor that gave no result within the sample timeout */
+#define SENSOR_STATUS_NO_RESULT                    255
+
+/* Sample counter and timestamp of the record, after the last record range so
+ * they stay at the same place for every record offset */
+#define SENSOR_SAMPLE_COUNTER_OFFSET               27
+#define SENSOR_SAMPLE_TIMESTAMP_OFFSET             28
+
+/* Longest wait for the ranging result of a sensor before it is reported
+ * with SENSOR_STATUS_NO_RESULT, 0 waits two ranging periods of the applied
+ * configuration so high-rate sensors are not left stale for long */
+#ifndef SENSOR_SAMPLE_TIMEOUT_MS
+#define SENSOR_SAMPLE_TIMEOUT_MS                   0
+#endif
+/* Sensor state check period while the sensor is disabled */
+#define SENSOR_DISABLED_CHECK_MS                   100
+
+/* Assembly data is triple buffered, the sensor, Modbus and web tasks never
+ * block the OpENer thread and OpENer always sends a consistent snapshot */
+static EipUint8 s_input_assembly_storage[
+  ASSEMBLY_BUFFER_STORAGE_SIZE(DEMO_APP_INPUT_ASSEMBLY_SIZE)];
+static EipUint8 s_output_assembly_storage[
+  ASSEMBLY_BUFFER_STORAGE_SIZE(DEMO_APP_OUTPUT_ASSEMBLY_SIZE)];
+static EipUint8 s_config_assembly_storage[
+  ASSEMBLY_BUFFER_STORAGE_SIZE(DEMO_APP_CONFIG_ASSEMBLY_SIZE)];
+static AssemblyBuffer s_input_assembly;
+static AssemblyBuffer s_output_assembly;
+static AssemblyBuffer s_config_assembly;
 
 static const gpio_num_t kStatusLedGpio = GPIO_NUM_33;
 static bool restart_pending = false;
 static EipUint32 s_active_io_connections = 0;
 static bool s_io_activity_seen = false;
 
-/* Mutexes for thread-safe access */
-static SemaphoreHandle_t s_assembly_mutex = NULL;  // Protects assembly data arrays
+/* Mutexes for thread-safe access, the assembly writer mutexes serialize the
+ * application writers of one assembly and are never taken by OpENer */
+static SemaphoreHandle_t s_input_writer_mutex = NULL;
+static SemaphoreHandle_t s_output_writer_mutex = NULL;
+static SemaphoreHandle_t s_config_writer_mutex = NULL;
 static SemaphoreHandle_t s_sensor_state_mutex = NULL;  // Protects sensor state variables
 
 /* VL53L1x sensor handles */
 static vl53l1x_handle_t s_vl53l1x_handle = VL53L1X_INIT;
-static vl53l1x_device_handle_t s_vl53l1x_device = VL53L1X_DEVICE_INIT;
+static vl53l1x_array_t s_vl53l1x_array;
+static gpio_num_t s_sensor_xshut_gpios[VL53L1X_ARRAY_MAX_SENSORS];
+static uint8_t s_sensor_count = 1;  // Sensors in the array, one record each
 static TaskHandle_t s_vl53l1x_task_handle = NULL;
 static bool s_sensor_enabled = true;  // Track sensor enabled state
 static uint8_t s_sensor_start_byte = 0;  // Track sensor data start byte offset
+static uint32_t s_sensor_sample_counter = 0;  // Results published, byte 27
+/* Processing pipeline of each sensor, only touched by the sensor task */
+static vl53l1x_filter_t s_sensor_filters[VL53L1X_ARRAY_MAX_SENSORS];
+static volatile bool s_sensor_processing = false;  // Records hold processed values
 
 // Export device handle for webui_api.c
 void *g_vl53l1x_device_handle = NULL;
 
-// Export mutex for webui_api.c and modbus_register_map.c
-SemaphoreHandle_t sample_application_get_assembly_mutex(void)
+static AssemblyBuffer *GetAssemblyBuffer(uint32_t instance)
+{
+    switch (instance) {
+        case DEMO_APP_INPUT_ASSEMBLY_NUM:
+            return &s_input_assembly;
+        case DEMO_APP_OUTPUT_ASSEMBLY_NUM:
+            return &s_output_assembly;
+        case DEMO_APP_CONFIG_ASSEMBLY_NUM:
+            return &s_config_assembly;
+        default:
+            return NULL;
+    }
+}
+
+static SemaphoreHandle_t GetAssemblyWriterMutex(const AssemblyBuffer *assembly)
+{
+    if (assembly == &s_input_assembly) {
+        return s_input_writer_mutex;
+    }
+    if (assembly == &s_output_assembly) {
+        return s_output_writer_mutex;
+    }
+    return s_config_writer_mutex;
+}
+
+// Assembly access for webui_api.c and modbus_register_map.c
+uint16_t sample_application_get_assembly_size(uint32_t instance)
+{
+    AssemblyBuffer *assembly = GetAssemblyBuffer(instance);
+    return (assembly != NULL) ? assembly->data_length : 0;
+}
+
+bool sample_application_read_assembly(uint32_t instance, uint16_t offset,
+                                      uint8_t *data, uint16_t length)
+{
+    AssemblyBuffer *assembly = GetAssemblyBuffer(instance);
+    if (assembly == NULL) {
+        return false;
+    }
+    return AssemblyBufferRead(assembly, offset, data, length) == kEipStatusOk;
+}
+
+// Only writes that change the produced data count as a change of state
+static bool InputAssemblyChanged(uint16_t offset, const uint8_t *data,
+                                 uint16_t length)
+{
+    uint8_t current[DEMO_APP_INPUT_ASSEMBLY_SIZE];
+    return length > sizeof(current) ||
+           AssemblyBufferRead(&s_input_assembly, offset, current, length) != kEipStatusOk ||
+           memcmp(current, data, length) != 0;
+}
+
+// Writes to assemblies received by OpENer are queued and applied by the
+// OpENer thread, which is woken up for them. The writer does not wait, callers
+// that need the written data back check
+// sample_application_assembly_write_pending().
+// Changed input data is sent right away on change of state and application
+// triggered connections, cyclic connections pick it up with their next RPI.
+// Called with the writer mutex of the assembly held.
+static bool WriteAssemblyLocked(AssemblyBuffer *assembly, uint16_t offset,
+                                const uint8_t *data, uint16_t length)
+{
+    bool changed = assembly == &s_input_assembly &&
+                   InputAssemblyChanged(offset, data, length);
+    bool ok = AssemblyBufferWrite(assembly, offset, data, length) == kEipStatusOk;
+    if (ok && changed &&
+        TriggerAssemblyProduction(DEMO_APP_INPUT_ASSEMBLY_NUM) != kEipStatusOk) {
+        OPENER_TRACE_WARN("Production request queue full\n");
+    }
+    if (ok && AssemblyBufferWritePending(assembly)) {
+        OpenerRequestService(kOpenerServiceApplication);
+    }
+    return ok;
+}
+
+bool sample_application_write_assembly(uint32_t instance, uint16_t offset,
+                                       const uint8_t *data, uint16_t length)
+{
+    AssemblyBuffer *assembly = GetAssemblyBuffer(instance);
+    if (assembly == NULL) {
+        return false;
+    }
+    SemaphoreHandle_t writer_mutex = GetAssemblyWriterMutex(assembly);
+    if (writer_mutex == NULL) {
+        return false;
+    }
+
+    xSemaphoreTake(writer_mutex, portMAX_DELAY);
+    bool ok = WriteAssemblyLocked(assembly, offset, data, length);
+    xSemaphoreGive(writer_mutex);
+    return ok;
+}
+
+// True while writes to the assembly are queued for the OpENer thread
+bool sample_application_assembly_write_pending(uint32_t instance)
 {
-    return s_assembly_mutex;
+    AssemblyBuffer *assembly = GetAssemblyBuffer(instance);
+    return assembly != NULL && AssemblyBufferWritePending(assembly);
+}
+
+// Publishes the record and its sample stamp with one write, so OpENer never
+// sends a record with the stamp of another one. The bytes in between keep
+// their current content.
+static void PublishSensorSample(uint8_t offset, const uint8_t *record,
+                                uint8_t record_size, uint8_t counter,
+                                uint32_t timestamp_us)
+{
+    if (s_input_writer_mutex == NULL) {
+        return;
+    }
+
+    uint8_t span[DEMO_APP_INPUT_ASSEMBLY_SIZE];
+    const uint16_t span_length = DEMO_APP_INPUT_ASSEMBLY_SIZE - offset;
+    uint8_t *timestamp = &span[SENSOR_SAMPLE_TIMESTAMP_OFFSET - offset];
+
+    xSemaphoreTake(s_input_writer_mutex, portMAX_DELAY);
+    if (AssemblyBufferRead(&s_input_assembly, offset, span, span_length) == kEipStatusOk) {
+        memcpy(span, record, record_size);
+        span[SENSOR_SAMPLE_COUNTER_OFFSET - offset] = counter;
+        timestamp[0] = (uint8_t)(timestamp_us & 0xFF);
+        timestamp[1] = (uint8_t)((timestamp_us >> 8) & 0xFF);
+        timestamp[2] = (uint8_t)((timestamp_us >> 16) & 0xFF);
+        timestamp[3] = (uint8_t)((timestamp_us >> 24) & 0xFF);
+        WriteAssemblyLocked(&s_input_assembly, offset, span, span_length);
+    }
+    xSemaphoreGive(s_input_writer_mutex);
+}
+
+// Sensors with a record, the records must end before the sample stamp
+static uint8_t SensorRecordCount(void)
+{
+    const uint8_t fit = SENSOR_SAMPLE_COUNTER_OFFSET / SENSOR_RECORD_SIZE;
+    return s_sensor_count < fit ? s_sensor_count : fit;
+}
+
+static uint8_t SensorRegionSize(void)
+{
+    return (uint8_t)(SensorRecordCount() * SENSOR_RECORD_SIZE);
+}
+
+static void ClearSensorData(uint8_t offset)
+{
+    static const uint8_t zeros[SENSOR_SAMPLE_COUNTER_OFFSET] = { 0 };
+    sample_application_write_assembly(DEMO_APP_INPUT_ASSEMBLY_NUM, offset,
+                                      zeros, SensorRegionSize());
+}
+
+// Sensor layout for webui_api.c
+uint8_t sample_application_get_sensor_count(void)
+{
+    return SensorRecordCount();
+}
+
+uint8_t sample_application_get_sensor_record_size(void)
+{
+    return SENSOR_RECORD_SIZE;
+}
+
+bool sample_application_get_sensor_processing(void)
+{
+    return s_sensor_processing;
+}
+
+// Achieved sample rate and lost results of sensor index, false if it did
+// not come up
+bool sample_application_get_sensor_stats(uint8_t index, uint32_t *rate_millihz,
+                                         uint32_t *missed, uint32_t *timeouts)
+{
+    vl53l1x_array_stats_t stats;
+    if (g_vl53l1x_device_handle == NULL ||
+        !vl53l1x_array_get_stats(&s_vl53l1x_array, index, &stats)) {
+        return false;
+    }
+    *rate_millihz = stats.rate_millihz;
+    *missed = stats.missed;
+    *timeouts = stats.timeouts;
+    return true;
+}
+
+// Runs in the sensor task for every sensor, the pipeline starts over with
+// the new settings
+static bool ApplySensorConfigJob(vl53l1x_device_handle_t *device, const void *data)
+{
+    const vl53l1x_config_t *config = (const vl53l1x_config_t *)data;
+    for (uint8_t i = 0; i < s_sensor_count; i++) {
+        if (vl53l1x_array_get_device(&s_vl53l1x_array, i) == device) {
+            vl53l1x_filter_init(&s_sensor_filters[i], config);
+        }
+    }
+    s_sensor_processing = vl53l1x_filter_enabled(config);
+    return vl53l1x_apply_config(device, config);
+}
+
+// Queues config for every sensor, the sensor task applies it between
+// sweeps so the caller does not wait for the bus (called from API)
+bool sample_application_apply_sensor_config(const void *config)
+{
+    if (g_vl53l1x_device_handle == NULL) {
+        return false;
+    }
+    return vl53l1x_array_submit(&s_vl53l1x_array, ApplySensorConfigJob,
+                                config, sizeof(vl53l1x_config_t));
+}
+
+// Parses CONFIG_OPENER_VL53L1X_XSHUT_GPIOS, "20,21,22" gives three sensors.
+// An empty list is a single sensor without XSHUT.
+static uint8_t ParseSensorXshutGpios(const char *list, gpio_num_t *gpios)
+{
+    uint8_t count = 0;
+    while (*list != '\0' && count < VL53L1X_ARRAY_MAX_SENSORS) {
+        char *end = NULL;
+        long gpio = strtol(list, &end, 10);
+        if (end == list) {
+            list++;  // separator
+            continue;
+        }
+        gpios[count++] = (gpio_num_t)gpio;
+        list = end;
+    }
+    if (*list != '\0') {
+        OPENER_TRACE_WARN("More than %d VL53L1x XSHUT GPIOs, ignoring the rest\n",
+                          VL53L1X_ARRAY_MAX_SENSORS);
+    }
+    if (count == 0) {
+        gpios[count++] = GPIO_NUM_NC;
+    }
+    return count;
 }
 
 // Function to set sensor enabled state (called from API)
@@ -84,14 +360,8 @@ void sample_application_set_sensor_enabled(bool enabled)
     xSemaphoreGive(s_sensor_state_mutex);
     
     if (!enabled) {
-        // Zero out configured byte range when disabled (need assembly mutex)
-        if (s_assembly_mutex != NULL) {
-            xSemaphoreTake(s_assembly_mutex, portMAX_DELAY);
-            memset(&g_assembly_data064[current_offset], 0, 9);
-            xSemaphoreGive(s_assembly_mutex);
-        } else {
-            memset(&g_assembly_data064[current_offset], 0, 9);
-        }
+        // Zero out configured byte range when disabled
+        ClearSensorData(current_offset);
     }
 }
 
@@ -103,6 +373,12 @@ void sample_application_set_sensor_byte_offset(uint8_t start_byte)
         OPENER_TRACE_ERR("Invalid sensor byte offset: %d (must be 0, 9, or 18)\n", start_byte);
         return;
     }
+    // The records of all sensors must end before the sample stamp
+    if (start_byte + SensorRegionSize() > SENSOR_SAMPLE_COUNTER_OFFSET) {
+        OPENER_TRACE_ERR("Records of %d sensors do not fit at byte offset %d\n",
+                         SensorRecordCount(), start_byte);
+        return;
+    }
     
     if (s_sensor_state_mutex == NULL) {
         s_sensor_state_mutex = xSemaphoreCreateMutex();
@@ -121,14 +397,7 @@ void sample_application_set_sensor_byte_offset(uint8_t start_byte)
                          s_sensor_start_byte, start_byte);
         xSemaphoreGive(s_sensor_state_mutex);  // Release before assembly access
         
-        // Zero old range with assembly mutex
-        if (s_assembly_mutex != NULL) {
-            xSemaphoreTake(s_assembly_mutex, portMAX_DELAY);
-            memset(&g_assembly_data064[old_offset], 0, 9);
-            xSemaphoreGive(s_assembly_mutex);
-        } else {
-            memset(&g_assembly_data064[old_offset], 0, 9);
-        }
+        ClearSensorData(old_offset);
         
         xSemaphoreTake(s_sensor_state_mutex, portMAX_DELAY);
     }
@@ -137,7 +406,7 @@ void sample_application_set_sensor_byte_offset(uint8_t start_byte)
     xSemaphoreGive(s_sensor_state_mutex);
     
     OPENER_TRACE_INFO("Sensor data start byte offset set to %d (bytes %d-%d)\n", 
-                     start_byte, start_byte, start_byte + 8);
+                     start_byte, start_byte, start_byte + SensorRegionSize() - 1);
 }
 
 // Function to get sensor data start byte offset (called from API)
@@ -246,6 +515,100 @@ static void ConfigureStatusLed(void) {
   gpio_set_level(kStatusLedGpio, 0);
 }
 
+/* Record layout, a compact record is the first SENSOR_COMPACT_RECORD_SIZE bytes:
+ * offset+0 to offset+1: Distance (little-endian)
+ * offset+2: Status
+ * offset+3 to offset+4: Ambient (little-endian)
+ * offset+5 to offset+6: SigPerSPAD (little-endian)
+ * offset+7 to offset+8: NumSPADs (little-endian) */
+static void EncodeSensorRecord(const VL53L1X_Result_t *result,
+                               uint8_t record[SENSOR_FULL_RECORD_SIZE]) {
+  record[0] = (uint8_t)(result->Distance & 0xFF);
+  record[1] = (uint8_t)((result->Distance >> 8) & 0xFF);
+  record[2] = result->Status;
+  record[3] = (uint8_t)(result->Ambient & 0xFF);
+  record[4] = (uint8_t)((result->Ambient >> 8) & 0xFF);
+  record[5] = (uint8_t)(result->SigPerSPAD & 0xFF);
+  record[6] = (uint8_t)((result->SigPerSPAD >> 8) & 0xFF);
+  record[7] = (uint8_t)(result->NumSPADs & 0xFF);
+  record[8] = (uint8_t)((result->NumSPADs >> 8) & 0xFF);
+}
+
+/* Record layout with the processing pipeline on, a compact record is the
+ * first SENSOR_COMPACT_RECORD_SIZE bytes:
+ * offset+0 to offset+1: Filtered distance (little-endian)
+ * offset+2: Status of the result
+ * offset+3 to offset+4: Rate of change in mm/s (signed little-endian)
+ * offset+5 to offset+6: SigPerSPAD of the result (little-endian)
+ * offset+7: Flags, bit 0 switch point, bit 1 result rejected, bit 2 settled
+ * offset+8: Rejected results (wraps) */
+static void EncodeProcessedRecord(const VL53L1X_Result_t *result,
+                                  const vl53l1x_filter_output_t *output,
+                                  uint8_t record[SENSOR_FULL_RECORD_SIZE]) {
+  const uint16_t rate = (uint16_t)output->rate_mm_s;
+  record[0] = (uint8_t)(output->distance_mm & 0xFF);
+  record[1] = (uint8_t)((output->distance_mm >> 8) & 0xFF);
+  record[2] = result->Status;
+  record[3] = (uint8_t)(rate & 0xFF);
+  record[4] = (uint8_t)((rate >> 8) & 0xFF);
+  record[5] = (uint8_t)(result->SigPerSPAD & 0xFF);
+  record[6] = (uint8_t)((result->SigPerSPAD >> 8) & 0xFF);
+  record[7] = output->flags;
+  record[8] = (uint8_t)(output->rejected & 0xFF);
+}
+
+typedef struct {
+  uint8_t offset;       /* start byte of the records this pass */
+  int64_t last_log_us;
+} SensorPublishContext;
+
+/* Called by the array for each result as it is read */
+static void PublishArraySample(uint8_t index, const vl53l1x_sample_t *sample,
+                               void *arg) {
+  SensorPublishContext *context = (SensorPublishContext *)arg;
+  const uint8_t offset = context->offset + index * SENSOR_RECORD_SIZE;
+  uint8_t record[SENSOR_FULL_RECORD_SIZE] = { 0 };
+
+  if (index >= SensorRecordCount()) {
+    return;
+  }
+
+  if (sample == NULL) {
+    /* Keep the stamp, it only moves with new results */
+    record[2] = SENSOR_STATUS_NO_RESULT;
+    sample_application_write_assembly(DEMO_APP_INPUT_ASSEMBLY_NUM, offset,
+                                      record, SENSOR_RECORD_SIZE);
+    return;
+  }
+
+  vl53l1x_filter_t *filter = &s_sensor_filters[index];
+  if (filter->enabled) {
+    vl53l1x_filter_output_t output;
+    vl53l1x_filter_update(filter, &sample->result, sample->timestamp_us, &output);
+    EncodeProcessedRecord(&sample->result, &output, record);
+  } else {
+    EncodeSensorRecord(&sample->result, record);
+  }
+  /* Byte 27: sample counter, bytes 28-31: time the result became ready */
+  PublishSensorSample(offset, record, SENSOR_RECORD_SIZE,
+                      (uint8_t)++s_sensor_sample_counter,
+                      (uint32_t)sample->timestamp_us);
+
+  /* Log once per second */
+  if (sample->timestamp_us - context->last_log_us >= 1000000) {
+    const VL53L1X_Result_t *result = &sample->result;
+    vl53l1x_array_stats_t stats = { 0 };
+    vl53l1x_array_get_stats(&s_vl53l1x_array, index, &stats);
+    context->last_log_us = sample->timestamp_us;
+    OPENER_TRACE_INFO("VL53L1x[%u]: #%" PRIu32 " Distance=%d mm, Status=%d, Ambient=%d, SigPerSPAD=%d, NumSPADs=%d, "
+                     "%" PRIu32 ".%01" PRIu32 " Hz, missed %" PRIu32 "\n",
+                     index, s_sensor_sample_counter, result->Distance, result->Status,
+                     result->Ambient, result->SigPerSPAD, result->NumSPADs,
+                     stats.rate_millihz / 1000, stats.rate_millihz % 1000 / 100,
+                     stats.missed);
+  }
+}
+
 static void vl53l1x_sensor_task(void *pvParameters) {
   (void)pvParameters;
   
@@ -266,23 +629,45 @@ static void vl53l1x_sensor_task(void *pvParameters) {
   }
   OPENER_TRACE_INFO("VL53L1x handle initialized\n");
   
-  /* Add device */
-  s_vl53l1x_device.vl53l1x_handle = &s_vl53l1x_handle;
-  s_vl53l1x_device.i2c_address = VL53L1X_DEFAULT_I2C_ADDRESS;
-  if (!vl53l1x_add_device(&s_vl53l1x_device)) {
-    OPENER_TRACE_ERR("Failed to add VL53L1x device\n");
+  /* Bring the sensors up one at a time, this task services all of them on
+   * the shared bus */
+  vl53l1x_array_config_t array_config = {
+    .vl53l1x_handle = &s_vl53l1x_handle,
+    .count = s_sensor_count,
+    .interrupt_gpio = (gpio_num_t)CONFIG_OPENER_VL53L1X_INT_GPIO,
+    .groups = CONFIG_OPENER_VL53L1X_RANGING_GROUPS,
+    .poll_period_ms = CONFIG_OPENER_VL53L1X_POLL_PERIOD_MS,
+    .result_timeout_ms = SENSOR_SAMPLE_TIMEOUT_MS,
+  };
+  memcpy(array_config.xshut_gpio, s_sensor_xshut_gpios,
+         sizeof(array_config.xshut_gpio));
+  if (!vl53l1x_array_init(&s_vl53l1x_array, &array_config)) {
+    OPENER_TRACE_ERR("Failed to add VL53L1x devices\n");
     vTaskDelete(NULL);
     return;
   }
-  g_vl53l1x_device_handle = &s_vl53l1x_device;
-  OPENER_TRACE_INFO("VL53L1x device added successfully\n");
-  
-  /* Wait a bit for sensor to stabilize */
-  vTaskDelay(pdMS_TO_TICKS(100));
-  
+  /* The web UI configures and calibrates the first sensor that came up */
+  for (uint8_t i = 0; i < s_sensor_count && g_vl53l1x_device_handle == NULL; i++) {
+    g_vl53l1x_device_handle = vl53l1x_array_get_device(&s_vl53l1x_array, i);
+  }
+  OPENER_TRACE_INFO("VL53L1x devices added successfully (%u of %u)\n",
+                    s_vl53l1x_array.present, s_sensor_count);
+
+  /* Processing pipeline from the saved configuration, the web UI changes it
+   * through ApplySensorConfigJob */
+  vl53l1x_config_t sensor_config;
+  vl53l1x_config_load(&sensor_config);
+  for (uint8_t i = 0; i < s_sensor_count; i++) {
+    vl53l1x_filter_init(&s_sensor_filters[i], &sensor_config);
+  }
+  s_sensor_processing = vl53l1x_filter_enabled(&sensor_config);
+  if (s_sensor_processing) {
+    OPENER_TRACE_INFO("VL53L1x processing pipeline on\n");
+  }
+
   /* Main sensor reading loop */
-  const TickType_t loop_delay_ticks = pdMS_TO_TICKS(100); /* 10 Hz update rate (100ms) */
-  
+  SensorPublishContext context = { 0 };
+
   while (1) {
     // Read sensor state with mutex protection
     bool sensor_enabled;
@@ -296,82 +681,37 @@ static void vl53l1x_sensor_task(void *pvParameters) {
       sensor_enabled = s_sensor_enabled;
       sensor_offset = s_sensor_start_byte;
     }
-    
-    if (sensor_enabled) {
-      if (s_vl53l1x_handle.initialized) {
-        /* Read complete result structure */
-        VL53L1X_Result_t result;
-        VL53L1X_ERROR api_status = VL53L1X_GetResult(s_vl53l1x_device.dev, &result);
-        
-        if (api_status == VL53L1X_ERROR_NONE) {
-          /* Write sensor data to assembly with mutex protection */
-          if (s_assembly_mutex != NULL) {
-            xSemaphoreTake(s_assembly_mutex, portMAX_DELAY);
-          }
-          
-          /* Write distance to bytes offset+0 and offset+1 of input assembly (little-endian) */
-          g_assembly_data064[sensor_offset + 0] = (uint8_t)(result.Distance & 0xFF);
-          g_assembly_data064[sensor_offset + 1] = (uint8_t)((result.Distance >> 8) & 0xFF);
-          
-          /* Write Status, Ambient, SigPerSPAD, NumSPADs starting at offset+2 */
-          g_assembly_data064[sensor_offset + 2] = result.Status;  /* Status */
-          
-          /* Bytes offset+3 to offset+4: Ambient (little-endian) */
-          g_assembly_data064[sensor_offset + 3] = (uint8_t)(result.Ambient & 0xFF);
-          g_assembly_data064[sensor_offset + 4] = (uint8_t)((result.Ambient >> 8) & 0xFF);
-          
-          /* Bytes offset+5 to offset+6: SigPerSPAD (little-endian) */
-          g_assembly_data064[sensor_offset + 5] = (uint8_t)(result.SigPerSPAD & 0xFF);
-          g_assembly_data064[sensor_offset + 6] = (uint8_t)((result.SigPerSPAD >> 8) & 0xFF);
-          
-          /* Bytes offset+7 to offset+8: NumSPADs (little-endian) */
-          g_assembly_data064[sensor_offset + 7] = (uint8_t)(result.NumSPADs & 0xFF);
-          g_assembly_data064[sensor_offset + 8] = (uint8_t)((result.NumSPADs >> 8) & 0xFF);
-          
-          if (s_assembly_mutex != NULL) {
-            xSemaphoreGive(s_assembly_mutex);
-          }
-          
-          /* Clear interrupt after reading */
-          VL53L1X_ClearInterrupt(s_vl53l1x_device.dev);
-          
-          /* Optional: Log every 10 readings (1 second at 10Hz) */
-          static uint32_t log_counter = 0;
-          if (++log_counter >= 10) {
-            log_counter = 0;
-            OPENER_TRACE_INFO("VL53L1x: Distance=%d mm, Status=%d, Ambient=%d, SigPerSPAD=%d, NumSPADs=%d\n",
-                             result.Distance, result.Status, result.Ambient, result.SigPerSPAD, result.NumSPADs);
-          }
-        } else {
-          OPENER_TRACE_WARN("VL53L1x GetResult failed: %d\n", api_status);
-        }
-      } else {
-        OPENER_TRACE_WARN("VL53L1x not initialized\n");
-      }
-    } else {
-      /* Sensor is disabled - zero out configured byte range */
-      if (s_assembly_mutex != NULL) {
-        xSemaphoreTake(s_assembly_mutex, portMAX_DELAY);
-        memset(&g_assembly_data064[sensor_offset], 0, 9);
-        xSemaphoreGive(s_assembly_mutex);
-      } else {
-        memset(&g_assembly_data064[sensor_offset], 0, 9);
-      }
+
+    if (!sensor_enabled) {
+      /* Sensor is disabled - zero out configured byte range, the sample
+       * counter stops so the PLC sees the data is stale */
+      ClearSensorData(sensor_offset);
+      vTaskDelay(pdMS_TO_TICKS(SENSOR_DISABLED_CHECK_MS));
+      continue;
     }
-    
-    vTaskDelay(loop_delay_ticks);
+
+    /* Publishes each result as soon as it is read, returns after waiting
+     * for the next one */
+    context.offset = sensor_offset;
+    vl53l1x_array_service(&s_vl53l1x_array, PublishArraySample, &context);
   }
 }
 
 EipStatus ApplicationInitialization(void) {
-  CreateAssemblyObject( DEMO_APP_OUTPUT_ASSEMBLY_NUM, g_assembly_data096,
-                       sizeof(g_assembly_data096));
+  CreateAssemblyBufferObject(&s_output_assembly, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
+                             s_output_assembly_storage,
+                             DEMO_APP_OUTPUT_ASSEMBLY_SIZE,
+                             kAssemblyBufferConsumedByApplication);
 
-  CreateAssemblyObject( DEMO_APP_INPUT_ASSEMBLY_NUM, g_assembly_data064,
-                       sizeof(g_assembly_data064));
+  CreateAssemblyBufferObject(&s_input_assembly, DEMO_APP_INPUT_ASSEMBLY_NUM,
+                             s_input_assembly_storage,
+                             DEMO_APP_INPUT_ASSEMBLY_SIZE,
+                             kAssemblyBufferProducedByApplication);
 
-  CreateAssemblyObject( DEMO_APP_CONFIG_ASSEMBLY_NUM, g_assembly_data097,
-                       sizeof(g_assembly_data097));
+  CreateAssemblyBufferObject(&s_config_assembly, DEMO_APP_CONFIG_ASSEMBLY_NUM,
+                             s_config_assembly_storage,
+                             DEMO_APP_CONFIG_ASSEMBLY_SIZE,
+                             kAssemblyBufferConsumedByApplication);
 
   ConfigureExclusiveOwnerConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
   DEMO_APP_INPUT_ASSEMBLY_NUM,
@@ -387,9 +727,12 @@ EipStatus ApplicationInitialization(void) {
   ConfigureStatusLed();
 
   /* Initialize mutexes */
-  s_assembly_mutex = xSemaphoreCreateMutex();
-  if (s_assembly_mutex == NULL) {
-    OPENER_TRACE_ERR("Failed to create assembly mutex\n");
+  s_input_writer_mutex = xSemaphoreCreateMutex();
+  s_output_writer_mutex = xSemaphoreCreateMutex();
+  s_config_writer_mutex = xSemaphoreCreateMutex();
+  if (s_input_writer_mutex == NULL || s_output_writer_mutex == NULL ||
+      s_config_writer_mutex == NULL) {
+    OPENER_TRACE_ERR("Failed to create assembly writer mutexes\n");
   }
   
   s_sensor_state_mutex = xSemaphoreCreateMutex();
@@ -397,13 +740,22 @@ EipStatus ApplicationInitialization(void) {
     OPENER_TRACE_ERR("Failed to create sensor state mutex\n");
   }
 
+  /* One record per VL53L1x, the offset check below needs the count */
+  s_sensor_count = ParseSensorXshutGpios(CONFIG_OPENER_VL53L1X_XSHUT_GPIOS,
+                                         s_sensor_xshut_gpios);
+  if (SensorRecordCount() < s_sensor_count) {
+    OPENER_TRACE_ERR("Only %d of %d VL53L1x records fit in Input Assembly %d, "
+                     "enable compact records\n", SensorRecordCount(),
+                     s_sensor_count, DEMO_APP_INPUT_ASSEMBLY_NUM);
+  }
+
   /* Load sensor enabled state from NVS and initialize */
   s_sensor_enabled = system_sensor_enabled_load();
   sample_application_set_sensor_enabled(s_sensor_enabled);
   
   /* Load sensor data start byte offset from NVS */
-  s_sensor_start_byte = system_sensor_byte_offset_load();
-  sample_application_set_sensor_byte_offset(s_sensor_start_byte);
+  /* Keeps offset 0 if the records do not fit at the saved one */
+  sample_application_set_sensor_byte_offset(system_sensor_byte_offset_load());
   
   /* Create VL53L1x sensor task on Core 1 (always create, task checks enabled state) */
   BaseType_t sensor_task_result = xTaskCreatePinnedToCore(
@@ -456,6 +808,10 @@ EipStatus ApplicationInitialization(void) {
 }
 
 void HandleApplication(void) {
+  /* apply the queued writes of the Modbus and web tasks to the received
+   * assemblies */
+  AssemblyBufferService(&s_output_assembly);
+  AssemblyBufferService(&s_config_assembly);
 }
 
 void CheckIoConnectionEvent(unsigned int output_assembly_id,
@@ -492,19 +848,21 @@ EipStatus AfterAssemblyDataReceived(CipInstance *instance) {
 
   switch (instance->instance_number) {
     case DEMO_APP_OUTPUT_ASSEMBLY_NUM:
+    {
+      uint8_t led_control = 0;
+      AssemblyBufferPublish(&s_output_assembly);
+      AssemblyBufferRead(&s_output_assembly, 0, &led_control, 1);
       /* Process output assembly data (LED control only) */
-      /* Note: Input assembly bytes 0-8 are now reserved for VL53L1x sensor data:
-       *   Bytes 0-1: Distance (mm)
-       *   Byte 2: Status
-       *   Bytes 3-4: Ambient (kcps)
-       *   Bytes 5-6: SigPerSPAD (kcps/SPAD)
-       *   Bytes 7-8: NumSPADs
+      /* Note: Input assembly bytes from the sensor start byte are reserved
+       * for one VL53L1x record per sensor (see EncodeSensorRecord), byte 27
+       * for the sample counter and bytes 28-31 for the sample timestamp (us)
        * Output data is no longer mirrored to input assembly */
-      gpio_set_level(kStatusLedGpio,
-                     (g_assembly_data096[0] & 0x01) ? 1 : 0);
+      gpio_set_level(kStatusLedGpio, (led_control & 0x01) ? 1 : 0);
       IdentityNoteIoActivity();
       break;
+    }
     case DEMO_APP_CONFIG_ASSEMBLY_NUM:
+      AssemblyBufferPublish(&s_config_assembly);
       status = kEipStatusOk;
       break;
     default:
@@ -516,8 +874,11 @@ EipStatus AfterAssemblyDataReceived(CipInstance *instance) {
 }
 
 EipBool8 BeforeAssemblyDataSend(CipInstance *instance) {
-  (void) instance;
   IdentityNoteIoActivity();
+  if (instance->instance_number == DEMO_APP_INPUT_ASSEMBLY_NUM) {
+    /* switch attribute 3 to the latest sensor data, no copy */
+    return AssemblyBufferAcquire(&s_input_assembly);
+  }
   return true;
 }
 
@@ -0,0 +1,115 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+/** @file POSIX/main.c
+ *  @brief Host entry point running the OpENer stack of this repository on
+ *  Linux, for load testing without a board
+ *
+ *  Usage: opener <interface>, e.g. "opener lo" to serve loopback traffic.
+ */
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "generic_networkhandler.h"
+#include "opener_api.h"
+#include "cipcommon.h"
+#include "cipethernetlink.h"
+#include "ciptcpipinterface.h"
+#include "trace.h"
+#include "networkconfig.h"
+#include "doublylinkedlist.h"
+#include "cipconnectionobject.h"
+#include "nvdata.h"
+
+/** @brief Signals the OpENer loop to shut down, set by SIGINT and SIGTERM */
+volatile int g_end_stack = 0;
+
+static void LeaveStack(int signal_number) {
+  (void) signal_number;
+  g_end_stack = 1;
+}
+
+int main(int argc,
+         char *arguments[]) {
+  if(argc != 2) {
+    fprintf(stderr, "Wrong number of command line parameters!\n");
+    fprintf(stderr, "Usage: %s [interface name]\n", arguments[0]);
+    fprintf(stderr, "\te.g. ./OpENer lo\n");
+    return EXIT_FAILURE;
+  }
+  const char *const iface = arguments[1];
+
+  if(!IfaceLinkIsUp(iface) ) {
+    fprintf(stderr, "Network link %s is down, OpENer not started\n", iface);
+    return EXIT_FAILURE;
+  }
+
+  DoublyLinkedListInitialize(&connection_list,
+                             CipConnectionObjectListArrayAllocator,
+                             CipConnectionObjectListArrayFree);
+
+  uint8_t iface_mac[6];
+  if(kEipStatusError == IfaceGetMacAddress(iface, iface_mac) ) {
+    fprintf(stderr, "Could not get MAC address of %s: %s\n",
+            iface, strerror(errno) );
+    return EXIT_FAILURE;
+  }
+
+  SetDeviceSerialNumber(123456789);
+
+  /* Same seed source in every run would reuse connection IDs across
+   *  restarts, which confuses scanners still holding old connections */
+  srand( (unsigned int) time(NULL) );
+  EipUint16 unique_connection_id = (EipUint16) rand();
+
+  if(kEipStatusOk != CipStackInit(unique_connection_id) ) {
+    fprintf(stderr, "CipStackInit failed\n");
+    return EXIT_FAILURE;
+  }
+
+  CipClass *tcp_ip_class = GetCipClass(kCipTcpIpInterfaceClassCode);
+  if(NULL != tcp_ip_class) {
+    InsertGetSetCallback(tcp_ip_class, NvTcpipSetCallback, kNvDataFunc);
+  }
+
+  CipEthernetLinkSetMac(iface_mac);
+
+  GetHostName(&g_tcpip.hostname);
+
+  if(kEipStatusOk !=
+     IfaceGetConfiguration(iface, &g_tcpip.interface_configuration) ) {
+    OPENER_TRACE_WARN("Problems getting interface configuration\n");
+  }
+
+  struct sigaction leave_action;
+  memset(&leave_action, 0, sizeof(leave_action) );
+  leave_action.sa_handler = LeaveStack;
+  sigaction(SIGINT, &leave_action, NULL);
+  sigaction(SIGTERM, &leave_action, NULL);
+  /* a scanner dropping its TCP connection must not kill the process */
+  signal(SIGPIPE, SIG_IGN);
+
+  if(kEipStatusOk != NetworkHandlerInitialize() ) {
+    fprintf(stderr, "NetworkHandlerInitialize failed\n");
+    ShutdownCipStack();
+    return EXIT_FAILURE;
+  }
+
+  while(!g_end_stack) {
+    if(kEipStatusOk != NetworkHandlerProcessCyclic() ) {
+      OPENER_TRACE_ERR("Error in NetworkHandler loop! Exiting OpENer!\n");
+      g_end_stack = 1;
+    }
+  }
+
+  NetworkHandlerFinish();
+  ShutdownCipStack();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,173 @@
+/*******************************************************************************
+ * Copyright (c) 2018, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "networkconfig.h"
+#include "cipstring.h"
+#include "cipcommon.h"
+#include "ciperror.h"
+#include "trace.h"
+#include "opener_api.h"
+
+/** @brief Issues one interface ioctl() on a temporary datagram socket
+ *
+ *  @param  iface   name of the network interface
+ *  @param  request the SIOCGIF* request
+ *  @param  ifr     request structure, filled on success
+ *  @return         kEipStatusOk on success, kEipStatusError with errno set
+ */
+static EipStatus IfaceIoctl(const char *iface,
+                            unsigned long request,
+                            struct ifreq *ifr) {
+  if(strlen(iface) >= sizeof(ifr->ifr_name) ) {
+    errno = ENAMETOOLONG;
+    return kEipStatusError;
+  }
+  memset(ifr, 0, sizeof(*ifr) );
+  strcpy(ifr->ifr_name, iface);
+
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if(fd < 0) {
+    return kEipStatusError;
+  }
+  int result = ioctl(fd, request, ifr);
+  int saved_errno = errno;
+  close(fd);
+  errno = saved_errno;
+  return (0 == result) ? kEipStatusOk : kEipStatusError;
+}
+
+bool IfaceLinkIsUp(const char *iface) {
+  struct ifreq ifr;
+  if(kEipStatusOk != IfaceIoctl(iface, SIOCGIFFLAGS, &ifr) ) {
+    return false;
+  }
+  return (ifr.ifr_flags & (IFF_UP | IFF_RUNNING) ) == (IFF_UP | IFF_RUNNING);
+}
+
+EipStatus IfaceGetMacAddress(TcpIpInterface *iface,
+                             uint8_t *const physical_address) {
+  struct ifreq ifr;
+  if(kEipStatusOk != IfaceIoctl(iface, SIOCGIFHWADDR, &ifr) ) {
+    return kEipStatusError;
+  }
+  /* the loopback interface reports an all zero address, that is fine for
+   *  load testing */
+  memcpy(physical_address, ifr.ifr_hwaddr.sa_data, 6);
+  return kEipStatusOk;
+}
+
+static EipStatus GetIpAndNetmaskFromInterface(
+  TcpIpInterface *iface,
+  CipTcpIpInterfaceConfiguration *iface_cfg) {
+  struct ifreq ifr;
+  if(kEipStatusOk != IfaceIoctl(iface, SIOCGIFADDR, &ifr) ) {
+    return kEipStatusError;
+  }
+  iface_cfg->ip_address =
+    ( (struct sockaddr_in *) &ifr.ifr_addr )->sin_addr.s_addr;
+
+  if(kEipStatusOk != IfaceIoctl(iface, SIOCGIFNETMASK, &ifr) ) {
+    return kEipStatusError;
+  }
+  iface_cfg->network_mask =
+    ( (struct sockaddr_in *) &ifr.ifr_netmask )->sin_addr.s_addr;
+  return kEipStatusOk;
+}
+
+/** @brief Reads the default gateway of the interface from /proc/net/route
+ *
+ *  A missing default route is not an error, the gateway stays 0.
+ */
+static EipStatus GetGatewayFromRoute(TcpIpInterface *iface,
+                                     CipTcpIpInterfaceConfiguration *iface_cfg)
+{
+  FILE *file = fopen("/proc/net/route", "r");
+  if(NULL == file) {
+    return kEipStatusOk;
+  }
+  char line[256];
+  while(NULL != fgets(line, sizeof(line), file) ) {
+    char name[IF_NAMESIZE + 1];
+    unsigned int destination = 0;
+    unsigned int gateway = 0;
+    if(3 == sscanf(line, "%16s %x %x", name, &destination, &gateway) &&
+       0 == strcmp(name, iface) && 0 == destination) {
+      /* /proc/net/route prints the addresses in network byte order */
+      iface_cfg->gateway = gateway;
+      break;
+    }
+  }
+  fclose(file);
+  return kEipStatusOk;
+}
+
+EipStatus IfaceGetConfiguration(TcpIpInterface *iface,
+                                CipTcpIpInterfaceConfiguration *iface_cfg) {
+  CipTcpIpInterfaceConfiguration local_cfg;
+  EipStatus status;
+
+  memset(&local_cfg, 0x00, sizeof local_cfg);
+
+  status = GetIpAndNetmaskFromInterface(iface, &local_cfg);
+  if(kEipStatusOk == status) {
+    status = GetGatewayFromRoute(iface, &local_cfg);
+  }
+  if(kEipStatusOk == status) {
+    ClearCipString(&iface_cfg->domain_name);
+    *iface_cfg = local_cfg;
+  }
+  return status;
+}
+
+EipStatus IfaceWaitForIp(TcpIpInterface *const iface,
+                         int timeout,
+                         volatile int *const abort_wait) {
+  CipTcpIpInterfaceConfiguration local_cfg;
+  /* poll every 100 ms, timeout is given in seconds */
+  int remaining_polls = (timeout < 0) ? -1 : timeout * 10;
+
+  do {
+    memset(&local_cfg, 0x00, sizeof local_cfg);
+    if(kEipStatusOk == GetIpAndNetmaskFromInterface(iface, &local_cfg) &&
+       0 != local_cfg.ip_address) {
+      return kEipStatusOk;
+    }
+    if(0 == remaining_polls) {
+      errno = ETIMEDOUT;
+      return kEipStatusError;
+    }
+    if(remaining_polls > 0) {
+      remaining_polls--;
+    }
+    const struct timespec poll_delay = { .tv_sec = 0, .tv_nsec = 100000000L };
+    nanosleep(&poll_delay, NULL);
+  } while(0 == *abort_wait);
+
+  errno = EINTR;
+  return kEipStatusError;
+}
+
+void GetHostName(CipString *hostname) {
+  char name_buf[HOST_NAME_MAX + 1];
+  if(0 != gethostname(name_buf, sizeof(name_buf) ) ) {
+    OPENER_TRACE_WARN("gethostname() failed, host name left empty\n");
+    return;
+  }
+  name_buf[sizeof(name_buf) - 1] = '\0';
+  SetCipStringByCstr(hostname, name_buf);
+}
@@ -0,0 +1,19 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+#ifndef OPENER_POSIX_NETWORKCONFIG_H_
+#define OPENER_POSIX_NETWORKCONFIG_H_
+
+#include "typedefs.h"
+
+/** @brief Checks whether the named network interface is up and running
+ *
+ *  @param iface Name of the network interface, e.g. "lo" or "eth0"
+ *  @return true if the interface exists and is running
+ */
+bool IfaceLinkIsUp(const char *iface);
+
+#endif /* OPENER_POSIX_NETWORKCONFIG_H_ */
@@ -0,0 +1,172 @@
+/*******************************************************************************
+ * Copyright (c) 2009, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+#ifndef OPENER_USER_CONF_H_
+#define OPENER_USER_CONF_H_
+
+/** @file POSIX/sample_application/opener_user_conf.h
+ * @brief OpENer configuration setup for the POSIX host build
+ *
+ * The values mirror ports/ESP32/sample_application/opener_user_conf.h, so the
+ * host build runs the stack in the same configuration as the device. Keep
+ * both files in sync.
+ */
+
+#include <assert.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include "typedefs.h"
+
+#ifndef RESTRICT
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 199901L
+#define RESTRICT restrict
+#else
+#define RESTRICT
+#endif
+#endif
+
+#ifndef CIP_FILE_OBJECT
+  #define CIP_FILE_OBJECT 0
+#endif
+
+#ifndef CIP_SECURITY_OBJECTS
+  #define CIP_SECURITY_OBJECTS 0
+#endif
+
+#ifdef OPENER_UNIT_TEST
+  #include "test_assert.h"
+#endif
+
+#ifndef OPENER_IS_DLR_DEVICE
+  #define OPENER_IS_DLR_DEVICE  0
+#endif
+
+#if defined(OPENER_IS_DLR_DEVICE) && 0 != OPENER_IS_DLR_DEVICE
+  #define OPENER_TCPIP_IFACE_CFG_SETTABLE 1
+  #define OPENER_ETHLINK_CNTRS_ENABLE     1
+  #define OPENER_ETHLINK_IFACE_CTRL_ENABLE  1
+  #define OPENER_ETHLINK_LABEL_ENABLE     1
+  #define OPENER_ETHLINK_INSTANCE_CNT     3
+#endif
+#ifndef OPENER_TCPIP_IFACE_CFG_SETTABLE
+  #define OPENER_TCPIP_IFACE_CFG_SETTABLE 1
+#endif
+
+#ifndef OPENER_ETHLINK_INSTANCE_CNT
+  #define OPENER_ETHLINK_INSTANCE_CNT  1
+#endif
+
+#ifndef OPENER_ETHLINK_LABEL_ENABLE
+  #define OPENER_ETHLINK_LABEL_ENABLE  0
+#endif
+
+#ifndef OPENER_ETHLINK_CNTRS_ENABLE
+  #define OPENER_ETHLINK_CNTRS_ENABLE 1
+#endif
+
+#ifndef OPENER_ETHLINK_IFACE_CTRL_ENABLE
+  #define OPENER_ETHLINK_IFACE_CTRL_ENABLE 0
+#endif
+
+#define OPENER_CIP_NUM_APPLICATION_SPECIFIC_CONNECTABLE_OBJECTS 1
+
+#define OPENER_CIP_NUM_EXPLICIT_CONNS 6
+
+#define OPENER_CIP_NUM_EXLUSIVE_OWNER_CONNS 1
+
+#define OPENER_CIP_NUM_INPUT_ONLY_CONNS 1
+
+#define OPENER_CIP_NUM_INPUT_ONLY_CONNS_PER_CON_PATH 3
+
+#define OPENER_CIP_NUM_LISTEN_ONLY_CONNS 1
+
+#define OPENER_CIP_NUM_LISTEN_ONLY_CONNS_PER_CON_PATH   3
+
+#define OPENER_NUMBER_OF_SUPPORTED_SESSIONS 20
+
+#define PC_OPENER_ETHERNET_BUFFER_SIZE 512
+
+/** @brief Number of preallocated receive buffers for the implicit I/O socket
+ *
+ *  All datagrams pending on the I/O socket are drained with one recvmmsg()
+ *  call per select() wakeup, up to this number, before being dispatched.
+ */
+#ifndef OPENER_UDP_IO_RECEIVE_BATCH_SIZE
+  #define OPENER_UDP_IO_RECEIVE_BATCH_SIZE 8
+#endif
+
+static const MilliSeconds kOpenerTimerTickInMilliSeconds = 10;
+
+/** @brief Wake the network handler at the earliest connection deadline
+ *
+ *  When enabled, select() sleeps until the next connection production or
+ *  watchdog deadline (at most kOpenerTimerTickInMilliSeconds) instead of
+ *  always sleeping a full tick, so RPIs shorter than the tick are produced
+ *  on time.
+ */
+#ifndef OPENER_CONNECTION_SCHEDULER
+  #define OPENER_CONNECTION_SCHEDULER 1
+#endif
+
+/** @brief Time the stages of the I/O path with the performance counter
+ *
+ *  Aggregated per-stage statistics and the most recent measurements are
+ *  exposed by the vendor specific Performance Trace object (class 0x64),
+ *  see cipperf.h. Costs two counter reads per stage.
+ */
+#ifndef OPENER_PERF_TRACE
+  #define OPENER_PERF_TRACE 1
+#endif
+
+/** @brief Size in bytes of the static arena holding the CIP object model
+ *
+ *  Classes, instances and their attribute and service tables are allocated
+ *  from it instead of the heap, see ciparena.h. CipStackInit() traces the
+ *  bytes used, allocations that do not fit fall back to CipCalloc(). The
+ *  sample application needs about 14 kB on a 64 bit host, 0 disables the
+ *  arena.
+ */
+#ifndef OPENER_CIP_OBJECT_ARENA_SIZE
+  #define OPENER_CIP_OBJECT_ARENA_SIZE 32768
+#endif
+
+#define OPENER_WITH_TRACES
+#ifndef OPENER_TRACE_LEVEL
+  #define OPENER_TRACE_LEVEL (OPENER_TRACE_LEVEL_ERROR | \
+                              OPENER_TRACE_LEVEL_WARNING)
+#endif
+
+#ifndef OPENER_UNIT_TEST
+
+#ifdef OPENER_WITH_TRACES
+    #include <stdio.h>
+
+    #define LOG_TRACE(...)  fprintf(stderr,__VA_ARGS__)
+
+    #ifdef IDLING_ASSERT
+        #define OPENER_ASSERT(assertion)                                    \
+  do {                                                              \
+    if( !(assertion) ) {                                            \
+      LOG_TRACE("Assertion \"%s\" failed: file \"%s\", line %d\n",  \
+                # assertion, __FILE__, __LINE__);                   \
+      while(1) {  }                                                 \
+    }                                                               \
+  } while(0)
+
+    #else
+        #define OPENER_ASSERT(assertion) assert(assertion)
+    #endif
+
+#else
+    #define OPENER_ASSERT(assertion) assert(assertion)
+#endif
+
+#endif
+
+#endif /*OPENER_USER_CONF_H_*/
@@ -0,0 +1,282 @@
+/*******************************************************************************
+ * Copyright (c) 2012, Rockwell Automation, Inc.
+ * All rights reserved.
+ *
+ ******************************************************************************/
+
+/** @file POSIX/sample_application/sampleapplication.c
+ *  @brief Host version of the ESP32 sample application
+ *
+ *  Exposes the same assemblies as the device (input 100, output 150,
+ *  configuration 151, same sizes and connection points). There is no sensor
+ *  on the host, instead the received output data is echoed into the input
+ *  assembly, so a load generator can match every produced frame to the frame
+ *  it sent.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "opener_api.h"
+#include "appcontype.h"
+#include "trace.h"
+#include "cipidentity.h"
+#include "cipqos.h"
+#include "ciptcpipinterface.h"
+#include "ciptypes.h"
+#include "cipassemblybuffer.h"
+#include "cipethernetlink.h"
+#include "generic_networkhandler.h"
+
+#define DEMO_APP_INPUT_ASSEMBLY_NUM                100
+#define DEMO_APP_OUTPUT_ASSEMBLY_NUM               150
+#define DEMO_APP_CONFIG_ASSEMBLY_NUM               151
+#define DEMO_APP_INPUT_ASSEMBLY_SIZE               32
+#define DEMO_APP_OUTPUT_ASSEMBLY_SIZE              32
+#define DEMO_APP_CONFIG_ASSEMBLY_SIZE              10
+
+static EipUint8 s_input_assembly_storage[
+  ASSEMBLY_BUFFER_STORAGE_SIZE(DEMO_APP_INPUT_ASSEMBLY_SIZE)];
+static EipUint8 s_output_assembly_storage[
+  ASSEMBLY_BUFFER_STORAGE_SIZE(DEMO_APP_OUTPUT_ASSEMBLY_SIZE)];
+static EipUint8 s_config_assembly_storage[
+  ASSEMBLY_BUFFER_STORAGE_SIZE(DEMO_APP_CONFIG_ASSEMBLY_SIZE)];
+static AssemblyBuffer s_input_assembly;
+static AssemblyBuffer s_output_assembly;
+static AssemblyBuffer s_config_assembly;
+
+static EipUint32 s_active_io_connections = 0;
+
+EipStatus EthLnkPreGetCallback(CipInstance *instance,
+                               CipAttributeStruct *attribute,
+                               CipByte service);
+EipStatus EthLnkPostGetCallback(CipInstance *instance,
+                                CipAttributeStruct *attribute,
+                                CipByte service);
+
+static void IdentityEnter(CipIdentityState state,
+                          CipIdentityExtendedStatus ext_status) {
+  g_identity.state = (CipUsint)state;
+  CipIdentitySetExtendedDeviceStatus(ext_status);
+}
+
+EipStatus ApplicationInitialization(void) {
+  CreateAssemblyBufferObject(&s_output_assembly, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
+                             s_output_assembly_storage,
+                             DEMO_APP_OUTPUT_ASSEMBLY_SIZE,
+                             kAssemblyBufferConsumedByApplication);
+
+  CreateAssemblyBufferObject(&s_input_assembly, DEMO_APP_INPUT_ASSEMBLY_NUM,
+                             s_input_assembly_storage,
+                             DEMO_APP_INPUT_ASSEMBLY_SIZE,
+                             kAssemblyBufferProducedByApplication);
+
+  CreateAssemblyBufferObject(&s_config_assembly, DEMO_APP_CONFIG_ASSEMBLY_NUM,
+                             s_config_assembly_storage,
+                             DEMO_APP_CONFIG_ASSEMBLY_SIZE,
+                             kAssemblyBufferConsumedByApplication);
+
+  ConfigureExclusiveOwnerConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
+                                         DEMO_APP_INPUT_ASSEMBLY_NUM,
+                                         DEMO_APP_CONFIG_ASSEMBLY_NUM);
+  ConfigureInputOnlyConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
+                                    DEMO_APP_INPUT_ASSEMBLY_NUM,
+                                    DEMO_APP_CONFIG_ASSEMBLY_NUM);
+  ConfigureListenOnlyConnectionPoint(0, DEMO_APP_OUTPUT_ASSEMBLY_NUM,
+                                     DEMO_APP_INPUT_ASSEMBLY_NUM,
+                                     DEMO_APP_CONFIG_ASSEMBLY_NUM);
+  CipRunIdleHeaderSetO2T(false);
+  CipRunIdleHeaderSetT2O(false);
+
+#if defined(OPENER_ETHLINK_CNTRS_ENABLE) && 0 != OPENER_ETHLINK_CNTRS_ENABLE
+  {
+    CipClass *p_eth_link_class = GetCipClass(kCipEthernetLinkClassCode);
+    InsertGetSetCallback(p_eth_link_class,
+                         EthLnkPreGetCallback,
+                         kPreGetFunc);
+    InsertGetSetCallback(p_eth_link_class,
+                         EthLnkPostGetCallback,
+                         kPostGetFunc);
+    for(int idx = 0; idx < OPENER_ETHLINK_INSTANCE_CNT; ++idx) {
+      CipAttributeStruct *p_eth_link_attr;
+      CipInstance *p_eth_link_inst =
+        GetCipInstance(p_eth_link_class, idx + 1);
+      OPENER_ASSERT(p_eth_link_inst);
+
+      p_eth_link_attr = GetCipAttribute(p_eth_link_inst, 4);
+      p_eth_link_attr->attribute_flags |= (kPreGetFunc | kPostGetFunc);
+      p_eth_link_attr = GetCipAttribute(p_eth_link_inst, 5);
+      p_eth_link_attr->attribute_flags |= (kPreGetFunc | kPostGetFunc);
+    }
+  }
+#endif
+
+  s_active_io_connections = 0;
+  IdentityEnter(kStateStandby, kNoIoConnectionsEstablished);
+
+  return kEipStatusOk;
+}
+
+void HandleApplication(void) {
+  AssemblyBufferService(&s_output_assembly);
+  AssemblyBufferService(&s_config_assembly);
+}
+
+void CheckIoConnectionEvent(unsigned int output_assembly_id,
+                            unsigned int input_assembly_id,
+                            IoConnectionEvent io_connection_event) {
+
+  (void) output_assembly_id;
+  (void) input_assembly_id;
+
+  switch(io_connection_event) {
+    case kIoConnectionEventOpened:
+      if(s_active_io_connections++ == 0) {
+        IdentityEnter(kStateOperational,
+                      kAtLeastOneIoConnectionInRunMode);
+      }
+      break;
+    case kIoConnectionEventTimedOut:
+    case kIoConnectionEventClosed:
+      if(s_active_io_connections > 0) {
+        s_active_io_connections--;
+      }
+      if(s_active_io_connections == 0) {
+        IdentityEnter(kStateStandby, kNoIoConnectionsEstablished);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+EipStatus AfterAssemblyDataReceived(CipInstance *instance) {
+  EipStatus status = kEipStatusOk;
+
+  switch(instance->instance_number) {
+    case DEMO_APP_OUTPUT_ASSEMBLY_NUM: {
+      EipUint8 output_data[DEMO_APP_OUTPUT_ASSEMBLY_SIZE];
+      AssemblyBufferPublish(&s_output_assembly);
+      AssemblyBufferRead(&s_output_assembly, 0, output_data,
+                         sizeof(output_data) );
+      /* echo for round trip measurements, see file comment, change of state
+       * and application triggered connections send the echo right away */
+      AssemblyBufferWrite(&s_input_assembly, 0, output_data,
+                          sizeof(output_data) );
+      TriggerAssemblyProduction(DEMO_APP_INPUT_ASSEMBLY_NUM);
+      break;
+    }
+    case DEMO_APP_CONFIG_ASSEMBLY_NUM:
+      AssemblyBufferPublish(&s_config_assembly);
+      break;
+    default:
+      OPENER_TRACE_INFO(
+        "Unknown assembly instance ind AfterAssemblyDataReceived");
+      break;
+  }
+  return status;
+}
+
+EipBool8 BeforeAssemblyDataSend(CipInstance *instance) {
+  if(instance->instance_number == DEMO_APP_INPUT_ASSEMBLY_NUM) {
+    return AssemblyBufferAcquire(&s_input_assembly);
+  }
+  return true;
+}
+
+EipStatus ResetDevice(void) {
+  CloseAllConnections();
+  CipQosUpdateUsedSetQosValues();
+  s_active_io_connections = 0;
+  IdentityEnter(kStateStandby, kNoIoConnectionsEstablished);
+  return kEipStatusOk;
+}
+
+EipStatus ResetDeviceToInitialConfiguration(void) {
+  g_tcpip.encapsulation_inactivity_timeout = 120;
+  CipQosResetAttributesToDefaultValues();
+  ResetDevice();
+  return kEipStatusOk;
+}
+
+#if defined(OPENER_ETHLINK_CNTRS_ENABLE) && 0 != OPENER_ETHLINK_CNTRS_ENABLE
+EipStatus EthLnkPreGetCallback(CipInstance *instance,
+                               CipAttributeStruct *attribute,
+                               CipByte service) {
+  (void)service;
+  if(instance->instance_number == 0 ||
+     instance->instance_number > OPENER_ETHLINK_INSTANCE_CNT) {
+    return kEipStatusOk;
+  }
+
+  size_t idx = instance->instance_number - 1U;
+  switch(attribute->attribute_number) {
+    case 4: {
+      const NetworkInterfaceCounters *src = NetworkGetInterfaceCounters();
+      CipEthernetLinkInterfaceCounters *dst =
+        &g_ethernet_link[idx].interface_cntrs;
+      dst->ul.in_octets         = src->in_octets;
+      dst->ul.in_ucast          = src->in_ucast_packets;
+      dst->ul.in_nucast         = src->in_nucast_packets;
+      dst->ul.in_discards       = src->in_discards;
+      dst->ul.in_errors         = src->in_errors;
+      dst->ul.in_unknown_protos = src->in_unknown_protos;
+      dst->ul.out_octets        = src->out_octets;
+      dst->ul.out_ucast         = src->out_ucast_packets;
+      dst->ul.out_nucast        = src->out_nucast_packets;
+      dst->ul.out_discards      = src->out_discards;
+      dst->ul.out_errors        = src->out_errors;
+      break;
+    }
+    case 5:
+      memset(g_ethernet_link[idx].media_cntrs.cntr32, 0,
+             sizeof(g_ethernet_link[idx].media_cntrs.cntr32) );
+      break;
+    default:
+      break;
+  }
+  return kEipStatusOk;
+}
+
+EipStatus EthLnkPostGetCallback(CipInstance *instance,
+                                CipAttributeStruct *attribute,
+                                CipByte service) {
+  if( (service & 0x7FU) != kEthLinkGetAndClear ||
+      instance->instance_number == 0 ||
+      instance->instance_number > OPENER_ETHLINK_INSTANCE_CNT ) {
+    return kEipStatusOk;
+  }
+
+  size_t idx = instance->instance_number - 1U;
+  switch(attribute->attribute_number) {
+    case 4:
+      memset(g_ethernet_link[idx].interface_cntrs.cntr32, 0,
+             sizeof(g_ethernet_link[idx].interface_cntrs.cntr32) );
+      NetworkResetInterfaceCounters();
+      break;
+    case 5:
+      memset(g_ethernet_link[idx].media_cntrs.cntr32, 0,
+             sizeof(g_ethernet_link[idx].media_cntrs.cntr32) );
+      break;
+    default:
+      break;
+  }
+  return kEipStatusOk;
+}
+#endif /* OPENER_ETHLINK_CNTRS_ENABLE */
+
+void *
+CipCalloc(size_t number_of_elements,
+          size_t size_of_element) {
+  return calloc(number_of_elements, size_of_element);
+}
+
+void CipFree(void *data) {
+  free(data);
+}
+
+void RunIdleChanged(EipUint32 run_idle_value) {
+  OPENER_TRACE_INFO("Run/Idle handler triggered\n");
+  (void) run_idle_value;
+}
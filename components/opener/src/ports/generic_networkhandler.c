@@ -11,7 +11,12 @@
  *  The generic network handler delegates platform-dependent tasks to the platform network handler
  */
 
+#if defined(__linux__) && !defined(ESP32) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* recvmmsg() */
+#endif
+
 #include <inttypes.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 
 #include "generic_networkhandler.h"
@@ -23,6 +28,8 @@
 #include "ciptcpipinterface.h"
 #include "opener_user_conf.h"
 #include "cipqos.h"
+#include "cipconnectionscheduler.h"
+#include "cipperf.h"
 
 #define MAX_NO_OF_TCP_SOCKETS 10
 
@@ -46,6 +53,24 @@
 #define NWBUF_CAST
 #endif
 
+/* Linux can drain a whole batch of datagrams with a single system call,
+ * other platforms (lwIP) fall back to a non-blocking recvfrom() loop */
+#if defined(__linux__) && !defined(ESP32)
+#define OPENER_UDP_IO_USE_RECVMMSG 1
+#else
+#define OPENER_UDP_IO_USE_RECVMMSG 0
+#endif
+
+/* Linux wakes the OpENer thread with an eventfd, lwIP has no such primitive
+ * and uses a pair of loopback UDP sockets */
+#if defined(__linux__) && !defined(ESP32)
+#define OPENER_WAKEUP_USE_EVENTFD 1
+#include <sys/eventfd.h>
+#include <unistd.h>
+#else
+#define OPENER_WAKEUP_USE_EVENTFD 0
+#endif
+
 #ifndef MSG_NOSIGNAL
 #define MSG_NOSIGNAL 0
 #define MSG_NOSIGNAL_PRAGMA_MESSAGE \
@@ -69,7 +94,7 @@ int g_current_active_tcp_socket;
 
 struct timeval g_time_value;
 MilliSeconds g_actual_time;
-MilliSeconds g_last_time;
+MicroSeconds g_last_time;
 
 NetworkStatus g_network_status;
 
@@ -81,6 +106,21 @@ NetworkStatus g_network_status;
  */
 TimeoutCheckerFunction timeout_checker_array[OPENER_TIMEOUT_CHECKER_ARRAY_SIZE];
 
+/** @brief Sub-millisecond rest of the elapsed time not yet passed to the
+ *  timeout checker functions
+ */
+static MicroSeconds timeout_checker_elapsed_time;
+
+/** @brief OpenerServiceFlag bits requested by OpenerRequestService() and not
+ *  yet served
+ */
+static atomic_uint s_service_requests;
+
+/** @brief Set while a wakeup is signaled and not yet consumed, and while there
+ *  is no wakeup channel
+ */
+static atomic_bool s_wakeup_pending = true;
+
 /** @brief handle any connection request coming in the TCP server socket.
  *
  */
@@ -110,6 +150,11 @@ EipStatus HandleDataOnTcpSocket(int socket);
 
 void CheckEncapsulationInactivity(int socket_handle);
 
+/** @brief Consumes the wakeups signaled by OpenerRequestService()
+ *
+ */
+static void CheckAndHandleWakeupChannel(void);
+
 void RemoveSocketTimerFromList(const int socket_handle);
 
 static NetworkInterfaceCounters g_network_interface_counters;
@@ -156,6 +201,117 @@ void NetworkResetInterfaceCounters(void) {
   memset(&g_network_interface_counters, 0, sizeof(g_network_interface_counters));
 }
 
+/** @brief One datagram received on the implicit I/O socket */
+typedef struct {
+  struct sockaddr_in from_address;
+  size_t length;
+  CipOctet data[PC_OPENER_ETHERNET_BUFFER_SIZE];
+} UdpIoReceiveBuffer;
+
+/** @brief Preallocated receive buffers, filled and dispatched once per select() wakeup */
+static UdpIoReceiveBuffer s_udp_io_receive_buffers[
+  OPENER_UDP_IO_RECEIVE_BATCH_SIZE];
+
+static UdpIoReceiveStatistics s_udp_io_receive_statistics;
+
+const UdpIoReceiveStatistics *NetworkGetUdpIoReceiveStatistics(void) {
+  return &s_udp_io_receive_statistics;
+}
+
+void NetworkResetUdpIoReceiveStatistics(void) {
+  memset(&s_udp_io_receive_statistics, 0,
+         sizeof(s_udp_io_receive_statistics) );
+}
+
+/** @brief Reassembly states of an encapsulation message received on TCP */
+typedef enum {
+  kTcpReceiveStateHeader, /**< waiting for the encapsulation header */
+  kTcpReceiveStateBody, /**< waiting for the rest of the message */
+  kTcpReceiveStateDiscard /**< skipping the rest of an oversized message */
+} TcpReceiveState;
+
+/** @brief Reassembly buffer of an explicit messaging TCP socket
+ *
+ *  Encapsulation messages may be split over several TCP segments and several
+ *  messages may arrive in one segment, so received data is accumulated here
+ *  across select() wakeups and split at the message boundaries.
+ */
+typedef struct {
+  int socket; /**< owning socket, kEipInvalidSocket if unused */
+  TcpReceiveState state;
+  size_t received_length; /**< bytes currently held in buffer */
+  size_t message_length; /**< length of the current message including header,
+                              or bytes left to skip in the discard state */
+  CipOctet buffer[PC_OPENER_ETHERNET_BUFFER_SIZE];
+} TcpReceiveBuffer;
+
+static TcpReceiveBuffer s_tcp_receive_buffers[
+  OPENER_NUMBER_OF_SUPPORTED_SESSIONS];
+
+static void ReleaseTcpReceiveBuffer(const int socket);
+
+/** @brief Creates the wakeup channel used by OpenerRequestService()
+ *
+ *  An eventfd on Linux, which is both ends of the channel. Otherwise a
+ *  loopback UDP socket in the select() set and a second one connected to it.
+ *  A failure is not fatal, requested services then wait for the next tick.
+ */
+static void CreateWakeupChannel(void) {
+  g_network_status.wakeup_receiver = kEipInvalidSocket;
+  g_network_status.wakeup_sender = kEipInvalidSocket;
+
+#if OPENER_WAKEUP_USE_EVENTFD
+  const int receiver = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  const int sender = receiver;
+  const bool created = kEipInvalidSocket != receiver;
+#else
+  const int receiver = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  const int sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  struct sockaddr_in address = {
+    .sin_family = AF_INET,
+    .sin_port = 0, /* any free port */
+    .sin_addr.s_addr = htonl(INADDR_LOOPBACK)
+  };
+  socklen_t address_length = sizeof(address);
+  const bool created = kEipInvalidSocket != receiver &&
+                       kEipInvalidSocket != sender &&
+                       0 == bind( receiver, (struct sockaddr *) &address,
+                                  sizeof(address) ) &&
+                       0 == getsockname( receiver,
+                                         (struct sockaddr *) &address,
+                                         &address_length ) &&
+                       0 == connect( sender, (struct sockaddr *) &address,
+                                     sizeof(address) ) &&
+                       0 <= SetSocketToNonBlocking(receiver) &&
+                       0 <= SetSocketToNonBlocking(sender);
+#endif
+
+  if(!created) {
+    int error_code = GetSocketErrorNumber();
+    char *error_message = GetErrorMessage(error_code);
+    OPENER_TRACE_WARN(
+      "networkhandler: no wakeup channel, %d - %s, service requests wait for the next tick\n",
+      error_code,
+      error_message);
+    FreeErrorMessage(error_message);
+    if(kEipInvalidSocket != receiver) {
+      CloseSocketPlatform(receiver);
+    }
+    if(kEipInvalidSocket != sender && sender != receiver) {
+      CloseSocketPlatform(sender);
+    }
+    return;
+  }
+
+  FD_SET(receiver, &master_socket);
+  if(receiver > highest_socket_handle) {
+    highest_socket_handle = receiver;
+  }
+  g_network_status.wakeup_receiver = receiver;
+  g_network_status.wakeup_sender = sender;
+  atomic_store(&s_wakeup_pending, false);
+}
+
 /*************************************************
 * Function implementations from now on
 *************************************************/
@@ -410,9 +566,17 @@ EipStatus NetworkHandlerInitialize(void) {
                                        0,
                                        g_network_status.udp_unicast_listener);
 
-  g_last_time = GetMilliSeconds(); /* initialize time keeping */
+  CreateWakeupChannel();
+
+  g_last_time = GetMicroSeconds(); /* initialize time keeping */
+  g_actual_time = (MilliSeconds) (g_last_time / 1000ULL);
   g_network_status.elapsed_time = 0;
+  timeout_checker_elapsed_time = 0;
   NetworkResetInterfaceCounters();
+  NetworkResetUdpIoReceiveStatistics();
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; i++) {
+    s_tcp_receive_buffers[i].socket = kEipInvalidSocket;
+  }
 
   return kEipStatusOk;
 }
@@ -426,6 +590,7 @@ void CloseTcpSocket(int socket_handle) {
   OPENER_TRACE_STATE("Closing TCP socket %d\n", socket_handle);
   ShutdownSocketPlatform(socket_handle);
   RemoveSocketTimerFromList(socket_handle);
+  ReleaseTcpReceiveBuffer(socket_handle);
   CloseSocket(socket_handle);
 }
 
@@ -499,18 +664,30 @@ EipStatus NetworkHandlerProcessCyclic(void) {
 
   read_socket = master_socket;
 
-  g_time_value.tv_sec = 0;
-  g_time_value.tv_usec =
+  /* the connection manager is serviced at least every tick, and earlier if a
+   *  connection deadline is due before the tick expires */
+  MicroSeconds manage_interval =
+    (MicroSeconds) kOpenerTimerTickInMilliSeconds * 1000ULL;
+#if defined(OPENER_CONNECTION_SCHEDULER) && 0 != OPENER_CONNECTION_SCHEDULER
+  MicroSeconds next_deadline = ConnectionSchedulerGetTimeToNextDeadline();
+  if(next_deadline < manage_interval) {
+    manage_interval = next_deadline;
+  }
+#endif
+
+  MicroSeconds select_timeout =
     (g_network_status.elapsed_time <
-     kOpenerTimerTickInMilliSeconds ? kOpenerTimerTickInMilliSeconds -
-     g_network_status.elapsed_time : 0)
-    * 1000; /* 10 ms */
+     manage_interval ? manage_interval -
+     g_network_status.elapsed_time : 0);
+  g_time_value.tv_sec = (long) (select_timeout / 1000000ULL);
+  g_time_value.tv_usec = (long) (select_timeout % 1000000ULL);
 
   int ready_socket = select(highest_socket_handle + 1,
                             &read_socket,
                             0,
                             0,
                             &g_time_value);
+  OPENER_PERF_BEGIN(wake_start);
 
   if(ready_socket == kEipInvalidSocket) {
     if(EINTR == errno) /* we have somehow been interrupted. The default behavior is to go back into the select loop. */
@@ -529,6 +706,7 @@ EipStatus NetworkHandlerProcessCyclic(void) {
 
   if(ready_socket > 0) {
 
+    CheckAndHandleWakeupChannel();
     CheckAndHandleTcpListenerSocket();
     CheckAndHandleUdpUnicastSocket();
     CheckAndHandleUdpGlobalBroadcastSocket();
@@ -553,27 +731,43 @@ EipStatus NetworkHandlerProcessCyclic(void) {
   /* Check if all connections from one originator times out */
   //CheckForTimedOutConnectionsAndCloseTCPConnections();
   //OPENER_TRACE_INFO("Socket Loop done\n");
-  g_actual_time = GetMilliSeconds();
-  g_network_status.elapsed_time += g_actual_time - g_last_time;
-  g_last_time = g_actual_time;
+  MicroSeconds actual_time = GetMicroSeconds();
+  g_network_status.elapsed_time += actual_time - g_last_time;
+  g_last_time = actual_time;
+  g_actual_time = (MilliSeconds) (actual_time / 1000ULL);
   //OPENER_TRACE_INFO("Elapsed time: %u\n", g_network_status.elapsed_time);
 
   /* check if we had been not able to update the connection manager for several kOpenerTimerTickInMilliSeconds.
    * This should compensate the jitter of the windows timer
    */
-  if(g_network_status.elapsed_time >= kOpenerTimerTickInMilliSeconds) {
-    /* call manage_connections() in connection manager every kOpenerTimerTickInMilliSeconds ms */
+  /* taken after the wakeup was consumed, so the requests of every consumed
+   * wakeup are served in this cycle */
+  const unsigned int service_requests =
+    atomic_exchange(&s_service_requests, 0U);
+
+  if(g_network_status.elapsed_time >= manage_interval ||
+     0 != (service_requests & kOpenerServiceProduction) ) {
+    /* call manage_connections() in connection manager every kOpenerTimerTickInMilliSeconds ms,
+     * or at the earliest connection deadline in scheduler mode, and right away
+     * when the application requested a production */
     ManageConnections(g_network_status.elapsed_time);
 
     /* Call timeout checker functions registered in timeout_checker_array */
+    timeout_checker_elapsed_time += g_network_status.elapsed_time;
+    MilliSeconds timeout_checker_elapsed_milliseconds =
+      (MilliSeconds) (timeout_checker_elapsed_time / 1000ULL);
+    timeout_checker_elapsed_time %= 1000ULL;
     for (size_t i = 0; i < OPENER_TIMEOUT_CHECKER_ARRAY_SIZE; i++) {
       if (NULL != timeout_checker_array[i]) {
-        (timeout_checker_array[i])(g_network_status.elapsed_time);
+        (timeout_checker_array[i])(timeout_checker_elapsed_milliseconds);
       }
     }
 
     g_network_status.elapsed_time = 0;
+  } else if(0 != (service_requests & kOpenerServiceApplication) ) {
+    HandleApplication(); /* ManageConnections() calls it otherwise */
   }
+  OPENER_PERF_END(kPerfStageSelectWake, wake_start);
   return kEipStatusOk;
 }
 
@@ -581,9 +775,54 @@ EipStatus NetworkHandlerFinish(void) {
   CloseTcpSocket(g_network_status.tcp_listener);
   CloseUdpSocket(g_network_status.udp_unicast_listener);
   CloseUdpSocket(g_network_status.udp_global_broadcast_listener);
+  atomic_store(&s_wakeup_pending, true); /* no more wakeups */
+  CloseUdpSocket(g_network_status.wakeup_receiver);
+  if(g_network_status.wakeup_sender != g_network_status.wakeup_receiver) {
+    CloseUdpSocket(g_network_status.wakeup_sender);
+  }
+  g_network_status.wakeup_receiver = kEipInvalidSocket;
+  g_network_status.wakeup_sender = kEipInvalidSocket;
   return kEipStatusOk;
 }
 
+void OpenerRequestService(const unsigned int service_flags) {
+  atomic_fetch_or(&s_service_requests, service_flags);
+  if( atomic_exchange(&s_wakeup_pending, true) ) {
+    return; /* a wakeup is already pending, or there is no wakeup channel */
+  }
+#if OPENER_WAKEUP_USE_EVENTFD
+  const uint64_t wakeup = 1;
+  const ssize_t sent = write( g_network_status.wakeup_sender, &wakeup,
+                              sizeof(wakeup) );
+#else
+  const CipOctet wakeup = 0;
+  const ssize_t sent = send(g_network_status.wakeup_sender,
+                            NWBUF_CAST &wakeup, sizeof(wakeup), 0);
+#endif
+  if(0 > sent) {
+    atomic_store(&s_wakeup_pending, false); /* the next call tries again */
+  }
+}
+
+static void CheckAndHandleWakeupChannel(void) {
+  if(kEipInvalidSocket == g_network_status.wakeup_receiver ||
+     true != CheckSocketSet(g_network_status.wakeup_receiver) ) {
+    return;
+  }
+  /* re-arm before draining, the requests of every wakeup consumed here are
+   * already visible to the rest of this cycle */
+  atomic_store(&s_wakeup_pending, false);
+#if OPENER_WAKEUP_USE_EVENTFD
+  uint64_t wakeups = 0;
+  (void) read( g_network_status.wakeup_receiver, &wakeups, sizeof(wakeups) );
+#else
+  CipOctet buffer[16];
+  while(0 < recv(g_network_status.wakeup_receiver, NWBUF_CAST buffer,
+                 sizeof(buffer), 0) ) {
+  }
+#endif
+}
+
 void CheckAndHandleUdpGlobalBroadcastSocket(void) {
   /* see if this is an unsolicited inbound UDP message */
   if( true == CheckSocketSet(g_network_status.udp_global_broadcast_listener) ) {
@@ -784,25 +1023,135 @@ EipStatus SendUdpData(const struct sockaddr_in *const address,
   return kEipStatusOk;
 }
 
-EipStatus HandleDataOnTcpSocket(int socket) {
-  OPENER_TRACE_INFO("Entering HandleDataOnTcpSocket for socket: %d\n", socket);
-  int remaining_bytes = 0;
-  long data_sent = PC_OPENER_ETHERNET_BUFFER_SIZE;
+/** @brief Looks up the receive buffer of a TCP socket, assigning a free one
+ *  on the first data received on the socket
+ *
+ *  @param socket The TCP socket
+ *  @return The receive buffer, or NULL if all buffers are in use
+ */
+static TcpReceiveBuffer *GetTcpReceiveBuffer(const int socket) {
+  TcpReceiveBuffer *free_buffer = NULL;
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; i++) {
+    if(socket == s_tcp_receive_buffers[i].socket) {
+      return &s_tcp_receive_buffers[i];
+    }
+    if(NULL == free_buffer &&
+       kEipInvalidSocket == s_tcp_receive_buffers[i].socket) {
+      free_buffer = &s_tcp_receive_buffers[i];
+    }
+  }
+  if(NULL != free_buffer) {
+    free_buffer->socket = socket;
+    free_buffer->state = kTcpReceiveStateHeader;
+    free_buffer->received_length = 0;
+    free_buffer->message_length = 0;
+  }
+  return free_buffer;
+}
 
-  /* We will handle just one EIP packet here the rest is done by the select
-   * method which will inform us if more data is available in the socket
-     because of the current implementation of the main loop this may not be
-     the fastest way and a loop here with a non blocking socket would better
-     fit*/
+static void ReleaseTcpReceiveBuffer(const int socket) {
+  for(size_t i = 0; i < OPENER_NUMBER_OF_SUPPORTED_SESSIONS; i++) {
+    if(socket == s_tcp_receive_buffers[i].socket) {
+      s_tcp_receive_buffers[i].socket = kEipInvalidSocket;
+    }
+  }
+}
 
-  /*Check how many data is here -- read the first four bytes from the connection */
-  CipOctet incoming_message[PC_OPENER_ETHERNET_BUFFER_SIZE] = { 0 };
+/** @brief Removes already processed bytes from the front of a receive buffer */
+static void ConsumeTcpReceiveBuffer(TcpReceiveBuffer *const receive_buffer,
+                                    const size_t length) {
+  receive_buffer->received_length -= length;
+  memmove(receive_buffer->buffer,
+          receive_buffer->buffer + length,
+          receive_buffer->received_length);
+}
 
-  long number_of_read_bytes = recv(socket, NWBUF_CAST incoming_message, 4, 0); /*TODO we may have to set the socket to a non blocking socket */
+/** @brief Processes one complete encapsulation message received on TCP and
+ *  sends the reply
+ *
+ *  @param socket The socket the message was received on
+ *  @param message The encapsulation message
+ *  @param message_length Length of the encapsulation message including header
+ *  @param sender_address The peer address of the socket
+ */
+static void HandleEncapsulationMessageOnTcpSocket(const int socket,
+                                                  EipUint8 *const message,
+                                                  const size_t message_length,
+                                                  struct sockaddr *const sender_address)
+{
+  int remaining_bytes = 0;
 
+  OPENER_TRACE_INFO("Data received on TCP: %" PRIuSZT "\n", message_length);
+  NetworkCountersRecordRx(message_length, false);
+
+  g_current_active_tcp_socket = socket;
+
+  ENIPMessage outgoing_message;
+  InitializeENIPMessage(&outgoing_message);
+  EipStatus need_to_send = HandleReceivedExplictTcpData(socket,
+                                                        message,
+                                                        message_length,
+                                                        &remaining_bytes,
+                                                        sender_address,
+                                                        &outgoing_message);
   SocketTimer *const socket_timer = SocketTimerArrayGetSocketTimer(g_timestamps,
                                                                    OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
                                                                    socket);
+  if(NULL != socket_timer) {
+    SocketTimerSetLastUpdate(socket_timer, g_actual_time);
+  }
+
+  g_current_active_tcp_socket = kEipInvalidSocket;
+
+  if(remaining_bytes != 0) {
+    OPENER_TRACE_WARN(
+      "Warning: received packet was to long: %d Bytes left!\n",
+      remaining_bytes);
+  }
+
+  if(need_to_send > 0) {
+    OPENER_TRACE_INFO("TCP reply: send %" PRIuSZT " bytes on %d\n",
+                      outgoing_message.used_message_length,
+                      socket);
+
+    long data_sent = send(socket,
+                          (char *) outgoing_message.message_buffer,
+                          outgoing_message.used_message_length,
+                          MSG_NOSIGNAL);
+    if(data_sent != (long) outgoing_message.used_message_length) {
+      OPENER_TRACE_WARN(
+        "TCP response was not fully sent: exp %" PRIuSZT ", sent %ld\n",
+        outgoing_message.used_message_length,
+        data_sent);
+      NetworkCountersRecordTxDiscard();
+    }
+    if (data_sent > 0) {
+      NetworkCountersRecordTx((size_t)data_sent, false);
+    } else {
+      NetworkCountersRecordTxError();
+    }
+  }
+}
+
+EipStatus HandleDataOnTcpSocket(int socket) {
+  OPENER_TRACE_INFO("Entering HandleDataOnTcpSocket for socket: %d\n", socket);
+
+  TcpReceiveBuffer *const receive_buffer = GetTcpReceiveBuffer(socket);
+  if(NULL == receive_buffer) {
+    OPENER_TRACE_ERR("networkhandler: no receive buffer for socket %d\n",
+                     socket);
+    return kEipStatusError;
+  }
+
+  /* Only one recv() per select() wakeup, the socket may be blocking. Partial
+   * messages stay in the receive buffer until the next wakeup. */
+  long number_of_read_bytes = recv(socket,
+                                   NWBUF_CAST (receive_buffer->buffer +
+                                               receive_buffer->received_length),
+                                   sizeof(receive_buffer->buffer) -
+                                   receive_buffer->received_length,
+                                   0);
+
   if(number_of_read_bytes == 0) {
     OPENER_TRACE_ERR(
       "networkhandler: socket: %d - connection closed by client.\n",
@@ -823,172 +1172,92 @@ EipStatus HandleDataOnTcpSocket(int socket) {
     FreeErrorMessage(error_message);
     return kEipStatusError;
   }
+  receive_buffer->received_length += (size_t) number_of_read_bytes;
 
-  const EipUint8 *read_buffer = &incoming_message[2]; /* at this place EIP stores the data length */
-  EipUint16 reported_length = GetUintFromMessage(&read_buffer);
-  
-  // Prevent integer overflow: check if reported_length would cause overflow
-  if (reported_length > (PC_OPENER_ETHERNET_BUFFER_SIZE + 4)) {
-    OPENER_TRACE_ERR("Invalid packet length reported: %u (max: %u)\n",
-                     reported_length, PC_OPENER_ETHERNET_BUFFER_SIZE);
-    return kEipStatusError;
-  }
-  
-  size_t data_size = reported_length + ENCAPSULATION_HEADER_LENGTH - 4; /* -4 is for the 4 bytes we have already read*/
-  /* (NOTE this advances the buffer pointer) */
-  if( (PC_OPENER_ETHERNET_BUFFER_SIZE - 4) < data_size ) { /*TODO can this be handled in a better way?*/
-    OPENER_TRACE_ERR(
-      "too large packet received will be ignored, will drop the data\n");
-    /* Currently we will drop the whole packet */
-
-    do {
-      OPENER_TRACE_INFO(
-        "Entering consumption loop, remaining data to receive: %ld\n",
-        data_sent);
-      number_of_read_bytes = recv(socket,
-                                  NWBUF_CAST & incoming_message[0],
-                                  data_sent,
-                                  0);
-
-      if(number_of_read_bytes == 0) /* got error or connection closed by client */
-      {
-        int error_code = GetSocketErrorNumber();
-        char *error_message = GetErrorMessage(error_code);
-        OPENER_TRACE_ERR(
-          "networkhandler: socket: %d - connection closed by client: %d - %s\n",
-          socket,
-          error_code,
-          error_message);
-        FreeErrorMessage(error_message);
-        RemoveSocketTimerFromList(socket);
-        return kEipStatusError;
-      }
-      if(number_of_read_bytes < 0) {
-        int error_code = GetSocketErrorNumber();
-        char *error_message = GetErrorMessage(error_code);
-        if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
-          return kEipStatusOk;
-        } OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
-                           error_code,
-                           error_message);
-        FreeErrorMessage(error_message);
-        return kEipStatusError;
-      }
-      data_size -= number_of_read_bytes;
-      if( (data_size < PC_OPENER_ETHERNET_BUFFER_SIZE) && (data_size != 0) ) {
-        data_sent = data_size;
-      }
-    } while(0 < data_size);
+  SocketTimer *const socket_timer = SocketTimerArrayGetSocketTimer(g_timestamps,
+                                                                   OPENER_NUMBER_OF_SUPPORTED_SESSIONS,
+                                                                   socket);
+  if(NULL != socket_timer) {
     SocketTimerSetLastUpdate(socket_timer, g_actual_time);
-    return kEipStatusOk;
   }
 
-  number_of_read_bytes = recv(socket,
-                              NWBUF_CAST & incoming_message[4],
-                              data_size,
-                              0);
-
-  if(0 == number_of_read_bytes) /* got error or connection closed by client */
-  {
-    int error_code = GetSocketErrorNumber();
-    char *error_message = GetErrorMessage(error_code);
-    OPENER_TRACE_ERR(
-      "networkhandler: socket: %d - connection closed by client: %d - %s\n",
-      socket,
-      error_code,
-      error_message);
-    FreeErrorMessage(error_message);
-    RemoveSocketTimerFromList(socket);
-    RemoveSession(socket);
-    return kEipStatusError;
-  }
-  if(number_of_read_bytes < 0) {
+  struct sockaddr sender_address;
+  memset( &sender_address, 0, sizeof(sender_address) );
+  socklen_t fromlen = sizeof(sender_address);
+  if(getpeername(socket, (struct sockaddr *) &sender_address, &fromlen) < 0) {
     int error_code = GetSocketErrorNumber();
     char *error_message = GetErrorMessage(error_code);
-    if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
-      return kEipStatusOk;
-    } OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
-                       error_code,
-                       error_message);
+    OPENER_TRACE_ERR("networkhandler: could not get peername: %d - %s\n",
+                     error_code,
+                     error_message);
     FreeErrorMessage(error_message);
-    return kEipStatusError;
   }
 
-  if( (unsigned) number_of_read_bytes == data_size ) {
-    /*we got the right amount of data */
-    data_size += 4;
-    /*TODO handle partial packets*/
-    OPENER_TRACE_INFO("Data received on TCP: %" PRIuSZT "\n", data_size);
-    NetworkCountersRecordRx(data_size, false);
-
-    g_current_active_tcp_socket = socket;
-
-    struct sockaddr sender_address;
-    memset( &sender_address, 0, sizeof(sender_address) );
-    socklen_t fromlen = sizeof(sender_address);
-    if(getpeername(socket, (struct sockaddr *) &sender_address, &fromlen) < 0) {
-      int error_code = GetSocketErrorNumber();
-      char *error_message = GetErrorMessage(error_code);
-      OPENER_TRACE_ERR("networkhandler: could not get peername: %d - %s\n",
-                       error_code,
-                       error_message);
-      FreeErrorMessage(error_message);
-    }
-
-    ENIPMessage outgoing_message;
-    InitializeENIPMessage(&outgoing_message);
-    EipStatus need_to_send = HandleReceivedExplictTcpData(socket,
-                                                          incoming_message,
-                                                          data_size,
-                                                          &remaining_bytes,
-                                                          &sender_address,
-                                                          &outgoing_message);
-    if(NULL != socket_timer) {
-      SocketTimerSetLastUpdate(socket_timer, g_actual_time);
-    }
-
-    g_current_active_tcp_socket = kEipInvalidSocket;
-
-    if(remaining_bytes != 0) {
-      OPENER_TRACE_WARN(
-        "Warning: received packet was to long: %d Bytes left!\n",
-        remaining_bytes);
-    }
-
-    if(need_to_send > 0) {
-      OPENER_TRACE_INFO("TCP reply: send %" PRIuSZT " bytes on %d\n",
-                        outgoing_message.used_message_length,
-                        socket);
-
-      data_sent = send(socket,
-                       (char *) outgoing_message.message_buffer,
-                       outgoing_message.used_message_length,
-                       MSG_NOSIGNAL);
-      SocketTimerSetLastUpdate(socket_timer, g_actual_time);
-      if(data_sent != outgoing_message.used_message_length) {
-        OPENER_TRACE_WARN(
-          "TCP response was not fully sent: exp %" PRIuSZT ", sent %ld\n",
-          outgoing_message.used_message_length,
-          data_sent);
-        NetworkCountersRecordTxDiscard();
+  /* process every complete message, requests may be pipelined */
+  for(;;) {
+    switch(receive_buffer->state) {
+      case kTcpReceiveStateHeader: {
+        if(receive_buffer->received_length < ENCAPSULATION_HEADER_LENGTH) {
+          return kEipStatusOk;
+        }
+        const EipUint8 *read_buffer = &receive_buffer->buffer[2]; /* at this place EIP stores the data length */
+        const EipUint16 reported_length = GetUintFromMessage(&read_buffer);
+        /* far beyond any valid request, the peer is not speaking
+         * EtherNet/IP, close the session */
+        if(reported_length > (PC_OPENER_ETHERNET_BUFFER_SIZE + 4) ) {
+          OPENER_TRACE_ERR("Invalid packet length reported: %u (max: %u)\n",
+                           reported_length, PC_OPENER_ETHERNET_BUFFER_SIZE);
+          return kEipStatusError;
+        }
+        receive_buffer->message_length = reported_length +
+                                         ENCAPSULATION_HEADER_LENGTH;
+        /* slightly too large, skip the message and keep the session */
+        if(receive_buffer->message_length > sizeof(receive_buffer->buffer) ) {
+          OPENER_TRACE_ERR(
+            "too large packet received will be ignored, will drop the data\n");
+          NetworkCountersRecordRxDiscard();
+          receive_buffer->state = kTcpReceiveStateDiscard;
+        } else {
+          receive_buffer->state = kTcpReceiveStateBody;
+        }
+        break;
       }
-      if (data_sent > 0) {
-        NetworkCountersRecordTx((size_t)data_sent, false);
-      } else {
-        NetworkCountersRecordTxError();
+
+      case kTcpReceiveStateBody:
+        if(receive_buffer->received_length < receive_buffer->message_length) {
+          return kEipStatusOk;
+        }
+        HandleEncapsulationMessageOnTcpSocket(socket,
+                                              receive_buffer->buffer,
+                                              receive_buffer->message_length,
+                                              &sender_address);
+        if(socket != receive_buffer->socket) {
+          return kEipStatusOk; /* socket has been closed by the request */
+        }
+        ConsumeTcpReceiveBuffer(receive_buffer,
+                                receive_buffer->message_length);
+        receive_buffer->state = kTcpReceiveStateHeader;
+        break;
+
+      case kTcpReceiveStateDiscard: {
+        size_t discard_length = receive_buffer->message_length;
+        if(discard_length > receive_buffer->received_length) {
+          discard_length = receive_buffer->received_length;
+        }
+        ConsumeTcpReceiveBuffer(receive_buffer, discard_length);
+        receive_buffer->message_length -= discard_length;
+        if(0 != receive_buffer->message_length) {
+          return kEipStatusOk;
+        }
+        receive_buffer->state = kTcpReceiveStateHeader;
+        break;
       }
-    }
 
-    return kEipStatusOk;
-  } else {
-    /* we got a fragmented packet currently we cannot handle this will
-     * for this we would need a network buffer per TCP socket
-     *
-     * However with typical packet sizes of EIP this shouldn't be a big issue.
-     */
-    /*TODO handle fragmented packets */
-  }
-  return kEipStatusError;
+      default:
+        OPENER_TRACE_ERR("networkhandler: invalid TCP receive state\n");
+        return kEipStatusError;
+    }
+  }
 }
 
 /** @brief Create the UDP socket for the implicit IO messaging, one socket handles all connections
@@ -1130,73 +1399,128 @@ EipUint32 GetPeerAddress(void) {
   return peer_address.sin_addr.s_addr;
 }
 
+/** @brief Traces a receive error on the implicit I/O socket
+ *
+ *  The socket is shared by all I/O connections, so an error cannot be
+ *  attributed to a single connection and no connection is closed.
+ *
+ *  @return true if the socket has just been drained
+ */
+static bool HandleUdpIoReceiveError(void) {
+  int error_code = GetSocketErrorNumber();
+  if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
+    return true;
+  }
+  NetworkCountersRecordRxError();
+  char *error_message = GetErrorMessage(error_code);
+  OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
+                   error_code,
+                   error_message);
+  FreeErrorMessage(error_message);
+  return false;
+}
+
+/** @brief Receives up to OPENER_UDP_IO_RECEIVE_BATCH_SIZE pending datagrams
+ *  from the implicit I/O socket without blocking
+ *
+ *  @return number of receive buffers filled
+ */
+static size_t ReceiveUdpIoBatch(void) {
+#if OPENER_UDP_IO_USE_RECVMMSG
+  static struct mmsghdr messages[OPENER_UDP_IO_RECEIVE_BATCH_SIZE];
+  static struct iovec io_vectors[OPENER_UDP_IO_RECEIVE_BATCH_SIZE];
+
+  for(size_t i = 0; i < OPENER_UDP_IO_RECEIVE_BATCH_SIZE; i++) {
+    io_vectors[i].iov_base = s_udp_io_receive_buffers[i].data;
+    io_vectors[i].iov_len = sizeof(s_udp_io_receive_buffers[i].data);
+    memset(&messages[i], 0, sizeof(messages[i]) );
+    messages[i].msg_hdr.msg_name = &s_udp_io_receive_buffers[i].from_address;
+    messages[i].msg_hdr.msg_namelen =
+      sizeof(s_udp_io_receive_buffers[i].from_address);
+    messages[i].msg_hdr.msg_iov = &io_vectors[i];
+    messages[i].msg_hdr.msg_iovlen = 1;
+  }
+
+  int received_messages = recvmmsg(g_network_status.udp_io_messaging,
+                                   messages,
+                                   OPENER_UDP_IO_RECEIVE_BATCH_SIZE,
+                                   MSG_DONTWAIT,
+                                   NULL);
+  if(0 > received_messages) {
+    HandleUdpIoReceiveError();
+    return 0;
+  }
+
+  for(int i = 0; i < received_messages; i++) {
+    s_udp_io_receive_buffers[i].length = messages[i].msg_len;
+    if(0 != (messages[i].msg_hdr.msg_flags & MSG_TRUNC) ) {
+      OPENER_TRACE_WARN("networkhandler: truncated I/O datagram dropped\n");
+      s_udp_io_receive_buffers[i].length = 0;
+    }
+  }
+  return (size_t) received_messages;
+#else
+  size_t received_messages = 0;
+
+  while(received_messages < OPENER_UDP_IO_RECEIVE_BATCH_SIZE) {
+    UdpIoReceiveBuffer *buffer = &s_udp_io_receive_buffers[received_messages];
+    socklen_t from_address_length = sizeof(buffer->from_address);
+
+    int received_size = recvfrom(g_network_status.udp_io_messaging,
+                                 NWBUF_CAST buffer->data,
+                                 sizeof(buffer->data),
+                                 0,
+                                 (struct sockaddr *) &buffer->from_address,
+                                 &from_address_length);
+    if(0 > received_size) {
+      HandleUdpIoReceiveError();
+      break;
+    }
+    buffer->length = (size_t) received_size;
+    received_messages++;
+  }
+  return received_messages;
+#endif /* OPENER_UDP_IO_USE_RECVMMSG */
+}
+
 void CheckAndHandleConsumingUdpSocket(void) {
-  DoublyLinkedListNode *iterator = connection_list.first;
-
-  CipConnectionObject *current_connection_object = NULL;
-
-  /* see a message of the registered UDP socket has been received     */
-  while(NULL != iterator) {
-    current_connection_object = (CipConnectionObject *) iterator->data;
-    iterator = iterator->next; /* do this at the beginning as the close function may can make the entry invalid */
-
-    if( (kEipInvalidSocket !=
-         current_connection_object->socket[kUdpCommuncationDirectionConsuming])
-        && ( true ==
-             CheckSocketSet(current_connection_object->socket[
-                              kUdpCommuncationDirectionConsuming
-                            ]) ) ) {
-      #if NETWORK_VERBOSE_LOGGING
-      OPENER_TRACE_INFO("Processing UDP consuming message\n");
-      #endif
-      struct sockaddr_in from_address = { 0 };
-      socklen_t from_address_length = sizeof(from_address);
-      CipOctet incoming_message[PC_OPENER_ETHERNET_BUFFER_SIZE] = { 0 };
-
-      int received_size = recvfrom(g_network_status.udp_io_messaging,
-                                   NWBUF_CAST incoming_message,
-                                   sizeof(incoming_message),
-                                   0,
-                                   (struct sockaddr *) &from_address,
-                                   &from_address_length);
-      if(0 == received_size) {
-        NetworkCountersRecordRxDiscard();
-        NetworkCountersRecordRxError();
-        int error_code = GetSocketErrorNumber();
-        char *error_message = GetErrorMessage(error_code);
-        OPENER_TRACE_ERR(
-          "networkhandler: socket: %d - connection closed by client: %d - %s\n",
-          current_connection_object->socket[
-            kUdpCommuncationDirectionConsuming],
-          error_code,
-          error_message);
-        FreeErrorMessage(error_message);
-        current_connection_object->connection_close_function(
-          current_connection_object);
-        continue;
-      }
+  /* all consuming I/O connections share the I/O messaging socket */
+  if(kEipInvalidSocket == g_network_status.udp_io_messaging ||
+     true != CheckSocketSet(g_network_status.udp_io_messaging) ) {
+    return;
+  }
 
-      if(0 > received_size) {
-        int error_code = GetSocketErrorNumber();
-        if(OPENER_SOCKET_WOULD_BLOCK == error_code) {
-          return; // No fatal error, resume execution
-        } 
-        NetworkCountersRecordRxError();
-        char *error_message = GetErrorMessage(error_code);
-        OPENER_TRACE_ERR("networkhandler: error on recv: %d - %s\n",
-                           error_code,
-                           error_message);
-        FreeErrorMessage(error_message);
-        current_connection_object->connection_close_function(
-          current_connection_object);
-        continue;
-      }
+  #if NETWORK_VERBOSE_LOGGING
+  OPENER_TRACE_INFO("Processing UDP consuming messages\n");
+  #endif
 
-      NetworkCountersRecordRx((size_t)received_size, false);
-      HandleReceivedConnectedData(incoming_message, received_size,
-                                  &from_address);
+  /* drain first so datagrams from all originators are handled in this pass */
+  size_t received_messages = ReceiveUdpIoBatch();
 
+  for(size_t i = 0; i < received_messages; i++) {
+    UdpIoReceiveBuffer *buffer = &s_udp_io_receive_buffers[i];
+    if(0 == buffer->length) {
+      NetworkCountersRecordRxDiscard();
+      continue;
     }
+    NetworkCountersRecordRx(buffer->length, false);
+    OPENER_PERF_BEGIN(handle_start);
+    HandleReceivedConnectedData(buffer->data, (int) buffer->length,
+                                &buffer->from_address);
+    OPENER_PERF_END(kPerfStageHandleReceivedConnectedData, handle_start);
+  }
+
+  s_udp_io_receive_statistics.wakeups++;
+  s_udp_io_receive_statistics.packets += (CipUdint) received_messages;
+  s_udp_io_receive_statistics.last_packets_per_wakeup =
+    (CipUdint) received_messages;
+  if(received_messages > s_udp_io_receive_statistics.max_packets_per_wakeup) {
+    s_udp_io_receive_statistics.max_packets_per_wakeup =
+      (CipUdint) received_messages;
+  }
+  if(OPENER_UDP_IO_RECEIVE_BATCH_SIZE == received_messages) {
+    /* more datagrams may be pending, select() reports them right away */
+    s_udp_io_receive_statistics.full_batches++;
   }
 }
 
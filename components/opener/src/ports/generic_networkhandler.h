@@ -56,7 +56,7 @@ extern int g_current_active_tcp_socket;
 
 extern struct timeval g_time_value;
 extern MilliSeconds g_actual_time;
-extern MilliSeconds g_last_time;
+extern MicroSeconds g_last_time; /**< time stamp of the last elapsed time update in microseconds */
 /** @brief Struct representing the current network status
  *
  */
@@ -65,9 +65,11 @@ typedef struct {
   int udp_unicast_listener; /**< UDP unicast listener socket */
   int udp_global_broadcast_listener; /**< UDP global network broadcast listener */
   int udp_io_messaging; /**< UDP IO messaging socket */
+  int wakeup_receiver; /**< wakeup channel in the select() set, readable after OpenerRequestService() */
+  int wakeup_sender; /**< end of the wakeup channel written by OpenerRequestService() */
   CipUdint ip_address; /**< IP being valid during NetworkHandlerInitialize() */
   CipUdint network_mask; /**< network mask being valid during NetworkHandlerInitialize() */
-  MilliSeconds elapsed_time;
+  MicroSeconds elapsed_time; /**< time in microseconds not yet passed to ManageConnections() */
 } NetworkStatus;
 
 extern NetworkStatus g_network_status; /**< Global variable holding the current network status */
@@ -89,6 +91,18 @@ typedef struct {
 const NetworkInterfaceCounters *NetworkGetInterfaceCounters(void);
 void NetworkResetInterfaceCounters(void);
 
+/** @brief Receive statistics of the implicit I/O messaging socket */
+typedef struct {
+  CipUdint wakeups; /**< select() wakeups with the I/O socket readable */
+  CipUdint packets; /**< datagrams received on the I/O socket */
+  CipUdint last_packets_per_wakeup; /**< datagrams drained in the last wakeup */
+  CipUdint max_packets_per_wakeup; /**< most datagrams drained in one wakeup */
+  CipUdint full_batches; /**< wakeups which filled all receive buffers */
+} UdpIoReceiveStatistics;
+
+const UdpIoReceiveStatistics *NetworkGetUdpIoReceiveStatistics(void);
+void NetworkResetUdpIoReceiveStatistics(void);
+
 /** @brief The platform independent part of network handler initialization routine
  *
  *  @return Returns the OpENer status after the initialization routine
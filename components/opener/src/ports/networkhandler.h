@@ -58,6 +58,23 @@ MicroSeconds GetMicroSeconds(void);
  */
 MilliSeconds GetMilliSeconds(void);
 
+/** @brief Returns the free running performance counter used to time the I/O
+ *  path stages (see cipperf.h)
+ *
+ * Should be the cheapest fine grained time source of the platform, e.g. the
+ * CPU cycle counter. Only differences of less than one wrap around period are
+ * meaningful.
+ *
+ *  @return Current performance counter value
+ */
+PerfTicks GetPerfCounter(void);
+
+/** @brief Returns the rate of the performance counter
+ *
+ *  @return Counter ticks per second
+ */
+CipUdint GetPerfCounterFrequency(void);
+
 /** @brief Sets QoS on socket
  *
  * A wrapper function - needs a platform dependent implementation to set QoS on a socket
@@ -7,8 +7,9 @@
 /** @file nvtcpip.c
  *  @brief This file implements the functions to handle TCP/IP object's NV data.
  *
- *  This is only a code skeleton. The real load and store operation is NOT
- *  implemented.
+ *  The ESP32 build keeps the data in NVS. Other platforms (the POSIX host
+ *  build) only get a code skeleton, the real load and store operation is NOT
+ *  implemented there.
  */
 #include "nvtcpip.h"
 
@@ -18,6 +19,9 @@
 #include "ciptcpipinterface.h"
 #include "cipstring.h"
 #include "trace.h"
+
+#if defined(ESP32)
+
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
@@ -289,3 +293,28 @@ EipStatus NvTcpipStore(const CipTcpIpObject *p_tcp_ip) {
 
   return kEipStatusOk;
 }
+
+#else /* defined(ESP32) */
+
+/** @brief Load NV data of the TCP/IP object, keeps the defaults
+ *
+ *  @param  p_tcp_ip pointer to the TCP/IP object's data structure
+ *  @return kEipStatusOk: success; kEipStatusError: failure
+ */
+EipStatus NvTcpipLoad(CipTcpIpObject *p_tcp_ip) {
+  (void)p_tcp_ip;
+  return kEipStatusOk;
+}
+
+/** @brief Store NV data of the TCP/IP object, not persisted
+ *
+ *  @param  p_tcp_ip pointer to the TCP/IP object's data structure
+ *  @return kEipStatusOk: success; kEipStatusError: failure
+ */
+EipStatus NvTcpipStore(const CipTcpIpObject *p_tcp_ip) {
+  (void)p_tcp_ip;
+  OPENER_TRACE_INFO("NV data of the TCP/IP object not stored on this platform\n");
+  return kEipStatusOk;
+}
+
+#endif /* defined(ESP32) */
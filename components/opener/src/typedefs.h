@@ -67,6 +67,8 @@ static const int kEipInvalidSocket = -1;
 
 typedef unsigned long MilliSeconds;
 typedef unsigned long long MicroSeconds;
+/** @brief Performance counter value, wraps around, see GetPerfCounter() */
+typedef uint32_t PerfTicks;
 
 
 /** @brief CIP object instance number type.
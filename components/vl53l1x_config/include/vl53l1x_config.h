@@ -8,6 +8,9 @@
 extern "C" {
 #endif
 
+// Longest median and moving average window of the processing pipeline
+#define VL53L1X_CONFIG_FILTER_WINDOW_MAX 8
+
 /**
  * @brief VL53L1x configuration structure
  * 
@@ -16,8 +19,8 @@ extern "C" {
 typedef struct {
     // Distance Mode Configuration
     uint16_t distance_mode;           // 1=SHORT (<1.3m), 2=LONG (<4m, default)
-    uint16_t timing_budget_ms;        // 15, 20, 33, 50, 100 (default), 200, 500
-    uint32_t inter_measurement_ms;    // Must be >= timing_budget, default: 100
+    uint16_t timing_budget_ms;        // 15 (SHORT only), 20, 33, 50, 100 (default), 200, 500
+    uint32_t inter_measurement_ms;    // Must be >= timing_budget, default: 100 (20 with SHORT/20 ms gives 50 Hz)
     
     // Region of Interest (ROI) Configuration
     uint16_t roi_x_size;              // 4-16 (default: 16)
@@ -42,6 +45,16 @@ typedef struct {
     
     // I2C Configuration (for multiple sensors)
     uint8_t i2c_address;              // 0x29-0x7F (default: 0x29)
+    
+    // Processing Pipeline (all stages off by default, results pass raw)
+    uint8_t reject_invalid_status;    // 1=drop results with a range status other than 0 (default: 0)
+    uint16_t min_signal_per_spad;     // drop results below this SigPerSPAD in kcps, 0=off (default: 0)
+    uint16_t max_step_mm;             // drop single jumps larger than this, 0=off (default: 0)
+    uint8_t median_window;            // 0-8 samples, 0 or 1=off (default: 0)
+    uint8_t average_window;           // 0-8 samples, 0 or 1=off (default: 0)
+    uint8_t ema_alpha;                // weight of a new sample in 1/256, 0=off (default: 0)
+    uint16_t switch_point_mm;         // switch bit set at or below, 0=off (default: 0)
+    uint16_t switch_hysteresis_mm;    // switch bit clears above switch point + this (default: 10)
 } vl53l1x_config_t;
 
 /**
@@ -75,6 +88,17 @@ void vl53l1x_config_get_defaults(vl53l1x_config_t *config);
  */
 bool vl53l1x_config_validate(const vl53l1x_config_t *config);
 
+/**
+ * @brief Time between two ranging results of a sensor running with config
+ * 
+ * The sensor starts a ranging every inter-measurement period, or right after
+ * the previous one if the timing budget is longer.
+ * 
+ * @param config Pointer to configuration structure
+ * @return Ranging period in ms
+ */
+uint32_t vl53l1x_config_period_ms(const vl53l1x_config_t *config);
+
 #ifdef __cplusplus
 }
 #endif
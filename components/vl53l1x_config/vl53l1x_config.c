@@ -2,6 +2,7 @@
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "esp_log.h"
+#include <stddef.h>
 #include <string.h>
 
 static const char *TAG = "vl53l1x_config";
@@ -31,6 +32,7 @@ void vl53l1x_config_get_defaults(vl53l1x_config_t *config)
     config->threshold_window = 0;           // Disabled
     config->interrupt_polarity = 1;         // Active high
     config->i2c_address = 0x29;            // Default address
+    config->switch_hysteresis_mm = 10;      // Processing pipeline off
 }
 
 bool vl53l1x_config_validate(const vl53l1x_config_t *config)
@@ -58,6 +60,10 @@ bool vl53l1x_config_validate(const vl53l1x_config_t *config)
         ESP_LOGE(TAG, "Invalid timing_budget_ms: %d", config->timing_budget_ms);
         return false;
     }
+    if (config->timing_budget_ms == 15 && config->distance_mode != 1) {
+        ESP_LOGE(TAG, "timing_budget_ms 15 needs SHORT distance_mode");
+        return false;
+    }
     
     // Validate inter_measurement_ms
     if (config->inter_measurement_ms < config->timing_budget_ms) {
@@ -109,6 +115,23 @@ bool vl53l1x_config_validate(const vl53l1x_config_t *config)
         return false;
     }
     
+    // Validate processing pipeline
+    if (config->reject_invalid_status > 1) {
+        ESP_LOGE(TAG, "Invalid reject_invalid_status: %d (must be 0 or 1)", config->reject_invalid_status);
+        return false;
+    }
+    if (config->median_window > VL53L1X_CONFIG_FILTER_WINDOW_MAX ||
+        config->average_window > VL53L1X_CONFIG_FILTER_WINDOW_MAX) {
+        ESP_LOGE(TAG, "Invalid median_window %d / average_window %d (must be 0-%d)",
+                 config->median_window, config->average_window, VL53L1X_CONFIG_FILTER_WINDOW_MAX);
+        return false;
+    }
+    if (config->switch_point_mm > 4000 || config->switch_hysteresis_mm > 4000) {
+        ESP_LOGE(TAG, "Invalid switch_point_mm %d / switch_hysteresis_mm %d (must be 0-4000)",
+                 config->switch_point_mm, config->switch_hysteresis_mm);
+        return false;
+    }
+    
     // Validate i2c_address
     if (config->i2c_address < 0x29 || config->i2c_address > 0x7F) {
         ESP_LOGE(TAG, "Invalid i2c_address: 0x%02X (must be 0x29-0x7F)", config->i2c_address);
@@ -118,6 +141,14 @@ bool vl53l1x_config_validate(const vl53l1x_config_t *config)
     return true;
 }
 
+uint32_t vl53l1x_config_period_ms(const vl53l1x_config_t *config)
+{
+    if (config->inter_measurement_ms > config->timing_budget_ms) {
+        return config->inter_measurement_ms;
+    }
+    return config->timing_budget_ms;
+}
+
 bool vl53l1x_config_load(vl53l1x_config_t *config)
 {
     if (config == NULL) {
@@ -136,6 +167,8 @@ bool vl53l1x_config_load(vl53l1x_config_t *config)
         return false;
     }
     
+    // Fields missing from a shorter blob keep their defaults
+    vl53l1x_config_get_defaults(config);
     size_t required_size = sizeof(vl53l1x_config_t);
     err = nvs_get_blob(handle, NVS_KEY, config, &required_size);
     nvs_close(handle);
@@ -151,6 +184,16 @@ bool vl53l1x_config_load(vl53l1x_config_t *config)
         return false;
     }
     
+    // Saved by a firmware without the processing pipeline, leave it off
+    const size_t pipeline_offset = offsetof(vl53l1x_config_t, reject_invalid_status);
+    if (required_size >= pipeline_offset && required_size < sizeof(vl53l1x_config_t)) {
+        vl53l1x_config_t defaults;
+        vl53l1x_config_get_defaults(&defaults);
+        memcpy((uint8_t *)config + pipeline_offset, (const uint8_t *)&defaults + pipeline_offset,
+               sizeof(vl53l1x_config_t) - pipeline_offset);
+        required_size = sizeof(vl53l1x_config_t);
+    }
+    
     if (required_size != sizeof(vl53l1x_config_t)) {
         ESP_LOGW(TAG, "Configuration size mismatch (expected %zu, got %zu), using defaults",
                  sizeof(vl53l1x_config_t), required_size);
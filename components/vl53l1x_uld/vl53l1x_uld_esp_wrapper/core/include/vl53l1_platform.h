@@ -19,7 +19,9 @@
 #define _VL53L1_PLATFORM_H_
 
 #include "vl53l1_types.h"
+#ifdef ESP_PLATFORM
 #include "i2c_handler.h"
+#endif
 
 #ifdef __cplusplus
 extern "C"
@@ -106,6 +108,8 @@ extern "C"
 	typedef int8_t (*vl53l1x_read_byte)(uint16_t dev, uint16_t index, uint8_t *pdata);
 	typedef int8_t (*vl53l1x_read_word)(uint16_t dev, uint16_t index, uint16_t *pdata);
 	typedef int8_t (*vl53l1x_read_dword)(uint16_t dev, uint16_t index, uint32_t *pdata);
+	/** Sends buffered writes, optional (NULL if writes are never buffered) */
+	typedef int8_t (*vl53l1x_flush)(void);
 
 	extern vl53l1x_write_multi g_vl53l1x_write_multi_ptr;
 	extern vl53l1x_read_multi g_vl53l1x_read_multi_ptr;
@@ -115,6 +119,7 @@ extern "C"
 	extern vl53l1x_read_byte g_vl53l1x_read_byte_ptr;
 	extern vl53l1x_read_word g_vl53l1x_read_word_ptr;
 	extern vl53l1x_read_dword g_vl53l1x_read_dword_ptr;
+	extern vl53l1x_flush g_vl53l1x_flush_ptr;
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,403 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "vl53l1_platform_mock.h"
+
+#include <errno.h>
+#include <time.h>
+
+#include "VL53L1X_api.h"
+
+#define MOCK_ERROR 255
+#define MOCK_REGISTER_SPACE 0x0200
+
+// Oscillator calibration that makes the default configuration range every ~100 ms
+#define MOCK_OSC_CALIBRATE_VAL 0x0025
+
+#define RESULT__STREAM_COUNT 0x008B
+
+typedef struct
+{
+    bool present;
+    bool shutdown;
+    uint8_t address;
+    bool ranging;
+    bool pending;            // result ready and not cleared, GPIO1 asserted
+    uint16_t distance_mm;
+    uint32_t period_override_us;
+    int64_t next_ready_us;
+    uint8_t regs[MOCK_REGISTER_SPACE];
+    VL53L1_MockStats_t stats;
+} mock_sensor_t;
+
+static mock_sensor_t s_sensors[VL53L1_MOCK_MAX_DEVICES];
+static bool s_initialized = false;
+
+int64_t VL53L1_MockNowUs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static void power_on(mock_sensor_t *sensor)
+{
+    memset(sensor->regs, 0, sizeof(sensor->regs));
+    sensor->address = VL53L1_MOCK_DEFAULT_ADDRESS;
+    sensor->ranging = false;
+    sensor->pending = false;
+
+    sensor->regs[VL53L1_I2C_SLAVE__DEVICE_ADDRESS] = VL53L1_MOCK_DEFAULT_ADDRESS;
+    sensor->regs[VL53L1_FIRMWARE__SYSTEM_STATUS] = 0x01; // booted
+    sensor->regs[VL53L1_IDENTIFICATION__MODEL_ID] = 0xEA;
+    sensor->regs[VL53L1_IDENTIFICATION__MODEL_ID + 1] = 0xCC;
+    sensor->regs[VL53L1_RESULT__OSC_CALIBRATE_VAL] = MOCK_OSC_CALIBRATE_VAL >> 8;
+    sensor->regs[VL53L1_RESULT__OSC_CALIBRATE_VAL + 1] = MOCK_OSC_CALIBRATE_VAL & 0xFF;
+    sensor->regs[GPIO_HV_MUX__CTRL] = 0x01; // active high
+}
+
+static void reset_sensors(uint8_t count)
+{
+    for (uint8_t i = 0; i < VL53L1_MOCK_MAX_DEVICES; i++)
+    {
+        mock_sensor_t *sensor = &s_sensors[i];
+        power_on(sensor);
+        sensor->present = i < count;
+        sensor->shutdown = false;
+        sensor->distance_mm = 1000;
+        sensor->period_override_us = 0;
+        memset(&sensor->stats, 0, sizeof(sensor->stats));
+    }
+    s_initialized = true;
+}
+
+static void ensure_initialized(void)
+{
+    if (!s_initialized)
+    {
+        reset_sensors(1);
+    }
+}
+
+void VL53L1_MockReset(uint8_t count)
+{
+    reset_sensors(count < VL53L1_MOCK_MAX_DEVICES ? count : VL53L1_MOCK_MAX_DEVICES);
+}
+
+void VL53L1_MockSetShutdown(uint8_t index, bool shutdown)
+{
+    ensure_initialized();
+    if (index >= VL53L1_MOCK_MAX_DEVICES)
+    {
+        return;
+    }
+    mock_sensor_t *sensor = &s_sensors[index];
+    if (sensor->shutdown && !shutdown)
+    {
+        power_on(sensor);
+    }
+    sensor->present = true;
+    sensor->shutdown = shutdown;
+}
+
+void VL53L1_MockSetDistance(uint8_t index, uint16_t distance_mm)
+{
+    ensure_initialized();
+    if (index < VL53L1_MOCK_MAX_DEVICES)
+    {
+        s_sensors[index].distance_mm = distance_mm;
+    }
+}
+
+void VL53L1_MockSetPeriodUs(uint8_t index, uint32_t period_us)
+{
+    ensure_initialized();
+    if (index < VL53L1_MOCK_MAX_DEVICES)
+    {
+        s_sensors[index].period_override_us = period_us;
+    }
+}
+
+uint8_t VL53L1_MockGetAddress(uint8_t index)
+{
+    ensure_initialized();
+    return index < VL53L1_MOCK_MAX_DEVICES ? s_sensors[index].address : 0;
+}
+
+void VL53L1_MockGetStats(uint8_t index, VL53L1_MockStats_t *stats)
+{
+    ensure_initialized();
+    if (index < VL53L1_MOCK_MAX_DEVICES && stats)
+    {
+        *stats = s_sensors[index].stats;
+    }
+}
+
+static bool responds(const mock_sensor_t *sensor, uint16_t dev)
+{
+    return sensor->present && !sensor->shutdown && sensor->address == (dev & 0x7F);
+}
+
+static uint16_t reg_word(const mock_sensor_t *sensor, uint16_t index)
+{
+    return (uint16_t)(sensor->regs[index] << 8 | sensor->regs[index + 1]);
+}
+
+static void set_reg_word(mock_sensor_t *sensor, uint16_t index, uint16_t value)
+{
+    sensor->regs[index] = value >> 8;
+    sensor->regs[index + 1] = value & 0xFF;
+}
+
+// Same conversion as VL53L1X_GetInterMeasurementInMs
+static int64_t period_us(const mock_sensor_t *sensor)
+{
+    if (sensor->period_override_us > 0)
+    {
+        return sensor->period_override_us;
+    }
+
+    const uint32_t inter_measurement =
+        (uint32_t)sensor->regs[VL53L1_SYSTEM__INTERMEASUREMENT_PERIOD] << 24 |
+        (uint32_t)sensor->regs[VL53L1_SYSTEM__INTERMEASUREMENT_PERIOD + 1] << 16 |
+        (uint32_t)sensor->regs[VL53L1_SYSTEM__INTERMEASUREMENT_PERIOD + 2] << 8 |
+        sensor->regs[VL53L1_SYSTEM__INTERMEASUREMENT_PERIOD + 3];
+    const uint16_t clock_pll = reg_word(sensor, VL53L1_RESULT__OSC_CALIBRATE_VAL) & 0x3FF;
+    const int64_t period = clock_pll > 0 ? (int64_t)(inter_measurement * 1000.0 / (clock_pll * 1.075)) : 0;
+    return period > 0 ? period : 100000;
+}
+
+// Completes the ranging in progress if its period has elapsed
+static void update(mock_sensor_t *sensor, int64_t now_us)
+{
+    if (!sensor->ranging || sensor->pending || now_us < sensor->next_ready_us)
+    {
+        return;
+    }
+
+    sensor->pending = true;
+    sensor->stats.results++;
+    sensor->stats.last_ready_us = sensor->next_ready_us;
+
+    sensor->regs[VL53L1_RESULT__RANGE_STATUS] = 9; // range valid
+    sensor->regs[RESULT__STREAM_COUNT] = (uint8_t)sensor->stats.results;
+    set_reg_word(sensor, VL53L1_RESULT__DSS_ACTUAL_EFFECTIVE_SPADS_SD0, 32 << 8);
+    set_reg_word(sensor, RESULT__AMBIENT_COUNT_RATE_MCPS_SD, 16);
+    set_reg_word(sensor, VL53L1_RESULT__FINAL_CROSSTALK_CORRECTED_RANGE_MM_SD0, sensor->distance_mm);
+    set_reg_word(sensor, VL53L1_RESULT__PEAK_SIGNAL_COUNT_RATE_CROSSTALK_CORRECTED_MCPS_SD0, 0x0100);
+}
+
+// The next ranging starts on the period grid once the result is cleared
+static void clear_result(mock_sensor_t *sensor, int64_t now_us)
+{
+    if (!sensor->pending)
+    {
+        return;
+    }
+
+    const int64_t period = period_us(sensor);
+    const int64_t lost = (now_us - sensor->stats.last_ready_us) / period;
+    sensor->stats.overruns += (uint32_t)lost;
+    sensor->next_ready_us = sensor->stats.last_ready_us + (lost + 1) * period;
+    sensor->pending = false;
+}
+
+static void write_reg(mock_sensor_t *sensor, uint16_t index, uint8_t value, int64_t now_us)
+{
+    sensor->regs[index] = value;
+
+    switch (index)
+    {
+    case VL53L1_I2C_SLAVE__DEVICE_ADDRESS:
+        sensor->address = value & 0x7F;
+        break;
+    case SYSTEM__INTERRUPT_CLEAR:
+        if (value & 0x01)
+        {
+            clear_result(sensor, now_us);
+        }
+        break;
+    case SYSTEM__MODE_START:
+        sensor->pending = false;
+        sensor->ranging = (value & 0x40) != 0;
+        sensor->next_ready_us = now_us + period_us(sensor);
+        break;
+    default:
+        break;
+    }
+}
+
+static uint8_t read_reg(const mock_sensor_t *sensor, uint16_t index)
+{
+    if (index == GPIO__TIO_HV_STATUS)
+    {
+        const uint8_t active_high = !(sensor->regs[GPIO_HV_MUX__CTRL] & 0x10);
+        const uint8_t level = sensor->pending ? active_high : !active_high;
+        return (sensor->regs[index] & ~0x01) | level;
+    }
+    return sensor->regs[index];
+}
+
+int8_t VL53L1_WriteMulti(uint16_t dev, uint16_t index, uint8_t *pdata, uint32_t count)
+{
+    ensure_initialized();
+    if ((uint32_t)index + count > MOCK_REGISTER_SPACE)
+    {
+        return MOCK_ERROR;
+    }
+
+    // every sensor at the address receives a write, as on a shared bus
+    mock_sensor_t *targets[VL53L1_MOCK_MAX_DEVICES];
+    uint8_t target_count = 0;
+    for (uint8_t i = 0; i < VL53L1_MOCK_MAX_DEVICES; i++)
+    {
+        if (responds(&s_sensors[i], dev))
+        {
+            targets[target_count++] = &s_sensors[i];
+        }
+    }
+    if (target_count == 0)
+    {
+        return MOCK_ERROR; // NACK
+    }
+
+    const int64_t now_us = VL53L1_MockNowUs();
+    for (uint8_t t = 0; t < target_count; t++)
+    {
+        mock_sensor_t *sensor = targets[t];
+        sensor->stats.transactions++;
+        sensor->stats.bytes += count;
+        update(sensor, now_us);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            write_reg(sensor, index + i, pdata[i], now_us);
+        }
+    }
+    return 0;
+}
+
+int8_t VL53L1_ReadMulti(uint16_t dev, uint16_t index, uint8_t *pdata, uint32_t count)
+{
+    ensure_initialized();
+    if ((uint32_t)index + count > MOCK_REGISTER_SPACE)
+    {
+        return MOCK_ERROR;
+    }
+
+    for (uint8_t i = 0; i < VL53L1_MOCK_MAX_DEVICES; i++)
+    {
+        mock_sensor_t *sensor = &s_sensors[i];
+        if (!responds(sensor, dev))
+        {
+            continue;
+        }
+        sensor->stats.transactions++;
+        sensor->stats.bytes += count;
+        update(sensor, VL53L1_MockNowUs());
+        for (uint32_t j = 0; j < count; j++)
+        {
+            pdata[j] = read_reg(sensor, index + j);
+        }
+        return 0;
+    }
+    return MOCK_ERROR; // NACK
+}
+
+int8_t VL53L1_WrByte(uint16_t dev, uint16_t index, uint8_t data)
+{
+    return VL53L1_WriteMulti(dev, index, &data, 1);
+}
+
+int8_t VL53L1_WrWord(uint16_t dev, uint16_t index, uint16_t data)
+{
+    uint8_t buffer[2] = {data >> 8, data & 0xFF};
+    return VL53L1_WriteMulti(dev, index, buffer, sizeof(buffer));
+}
+
+int8_t VL53L1_WrDWord(uint16_t dev, uint16_t index, uint32_t data)
+{
+    uint8_t buffer[4] = {data >> 24, (data >> 16) & 0xFF, (data >> 8) & 0xFF, data & 0xFF};
+    return VL53L1_WriteMulti(dev, index, buffer, sizeof(buffer));
+}
+
+int8_t VL53L1_RdByte(uint16_t dev, uint16_t index, uint8_t *data)
+{
+    return VL53L1_ReadMulti(dev, index, data, 1);
+}
+
+int8_t VL53L1_RdWord(uint16_t dev, uint16_t index, uint16_t *data)
+{
+    uint8_t buffer[2];
+    int8_t status = VL53L1_ReadMulti(dev, index, buffer, sizeof(buffer));
+    if (status == 0)
+    {
+        *data = (uint16_t)(buffer[0] << 8 | buffer[1]);
+    }
+    return status;
+}
+
+int8_t VL53L1_RdDWord(uint16_t dev, uint16_t index, uint32_t *data)
+{
+    uint8_t buffer[4];
+    int8_t status = VL53L1_ReadMulti(dev, index, buffer, sizeof(buffer));
+    if (status == 0)
+    {
+        *data = (uint32_t)buffer[0] << 24 | (uint32_t)buffer[1] << 16 |
+                (uint32_t)buffer[2] << 8 | buffer[3];
+    }
+    return status;
+}
+
+static void sleep_until_us(int64_t deadline_us)
+{
+    struct timespec deadline = {
+        .tv_sec = deadline_us / 1000000,
+        .tv_nsec = (deadline_us % 1000000) * 1000,
+    };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR)
+    {
+    }
+}
+
+int8_t VL53L1_WaitMs(uint16_t dev, int32_t wait_ms)
+{
+    (void)dev;
+    sleep_until_us(VL53L1_MockNowUs() + (int64_t)wait_ms * 1000);
+    return 0;
+}
+
+bool VL53L1_MockWaitGpio1(uint16_t dev, int64_t timeout_us, int64_t *ready_us)
+{
+    ensure_initialized();
+    mock_sensor_t *sensor = NULL;
+    for (uint8_t i = 0; i < VL53L1_MOCK_MAX_DEVICES && !sensor; i++)
+    {
+        if (responds(&s_sensors[i], dev))
+        {
+            sensor = &s_sensors[i];
+        }
+    }
+    if (!sensor || !sensor->ranging)
+    {
+        return false;
+    }
+
+    const int64_t deadline_us = VL53L1_MockNowUs() + timeout_us;
+    while (true)
+    {
+        const int64_t now_us = VL53L1_MockNowUs();
+        update(sensor, now_us);
+        if (sensor->pending)
+        {
+            if (ready_us)
+            {
+                *ready_us = sensor->stats.last_ready_us;
+            }
+            return true;
+        }
+        if (now_us >= deadline_us)
+        {
+            return false;
+        }
+        sleep_until_us(sensor->next_ready_us < deadline_us ? sensor->next_ready_us : deadline_us);
+    }
+}
@@ -0,0 +1,92 @@
+/**
+ * @file  vl53l1_platform_mock.h
+ * @brief Host replacement of vl53l1_platform.c backed by simulated sensors
+ *
+ * Linking vl53l1_platform_mock.c instead of vl53l1_platform.c runs the
+ * unmodified ULD (VL53L1X_api.c, VL53L1X_calibration.c) on a Linux host.
+ * Each simulated sensor has a register file and produces a ranging result
+ * every inter-measurement period once ranging is started:
+ *
+ * - GPIO__TIO_HV_STATUS reports data ready with the configured polarity until
+ *   SYSTEM__INTERRUPT_CLEAR is written, like GPIO1.
+ * - Ranging is held while a result is not cleared, periods that pass in the
+ *   meantime are counted as overruns.
+ * - Writing VL53L1_I2C_SLAVE__DEVICE_ADDRESS moves the sensor to the new
+ *   address, a sensor held in shutdown does not answer.
+ *
+ * Devices are addressed like the ESP wrapper does, the low byte of dev is the
+ * 7 bit I2C address. Time is CLOCK_MONOTONIC. Not thread safe.
+ */
+
+#ifndef _VL53L1_PLATFORM_MOCK_H_
+#define _VL53L1_PLATFORM_MOCK_H_
+
+#include <stdbool.h>
+
+#include "vl53l1_platform.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/** @brief Number of simulated sensors on the bus */
+#define VL53L1_MOCK_MAX_DEVICES 8
+
+/** @brief I2C address of a sensor after reset */
+#define VL53L1_MOCK_DEFAULT_ADDRESS 0x29
+
+/** @brief Access counters and result history of a simulated sensor */
+typedef struct
+{
+    uint32_t transactions;       /**< I2C transactions addressed to the sensor */
+    uint32_t bytes;              /**< register bytes transferred */
+    uint32_t results;            /**< ranging results produced */
+    uint32_t overruns;           /**< periods lost to an uncleared result */
+    int64_t last_ready_us;       /**< time the last result became ready */
+} VL53L1_MockStats_t;
+
+/** @brief Resets the bus to count sensors in power on state at the default
+ *  address, out of shutdown, with statistics cleared
+ *
+ * Until the first call the bus holds a single sensor.
+ */
+void VL53L1_MockReset(uint8_t count);
+
+/** @brief Holds a sensor in shutdown (XSHUT low) or releases it
+ *
+ * Releasing the sensor resets it to power on state at the default address.
+ */
+void VL53L1_MockSetShutdown(uint8_t index, bool shutdown);
+
+/** @brief Distance reported by a sensor, defaults to 1000 mm */
+void VL53L1_MockSetDistance(uint8_t index, uint16_t distance_mm);
+
+/** @brief Overrides the inter-measurement period of a sensor, 0 derives it
+ *  from the inter-measurement register */
+void VL53L1_MockSetPeriodUs(uint8_t index, uint32_t period_us);
+
+/** @brief Current I2C address of a sensor */
+uint8_t VL53L1_MockGetAddress(uint8_t index);
+
+/** @brief Access counters and result history of a sensor */
+void VL53L1_MockGetStats(uint8_t index, VL53L1_MockStats_t *stats);
+
+/** @brief Blocks until GPIO1 of the sensor at dev signals data ready,
+ *  standing in for the interrupt of the target
+ *
+ * @param dev        Device as passed to the ULD
+ * @param timeout_us Maximum time to wait
+ * @param ready_us   Time the pending result became ready, may be NULL
+ * @return true if a result is ready, false on timeout or if not ranging
+ */
+bool VL53L1_MockWaitGpio1(uint16_t dev, int64_t timeout_us, int64_t *ready_us);
+
+/** @brief CLOCK_MONOTONIC in microseconds, the time base of the mock */
+int64_t VL53L1_MockNowUs(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
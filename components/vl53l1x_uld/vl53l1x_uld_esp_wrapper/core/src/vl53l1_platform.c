@@ -107,8 +107,15 @@ int8_t VL53L1_RdDWord(uint16_t dev, uint16_t index, uint32_t *data)
 
 int8_t VL53L1_WaitMs(uint16_t dev, int32_t wait_ms)
 {
+	// a write the sensor has to act on during the wait must not sit in a batch
+	int8_t status = 0;
+	if (g_vl53l1x_flush_ptr != NULL)
+	{
+		status = g_vl53l1x_flush_ptr();
+	}
+
 	vTaskDelay(pdMS_TO_TICKS(wait_ms));
-	return 0;
+	return status;
 }
 
 vl53l1x_write_multi g_vl53l1x_write_multi_ptr = NULL;
@@ -118,4 +125,5 @@ vl53l1x_write_word g_vl53l1x_write_word_ptr = NULL;
 vl53l1x_write_dword g_vl53l1x_write_dword_ptr = NULL;
 vl53l1x_read_byte g_vl53l1x_read_byte_ptr = NULL;
 vl53l1x_read_word g_vl53l1x_read_word_ptr = NULL;
-vl53l1x_read_dword g_vl53l1x_read_dword_ptr = NULL;
\ No newline at end of file
+vl53l1x_read_dword g_vl53l1x_read_dword_ptr = NULL;
+vl53l1x_flush g_vl53l1x_flush_ptr = NULL;
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include "driver/i2c_master.h"
 #include "vl53l1x_types.h"
 
+// Longest register write sent as one transaction
+#define I2C_BURST_MAX_BYTES 128
+
 bool i2c_master_init(vl53l1x_i2c_handle_t *i2c_handle);
 bool i2c_add_device(vl53l1x_device_handle_t *device);
 bool i2c_update_address(const uint16_t dev, const uint8_t new_address);
@@ -22,4 +25,16 @@ int8_t i2c_write_byte(uint16_t dev, uint16_t index, uint8_t data);
 int8_t i2c_read_byte(uint16_t dev, uint16_t index, uint8_t *pdata);
 int8_t i2c_read_word(uint16_t dev, uint16_t index, uint16_t *pdata);
 int8_t i2c_read_dword(uint16_t dev, uint16_t index, uint32_t *pdata);
+
+// Write batching: between i2c_batch_begin and i2c_batch_end the register
+// writes of the calling task are buffered and each run of contiguous
+// registers goes out as one burst. A read, a write to another device or a
+// non-contiguous register, i2c_batch_flush or i2c_batch_end sends the
+// buffered bytes first, so the sensor sees the writes in order. Batches
+// nest, and one task batches at a time, others block in i2c_batch_begin.
+// Writes of tasks outside the batch go out immediately.
+void i2c_batch_begin(void);
+int8_t i2c_batch_flush(void);
+// Returns the first error of the batch, 0 if all writes went out
+int8_t i2c_batch_end(void);
 #endif
\ No newline at end of file
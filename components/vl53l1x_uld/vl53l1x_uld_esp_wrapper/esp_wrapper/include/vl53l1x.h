@@ -4,6 +4,7 @@
 #include "driver/gpio.h"
 #include "i2c_handler.h"
 #include "vl53l1x_types.h"
+#include "VL53L1X_api.h"
 
 typedef enum
 {
@@ -11,6 +12,14 @@ typedef enum
     LONG = 2,  // <4m
 } distance_mode;
 
+// One ranging result, stamped when the sensor signalled it ready
+typedef struct
+{
+    VL53L1X_Result_t result;
+    uint32_t sequence;    // number of the result since acquisition started, from 1
+    int64_t timestamp_us; // esp_timer time the result became ready
+} vl53l1x_sample_t;
+
 bool vl53l1x_init(vl53l1x_handle_t *vl53l1x_handle);
 bool vl53l1x_add_device(vl53l1x_device_handle_t *device);
 bool vl53l1x_update_device_address(vl53l1x_device_handle_t *device, uint8_t new_address);
@@ -30,4 +39,19 @@ void vl53l1x_log_signal_rate(const vl53l1x_device_handle_t *device);
 
 bool vl53l1x_apply_config(vl53l1x_device_handle_t *device, const void *config);
 
+// Data ready acquisition: with device->interrupt_gpio set, results are
+// signalled by the GPIO1 interrupt, otherwise the data ready flag is polled
+// every poll_period_ms. Call after vl53l1x_add_device.
+bool vl53l1x_start_acquisition(vl53l1x_device_handle_t *device, uint32_t poll_period_ms);
+void vl53l1x_stop_acquisition(vl53l1x_device_handle_t *device);
+
+// Waits up to timeout_ms for the next ranging result, reads and clears it.
+// Returns false on timeout or I2C error.
+bool vl53l1x_read_sample(vl53l1x_device_handle_t *device, uint32_t timeout_ms, vl53l1x_sample_t *sample);
+
+// Reads and clears the pending ranging result without waiting, one I2C read
+// when none is pending. Sets *ready if sample holds a new result, returns
+// false on I2C error. For callers that service several sensors on one bus.
+bool vl53l1x_poll_sample(vl53l1x_device_handle_t *device, vl53l1x_sample_t *sample, bool *ready);
+
 #endif
\ No newline at end of file
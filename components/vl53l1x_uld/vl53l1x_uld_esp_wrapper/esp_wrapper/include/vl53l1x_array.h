@@ -0,0 +1,131 @@
+#ifndef VL53L1X_ARRAY_H
+#define VL53L1X_ARRAY_H
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "vl53l1x.h"
+
+// Sensors an array can hold, one address each from VL53L1X_ARRAY_BASE_ADDRESS
+#define VL53L1X_ARRAY_MAX_SENSORS 8
+#define VL53L1X_ARRAY_BASE_ADDRESS 0x30
+
+// Time all sensors are held in shutdown before the first one is released
+#define VL53L1X_ARRAY_RESET_MS 10
+
+// Jobs waiting for the array task, and the data each one carries
+#define VL53L1X_ARRAY_JOB_QUEUE_LEN 4
+#define VL53L1X_ARRAY_JOB_DATA_SIZE 64
+
+// Without result_timeout_ms, a sensor times out after this many of its
+// ranging periods plus the margin
+#define VL53L1X_ARRAY_TIMEOUT_PERIODS 2
+#define VL53L1X_ARRAY_TIMEOUT_MARGIN_MS 10
+
+// Polling a continuously ranging sensor resumes period / this divisor plus a
+// poll period before its next result is due
+#define VL53L1X_ARRAY_POLL_EARLY_DIV 8
+
+// Time the achieved sample rate is averaged over
+#define VL53L1X_ARRAY_RATE_WINDOW_MS 1000
+
+typedef struct
+{
+    vl53l1x_handle_t *vl53l1x_handle;
+    uint8_t count;
+    // XSHUT of every sensor, only a single sensor may have none (GPIO_NUM_NC)
+    gpio_num_t xshut_gpio[VL53L1X_ARRAY_MAX_SENSORS];
+    // GPIO1 of the sensors, GPIO_NUM_NC to poll. Several sensors share the
+    // line wired-OR (GPIO1 is open drain), which needs active low polarity.
+    gpio_num_t interrupt_gpio;
+    // Sensors i and j range at the same time if i % groups == j % groups.
+    // 0 or count ranges one sensor at a time, 1 ranges all continuously.
+    uint8_t groups;
+    uint32_t poll_period_ms;    // data ready poll period without interrupt
+    // Longest wait for the result of a sensor, 0 derives it from the ranging
+    // period the sensor was last configured with
+    uint32_t result_timeout_ms;
+} vl53l1x_array_config_t;
+
+typedef struct
+{
+    vl53l1x_device_handle_t device;
+    bool present;       // booted, initialized and at its own address
+    int64_t due_us;     // result expected before this time
+    int64_t early_us;   // no result before this time, polling waits for it
+    bool pending;       // result of the current group not read yet
+    uint32_t timeouts;  // results missing after result_timeout_ms
+    uint32_t errors;    // I2C errors while reading results
+
+    // sample rate, see vl53l1x_array_get_stats
+    uint32_t samples;
+    uint32_t missed;
+    int64_t last_sample_us;  // 0 after a timeout, the gap is not counted as missed
+    int64_t window_us;       // start of the rate window
+    uint32_t window_samples;
+    uint32_t rate_millihz;
+} vl53l1x_array_sensor_t;
+
+typedef struct
+{
+    uint32_t period_ms;    // ranging period of the applied configuration
+    uint32_t rate_millihz; // results read per 1000 s over the last rate window
+    uint32_t samples;      // results read
+    // Results a continuously ranging sensor completed but the next one
+    // replaced before they were read. Groups that take turns read one result
+    // per turn and only miss it as a timeout.
+    uint32_t missed;
+    uint32_t timeouts;
+    uint32_t errors;
+} vl53l1x_array_stats_t;
+
+typedef struct
+{
+    vl53l1x_array_config_t config;
+    vl53l1x_array_sensor_t sensors[VL53L1X_ARRAY_MAX_SENSORS];
+    uint8_t present;        // sensors that came up
+    uint8_t group;          // group ranging now
+    bool group_started;
+    bool interrupt;         // interrupt_gpio wakes the task
+    TaskHandle_t task;      // task servicing the array, notified by GPIO1
+    QueueHandle_t jobs;     // vl53l1x_array_submit to the array task
+} vl53l1x_array_t;
+
+// Called for every result read, and with sample NULL for a sensor that gave
+// no result within result_timeout_ms or failed to read it
+typedef void (*vl53l1x_array_sample_cb_t)(uint8_t index, const vl53l1x_sample_t *sample, void *arg);
+
+// Run by the array task on every sensor that came up, with its register
+// writes batched. Must leave the sensor ranging, vl53l1x_apply_config is one.
+typedef bool (*vl53l1x_array_job_fn_t)(vl53l1x_device_handle_t *device, const void *data);
+
+// Brings the sensors up one at a time: all are held in shutdown, then each
+// one is released, initialized at the default address and moved to
+// VL53L1X_ARRAY_BASE_ADDRESS + index before the next one boots. A single
+// sensor stays at the default address. Sensors that fail stay in shutdown. Call from the task that services the array, after
+// vl53l1x_init. Returns false if no sensor came up.
+bool vl53l1x_array_init(vl53l1x_array_t *array, const vl53l1x_array_config_t *config);
+
+// Reads the results of the ranging group and waits for GPIO1 or the next
+// poll period if none is pending. Without the interrupt, polling pauses
+// until shortly before the next result of a sensor is due. Once every sensor of the group delivered
+// a result or timed out, the group is stopped and the next one started, so
+// only sensors of one group emit at a time. Call in a loop from the task
+// that called vl53l1x_array_init.
+void vl53l1x_array_service(vl53l1x_array_t *array, vl53l1x_array_sample_cb_t callback, void *arg);
+
+// Queues job for the task servicing the array, which runs it before the
+// next sweep and restarts the ranging group. size bytes of data are copied,
+// at most VL53L1X_ARRAY_JOB_DATA_SIZE. Returns without waiting for the job,
+// false if the queue is full. Call from any task once vl53l1x_array_init
+// returned true.
+bool vl53l1x_array_submit(vl53l1x_array_t *array, vl53l1x_array_job_fn_t job, const void *data, size_t size);
+
+// Copies the acquisition counters of sensor index, false if it did not come
+// up. Callable from any task, the counters are read without locking.
+bool vl53l1x_array_get_stats(const vl53l1x_array_t *array, uint8_t index, vl53l1x_array_stats_t *stats);
+
+// Device of sensor index, NULL if it did not come up
+vl53l1x_device_handle_t *vl53l1x_array_get_device(vl53l1x_array_t *array, uint8_t index);
+
+#endif
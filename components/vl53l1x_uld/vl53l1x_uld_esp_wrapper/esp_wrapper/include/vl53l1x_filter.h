@@ -0,0 +1,72 @@
+#ifndef VL53L1X_FILTER_H
+#define VL53L1X_FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "VL53L1X_api.h"
+#include "vl53l1x_config.h"
+
+// Consecutive jumps beyond max_step_mm taken as a real move of the target
+#define VL53L1X_FILTER_STEP_CONFIRM 3
+
+// Output flags
+#define VL53L1X_FILTER_FLAG_SWITCH 0x01   // distance at or below the switch point, with hysteresis
+#define VL53L1X_FILTER_FLAG_REJECTED 0x02 // this result was dropped, the output holds the last one
+#define VL53L1X_FILTER_FLAG_SETTLED 0x04  // median and average windows are full
+
+// Processing pipeline of one sensor. Every result runs through outlier
+// rejection, median, moving average and EMA in this order, stages that are
+// off pass it on. Distances are kept with 8 fraction bits, no floating point.
+typedef struct
+{
+    // settings, from vl53l1x_config_t
+    bool enabled;
+    bool reject_invalid_status;
+    uint16_t min_signal_per_spad;
+    uint16_t max_step_mm;
+    uint8_t median_window;
+    uint8_t average_window;
+    uint8_t ema_alpha;
+    uint16_t switch_point_mm;
+    uint16_t switch_hysteresis_mm;
+
+    // ring buffers of the accepted distances in mm
+    uint16_t median_ring[VL53L1X_CONFIG_FILTER_WINDOW_MAX];
+    uint8_t median_head;
+    uint8_t median_count;
+    uint16_t average_ring[VL53L1X_CONFIG_FILTER_WINDOW_MAX];
+    uint8_t average_head;
+    uint8_t average_count;
+    uint32_t average_sum;
+    uint32_t ema_q8;
+    bool ema_started;
+
+    bool have_output;
+    uint32_t output_q8;   // last output distance, mm * 256
+    int64_t output_us;    // time of the result behind it
+    int16_t rate_mm_s;
+    uint8_t step_count;   // consecutive jumps beyond max_step_mm
+    bool switch_on;
+    uint32_t rejected;
+} vl53l1x_filter_t;
+
+typedef struct
+{
+    uint16_t distance_mm; // 0 until the first result is accepted
+    int16_t rate_mm_s;    // positive while the target moves away
+    uint8_t flags;        // VL53L1X_FILTER_FLAG_*
+    uint32_t rejected;    // results dropped since vl53l1x_filter_init
+} vl53l1x_filter_output_t;
+
+// True if config turns on any stage
+bool vl53l1x_filter_enabled(const vl53l1x_config_t *config);
+
+// Takes the settings of config and starts over with empty buffers
+void vl53l1x_filter_init(vl53l1x_filter_t *filter, const vl53l1x_config_t *config);
+
+// Runs one result read at timestamp_us through the pipeline
+void vl53l1x_filter_update(vl53l1x_filter_t *filter, const VL53L1X_Result_t *result, int64_t timestamp_us,
+                           vl53l1x_filter_output_t *output);
+
+#endif
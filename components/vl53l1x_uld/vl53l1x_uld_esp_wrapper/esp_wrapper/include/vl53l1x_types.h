@@ -3,6 +3,8 @@
 
 #include "driver/gpio.h"
 #include "driver/i2c_master.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 typedef i2c_master_dev_handle_t dev_handle_t;
 
@@ -33,6 +35,15 @@ typedef struct
     uint16_t dev;
     // range mode
     // capture mode
+
+    // data ready acquisition, see vl53l1x_start_acquisition
+    SemaphoreHandle_t data_ready;    // given by the GPIO1 interrupt
+    volatile int64_t data_ready_us;  // esp_timer time of the last GPIO1 edge
+    uint32_t poll_period_ms;         // data ready poll period without interrupt
+    uint8_t interrupt_polarity;      // GPIO1 level of a pending result, read at start
+    uint32_t sample_count;           // results read since acquisition started
+    uint16_t timing_budget_ms;       // of the applied configuration
+    uint32_t ranging_period_ms;      // time between two results, see vl53l1x_config_period_ms
 } vl53l1x_device_handle_t;
 
 static const uint8_t VL53L1X_DEFAULT_I2C_ADDRESS = 0x29;
@@ -50,6 +61,13 @@ static const vl53l1x_device_handle_t VL53L1X_DEVICE_INIT = {
     .scl_speed_hz = 400000,
     .dev_handle = NULL,
     .dev = 0,
+    .data_ready = NULL,
+    .data_ready_us = 0,
+    .poll_period_ms = 2,
+    .interrupt_polarity = 1,
+    .sample_count = 0,
+    .timing_budget_ms = 100,
+    .ranging_period_ms = 100,
 };
 
 static const vl53l1x_i2c_handle_t VL53L1X_I2C_INIT = {
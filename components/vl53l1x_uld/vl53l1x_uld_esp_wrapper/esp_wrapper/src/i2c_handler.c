@@ -3,10 +3,25 @@
 #include "VL53L1X_api.h"
 #include <string.h>
 
+#include "freertos/task.h"
 #include "i2c_device_handler.h"
 
 static const char *TAG = "I2C_HANDLER";
 
+// Register writes of the batching task not sent yet
+typedef struct
+{
+    SemaphoreHandle_t lock;
+    TaskHandle_t owner;
+    uint8_t depth;
+    uint16_t dev;
+    uint32_t count;  // bytes buffered after the register address
+    int8_t status;   // first error since i2c_batch_begin
+    uint8_t buffer[2 + I2C_BURST_MAX_BYTES];
+} i2c_batch_t;
+
+static i2c_batch_t s_batch;
+
 bool i2c_master_init(vl53l1x_i2c_handle_t *i2c_handle)
 {
     i2c_master_bus_config_t bus_config = {
@@ -26,6 +41,15 @@ bool i2c_master_init(vl53l1x_i2c_handle_t *i2c_handle)
         return false;
     }
 
+    if (s_batch.lock == NULL)
+    {
+        s_batch.lock = xSemaphoreCreateMutex();
+        if (s_batch.lock == NULL)
+        {
+            ESP_LOGW(TAG, "no memory for write batching, writing registers one by one");
+        }
+    }
+
     i2c_handle->initialized = true;
     return true;
 }
@@ -137,6 +161,106 @@ bool i2c_read(const dev_handle_t *device, uint16_t reg, uint8_t *buf, size_t len
     return true;
 }
 
+static bool batching(void)
+{
+    return s_batch.owner != NULL && s_batch.owner == xTaskGetCurrentTaskHandle();
+}
+
+static int8_t transmit(dev_handle_t handle, uint8_t *buffer, uint32_t count)
+{
+    if (i2c_master_transmit(handle, buffer, 2 + count, 1000) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "I2C write multi failed at index 0x%02X%02X, count %lu", buffer[0], buffer[1], count);
+        return 255;
+    }
+    return 0;
+}
+
+void i2c_batch_begin(void)
+{
+    if (s_batch.lock == NULL)
+    {
+        return;
+    }
+    if (batching())
+    {
+        s_batch.depth++;
+        return;
+    }
+
+    xSemaphoreTake(s_batch.lock, portMAX_DELAY);
+    s_batch.owner = xTaskGetCurrentTaskHandle();
+    s_batch.depth = 1;
+    s_batch.count = 0;
+    s_batch.status = 0;
+}
+
+int8_t i2c_batch_flush(void)
+{
+    if (!batching() || s_batch.count == 0)
+    {
+        return 0;
+    }
+
+    int8_t status = 255;
+    dev_handle_t handle = get_device_handle(s_batch.dev);
+    if (handle != NULL)
+    {
+        status = transmit(handle, s_batch.buffer, s_batch.count);
+    }
+    s_batch.count = 0;
+    if (s_batch.status == 0)
+    {
+        s_batch.status = status;
+    }
+    return status;
+}
+
+int8_t i2c_batch_end(void)
+{
+    if (!batching())
+    {
+        return 0;
+    }
+
+    i2c_batch_flush();
+    int8_t status = s_batch.status;
+    if (--s_batch.depth == 0)
+    {
+        s_batch.owner = NULL;
+        xSemaphoreGive(s_batch.lock);
+    }
+    return status;
+}
+
+// Appends to the buffered run if the write continues it, otherwise sends
+// the run and starts a new one
+static int8_t batch_write(uint16_t dev, uint16_t index, uint8_t *pdata, uint32_t count)
+{
+    if (s_batch.count > 0)
+    {
+        uint16_t next = (((uint16_t)s_batch.buffer[0] << 8) | s_batch.buffer[1]) + s_batch.count;
+        if (dev != s_batch.dev || index != next || s_batch.count + count > I2C_BURST_MAX_BYTES)
+        {
+            int8_t status = i2c_batch_flush();
+            if (status != 0)
+            {
+                return status;
+            }
+        }
+    }
+
+    if (s_batch.count == 0)
+    {
+        s_batch.dev = dev;
+        s_batch.buffer[0] = (index >> 8) & 0xFF;
+        s_batch.buffer[1] = index & 0xFF;
+    }
+    memcpy(&s_batch.buffer[2 + s_batch.count], pdata, count);
+    s_batch.count += count;
+    return 0;
+}
+
 int8_t i2c_write_multi(uint16_t dev, uint16_t index, uint8_t *pdata, uint32_t count)
 {
     dev_handle_t handle = get_device_handle(dev);
@@ -146,24 +270,23 @@ int8_t i2c_write_multi(uint16_t dev, uint16_t index, uint8_t *pdata, uint32_t co
         return 255;
     }
 
-    uint8_t buffer[2 + 32];
-    if (count > 32)
+    if (count > I2C_BURST_MAX_BYTES)
     {
         ESP_LOGE(TAG, "i2c_write_multi: count %lu exceeds buffer size", count);
         return 255;
     }
-    
+
+    if (batching())
+    {
+        return batch_write(dev, index, pdata, count);
+    }
+
+    uint8_t buffer[2 + I2C_BURST_MAX_BYTES];
     buffer[0] = (index >> 8) & 0xFF;
     buffer[1] = index & 0xFF;
     memcpy(&buffer[2], pdata, count);
-    
-    if (i2c_master_transmit(handle, buffer, 2 + count, 1000) != ESP_OK)
-    {
-        ESP_LOGE(TAG, "I2C write multi failed at index 0x%04X, count %lu", index, count);
-        return 255;
-    }
 
-    return 0;
+    return transmit(handle, buffer, count);
 }
 
 int8_t i2c_read_multi(uint16_t dev, uint16_t index, uint8_t *pdata, uint32_t count)
@@ -175,6 +298,13 @@ int8_t i2c_read_multi(uint16_t dev, uint16_t index, uint8_t *pdata, uint32_t cou
         return 255;
     }
 
+    // the sensor must see buffered writes before the read
+    int8_t status = i2c_batch_flush();
+    if (status != 0)
+    {
+        return status;
+    }
+
     if (!i2c_read(&handle, index, pdata, count))
     {
         return 255;
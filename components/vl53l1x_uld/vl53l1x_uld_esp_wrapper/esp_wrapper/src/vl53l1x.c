@@ -5,6 +5,8 @@
 #include "VL53L1X_api.h"
 #include "VL53L1X_calibration.h"
 #include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
 
 #include "i2c_device_handler.h"
 #include "vl53l1x_config.h"
@@ -23,6 +25,7 @@ bool vl53l1x_init(vl53l1x_handle_t *vl53l1x_handle)
     g_vl53l1x_read_byte_ptr = i2c_read_byte;
     g_vl53l1x_read_word_ptr = i2c_read_word;
     g_vl53l1x_read_dword_ptr = i2c_read_dword;
+    g_vl53l1x_flush_ptr = i2c_batch_flush;
 
     // check if i2c is initialized
     if (!i2c_master_init(vl53l1x_handle->i2c_handle))
@@ -51,9 +54,13 @@ bool vl53l1x_add_device(vl53l1x_device_handle_t *device)
     wait_boot(device->dev);
     ESP_LOGI(TAG, "device booted");
 
+    // init and configuration write long runs of registers, send them as bursts
+    i2c_batch_begin();
+
     VL53L1X_ERROR init_status = VL53L1X_SensorInit(device->dev);
     if (init_status != 0)
     {
+        i2c_batch_end();
         ESP_LOGE(TAG, "device failed initialization with error code: 0x%02X", init_status);
         return false;
     }
@@ -82,6 +89,12 @@ bool vl53l1x_add_device(vl53l1x_device_handle_t *device)
     ESP_LOGI(TAG, "device ready");
     VL53L1X_StartRanging(device->dev);
 
+    if (i2c_batch_end() != 0)
+    {
+        ESP_LOGE(TAG, "device configuration writes failed");
+        return false;
+    }
+
     // log stuff after initialization success
     vl53l1x_log_sensor_id(device);
     vl53l1x_log_ambient_light(device);
@@ -105,6 +118,7 @@ bool vl53l1x_update_device_address(vl53l1x_device_handle_t *device, uint8_t new_
     }
 
     ESP_LOGI(TAG, "device address updated: 0x%02X->0x%02X", device->i2c_address, new_address);
+    device->i2c_address = new_address;
     device->dev = create_dev(get_port(device->dev), new_address);
 
     return true;
@@ -267,6 +281,8 @@ bool vl53l1x_apply_config(vl53l1x_device_handle_t *device, const void *config_pt
     VL53L1X_ERROR status;
     bool success = true;
 
+    i2c_batch_begin();
+
     // Stop ranging before configuration changes
     VL53L1X_StopRanging(device->dev);
 
@@ -352,6 +368,8 @@ bool vl53l1x_apply_config(vl53l1x_device_handle_t *device, const void *config_pt
         ESP_LOGE(TAG, "Failed to set interrupt polarity: %d", status);
         success = false;
     }
+    // data ready checks compare against the cached polarity
+    VL53L1X_GetInterruptPolarity(device->dev, &device->interrupt_polarity);
 
     // Restart ranging
     status = VL53L1X_StartRanging(device->dev);
@@ -360,13 +378,233 @@ bool vl53l1x_apply_config(vl53l1x_device_handle_t *device, const void *config_pt
         success = false;
     }
 
+    if (i2c_batch_end() != 0) {
+        ESP_LOGE(TAG, "Configuration writes failed");
+        success = false;
+    }
+
     if (success) {
-        ESP_LOGI(TAG, "Configuration applied successfully");
+        // the array derives its waits from the ranging period
+        device->timing_budget_ms = config->timing_budget_ms;
+        device->ranging_period_ms = vl53l1x_config_period_ms(config);
+        ESP_LOGI(TAG, "Configuration applied successfully, %lu ms ranging period",
+                 (unsigned long)device->ranging_period_ms);
     }
 
     return success;
 }
 
+static void IRAM_ATTR data_ready_isr(void *arg)
+{
+    vl53l1x_device_handle_t *device = (vl53l1x_device_handle_t *)arg;
+    BaseType_t higher_priority_task_woken = pdFALSE;
+
+    device->data_ready_us = esp_timer_get_time();
+    xSemaphoreGiveFromISR(device->data_ready, &higher_priority_task_woken);
+    if (higher_priority_task_woken == pdTRUE)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+bool vl53l1x_start_acquisition(vl53l1x_device_handle_t *device, uint32_t poll_period_ms)
+{
+    if (!device)
+    {
+        ESP_LOGE(TAG, "Invalid device handle for acquisition");
+        return false;
+    }
+
+    device->poll_period_ms = poll_period_ms > 0 ? poll_period_ms : 1;
+    device->sample_count = 0;
+
+    uint8_t polarity = 1;
+    if (VL53L1X_GetInterruptPolarity(device->dev, &polarity) != 0)
+    {
+        ESP_LOGE(TAG, "failed to read interrupt polarity");
+        return false;
+    }
+    device->interrupt_polarity = polarity;
+
+    if (device->interrupt_gpio == GPIO_NUM_NC)
+    {
+        ESP_LOGI(TAG, "polling data ready every %lu ms", (unsigned long)device->poll_period_ms);
+        return true;
+    }
+
+    if (device->data_ready == NULL)
+    {
+        device->data_ready = xSemaphoreCreateBinary();
+        if (device->data_ready == NULL)
+        {
+            ESP_LOGE(TAG, "failed to create data ready semaphore");
+            return false;
+        }
+    }
+
+    // GPIO1 is open drain, the pull-up covers boards without an external one
+    gpio_config_t io_config = {
+        .pin_bit_mask = 1ULL << device->interrupt_gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = polarity ? GPIO_INTR_POSEDGE : GPIO_INTR_NEGEDGE,
+    };
+    esp_err_t err = gpio_config(&io_config);
+    if (err == ESP_OK)
+    {
+        err = gpio_install_isr_service(0);
+        if (err == ESP_ERR_INVALID_STATE)
+        {
+            err = ESP_OK; // already installed by another driver
+        }
+    }
+    if (err == ESP_OK)
+    {
+        err = gpio_isr_handler_add(device->interrupt_gpio, data_ready_isr, device);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "data ready interrupt on GPIO%d failed (%s), polling instead",
+                 device->interrupt_gpio, esp_err_to_name(err));
+        device->interrupt_gpio = GPIO_NUM_NC;
+        return true;
+    }
+
+    // the edge of a result completed before the handler was added is lost
+    VL53L1X_ClearInterrupt(device->dev);
+    ESP_LOGI(TAG, "data ready interrupt on GPIO%d (active %s)",
+             device->interrupt_gpio, polarity ? "high" : "low");
+    return true;
+}
+
+void vl53l1x_stop_acquisition(vl53l1x_device_handle_t *device)
+{
+    if (!device || device->interrupt_gpio == GPIO_NUM_NC || device->data_ready == NULL)
+    {
+        return;
+    }
+
+    gpio_intr_disable(device->interrupt_gpio);
+    gpio_isr_handler_remove(device->interrupt_gpio);
+}
+
+// VL53L1X_CheckForDataReady without reading the polarity every time
+static bool check_data_ready(const vl53l1x_device_handle_t *device, uint8_t *ready)
+{
+    uint8_t status = 0;
+    if (VL53L1_RdByte(device->dev, GPIO__TIO_HV_STATUS, &status) != 0)
+    {
+        return false;
+    }
+    *ready = (status & 0x01) == device->interrupt_polarity;
+    return true;
+}
+
+static bool wait_data_ready(vl53l1x_device_handle_t *device, uint32_t timeout_ms, int64_t *ready_us)
+{
+    uint8_t ready = 0;
+
+    if (device->interrupt_gpio != GPIO_NUM_NC && device->data_ready != NULL)
+    {
+        if (xSemaphoreTake(device->data_ready, pdMS_TO_TICKS(timeout_ms)) == pdTRUE)
+        {
+            *ready_us = device->data_ready_us;
+            return true;
+        }
+        // no edge while a result was left uncleared, check the flag itself
+        if (check_data_ready(device, &ready) && ready)
+        {
+            *ready_us = esp_timer_get_time();
+            return true;
+        }
+        return false;
+    }
+
+    TickType_t poll_ticks = pdMS_TO_TICKS(device->poll_period_ms);
+    if (poll_ticks == 0)
+    {
+        poll_ticks = 1;
+    }
+    const int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    while (true)
+    {
+        if (!check_data_ready(device, &ready))
+        {
+            return false;
+        }
+        const int64_t now_us = esp_timer_get_time();
+        if (ready)
+        {
+            *ready_us = now_us;
+            return true;
+        }
+        if (now_us >= deadline_us)
+        {
+            return false;
+        }
+        vTaskDelay(poll_ticks);
+    }
+}
+
+static bool read_ready_sample(vl53l1x_device_handle_t *device, int64_t ready_us, vl53l1x_sample_t *sample)
+{
+    VL53L1X_ERROR status = VL53L1X_GetResult(device->dev, &sample->result);
+    // clear right away, the sensor signals the next result with a new edge
+    status |= VL53L1X_ClearInterrupt(device->dev);
+    if (status != 0)
+    {
+        ESP_LOGW(TAG, "failed to read ranging result: %d", status);
+        return false;
+    }
+
+    sample->sequence = ++device->sample_count;
+    sample->timestamp_us = ready_us;
+    return true;
+}
+
+bool vl53l1x_read_sample(vl53l1x_device_handle_t *device, uint32_t timeout_ms, vl53l1x_sample_t *sample)
+{
+    if (!device || !sample)
+    {
+        ESP_LOGE(TAG, "Invalid parameters for read_sample");
+        return false;
+    }
+
+    int64_t ready_us = 0;
+    if (!wait_data_ready(device, timeout_ms, &ready_us))
+    {
+        return false;
+    }
+    return read_ready_sample(device, ready_us, sample);
+}
+
+bool vl53l1x_poll_sample(vl53l1x_device_handle_t *device, vl53l1x_sample_t *sample, bool *ready)
+{
+    if (!device || !sample || !ready)
+    {
+        ESP_LOGE(TAG, "Invalid parameters for poll_sample");
+        return false;
+    }
+
+    uint8_t pending = 0;
+    *ready = false;
+    if (!check_data_ready(device, &pending))
+    {
+        return false;
+    }
+    if (!pending)
+    {
+        return true;
+    }
+    if (!read_ready_sample(device, esp_timer_get_time(), sample))
+    {
+        return false;
+    }
+    *ready = true;
+    return true;
+}
+
 void wait_boot(uint16_t dev)
 {
     uint8_t boot_state = 0xFF;
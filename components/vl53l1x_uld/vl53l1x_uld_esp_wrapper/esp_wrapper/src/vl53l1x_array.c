@@ -0,0 +1,534 @@
+#include "vl53l1x_array.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "VL53L1X_api.h"
+#include "i2c_handler.h"
+
+static const char *TAG = "VL53L1X_ARRAY";
+
+typedef struct
+{
+    vl53l1x_array_job_fn_t fn;
+    uint8_t data[VL53L1X_ARRAY_JOB_DATA_SIZE];
+} vl53l1x_array_job_t;
+
+static void IRAM_ATTR array_data_ready_isr(void *arg)
+{
+    vl53l1x_array_t *array = (vl53l1x_array_t *)arg;
+    BaseType_t higher_priority_task_woken = pdFALSE;
+
+    vTaskNotifyGiveFromISR(array->task, &higher_priority_task_woken);
+    if (higher_priority_task_woken == pdTRUE)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void shutdown_sensor(gpio_num_t xshut_gpio)
+{
+    if (xshut_gpio != GPIO_NUM_NC)
+    {
+        gpio_set_level(xshut_gpio, 0);
+    }
+}
+
+static bool in_group(const vl53l1x_array_t *array, uint8_t index)
+{
+    return array->sensors[index].present && index % array->config.groups == array->group;
+}
+
+static bool start_interrupt(vl53l1x_array_t *array)
+{
+    uint8_t polarity = 1;
+    for (uint8_t i = 0; i < array->config.count; i++)
+    {
+        if (array->sensors[i].present)
+        {
+            polarity = array->sensors[i].device.interrupt_polarity;
+            break;
+        }
+    }
+
+    // an active high GPIO1 drives the line low while idle
+    if (array->present > 1 && polarity)
+    {
+        ESP_LOGW(TAG, "GPIO%d shared by %u sensors needs active low interrupt polarity, polling instead",
+                 array->config.interrupt_gpio, array->present);
+        return false;
+    }
+
+    gpio_config_t io_config = {
+        .pin_bit_mask = 1ULL << array->config.interrupt_gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = polarity ? GPIO_INTR_POSEDGE : GPIO_INTR_NEGEDGE,
+    };
+    esp_err_t err = gpio_config(&io_config);
+    if (err == ESP_OK)
+    {
+        err = gpio_install_isr_service(0);
+        if (err == ESP_ERR_INVALID_STATE)
+        {
+            err = ESP_OK; // already installed by another driver
+        }
+    }
+    if (err == ESP_OK)
+    {
+        err = gpio_isr_handler_add(array->config.interrupt_gpio, array_data_ready_isr, array);
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "data ready interrupt on GPIO%d failed (%s), polling instead",
+                 array->config.interrupt_gpio, esp_err_to_name(err));
+        return false;
+    }
+    return true;
+}
+
+bool vl53l1x_array_init(vl53l1x_array_t *array, const vl53l1x_array_config_t *config)
+{
+    if (!array || !config || !config->vl53l1x_handle ||
+        config->count == 0 || config->count > VL53L1X_ARRAY_MAX_SENSORS)
+    {
+        ESP_LOGE(TAG, "Invalid parameters for array_init");
+        return false;
+    }
+
+    uint64_t xshut_mask = 0;
+    for (uint8_t i = 0; i < config->count; i++)
+    {
+        if (config->xshut_gpio[i] != GPIO_NUM_NC)
+        {
+            xshut_mask |= 1ULL << config->xshut_gpio[i];
+        }
+        else if (config->count > 1)
+        {
+            ESP_LOGE(TAG, "sensor %u has no XSHUT GPIO, an array needs one per sensor", i);
+            return false;
+        }
+    }
+
+    memset(array, 0, sizeof(*array));
+    array->config = *config;
+    if (array->config.groups == 0 || array->config.groups > config->count)
+    {
+        array->config.groups = config->count;
+    }
+    if (array->config.poll_period_ms == 0)
+    {
+        array->config.poll_period_ms = 1;
+    }
+    array->task = xTaskGetCurrentTaskHandle();
+    array->jobs = xQueueCreate(VL53L1X_ARRAY_JOB_QUEUE_LEN, sizeof(vl53l1x_array_job_t));
+    if (array->jobs == NULL)
+    {
+        ESP_LOGE(TAG, "no memory for the job queue");
+        return false;
+    }
+
+    // hold every sensor in shutdown, only the one released answers at the
+    // default address
+    if (xshut_mask != 0)
+    {
+        gpio_config_t io_config = {
+            .pin_bit_mask = xshut_mask,
+            .mode = GPIO_MODE_OUTPUT,
+            .pull_up_en = GPIO_PULLUP_DISABLE,
+            .pull_down_en = GPIO_PULLDOWN_DISABLE,
+            .intr_type = GPIO_INTR_DISABLE,
+        };
+        if (gpio_config(&io_config) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "failed to configure XSHUT GPIOs");
+            return false;
+        }
+        for (uint8_t i = 0; i < config->count; i++)
+        {
+            shutdown_sensor(config->xshut_gpio[i]);
+        }
+        vTaskDelay(pdMS_TO_TICKS(VL53L1X_ARRAY_RESET_MS));
+    }
+
+    for (uint8_t i = 0; i < config->count; i++)
+    {
+        vl53l1x_array_sensor_t *sensor = &array->sensors[i];
+        sensor->device = VL53L1X_DEVICE_INIT;
+        sensor->device.vl53l1x_handle = config->vl53l1x_handle;
+        sensor->device.xshut_gpio = config->xshut_gpio[i];
+
+        if (sensor->device.xshut_gpio != GPIO_NUM_NC)
+        {
+            gpio_set_level(sensor->device.xshut_gpio, 1);
+        }
+        if (!vl53l1x_add_device(&sensor->device))
+        {
+            ESP_LOGE(TAG, "sensor %u failed to come up", i);
+            shutdown_sensor(sensor->device.xshut_gpio);
+            continue;
+        }
+        if (config->count > 1 &&
+            !vl53l1x_update_device_address(&sensor->device, VL53L1X_ARRAY_BASE_ADDRESS + i))
+        {
+            ESP_LOGE(TAG, "sensor %u failed to move to 0x%02X", i, VL53L1X_ARRAY_BASE_ADDRESS + i);
+            shutdown_sensor(sensor->device.xshut_gpio);
+            continue;
+        }
+        if (!vl53l1x_start_acquisition(&sensor->device, array->config.poll_period_ms))
+        {
+            shutdown_sensor(sensor->device.xshut_gpio);
+            continue;
+        }
+        sensor->present = true;
+        array->present++;
+    }
+
+    if (array->present == 0)
+    {
+        ESP_LOGE(TAG, "no sensor came up");
+        return false;
+    }
+
+    // vl53l1x_add_device left every sensor ranging
+    if (array->config.groups > 1)
+    {
+        for (uint8_t i = 0; i < config->count; i++)
+        {
+            if (array->sensors[i].present)
+            {
+                VL53L1X_StopRanging(array->sensors[i].device.dev);
+            }
+        }
+    }
+
+    if (config->interrupt_gpio != GPIO_NUM_NC)
+    {
+        array->interrupt = start_interrupt(array);
+    }
+
+    ESP_LOGI(TAG, "%u of %u sensors up, %u ranging group(s), %s", array->present, config->count,
+             array->config.groups, array->interrupt ? "data ready interrupt" : "polling data ready");
+    return true;
+}
+
+static int64_t result_timeout_us(const vl53l1x_array_t *array, const vl53l1x_array_sensor_t *sensor)
+{
+    if (array->config.result_timeout_ms > 0)
+    {
+        return (int64_t)array->config.result_timeout_ms * 1000;
+    }
+    return ((int64_t)sensor->device.ranging_period_ms * VL53L1X_ARRAY_TIMEOUT_PERIODS +
+            VL53L1X_ARRAY_TIMEOUT_MARGIN_MS) * 1000;
+}
+
+// Polling before this time only finds the result of duration_ms ago
+static int64_t early_us(const vl53l1x_array_t *array, int64_t start_us, uint32_t duration_ms)
+{
+    const int64_t duration_us = (int64_t)duration_ms * 1000;
+    return start_us + duration_us - duration_us / VL53L1X_ARRAY_POLL_EARLY_DIV -
+           (int64_t)array->config.poll_period_ms * 1000;
+}
+
+static void count_sample(const vl53l1x_array_t *array, vl53l1x_array_sensor_t *sensor,
+                         const vl53l1x_sample_t *sample, int64_t now_us)
+{
+    if (sample)
+    {
+        // a continuously ranging sensor completes a result every period,
+        // a longer gap means results were replaced before they were read
+        const int64_t period_us = (int64_t)sensor->device.ranging_period_ms * 1000;
+        if (array->config.groups == 1 && sensor->last_sample_us != 0 && period_us > 0)
+        {
+            const int64_t periods = (sample->timestamp_us - sensor->last_sample_us + period_us / 2) / period_us;
+            if (periods > 1)
+            {
+                sensor->missed += (uint32_t)(periods - 1);
+            }
+        }
+        sensor->last_sample_us = sample->timestamp_us;
+        sensor->samples++;
+        sensor->window_samples++;
+    }
+    else
+    {
+        sensor->last_sample_us = 0;
+    }
+
+    if (sensor->window_us == 0)
+    {
+        sensor->window_us = now_us;
+        sensor->window_samples = 0;
+        return;
+    }
+    const int64_t elapsed_us = now_us - sensor->window_us;
+    if (elapsed_us >= (int64_t)VL53L1X_ARRAY_RATE_WINDOW_MS * 1000)
+    {
+        sensor->rate_millihz = (uint32_t)((int64_t)sensor->window_samples * 1000000000 / elapsed_us);
+        sensor->window_us = now_us;
+        sensor->window_samples = 0;
+    }
+}
+
+// A sensor of a group is done with its result, a continuously ranging one
+// waits for the next
+static void finish_sensor(vl53l1x_array_t *array, uint8_t index, const vl53l1x_sample_t *sample,
+                          vl53l1x_array_sample_cb_t callback, void *arg)
+{
+    vl53l1x_array_sensor_t *sensor = &array->sensors[index];
+    const int64_t now_us = esp_timer_get_time();
+
+    count_sample(array, sensor, sample, now_us);
+    if (array->config.groups > 1)
+    {
+        sensor->pending = false;
+    }
+    else
+    {
+        sensor->due_us = now_us + result_timeout_us(array, sensor);
+        sensor->early_us = sample ? early_us(array, sample->timestamp_us, sensor->device.ranging_period_ms) : 0;
+    }
+    callback(index, sample, arg);
+}
+
+static void start_group(vl53l1x_array_t *array, vl53l1x_array_sample_cb_t callback, void *arg)
+{
+    const int64_t now_us = esp_timer_get_time();
+
+    // the clear and start registers are adjacent, one burst per sensor
+    i2c_batch_begin();
+
+    for (uint8_t i = 0; i < array->config.count; i++)
+    {
+        if (!in_group(array, i))
+        {
+            continue;
+        }
+        vl53l1x_array_sensor_t *sensor = &array->sensors[i];
+        sensor->pending = true;
+        sensor->due_us = now_us + result_timeout_us(array, sensor);
+        // a started sensor has its first result after the timing budget,
+        // a continuously ranging one may have one any time
+        sensor->early_us = array->config.groups > 1
+                               ? early_us(array, now_us, sensor->device.timing_budget_ms)
+                               : 0;
+
+        // a result that came in after its sensor timed out must not count
+        // for this round
+        VL53L1X_ERROR status = VL53L1X_ClearInterrupt(sensor->device.dev);
+        if (array->config.groups > 1)
+        {
+            status |= VL53L1X_StartRanging(sensor->device.dev);
+        }
+        status |= i2c_batch_flush();
+        if (status != 0)
+        {
+            sensor->errors++;
+            finish_sensor(array, i, NULL, callback, arg);
+        }
+    }
+    i2c_batch_end();
+    array->group_started = true;
+}
+
+static void stop_group(vl53l1x_array_t *array)
+{
+    for (uint8_t i = 0; i < array->config.count; i++)
+    {
+        if (array->config.groups > 1 && in_group(array, i))
+        {
+            VL53L1X_StopRanging(array->sensors[i].device.dev);
+        }
+    }
+    array->group = (array->group + 1) % array->config.groups;
+    array->group_started = false;
+}
+
+bool vl53l1x_array_submit(vl53l1x_array_t *array, vl53l1x_array_job_fn_t job, const void *data, size_t size)
+{
+    if (!array || !array->jobs || !job || size > VL53L1X_ARRAY_JOB_DATA_SIZE)
+    {
+        ESP_LOGE(TAG, "Invalid parameters for array_submit");
+        return false;
+    }
+
+    vl53l1x_array_job_t entry = {.fn = job};
+    if (data)
+    {
+        memcpy(entry.data, data, size);
+    }
+    if (xQueueSend(array->jobs, &entry, 0) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "job queue full");
+        return false;
+    }
+    xTaskNotifyGive(array->task);
+    return true;
+}
+
+static void run_jobs(vl53l1x_array_t *array)
+{
+    vl53l1x_array_job_t job;
+    bool ran = false;
+
+    while (xQueueReceive(array->jobs, &job, 0) == pdTRUE)
+    {
+        for (uint8_t i = 0; i < array->config.count; i++)
+        {
+            vl53l1x_array_sensor_t *sensor = &array->sensors[i];
+            if (!sensor->present)
+            {
+                continue;
+            }
+            i2c_batch_begin();
+            bool done = job.fn(&sensor->device, job.data);
+            if (i2c_batch_end() != 0 || !done)
+            {
+                sensor->errors++;
+                ESP_LOGW(TAG, "job failed on sensor %u", i);
+            }
+        }
+        ran = true;
+    }
+    if (!ran)
+    {
+        return;
+    }
+
+    // jobs leave every sensor ranging, only the current group may range and
+    // its results start over
+    if (array->config.groups > 1)
+    {
+        for (uint8_t i = 0; i < array->config.count; i++)
+        {
+            if (array->sensors[i].present)
+            {
+                VL53L1X_StopRanging(array->sensors[i].device.dev);
+            }
+        }
+    }
+    array->group_started = false;
+}
+
+void vl53l1x_array_service(vl53l1x_array_t *array, vl53l1x_array_sample_cb_t callback, void *arg)
+{
+    run_jobs(array);
+
+    if (!array->group_started)
+    {
+        start_group(array, callback, arg);
+    }
+
+    // sweep until no result is left, a shared GPIO1 line only gives a new
+    // edge once every result on it is cleared
+    bool read_any;
+    do
+    {
+        read_any = false;
+        for (uint8_t i = 0; i < array->config.count; i++)
+        {
+            vl53l1x_array_sensor_t *sensor = &array->sensors[i];
+            if (!sensor->present || !sensor->pending)
+            {
+                continue;
+            }
+
+            vl53l1x_sample_t sample;
+            bool ready = false;
+            if (!vl53l1x_poll_sample(&sensor->device, &sample, &ready))
+            {
+                sensor->errors++;
+                finish_sensor(array, i, NULL, callback, arg);
+            }
+            else if (ready)
+            {
+                read_any = true;
+                finish_sensor(array, i, &sample, callback, arg);
+            }
+        }
+    } while (read_any);
+
+    const int64_t now_us = esp_timer_get_time();
+    int64_t next_due_us = INT64_MAX;
+    int64_t next_early_us = INT64_MAX;
+    for (uint8_t i = 0; i < array->config.count; i++)
+    {
+        vl53l1x_array_sensor_t *sensor = &array->sensors[i];
+        if (!sensor->present || !sensor->pending)
+        {
+            continue;
+        }
+        if (now_us >= sensor->due_us)
+        {
+            sensor->timeouts++;
+            ESP_LOGD(TAG, "sensor %u gave no result", i);
+            finish_sensor(array, i, NULL, callback, arg);
+            if (!sensor->pending)
+            {
+                continue;
+            }
+        }
+        if (sensor->due_us < next_due_us)
+        {
+            next_due_us = sensor->due_us;
+        }
+        if (sensor->early_us < next_early_us)
+        {
+            next_early_us = sensor->early_us;
+        }
+    }
+
+    if (next_due_us == INT64_MAX)
+    {
+        stop_group(array);
+        return;
+    }
+
+    // with the interrupt the timeout only bounds a lost edge, polling skips
+    // the part of the ranging period no sensor can have a result in
+    int64_t wake_us = next_due_us;
+    if (!array->interrupt)
+    {
+        wake_us = now_us + (int64_t)array->config.poll_period_ms * 1000;
+        if (next_early_us > wake_us)
+        {
+            wake_us = next_early_us < next_due_us ? next_early_us : next_due_us;
+        }
+    }
+    TickType_t ticks = pdMS_TO_TICKS((wake_us - now_us + 999) / 1000);
+    if (ticks == 0)
+    {
+        ticks = 1;
+    }
+    ulTaskNotifyTake(pdTRUE, ticks);
+}
+
+bool vl53l1x_array_get_stats(const vl53l1x_array_t *array, uint8_t index, vl53l1x_array_stats_t *stats)
+{
+    if (!array || !stats || index >= array->config.count || !array->sensors[index].present)
+    {
+        return false;
+    }
+
+    const vl53l1x_array_sensor_t *sensor = &array->sensors[index];
+    stats->period_ms = sensor->device.ranging_period_ms;
+    stats->rate_millihz = sensor->rate_millihz;
+    stats->samples = sensor->samples;
+    stats->missed = sensor->missed;
+    stats->timeouts = sensor->timeouts;
+    stats->errors = sensor->errors;
+    return true;
+}
+
+vl53l1x_device_handle_t *vl53l1x_array_get_device(vl53l1x_array_t *array, uint8_t index)
+{
+    if (!array || index >= array->config.count || !array->sensors[index].present)
+    {
+        return NULL;
+    }
+    return &array->sensors[index].device;
+}
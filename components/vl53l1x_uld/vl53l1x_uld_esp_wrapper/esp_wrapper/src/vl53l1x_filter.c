@@ -0,0 +1,211 @@
+#include "vl53l1x_filter.h"
+
+#include <string.h>
+
+#define MM_TO_Q8(mm) ((uint32_t)(mm) << 8)
+#define Q8_TO_MM(q8) ((uint16_t)(((q8) + 128) >> 8))
+
+bool vl53l1x_filter_enabled(const vl53l1x_config_t *config)
+{
+    return config->reject_invalid_status || config->min_signal_per_spad > 0 || config->max_step_mm > 0 ||
+           config->median_window > 1 || config->average_window > 1 || config->ema_alpha > 0 ||
+           config->switch_point_mm > 0;
+}
+
+void vl53l1x_filter_init(vl53l1x_filter_t *filter, const vl53l1x_config_t *config)
+{
+    memset(filter, 0, sizeof(*filter));
+    filter->enabled = vl53l1x_filter_enabled(config);
+    filter->reject_invalid_status = config->reject_invalid_status;
+    filter->min_signal_per_spad = config->min_signal_per_spad;
+    filter->max_step_mm = config->max_step_mm;
+    filter->median_window = config->median_window;
+    filter->average_window = config->average_window;
+    filter->ema_alpha = config->ema_alpha;
+    filter->switch_point_mm = config->switch_point_mm;
+    filter->switch_hysteresis_mm = config->switch_hysteresis_mm;
+
+    if (filter->median_window > VL53L1X_CONFIG_FILTER_WINDOW_MAX)
+    {
+        filter->median_window = VL53L1X_CONFIG_FILTER_WINDOW_MAX;
+    }
+    if (filter->average_window > VL53L1X_CONFIG_FILTER_WINDOW_MAX)
+    {
+        filter->average_window = VL53L1X_CONFIG_FILTER_WINDOW_MAX;
+    }
+}
+
+// The target moved, the windows must not smear the old distance into the new
+static void restart_stages(vl53l1x_filter_t *filter)
+{
+    filter->median_head = 0;
+    filter->median_count = 0;
+    filter->average_head = 0;
+    filter->average_count = 0;
+    filter->average_sum = 0;
+    filter->ema_started = false;
+}
+
+static uint16_t median_stage(vl53l1x_filter_t *filter, uint16_t mm)
+{
+    filter->median_ring[filter->median_head] = mm;
+    filter->median_head = (filter->median_head + 1) % filter->median_window;
+    if (filter->median_count < filter->median_window)
+    {
+        filter->median_count++;
+    }
+
+    // insertion sort, the window is at most 8 samples
+    uint16_t sorted[VL53L1X_CONFIG_FILTER_WINDOW_MAX];
+    for (uint8_t i = 0; i < filter->median_count; i++)
+    {
+        uint16_t value = filter->median_ring[i];
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > value; j--)
+        {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = value;
+    }
+
+    const uint8_t middle = filter->median_count / 2;
+    if (filter->median_count % 2 == 0)
+    {
+        return (uint16_t)(((uint32_t)sorted[middle - 1] + sorted[middle] + 1) / 2);
+    }
+    return sorted[middle];
+}
+
+static uint32_t average_stage(vl53l1x_filter_t *filter, uint16_t mm)
+{
+    if (filter->average_count == filter->average_window)
+    {
+        filter->average_sum -= filter->average_ring[filter->average_head];
+    }
+    else
+    {
+        filter->average_count++;
+    }
+    filter->average_ring[filter->average_head] = mm;
+    filter->average_head = (filter->average_head + 1) % filter->average_window;
+    filter->average_sum += mm;
+
+    return MM_TO_Q8(filter->average_sum) / filter->average_count;
+}
+
+static uint32_t ema_stage(vl53l1x_filter_t *filter, uint32_t q8)
+{
+    if (!filter->ema_started)
+    {
+        filter->ema_q8 = q8;
+        filter->ema_started = true;
+    }
+    else
+    {
+        int32_t delta = (int32_t)(q8 - filter->ema_q8);
+        filter->ema_q8 = (uint32_t)((int32_t)filter->ema_q8 + delta * filter->ema_alpha / 256);
+    }
+    return filter->ema_q8;
+}
+
+static bool reject_result(vl53l1x_filter_t *filter, const VL53L1X_Result_t *result)
+{
+    if (filter->reject_invalid_status && result->Status != 0)
+    {
+        return true;
+    }
+    if (result->SigPerSPAD < filter->min_signal_per_spad)
+    {
+        return true;
+    }
+    if (filter->max_step_mm == 0 || !filter->have_output)
+    {
+        return false;
+    }
+
+    const uint16_t last_mm = Q8_TO_MM(filter->output_q8);
+    const uint16_t step = result->Distance > last_mm ? result->Distance - last_mm : last_mm - result->Distance;
+    if (step <= filter->max_step_mm)
+    {
+        filter->step_count = 0;
+        return false;
+    }
+    if (++filter->step_count < VL53L1X_FILTER_STEP_CONFIRM)
+    {
+        return true;
+    }
+    filter->step_count = 0;
+    restart_stages(filter);
+    return false;
+}
+
+void vl53l1x_filter_update(vl53l1x_filter_t *filter, const VL53L1X_Result_t *result, int64_t timestamp_us,
+                           vl53l1x_filter_output_t *output)
+{
+    uint8_t flags = 0;
+
+    if (reject_result(filter, result))
+    {
+        filter->rejected++;
+        flags |= VL53L1X_FILTER_FLAG_REJECTED;
+    }
+    else
+    {
+        uint16_t mm = result->Distance;
+        if (filter->median_window > 1)
+        {
+            mm = median_stage(filter, mm);
+        }
+        uint32_t q8 = filter->average_window > 1 ? average_stage(filter, mm) : MM_TO_Q8(mm);
+        if (filter->ema_alpha > 0)
+        {
+            q8 = ema_stage(filter, q8);
+        }
+
+        if (filter->have_output && timestamp_us > filter->output_us)
+        {
+            int64_t rate = ((int64_t)q8 - (int64_t)filter->output_q8) * 1000000 /
+                           ((timestamp_us - filter->output_us) * 256);
+            if (rate > INT16_MAX)
+            {
+                rate = INT16_MAX;
+            }
+            else if (rate < INT16_MIN)
+            {
+                rate = INT16_MIN;
+            }
+            filter->rate_mm_s = (int16_t)rate;
+        }
+        filter->output_q8 = q8;
+        filter->output_us = timestamp_us;
+        filter->have_output = true;
+    }
+
+    const uint16_t distance_mm = filter->have_output ? Q8_TO_MM(filter->output_q8) : 0;
+    if (filter->have_output && filter->switch_point_mm > 0)
+    {
+        if (distance_mm <= filter->switch_point_mm)
+        {
+            filter->switch_on = true;
+        }
+        else if (distance_mm > (uint32_t)filter->switch_point_mm + filter->switch_hysteresis_mm)
+        {
+            filter->switch_on = false;
+        }
+    }
+    if (filter->switch_on)
+    {
+        flags |= VL53L1X_FILTER_FLAG_SWITCH;
+    }
+    if (filter->have_output &&
+        (filter->median_window <= 1 || filter->median_count == filter->median_window) &&
+        (filter->average_window <= 1 || filter->average_count == filter->average_window))
+    {
+        flags |= VL53L1X_FILTER_FLAG_SETTLED;
+    }
+
+    output->distance_mm = distance_mm;
+    output->rate_mm_s = filter->rate_mm_s;
+    output->flags = flags;
+    output->rejected = filter->rejected;
+}
@@ -94,7 +94,7 @@ bool webui_init(void)
 
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
     config.server_port = 80;
-    config.max_uri_handlers = 25; // Increased to accommodate all API endpoints (was 20, need more)
+    config.max_uri_handlers = 30; // Increased to accommodate all API endpoints (was 25, need more)
     config.max_open_sockets = 7;
     config.stack_size = 16384; // Increased for large file uploads
     config.task_priority = 5;
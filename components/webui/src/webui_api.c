@@ -3,7 +3,10 @@
 #include "ota_manager.h"
 #include "system_config.h"
 #include "modbus_tcp.h"
+#include "modbus_register_map.h"
+#include "modbus_server.h"
 #include "ciptcpipinterface.h"
+#include "cipperf.h"
 #include "nvtcpip.h"
 #include "esp_log.h"
 #include "esp_err.h"
@@ -17,9 +20,9 @@
 #include <stdlib.h>
 
 // Forward declarations for assembly access
-extern uint8_t g_assembly_data064[32];
-extern uint8_t g_assembly_data096[32];
-extern uint8_t g_assembly_data097[10];
+extern uint16_t sample_application_get_assembly_size(uint32_t instance);
+extern bool sample_application_read_assembly(uint32_t instance, uint16_t offset,
+                                             uint8_t *data, uint16_t length);
 
 // Forward declaration for device handle (will be set by sampleapplication)
 extern void *g_vl53l1x_device_handle;
@@ -31,11 +34,79 @@ extern void sample_application_set_sensor_enabled(bool enabled);
 extern void sample_application_set_sensor_byte_offset(uint8_t start_byte);
 extern uint8_t sample_application_get_sensor_byte_offset(void);
 
-// Forward declaration for assembly mutex access
-extern SemaphoreHandle_t sample_application_get_assembly_mutex(void);
+// Forward declarations for the sensor record layout
+extern uint8_t sample_application_get_sensor_count(void);
+extern uint8_t sample_application_get_sensor_record_size(void);
+
+// Sensor configuration, applied by the sensor task
+extern bool sample_application_apply_sensor_config(const void *config);
+extern bool sample_application_get_sensor_processing(void);
+extern bool sample_application_get_sensor_stats(uint8_t index, uint32_t *rate_millihz,
+                                                uint32_t *missed, uint32_t *timeouts);
+
+#define INPUT_ASSEMBLY_NUM   100
+#define OUTPUT_ASSEMBLY_NUM  150
+#define CONFIG_ASSEMBLY_NUM  151
 
 static const char *TAG = "webui_api";
 
+// The sensor records must end before the sample stamp at byte 27
+static bool sensor_records_fit(uint8_t start_byte)
+{
+    return start_byte + sample_application_get_sensor_count() *
+           sample_application_get_sensor_record_size() <= 27;
+}
+
+static void add_sensor_byte_range(cJSON *json, uint8_t start_byte)
+{
+    char range[8];
+    uint8_t end_byte = start_byte + sample_application_get_sensor_count() *
+                       sample_application_get_sensor_record_size() - 1;
+    snprintf(range, sizeof(range), "%u-%u", start_byte, end_byte);
+    cJSON_AddNumberToObject(json, "start_byte", start_byte);
+    cJSON_AddNumberToObject(json, "end_byte", end_byte);
+    cJSON_AddStringToObject(json, "range", range);
+}
+
+// Adds the fields of a sensor record. Compact records only hold distance and
+// status, with the processing pipeline on the record carries rate of change
+// and flags in place of ambient and SPADs.
+// Adds the achieved sample rate and lost results of sensor index
+static void add_sensor_stats(cJSON *json, uint8_t index)
+{
+    uint32_t rate_millihz = 0, missed = 0, timeouts = 0;
+    sample_application_get_sensor_stats(index, &rate_millihz, &missed, &timeouts);
+    cJSON_AddNumberToObject(json, "sample_rate_hz", rate_millihz / 1000.0);
+    cJSON_AddNumberToObject(json, "missed", missed);
+    cJSON_AddNumberToObject(json, "timeouts", timeouts);
+}
+
+static void add_sensor_record(cJSON *json, const uint8_t *record, uint8_t record_size)
+{
+    bool processed = sample_application_get_sensor_processing();
+    uint16_t ambient = 0, sig_per_spad = 0, num_spads = 0;
+
+    cJSON_AddNumberToObject(json, "distance_mm", record[0] | (record[1] << 8));
+    cJSON_AddNumberToObject(json, "status", record[2]);
+    cJSON_AddBoolToObject(json, "processed", processed);
+    if (record_size >= 9) {
+        sig_per_spad = record[5] | (record[6] << 8);
+        if (processed) {
+            cJSON_AddNumberToObject(json, "rate_mm_s", (int16_t)(record[3] | (record[4] << 8)));
+            cJSON_AddBoolToObject(json, "switch", (record[7] & 0x01) != 0);
+            cJSON_AddBoolToObject(json, "rejected", (record[7] & 0x02) != 0);
+            cJSON_AddBoolToObject(json, "settled", (record[7] & 0x04) != 0);
+            cJSON_AddNumberToObject(json, "rejected_count", record[8]);
+        } else {
+            ambient = record[3] | (record[4] << 8);
+            num_spads = record[7] | (record[8] << 8);
+        }
+    }
+    cJSON_AddNumberToObject(json, "ambient_kcps", ambient);
+    cJSON_AddNumberToObject(json, "sig_per_spad_kcps", sig_per_spad);
+    cJSON_AddNumberToObject(json, "num_spads", num_spads);
+}
+
 // Cache for distance_mode to avoid frequent NVS reads
 static uint8_t s_cached_distance_mode = 2; // Default to LONG mode
 static bool s_distance_mode_cached = false;
@@ -130,6 +201,14 @@ static esp_err_t api_get_config_handler(httpd_req_t *req)
     cJSON_AddNumberToObject(json, "threshold_window", config.threshold_window);
     cJSON_AddNumberToObject(json, "interrupt_polarity", config.interrupt_polarity);
     cJSON_AddNumberToObject(json, "i2c_address", config.i2c_address);
+    cJSON_AddNumberToObject(json, "reject_invalid_status", config.reject_invalid_status);
+    cJSON_AddNumberToObject(json, "min_signal_per_spad", config.min_signal_per_spad);
+    cJSON_AddNumberToObject(json, "max_step_mm", config.max_step_mm);
+    cJSON_AddNumberToObject(json, "median_window", config.median_window);
+    cJSON_AddNumberToObject(json, "average_window", config.average_window);
+    cJSON_AddNumberToObject(json, "ema_alpha", config.ema_alpha);
+    cJSON_AddNumberToObject(json, "switch_point_mm", config.switch_point_mm);
+    cJSON_AddNumberToObject(json, "switch_hysteresis_mm", config.switch_hysteresis_mm);
     
     return send_json_response(req, json, ESP_OK);
 }
@@ -137,7 +216,7 @@ static esp_err_t api_get_config_handler(httpd_req_t *req)
 // POST /api/config - Update VL53L1x configuration
 static esp_err_t api_post_config_handler(httpd_req_t *req)
 {
-    char content[512];
+    char content[1024];
     int ret = httpd_req_recv(req, content, sizeof(content) - 1);
     if (ret <= 0) {
         httpd_resp_send_500(req);
@@ -201,6 +280,30 @@ static esp_err_t api_post_config_handler(httpd_req_t *req)
     if ((item = cJSON_GetObjectItem(json, "i2c_address")) != NULL) {
         config.i2c_address = (uint8_t)cJSON_GetNumberValue(item);
     }
+    if ((item = cJSON_GetObjectItem(json, "reject_invalid_status")) != NULL) {
+        config.reject_invalid_status = (uint8_t)cJSON_GetNumberValue(item);
+    }
+    if ((item = cJSON_GetObjectItem(json, "min_signal_per_spad")) != NULL) {
+        config.min_signal_per_spad = (uint16_t)cJSON_GetNumberValue(item);
+    }
+    if ((item = cJSON_GetObjectItem(json, "max_step_mm")) != NULL) {
+        config.max_step_mm = (uint16_t)cJSON_GetNumberValue(item);
+    }
+    if ((item = cJSON_GetObjectItem(json, "median_window")) != NULL) {
+        config.median_window = (uint8_t)cJSON_GetNumberValue(item);
+    }
+    if ((item = cJSON_GetObjectItem(json, "average_window")) != NULL) {
+        config.average_window = (uint8_t)cJSON_GetNumberValue(item);
+    }
+    if ((item = cJSON_GetObjectItem(json, "ema_alpha")) != NULL) {
+        config.ema_alpha = (uint8_t)cJSON_GetNumberValue(item);
+    }
+    if ((item = cJSON_GetObjectItem(json, "switch_point_mm")) != NULL) {
+        config.switch_point_mm = (uint16_t)cJSON_GetNumberValue(item);
+    }
+    if ((item = cJSON_GetObjectItem(json, "switch_hysteresis_mm")) != NULL) {
+        config.switch_hysteresis_mm = (uint16_t)cJSON_GetNumberValue(item);
+    }
     
     cJSON_Delete(json);
     
@@ -219,11 +322,10 @@ static esp_err_t api_post_config_handler(httpd_req_t *req)
     // Invalidate distance mode cache since config was saved
     invalidate_distance_mode_cache();
     
-    // Apply configuration to sensor if device handle is available
+    // Queue the configuration for the sensors if they are running
     if (g_vl53l1x_device_handle != NULL) {
-        extern bool vl53l1x_apply_config(void *device, const void *config);
-        if (!vl53l1x_apply_config(g_vl53l1x_device_handle, &config)) {
-            ESP_LOGW(TAG, "Failed to apply configuration to sensor");
+        if (!sample_application_apply_sensor_config(&config)) {
+            ESP_LOGW(TAG, "Failed to queue configuration for the sensors");
         }
     }
     
@@ -262,40 +364,45 @@ static esp_err_t api_get_status_handler(httpd_req_t *req)
     // Get configured sensor data start byte offset
     uint8_t offset = sample_application_get_sensor_byte_offset();
     
-    // Get assembly mutex for thread-safe access
-    SemaphoreHandle_t assembly_mutex = sample_application_get_assembly_mutex();
-    if (assembly_mutex != NULL) {
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-    }
-    
-    // Read sensor data from assembly buffer using configured offset
-    uint16_t distance = g_assembly_data064[offset + 0] | (g_assembly_data064[offset + 1] << 8);
-    uint8_t status = g_assembly_data064[offset + 2];
-    uint16_t ambient = g_assembly_data064[offset + 3] | (g_assembly_data064[offset + 4] << 8);
-    uint16_t sig_per_spad = g_assembly_data064[offset + 5] | (g_assembly_data064[offset + 6] << 8);
-    uint16_t num_spads = g_assembly_data064[offset + 7] | (g_assembly_data064[offset + 8] << 8);
+    // Take consistent snapshots of the assemblies, this never blocks the OpENer thread
+    uint8_t input_assembly_copy[32] = { 0 };
+    uint8_t output_assembly_copy[32] = { 0 };
+    sample_application_read_assembly(INPUT_ASSEMBLY_NUM, 0, input_assembly_copy, sizeof(input_assembly_copy));
+    sample_application_read_assembly(OUTPUT_ASSEMBLY_NUM, 0, output_assembly_copy, sizeof(output_assembly_copy));
     
-    // Copy assembly data for JSON creation (release mutex before JSON operations)
-    uint8_t input_assembly_copy[32];
-    uint8_t output_assembly_copy[32];
-    memcpy(input_assembly_copy, g_assembly_data064, sizeof(input_assembly_copy));
-    memcpy(output_assembly_copy, g_assembly_data096, sizeof(output_assembly_copy));
+    uint8_t record_size = sample_application_get_sensor_record_size();
     uint8_t led_control = output_assembly_copy[0] & 0x01;
     
-    if (assembly_mutex != NULL) {
-        xSemaphoreGive(assembly_mutex);
-    }
+    // Sample counter (byte 27) and timestamp (bytes 28-31) follow every record offset
+    uint8_t sample_counter = input_assembly_copy[27];
+    uint32_t sample_timestamp_us = (uint32_t)input_assembly_copy[28] |
+                                   ((uint32_t)input_assembly_copy[29] << 8) |
+                                   ((uint32_t)input_assembly_copy[30] << 16) |
+                                   ((uint32_t)input_assembly_copy[31] << 24);
     
     // Get distance mode from cache (avoids frequent NVS reads)
     uint8_t distance_mode = get_cached_distance_mode();
     
-    cJSON_AddNumberToObject(json, "distance_mm", distance);
-    cJSON_AddNumberToObject(json, "status", status);
-    cJSON_AddNumberToObject(json, "ambient_kcps", ambient);
-    cJSON_AddNumberToObject(json, "sig_per_spad_kcps", sig_per_spad);
-    cJSON_AddNumberToObject(json, "num_spads", num_spads);
+    // Readings of the first record at the configured offset
+    add_sensor_record(json, &input_assembly_copy[offset], record_size);
+    add_sensor_stats(json, 0);
+    cJSON_AddNumberToObject(json, "sample_counter", sample_counter);
+    cJSON_AddNumberToObject(json, "sample_timestamp_us", sample_timestamp_us);
     cJSON_AddNumberToObject(json, "distance_mode", distance_mode);
     
+    // Distance, status and sample rate of every sensor of the array
+    uint8_t sensor_count = sample_application_get_sensor_count();
+    cJSON *sensors = cJSON_CreateArray();
+    for (uint8_t i = 0; i < sensor_count; i++) {
+        const uint8_t *record = &input_assembly_copy[offset + i * record_size];
+        cJSON *sensor = cJSON_CreateObject();
+        cJSON_AddNumberToObject(sensor, "distance_mm", record[0] | (record[1] << 8));
+        cJSON_AddNumberToObject(sensor, "status", record[2]);
+        add_sensor_stats(sensor, i);
+        cJSON_AddItemToArray(sensors, sensor);
+    }
+    cJSON_AddItemToObject(json, "sensors", sensors);
+    
     // Add Input Assembly 100 data
     cJSON *input_assembly = cJSON_CreateObject();
     // Add all 32 bytes for bit display
@@ -329,31 +436,17 @@ static esp_err_t api_get_assemblies_handler(httpd_req_t *req)
     // Get configured sensor data start byte offset
     uint8_t offset = sample_application_get_sensor_byte_offset();
     
-    // Get assembly mutex for thread-safe access
-    SemaphoreHandle_t assembly_mutex = sample_application_get_assembly_mutex();
-    if (assembly_mutex != NULL) {
-        xSemaphoreTake(assembly_mutex, portMAX_DELAY);
-    }
-    
-    // Read sensor data from assembly buffer using configured offset
-    uint16_t distance = g_assembly_data064[offset + 0] | (g_assembly_data064[offset + 1] << 8);
-    uint8_t status = g_assembly_data064[offset + 2];
-    uint16_t ambient = g_assembly_data064[offset + 3] | (g_assembly_data064[offset + 4] << 8);
-    uint16_t sig_per_spad = g_assembly_data064[offset + 5] | (g_assembly_data064[offset + 6] << 8);
-    uint16_t num_spads = g_assembly_data064[offset + 7] | (g_assembly_data064[offset + 8] << 8);
-    uint8_t led_control = g_assembly_data096[0] & 0x01;
+    // Take consistent snapshots of the sensor record and the LED byte
+    uint8_t sensor_data[9] = { 0 };
+    uint8_t output_byte0 = 0;
+    sample_application_read_assembly(INPUT_ASSEMBLY_NUM, offset, sensor_data, sizeof(sensor_data));
+    sample_application_read_assembly(OUTPUT_ASSEMBLY_NUM, 0, &output_byte0, 1);
     
-    if (assembly_mutex != NULL) {
-        xSemaphoreGive(assembly_mutex);
-    }
+    uint8_t led_control = output_byte0 & 0x01;
     
     // Input Assembly 100
     cJSON *input_assembly = cJSON_CreateObject();
-    cJSON_AddNumberToObject(input_assembly, "distance_mm", distance);
-    cJSON_AddNumberToObject(input_assembly, "status", status);
-    cJSON_AddNumberToObject(input_assembly, "ambient_kcps", ambient);
-    cJSON_AddNumberToObject(input_assembly, "sig_per_spad_kcps", sig_per_spad);
-    cJSON_AddNumberToObject(input_assembly, "num_spads", num_spads);
+    add_sensor_record(input_assembly, sensor_data, sample_application_get_sensor_record_size());
     cJSON_AddItemToObject(json, "input_assembly_100", input_assembly);
     
     // Output Assembly 150
@@ -363,12 +456,90 @@ static esp_err_t api_get_assemblies_handler(httpd_req_t *req)
     
     // Config Assembly 151
     cJSON *config_assembly = cJSON_CreateObject();
-    cJSON_AddNumberToObject(config_assembly, "size", sizeof(g_assembly_data097));
+    cJSON_AddNumberToObject(config_assembly, "size", sample_application_get_assembly_size(CONFIG_ASSEMBLY_NUM));
     cJSON_AddItemToObject(json, "config_assembly_151", config_assembly);
     
     return send_json_response(req, json, ESP_OK);
 }
 
+#define PERF_RECENT_RECORDS 32
+
+// GET /api/perf - Get per-stage timing of the EtherNet/IP I/O path
+static esp_err_t api_get_perf_handler(httpd_req_t *req)
+{
+    cJSON *json = cJSON_CreateObject();
+    
+#if defined(OPENER_PERF_TRACE) && 0 != OPENER_PERF_TRACE
+    cJSON_AddBoolToObject(json, "enabled", true);
+    cJSON_AddNumberToObject(json, "counter_frequency_hz", GetPerfCounterFrequency());
+    cJSON_AddNumberToObject(json, "busy_permille", PerfGetLoadPermille(kPerfStageSelectWake));
+    
+    // Snapshots are taken without blocking the OpENer thread
+    cJSON *stages = cJSON_CreateArray();
+    for (int i = 0; i < kPerfStageCount; i++) {
+        PerfStageStatistics statistics;
+        PerfGetStageStatistics((PerfStage)i, &statistics);
+        
+        cJSON *stage = cJSON_CreateObject();
+        cJSON_AddStringToObject(stage, "name", PerfGetStageName((PerfStage)i));
+        cJSON_AddNumberToObject(stage, "count", statistics.count);
+        cJSON_AddNumberToObject(stage, "min_ns", (double)PerfTicksToNanoSeconds(statistics.min));
+        cJSON_AddNumberToObject(stage, "mean_ns", statistics.count == 0 ? 0 :
+                                (double)PerfTicksToNanoSeconds(statistics.total / statistics.count));
+        cJSON_AddNumberToObject(stage, "max_ns", (double)PerfTicksToNanoSeconds(statistics.max));
+        cJSON_AddNumberToObject(stage, "load_permille", PerfGetLoadPermille((PerfStage)i));
+        
+        // Only non-empty buckets, each counts durations below le_ns
+        cJSON *histogram = cJSON_CreateArray();
+        for (int bucket = 0; bucket < PERF_HISTOGRAM_BUCKETS; bucket++) {
+            if (statistics.histogram[bucket] == 0) {
+                continue;
+            }
+            cJSON *entry = cJSON_CreateObject();
+            cJSON_AddNumberToObject(entry, "le_ns", (double)PerfTicksToNanoSeconds(2ULL << bucket));
+            cJSON_AddNumberToObject(entry, "count", statistics.histogram[bucket]);
+            cJSON_AddItemToArray(histogram, entry);
+        }
+        cJSON_AddItemToObject(stage, "histogram", histogram);
+        cJSON_AddItemToArray(stages, stage);
+    }
+    cJSON_AddItemToObject(json, "stages", stages);
+    
+    // Most recent measurements, oldest first, start in counter ticks
+    PerfTraceRecord records[PERF_RECENT_RECORDS];
+    size_t record_count = PerfGetRecentRecords(records, PERF_RECENT_RECORDS);
+    cJSON *recent = cJSON_CreateArray();
+    for (size_t i = 0; i < record_count; i++) {
+        cJSON *record = cJSON_CreateObject();
+        cJSON_AddStringToObject(record, "stage", PerfGetStageName(records[i].stage));
+        cJSON_AddNumberToObject(record, "start", records[i].start);
+        cJSON_AddNumberToObject(record, "duration_ns", (double)PerfTicksToNanoSeconds(records[i].duration));
+        cJSON_AddItemToArray(recent, record);
+    }
+    cJSON_AddItemToObject(json, "recent", recent);
+#else
+    cJSON_AddBoolToObject(json, "enabled", false);
+#endif
+    
+    return send_json_response(req, json, ESP_OK);
+}
+
+// POST /api/perf/reset - Clear the I/O path timing statistics
+static esp_err_t api_post_perf_reset_handler(httpd_req_t *req)
+{
+#if defined(OPENER_PERF_TRACE) && 0 != OPENER_PERF_TRACE
+    // Applied by the OpENer thread at its next wakeup
+    PerfRequestReset();
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "status", "ok");
+    cJSON_AddStringToObject(response, "message", "Performance statistics reset requested");
+    return send_json_response(req, response, ESP_OK);
+#else
+    return send_json_error(req, "Performance tracing is disabled", 400);
+#endif
+}
+
 // POST /api/calibrate/offset - Trigger offset calibration
 static esp_err_t api_calibrate_offset_handler(httpd_req_t *req)
 {
@@ -402,8 +573,6 @@ static esp_err_t api_calibrate_offset_handler(httpd_req_t *req)
     }
     
     extern bool vl53l1x_calibrate_offset(void *device, uint16_t target_distance_mm, int16_t *offset);
-    extern bool vl53l1x_apply_config(void *device, const void *config);
-    
     int16_t offset = 0;
     bool success = vl53l1x_calibrate_offset(g_vl53l1x_device_handle, target_distance, &offset);
     
@@ -436,7 +605,7 @@ static esp_err_t api_calibrate_offset_handler(httpd_req_t *req)
                 invalidate_distance_mode_cache();
                 
                 // Reapply config to restart ranging (calibration stops ranging)
-                vl53l1x_apply_config(g_vl53l1x_device_handle, &config);
+                sample_application_apply_sensor_config(&config);
         
         cJSON_AddStringToObject(response, "status", "ok");
         cJSON_AddNumberToObject(response, "offset_mm", sensor_offset);
@@ -482,8 +651,6 @@ static esp_err_t api_calibrate_xtalk_handler(httpd_req_t *req)
     }
     
     extern bool vl53l1x_calibrate_xtalk(void *device, uint16_t target_distance_mm, uint16_t *xtalk);
-    extern bool vl53l1x_apply_config(void *device, const void *config);
-    
     uint16_t xtalk = 0;
     bool success = vl53l1x_calibrate_xtalk(g_vl53l1x_device_handle, target_distance, &xtalk);
     
@@ -500,7 +667,7 @@ static esp_err_t api_calibrate_xtalk_handler(httpd_req_t *req)
                 invalidate_distance_mode_cache();
                 
                 // Reapply config to restart ranging (calibration stops ranging)
-                vl53l1x_apply_config(g_vl53l1x_device_handle, &config);
+                sample_application_apply_sensor_config(&config);
         
         cJSON_AddStringToObject(response, "status", "ok");
         cJSON_AddNumberToObject(response, "xtalk_cps", xtalk);
@@ -801,7 +968,10 @@ static esp_err_t api_ota_status_handler(httpd_req_t *req)
     return send_json_response(req, json, ESP_OK);
 }
 
-// GET /api/modbus - Get Modbus enabled state
+// Clients listed by GET /api/modbus, the server may have more
+#define MODBUS_API_MAX_CLIENTS 32
+
+// GET /api/modbus - Get Modbus enabled state and server statistics
 static esp_err_t api_get_modbus_handler(httpd_req_t *req)
 {
     bool enabled = system_modbus_enabled_load();
@@ -809,6 +979,38 @@ static esp_err_t api_get_modbus_handler(httpd_req_t *req)
     cJSON *json = cJSON_CreateObject();
     cJSON_AddBoolToObject(json, "enabled", enabled);
     
+    // Server statistics, only while the server runs
+    modbus_server_stats_t stats;
+    if (modbus_server_get_stats(&stats)) {
+        cJSON_AddNumberToObject(json, "connections", stats.connections);
+        cJSON_AddNumberToObject(json, "max_connections", stats.max_connections);
+        cJSON_AddNumberToObject(json, "accepted", stats.accepted);
+        cJSON_AddNumberToObject(json, "rejected", stats.rejected);
+        cJSON_AddNumberToObject(json, "evicted", stats.evicted);
+        cJSON_AddNumberToObject(json, "timed_out", stats.timed_out);
+        cJSON_AddNumberToObject(json, "protocol_errors", stats.protocol_errors);
+        cJSON_AddNumberToObject(json, "requests", (double)stats.requests);
+        cJSON_AddNumberToObject(json, "request_rate", stats.request_rate);
+        
+        modbus_server_client_info_t *clients = malloc(MODBUS_API_MAX_CLIENTS * sizeof(*clients));
+        if (clients != NULL) {
+            size_t count = modbus_server_get_clients(clients, MODBUS_API_MAX_CLIENTS);
+            cJSON *array = cJSON_AddArrayToObject(json, "clients");
+            for (size_t i = 0; i < count; i++) {
+                struct in_addr addr = { .s_addr = clients[i].address };
+                cJSON *client = cJSON_CreateObject();
+                cJSON_AddStringToObject(client, "address", inet_ntoa(addr));
+                cJSON_AddNumberToObject(client, "port", clients[i].port);
+                cJSON_AddNumberToObject(client, "requests", clients[i].requests);
+                cJSON_AddNumberToObject(client, "request_rate", clients[i].request_rate);
+                cJSON_AddNumberToObject(client, "idle_ms", clients[i].idle_ms);
+                cJSON_AddNumberToObject(client, "connected_ms", clients[i].connected_ms);
+                cJSON_AddItemToArray(array, client);
+            }
+            free(clients);
+        }
+    }
+    
     return send_json_response(req, json, ESP_OK);
 }
 
@@ -865,6 +1067,128 @@ static esp_err_t api_post_modbus_handler(httpd_req_t *req)
     return send_json_response(req, response, ESP_OK);
 }
 
+// JSON names of the register map fields, in enum order
+static const char *const s_modbus_table_names[MODBUS_TABLE_COUNT] = {
+    "input", "holding", "coils", "discrete_inputs"
+};
+static const char *const s_modbus_data_type_names[MODBUS_DATA_TYPE_COUNT] = {
+    "uint16", "int16", "uint32", "int32", "float32"
+};
+static const char *const s_modbus_word_order_names[MODBUS_WORD_ORDER_COUNT] = {
+    "high_first", "low_first"
+};
+
+// Index of name in names, count if it is not there
+static uint8_t lookup_name(const char *const *names, uint8_t count, const char *name)
+{
+    uint8_t i = 0;
+    while (i < count && (name == NULL || strcmp(names[i], name) != 0)) {
+        i++;
+    }
+    return i;
+}
+
+// GET /api/modbus/map - Get the applied Modbus register map
+static esp_err_t api_get_modbus_map_handler(httpd_req_t *req)
+{
+    modbus_register_mapping_t entries[MODBUS_REGISTER_MAP_MAX_ENTRIES];
+    size_t count = modbus_register_map_get(entries);
+    
+    cJSON *json = cJSON_CreateObject();
+    cJSON *array = cJSON_AddArrayToObject(json, "entries");
+    for (size_t i = 0; i < count; i++) {
+        cJSON *entry = cJSON_CreateObject();
+        cJSON_AddStringToObject(entry, "table", s_modbus_table_names[entries[i].table]);
+        cJSON_AddNumberToObject(entry, "start", entries[i].start);
+        cJSON_AddNumberToObject(entry, "count", entries[i].count);
+        cJSON_AddNumberToObject(entry, "assembly", entries[i].assembly);
+        cJSON_AddNumberToObject(entry, "offset", entries[i].offset);
+        cJSON_AddStringToObject(entry, "type", s_modbus_data_type_names[entries[i].data_type]);
+        cJSON_AddStringToObject(entry, "word_order", s_modbus_word_order_names[entries[i].word_order]);
+        cJSON_AddItemToArray(array, entry);
+    }
+    cJSON_AddNumberToObject(json, "max_entries", MODBUS_REGISTER_MAP_MAX_ENTRIES);
+    
+    return send_json_response(req, json, ESP_OK);
+}
+
+// POST /api/modbus/map - Save and apply a Modbus register map, an empty
+// entries array restores the default map
+static esp_err_t api_post_modbus_map_handler(httpd_req_t *req)
+{
+    char content[2560];
+    if (req->content_len >= sizeof(content)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Register map too large");
+        return ESP_FAIL;
+    }
+    size_t received = 0;
+    while (received < req->content_len) {
+        int ret = httpd_req_recv(req, content + received, req->content_len - received);
+        if (ret <= 0) {
+            httpd_resp_send_500(req);
+            return ESP_FAIL;
+        }
+        received += ret;
+    }
+    content[received] = '\0';
+    
+    cJSON *json = cJSON_Parse(content);
+    if (json == NULL) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        return ESP_FAIL;
+    }
+    
+    cJSON *array = cJSON_GetObjectItem(json, "entries");
+    int count = cJSON_IsArray(array) ? cJSON_GetArraySize(array) : -1;
+    if (count < 0 || count > MODBUS_REGISTER_MAP_MAX_ENTRIES) {
+        cJSON_Delete(json);
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Missing or invalid 'entries' field");
+        return ESP_FAIL;
+    }
+    
+    modbus_register_mapping_t entries[MODBUS_REGISTER_MAP_MAX_ENTRIES];
+    memset(entries, 0, sizeof(entries));
+    for (int i = 0; i < count; i++) {
+        cJSON *entry = cJSON_GetArrayItem(array, i);
+        cJSON *word_order = cJSON_GetObjectItem(entry, "word_order");
+        cJSON *type = cJSON_GetObjectItem(entry, "type");
+        entries[i].table = lookup_name(s_modbus_table_names, MODBUS_TABLE_COUNT,
+                                       cJSON_GetStringValue(cJSON_GetObjectItem(entry, "table")));
+        entries[i].data_type = type == NULL ? MODBUS_DATA_UINT16 :
+                               lookup_name(s_modbus_data_type_names, MODBUS_DATA_TYPE_COUNT,
+                                           cJSON_GetStringValue(type));
+        entries[i].word_order = word_order == NULL ? MODBUS_WORD_ORDER_HIGH_FIRST :
+                                lookup_name(s_modbus_word_order_names, MODBUS_WORD_ORDER_COUNT,
+                                            cJSON_GetStringValue(word_order));
+        entries[i].start = (uint16_t)cJSON_GetNumberValue(cJSON_GetObjectItem(entry, "start"));
+        entries[i].count = (uint16_t)cJSON_GetNumberValue(cJSON_GetObjectItem(entry, "count"));
+        entries[i].assembly = (uint32_t)cJSON_GetNumberValue(cJSON_GetObjectItem(entry, "assembly"));
+        entries[i].offset = (uint16_t)cJSON_GetNumberValue(cJSON_GetObjectItem(entry, "offset"));
+    }
+    cJSON_Delete(json);
+    
+    const modbus_register_mapping_t *map = count > 0 ? entries : NULL;
+    if (map != NULL && !modbus_register_map_validate(map, count)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid register map");
+        return ESP_FAIL;
+    }
+    if (!modbus_register_map_save(map, count)) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save register map");
+        return ESP_FAIL;
+    }
+    
+    // Apply the change immediately
+    modbus_register_map_configure(map, count);
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON_AddStringToObject(response, "status", "ok");
+    cJSON_AddNumberToObject(response, "entries", count);
+    cJSON_AddStringToObject(response, "message", count > 0 ? "Register map saved successfully"
+                                                           : "Default register map restored");
+    
+    return send_json_response(req, response, ESP_OK);
+}
+
 // GET /api/sensor/enabled - Get sensor enabled state
 static esp_err_t api_get_sensor_enabled_handler(httpd_req_t *req)
 {
@@ -922,12 +1246,11 @@ static esp_err_t api_post_sensor_enabled_handler(httpd_req_t *req)
 // GET /api/sensor/byteoffset - Get sensor data byte offset
 static esp_err_t api_get_sensor_byteoffset_handler(httpd_req_t *req)
 {
-    uint8_t start_byte = system_sensor_byte_offset_load();
+    // The applied offset, a saved one the records do not fit at is not used
+    uint8_t start_byte = sample_application_get_sensor_byte_offset();
     
     cJSON *json = cJSON_CreateObject();
-    cJSON_AddNumberToObject(json, "start_byte", start_byte);
-    cJSON_AddNumberToObject(json, "end_byte", start_byte + 8);
-    cJSON_AddStringToObject(json, "range", start_byte == 0 ? "0-8" : (start_byte == 9 ? "9-17" : "18-26"));
+    add_sensor_byte_range(json, start_byte);
     
     return send_json_response(req, json, ESP_OK);
 }
@@ -964,6 +1287,10 @@ static esp_err_t api_post_sensor_byteoffset_handler(httpd_req_t *req)
         httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid start_byte (must be 0, 9, or 18)");
         return ESP_FAIL;
     }
+    if (!sensor_records_fit(start_byte)) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Sensor records do not fit before byte 27 at this start_byte");
+        return ESP_FAIL;
+    }
     
     if (!system_sensor_byte_offset_save(start_byte)) {
         httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Failed to save sensor byte offset");
@@ -975,9 +1302,7 @@ static esp_err_t api_post_sensor_byteoffset_handler(httpd_req_t *req)
     
     cJSON *response = cJSON_CreateObject();
     cJSON_AddStringToObject(response, "status", "ok");
-    cJSON_AddNumberToObject(response, "start_byte", start_byte);
-    cJSON_AddNumberToObject(response, "end_byte", start_byte + 8);
-    cJSON_AddStringToObject(response, "range", start_byte == 0 ? "0-8" : (start_byte == 9 ? "9-17" : "18-26"));
+    add_sensor_byte_range(response, start_byte);
     cJSON_AddStringToObject(response, "message", "Sensor byte offset saved successfully");
     
     return send_json_response(req, response, ESP_OK);
@@ -1159,6 +1484,24 @@ void webui_register_api_handlers(httpd_handle_t server)
     };
     httpd_register_uri_handler(server, &get_assemblies_uri);
     
+    // GET /api/perf
+    httpd_uri_t get_perf_uri = {
+        .uri       = "/api/perf",
+        .method    = HTTP_GET,
+        .handler   = api_get_perf_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &get_perf_uri);
+    
+    // POST /api/perf/reset
+    httpd_uri_t post_perf_reset_uri = {
+        .uri       = "/api/perf/reset",
+        .method    = HTTP_POST,
+        .handler   = api_post_perf_reset_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &post_perf_reset_uri);
+    
     // POST /api/calibrate/offset
     httpd_uri_t calibrate_offset_uri = {
         .uri       = "/api/calibrate/offset",
@@ -1222,6 +1565,24 @@ void webui_register_api_handlers(httpd_handle_t server)
     };
     httpd_register_uri_handler(server, &post_modbus_uri);
     
+    // GET /api/modbus/map
+    httpd_uri_t get_modbus_map_uri = {
+        .uri       = "/api/modbus/map",
+        .method    = HTTP_GET,
+        .handler   = api_get_modbus_map_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &get_modbus_map_uri);
+    
+    // POST /api/modbus/map
+    httpd_uri_t post_modbus_map_uri = {
+        .uri       = "/api/modbus/map",
+        .method    = HTTP_POST,
+        .handler   = api_post_modbus_map_handler,
+        .user_ctx  = NULL
+    };
+    httpd_register_uri_handler(server, &post_modbus_map_uri);
+    
     // GET /api/sensor/enabled
     httpd_uri_t get_sensor_enabled_uri = {
         .uri       = "/api/sensor/enabled",
@@ -317,10 +317,70 @@ const char *webui_get_index_html(void)
            "</div>"
            "</div>"
            "</div>"
+           "<h3 style=\"margin: 20px 0 0; color: #212529; font-size: 1.25rem; font-weight: 600;\">Processing Pipeline</h3>"
+           "<p>Filters every result before it is written to Input Assembly 100. With any stage on, the record carries the filtered distance, rate of change and switch flags in place of ambient and SPADs. 0 turns a stage off.</p>"
+           "<div class=\"row\">"
+           "<div class=\"col-md-4\">"
+           "<div class=\"form-group\">"
+           "<label>Reject Invalid Status</label>"
+           "<select class=\"form-control\" id=\"reject_invalid_status\" name=\"reject_invalid_status\">"
+           "<option value=\"0\">Off</option>"
+           "<option value=\"1\">On</option>"
+           "</select>"
+           "</div>"
+           "</div>"
+           "<div class=\"col-md-4\">"
+           "<div class=\"form-group\">"
+           "<label>Min Signal per SPAD (kcps)</label>"
+           "<input type=\"number\" class=\"form-control\" id=\"min_signal_per_spad\" name=\"min_signal_per_spad\" min=\"0\" max=\"65535\" value=\"0\">"
+           "</div>"
+           "</div>"
+           "<div class=\"col-md-4\">"
+           "<div class=\"form-group\">"
+           "<label>Max Step (mm)</label>"
+           "<input type=\"number\" class=\"form-control\" id=\"max_step_mm\" name=\"max_step_mm\" min=\"0\" max=\"4000\" value=\"0\">"
+           "</div>"
+           "</div>"
+           "</div>"
+           "<div class=\"row\">"
+           "<div class=\"col-md-4\">"
+           "<div class=\"form-group\">"
+           "<label>Median Window</label>"
+           "<input type=\"number\" class=\"form-control\" id=\"median_window\" name=\"median_window\" min=\"0\" max=\"8\" value=\"0\">"
+           "</div>"
+           "</div>"
+           "<div class=\"col-md-4\">"
+           "<div class=\"form-group\">"
+           "<label>Average Window</label>"
+           "<input type=\"number\" class=\"form-control\" id=\"average_window\" name=\"average_window\" min=\"0\" max=\"8\" value=\"0\">"
+           "</div>"
+           "</div>"
+           "<div class=\"col-md-4\">"
+           "<div class=\"form-group\">"
+           "<label>EMA Alpha (1/256)</label>"
+           "<input type=\"number\" class=\"form-control\" id=\"ema_alpha\" name=\"ema_alpha\" min=\"0\" max=\"255\" value=\"0\">"
+           "</div>"
+           "</div>"
+           "</div>"
+           "<div class=\"row\">"
+           "<div class=\"col-md-6\">"
+           "<div class=\"form-group\">"
+           "<label>Switch Point (mm)</label>"
+           "<input type=\"number\" class=\"form-control\" id=\"switch_point_mm\" name=\"switch_point_mm\" min=\"0\" max=\"4000\" value=\"0\">"
+           "</div>"
+           "</div>"
+           "<div class=\"col-md-6\">"
+           "<div class=\"form-group\">"
+           "<label>Switch Hysteresis (mm)</label>"
+           "<input type=\"number\" class=\"form-control\" id=\"switch_hysteresis_mm\" name=\"switch_hysteresis_mm\" min=\"0\" max=\"4000\" value=\"10\">"
+           "</div>"
+           "</div>"
+           "</div>"
            "<div style=\"margin-top: 30px; padding-top: 20px; border-top: 1px solid #dee2e6;\">"
            "<div style=\"display: flex; justify-content: space-between; gap: 15px;\">"
            "<button type=\"button\" class=\"btn btn-primary\" onclick=\"saveConfig()\" style=\"flex: 1;\">Save Measurement Settings</button>"
            "<button type=\"button\" class=\"btn btn-secondary\" onclick=\"loadConfig()\" style=\"flex: 1;\">Load Current Settings</button>"
+           "<button type=\"button\" class=\"btn btn-secondary\" onclick=\"highRateConfig()\" style=\"flex: 1;\">High Rate (50 Hz)</button>"
            "<button type=\"button\" class=\"btn btn-warning\" onclick=\"resetConfig()\" style=\"flex: 1;\">Reset to Defaults</button>"
            "</div>"
            "</div>"
@@ -530,6 +590,14 @@ const char *webui_get_index_html(void)
            "      if (data.threshold_window !== undefined && data.threshold_window !== null) document.getElementById('threshold_window').value = data.threshold_window;" 
            "      if (data.interrupt_polarity !== undefined && data.interrupt_polarity !== null) document.getElementById('interrupt_polarity').value = data.interrupt_polarity;" 
            "      if (data.i2c_address !== undefined && data.i2c_address !== null) document.getElementById('i2c_address').value = '0x' + data.i2c_address.toString(16).padStart(2, '0');" 
+           "      if (data.reject_invalid_status !== undefined && data.reject_invalid_status !== null) document.getElementById('reject_invalid_status').value = data.reject_invalid_status;" 
+           "      if (data.min_signal_per_spad !== undefined && data.min_signal_per_spad !== null) document.getElementById('min_signal_per_spad').value = data.min_signal_per_spad;" 
+           "      if (data.max_step_mm !== undefined && data.max_step_mm !== null) document.getElementById('max_step_mm').value = data.max_step_mm;" 
+           "      if (data.median_window !== undefined && data.median_window !== null) document.getElementById('median_window').value = data.median_window;" 
+           "      if (data.average_window !== undefined && data.average_window !== null) document.getElementById('average_window').value = data.average_window;" 
+           "      if (data.ema_alpha !== undefined && data.ema_alpha !== null) document.getElementById('ema_alpha').value = data.ema_alpha;" 
+           "      if (data.switch_point_mm !== undefined && data.switch_point_mm !== null) document.getElementById('switch_point_mm').value = data.switch_point_mm;" 
+           "      if (data.switch_hysteresis_mm !== undefined && data.switch_hysteresis_mm !== null) document.getElementById('switch_hysteresis_mm').value = data.switch_hysteresis_mm;" 
            "      showMessage('Configuration loaded', 'success');" 
            "    })" 
            "    .catch(err => {" 
@@ -555,7 +623,15 @@ const char *webui_get_index_html(void)
            "    threshold_high_mm: parseInt(document.getElementById('threshold_high_mm').value),"
            "    threshold_window: parseInt(document.getElementById('threshold_window').value),"
            "    interrupt_polarity: parseInt(document.getElementById('interrupt_polarity').value),"
-           "    i2c_address: addrNum"
+           "    i2c_address: addrNum,"
+           "    reject_invalid_status: parseInt(document.getElementById('reject_invalid_status').value),"
+           "    min_signal_per_spad: parseInt(document.getElementById('min_signal_per_spad').value),"
+           "    max_step_mm: parseInt(document.getElementById('max_step_mm').value),"
+           "    median_window: parseInt(document.getElementById('median_window').value),"
+           "    average_window: parseInt(document.getElementById('average_window').value),"
+           "    ema_alpha: parseInt(document.getElementById('ema_alpha').value),"
+           "    switch_point_mm: parseInt(document.getElementById('switch_point_mm').value),"
+           "    switch_hysteresis_mm: parseInt(document.getElementById('switch_hysteresis_mm').value)"
            "  };"
            "  fetch('/api/config', {"
            "    method: 'POST',"
@@ -595,9 +671,23 @@ const char *webui_get_index_html(void)
            "    document.getElementById('threshold_window').value = 0;"
            "    document.getElementById('interrupt_polarity').value = 1;"
            "    document.getElementById('i2c_address').value = '0x29';"
+           "    document.getElementById('reject_invalid_status').value = 0;"
+           "    document.getElementById('min_signal_per_spad').value = 0;"
+           "    document.getElementById('max_step_mm').value = 0;"
+           "    document.getElementById('median_window').value = 0;"
+           "    document.getElementById('average_window').value = 0;"
+           "    document.getElementById('ema_alpha').value = 0;"
+           "    document.getElementById('switch_point_mm').value = 0;"
+           "    document.getElementById('switch_hysteresis_mm').value = 10;"
            "    showMessage('Form reset to defaults', 'info');"
            "  }"
            "}"
+           "function highRateConfig() {"
+           "  document.getElementById('distance_mode').value = 1;"
+           "  document.getElementById('timing_budget_ms').value = 20;"
+           "  document.getElementById('inter_measurement_ms').value = 20;"
+           "  showMessage('SHORT mode, 20 ms timing budget and period (50 Hz, up to 1.3 m). Save to apply.', 'info');"
+           "}"
            "function calibrateOffset() {"
            "  const dist = prompt('Enter target distance in mm (recommended: 100mm):', '100');"
            "  if (dist) {"
@@ -792,6 +882,7 @@ const char *webui_get_status_html(void)
            "<div class=\"col-md-6\">"
            "<p><strong>Signal per SPAD:</strong> <span id=\"sig_per_spad\">-</span> kcps/SPAD</p>"
            "<p><strong>Number of SPADs:</strong> <span id=\"num_spads\">-</span></p>"
+           "<p><strong>Sample Rate:</strong> <span id=\"sample_rate\">-</span> Hz (missed <span id=\"missed\">-</span>, timeouts <span id=\"timeouts\">-</span>)</p>"
            "</div>"
            "</div>"
            "</div>"
@@ -926,6 +1017,15 @@ const char *webui_get_status_html(void)
            "      } else {"
            "        document.getElementById('num_spads').textContent = '-';"
            "      }"
+           "      if (data.sample_rate_hz !== undefined && data.sample_rate_hz !== null) {"
+           "        document.getElementById('sample_rate').textContent = data.sample_rate_hz.toFixed(1);"
+           "        document.getElementById('missed').textContent = data.missed;"
+           "        document.getElementById('timeouts').textContent = data.timeouts;"
+           "      } else {"
+           "        document.getElementById('sample_rate').textContent = '-';"
+           "        document.getElementById('missed').textContent = '-';"
+           "        document.getElementById('timeouts').textContent = '-';"
+           "      }"
            "      "
            "      const distanceMode = data.distance_mode !== undefined ? data.distance_mode : 2;"
            "      updateDistanceBar(data.distance_mm, distanceMode);"
@@ -31,6 +31,7 @@
 #include "esp_netif_net_stack.h"
 #include "webui.h"
 #include "modbus_tcp.h"
+#include "modbus_register_map.h"
 #include "ota_manager.h"
 #include "system_config.h"
 
@@ -555,6 +556,9 @@ static void got_ip_event_handler(void *arg, esp_event_base_t event_base,
             ESP_LOGW(TAG, "Failed to initialize Web UI");
         }
         
+        // Register map saved in NVS, also used when the server is enabled later
+        modbus_register_map_load();
+        
         // Check NVS for Modbus enabled state before starting
         bool modbus_enabled = system_modbus_enabled_load();
         if (modbus_enabled) {
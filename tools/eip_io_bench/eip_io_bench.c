@@ -0,0 +1,971 @@
+/** @file eip_io_bench.c
+ *  @brief Class 1 implicit I/O load generator and latency benchmark
+ *
+ *  Acts as a scanner: registers a session, opens point-to-point class 1
+ *  connections with Forward_Open, streams O->T data at the requested RPI and
+ *  measures the T->O traffic of the adapter:
+ *  - inter-arrival time and jitter (deviation from the T->O API),
+ *  - lost, duplicated and reordered packets from the sequenced address item,
+ *  - optionally the echo latency, against the host build which echoes
+ *    output assembly 150 into input assembly 100.
+ *
+ *  Works against the device or against ports/POSIX over loopback. T->O data
+ *  is requested on an ephemeral port (T->O sockaddr info item), so the tool
+ *  and a host build of the stack can share one machine.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+#include "histogram.h"
+
+#define ENCAP_HEADER_LENGTH            24
+#define ENCAP_COMMAND_REGISTER_SESSION 0x0065
+#define ENCAP_COMMAND_UNREGISTER_SESSION 0x0066
+#define ENCAP_COMMAND_SEND_RR_DATA     0x006F
+
+#define CPF_ITEM_NULL_ADDRESS          0x0000
+#define CPF_ITEM_CONNECTED_DATA        0x00B1
+#define CPF_ITEM_UNCONNECTED_DATA      0x00B2
+#define CPF_ITEM_SOCKADDR_INFO_T_TO_O  0x8001
+#define CPF_ITEM_SEQUENCED_ADDRESS     0x8002
+
+#define CIP_SERVICE_FORWARD_OPEN       0x54
+#define CIP_SERVICE_FORWARD_CLOSE      0x4E
+
+#define ORIGINATOR_VENDOR_ID           0xFFF0
+#define ORIGINATOR_SERIAL_NUMBER       0x42454E43 /* "BENC" */
+
+/** @brief Send timestamps remembered per connection for the echo latency */
+#define ECHO_STAMP_RING                1024
+
+#define MAX_IO_DATA_SIZE               500
+#define RECEIVE_BATCH                  64
+
+typedef struct {
+  const char *host;
+  uint16_t port;
+  unsigned int connections;
+  uint32_t o2t_rpi_us;
+  uint32_t t2o_rpi_us;
+  unsigned int duration_s;
+  unsigned int warmup_s;
+  unsigned int o2t_point;
+  unsigned int t2o_point;
+  unsigned int config_point;
+  unsigned int o2t_size;
+  unsigned int t2o_size;
+  unsigned int timeout_multiplier;
+  uint8_t trigger; /**< production trigger bits of the transport class */
+  bool echo;
+  bool per_connection;
+} BenchConfig;
+
+typedef struct {
+  /* from Forward_Open */
+  bool open;
+  uint16_t connection_serial;
+  uint32_t o2t_connection_id;
+  uint32_t t2o_connection_id;
+  uint32_t o2t_api_us;
+  uint32_t t2o_api_us;
+
+  /* O->T, owned by the sender thread */
+  uint64_t next_send_ns;
+  uint32_t o2t_sequence;
+  uint16_t o2t_cip_sequence;
+  uint64_t sent;
+  uint64_t late_sends;
+  _Atomic uint64_t stamp_sent_ns[ECHO_STAMP_RING];
+
+  /* T->O, owned by the receiver thread */
+  bool have_first;
+  uint32_t first_sequence;
+  uint32_t highest_sequence;
+  uint64_t window; /**< bit n: highest_sequence - n received */
+  uint64_t last_arrival_ns;
+  uint64_t received;
+  uint64_t duplicates;
+  uint64_t reordered;
+  uint64_t gaps;
+  uint32_t last_stamp;
+  Histogram interval;
+  Histogram jitter;
+  Histogram echo_latency;
+} BenchConnection;
+
+static BenchConfig g_config = {
+  .host = NULL,
+  .port = 44818,
+  .connections = 1,
+  .o2t_rpi_us = 10000,
+  .t2o_rpi_us = 10000,
+  .duration_s = 10,
+  .warmup_s = 1,
+  .o2t_point = 150,
+  .t2o_point = 100,
+  .config_point = 151,
+  .o2t_size = 32,
+  .t2o_size = 32,
+  .timeout_multiplier = 2,
+  .trigger = 0x00,
+  .echo = false,
+  .per_connection = false,
+};
+
+static BenchConnection *g_connections;
+static int g_tcp_socket = -1;
+static int g_udp_socket = -1;
+static uint32_t g_session_handle;
+static struct sockaddr_in g_target_address;
+static atomic_bool g_stop;
+static atomic_bool g_measuring;
+
+/* ----- helpers ---------------------------------------------------------- */
+
+static uint64_t NowNs(clockid_t clock) {
+  struct timespec now;
+  clock_gettime(clock, &now);
+  return (uint64_t) now.tv_sec * 1000000000ULL + (uint64_t) now.tv_nsec;
+}
+
+static void PutUint16(uint8_t **buffer, uint16_t value) {
+  (*buffer)[0] = (uint8_t) value;
+  (*buffer)[1] = (uint8_t) (value >> 8);
+  *buffer += 2;
+}
+
+static void PutUint32(uint8_t **buffer, uint32_t value) {
+  PutUint16(buffer, (uint16_t) value);
+  PutUint16(buffer, (uint16_t) (value >> 16) );
+}
+
+static uint16_t GetUint16(const uint8_t *buffer) {
+  return (uint16_t) (buffer[0] | (buffer[1] << 8) );
+}
+
+static uint32_t GetUint32(const uint8_t *buffer) {
+  return (uint32_t) GetUint16(buffer) |
+         ( (uint32_t) GetUint16(buffer + 2) << 16 );
+}
+
+static void HandleSignal(int signal_number) {
+  (void) signal_number;
+  atomic_store(&g_stop, true);
+}
+
+/* ----- explicit messaging ---------------------------------------------- */
+
+static int ReceiveExactly(int socket_handle, uint8_t *buffer, size_t length) {
+  size_t received = 0;
+  while(received < length) {
+    ssize_t result = recv(socket_handle, buffer + received, length - received,
+                          0);
+    if(result <= 0) {
+      if(result < 0 && EINTR == errno) {
+        continue;
+      }
+      return -1;
+    }
+    received += (size_t) result;
+  }
+  return 0;
+}
+
+/** @brief Sends one encapsulation request and waits for its reply
+ *
+ *  @return length of the reply data after the encapsulation header, or -1
+ */
+static int EncapsulationTransaction(uint16_t command,
+                                    const uint8_t *data,
+                                    uint16_t data_length,
+                                    uint8_t *reply,
+                                    size_t reply_size) {
+  uint8_t request[ENCAP_HEADER_LENGTH + 600];
+  uint8_t *cursor = request;
+  PutUint16(&cursor, command);
+  PutUint16(&cursor, data_length);
+  PutUint32(&cursor, g_session_handle);
+  PutUint32(&cursor, 0); /* status */
+  memset(cursor, 0, 8); /* sender context */
+  cursor += 8;
+  PutUint32(&cursor, 0); /* options */
+  if(data_length > 0) {
+    memcpy(cursor, data, data_length);
+  }
+
+  size_t request_length = ENCAP_HEADER_LENGTH + data_length;
+  if(send(g_tcp_socket, request, request_length, MSG_NOSIGNAL) !=
+     (ssize_t) request_length) {
+    perror("send");
+    return -1;
+  }
+  if(ENCAP_COMMAND_UNREGISTER_SESSION == command) {
+    return 0; /* no reply */
+  }
+
+  uint8_t header[ENCAP_HEADER_LENGTH];
+  if(0 != ReceiveExactly(g_tcp_socket, header, sizeof(header) ) ) {
+    fprintf(stderr, "connection closed by target\n");
+    return -1;
+  }
+  uint16_t reply_length = GetUint16(header + 2);
+  uint32_t status = GetUint32(header + 8);
+  if(reply_length > reply_size ||
+     0 != ReceiveExactly(g_tcp_socket, reply, reply_length) ) {
+    fprintf(stderr, "invalid encapsulation reply\n");
+    return -1;
+  }
+  if(0 != status) {
+    fprintf(stderr, "encapsulation command 0x%04x failed, status 0x%08" PRIx32
+            "\n", command, status);
+    return -1;
+  }
+  if(ENCAP_COMMAND_REGISTER_SESSION == command) {
+    g_session_handle = GetUint32(header + 4);
+  }
+  return reply_length;
+}
+
+/** @brief Sends an unconnected request to the Connection Manager
+ *
+ *  @param t2o_port port for the T->O sockaddr info item, 0 to omit it
+ *  @return length of the message router response in @p response, or -1
+ */
+static int SendConnectionManagerRequest(const uint8_t *request,
+                                        uint16_t request_length,
+                                        uint16_t t2o_port,
+                                        uint8_t *response,
+                                        size_t response_size) {
+  uint8_t data[600];
+  uint8_t *cursor = data;
+  PutUint32(&cursor, 0); /* interface handle */
+  PutUint16(&cursor, 10); /* timeout */
+  PutUint16(&cursor, 0 != t2o_port ? 3 : 2);
+  PutUint16(&cursor, CPF_ITEM_NULL_ADDRESS);
+  PutUint16(&cursor, 0);
+  PutUint16(&cursor, CPF_ITEM_UNCONNECTED_DATA);
+  PutUint16(&cursor, request_length);
+  memcpy(cursor, request, request_length);
+  cursor += request_length;
+  if(0 != t2o_port) {
+    /* socket address fields are big endian */
+    PutUint16(&cursor, CPF_ITEM_SOCKADDR_INFO_T_TO_O);
+    PutUint16(&cursor, 16);
+    *cursor++ = 0;
+    *cursor++ = AF_INET;
+    memcpy(cursor, &t2o_port, 2); /* already in network byte order */
+    cursor += 2;
+    memset(cursor, 0, 12); /* address chosen by the target, sin_zero */
+    cursor += 12;
+  }
+
+  uint8_t reply[600];
+  int reply_length = EncapsulationTransaction(ENCAP_COMMAND_SEND_RR_DATA,
+                                              data,
+                                              (uint16_t) (cursor - data),
+                                              reply, sizeof(reply) );
+  if(reply_length < 0) {
+    return -1;
+  }
+
+  /* walk the CPF items to the unconnected data item */
+  if(reply_length < 8) {
+    return -1;
+  }
+  uint16_t item_count = GetUint16(reply + 6);
+  int offset = 8;
+  for(uint16_t i = 0; i < item_count && offset + 4 <= reply_length; i++) {
+    uint16_t type = GetUint16(reply + offset);
+    uint16_t length = GetUint16(reply + offset + 2);
+    offset += 4;
+    if(offset + length > reply_length) {
+      return -1;
+    }
+    if(CPF_ITEM_UNCONNECTED_DATA == type) {
+      if(length > response_size) {
+        return -1;
+      }
+      memcpy(response, reply + offset, length);
+      return length;
+    }
+    offset += length;
+  }
+  return -1;
+}
+
+/** @brief Encodes the application path, Forward_Close has a reserved byte
+ *  after the path size */
+static void PutConnectionPath(uint8_t **cursor, bool reserved_byte) {
+  *(*cursor)++ = g_config.config_point > 0xFF ? 6 : 4; /* size in words */
+  if(reserved_byte) {
+    *(*cursor)++ = 0;
+  }
+  *(*cursor)++ = 0x20; /* class 8 bit */
+  *(*cursor)++ = 0x04; /* assembly */
+  if(g_config.config_point > 0xFF) {
+    *(*cursor)++ = 0x25; /* instance 16 bit */
+    *(*cursor)++ = 0x00;
+    PutUint16(cursor, (uint16_t) g_config.config_point);
+    *(*cursor)++ = 0x2D; /* connection point 16 bit */
+    *(*cursor)++ = 0x00;
+    PutUint16(cursor, (uint16_t) g_config.o2t_point);
+    *(*cursor)++ = 0x2D;
+    *(*cursor)++ = 0x00;
+    PutUint16(cursor, (uint16_t) g_config.t2o_point);
+  } else {
+    *(*cursor)++ = 0x24; /* instance 8 bit */
+    *(*cursor)++ = (uint8_t) g_config.config_point;
+    *(*cursor)++ = 0x2C; /* connection point 8 bit */
+    *(*cursor)++ = (uint8_t) g_config.o2t_point;
+    *(*cursor)++ = 0x2C;
+    *(*cursor)++ = (uint8_t) g_config.t2o_point;
+  }
+}
+
+static void PutConnectionManagerPath(uint8_t **cursor, uint8_t service) {
+  *(*cursor)++ = service;
+  *(*cursor)++ = 2; /* path size in words */
+  *(*cursor)++ = 0x20;
+  *(*cursor)++ = 0x06; /* Connection Manager */
+  *(*cursor)++ = 0x24;
+  *(*cursor)++ = 0x01;
+}
+
+static void PrintCipError(const char *what,
+                          unsigned int index,
+                          const uint8_t *response,
+                          int length) {
+  uint8_t general_status = length >= 3 ? response[2] : 0xFF;
+  uint16_t extended_status = (length >= 6 && response[3] > 0) ?
+                             GetUint16(response + 4) : 0;
+  fprintf(stderr,
+          "%s of connection %u failed: general status 0x%02x, "
+          "extended status 0x%04x\n",
+          what, index, general_status, extended_status);
+}
+
+static int ForwardOpen(unsigned int index,
+                       BenchConnection *connection,
+                       uint16_t t2o_port) {
+  uint8_t request[100];
+  uint8_t *cursor = request;
+  PutConnectionManagerPath(&cursor, CIP_SERVICE_FORWARD_OPEN);
+  *cursor++ = 0x0A; /* priority/time tick */
+  *cursor++ = 0x0E; /* timeout ticks */
+  PutUint32(&cursor, 0); /* O->T connection ID, chosen by the target */
+  PutUint32(&cursor, connection->t2o_connection_id);
+  PutUint16(&cursor, connection->connection_serial);
+  PutUint16(&cursor, ORIGINATOR_VENDOR_ID);
+  PutUint32(&cursor, ORIGINATOR_SERIAL_NUMBER);
+  *cursor++ = (uint8_t) g_config.timeout_multiplier;
+  *cursor++ = 0;
+  *cursor++ = 0;
+  *cursor++ = 0;
+  /* point to point, scheduled priority, fixed size including the 16 bit
+   * sequence count */
+  PutUint32(&cursor, g_config.o2t_rpi_us);
+  PutUint16(&cursor, (uint16_t) (0x4800 | (g_config.o2t_size + 2) ) );
+  PutUint32(&cursor, g_config.t2o_rpi_us);
+  PutUint16(&cursor, (uint16_t) (0x4800 | (g_config.t2o_size + 2) ) );
+  *cursor++ = (uint8_t) (0x01 | g_config.trigger); /* class 1, client */
+  PutConnectionPath(&cursor, false);
+
+  uint8_t response[200];
+  int length = SendConnectionManagerRequest(request,
+                                            (uint16_t) (cursor - request),
+                                            t2o_port,
+                                            response, sizeof(response) );
+  if(length < 4 || response[0] != (CIP_SERVICE_FORWARD_OPEN | 0x80) ||
+     0 != response[2]) {
+    PrintCipError("Forward_Open", index, response, length);
+    return -1;
+  }
+  const uint8_t *reply = response + 4 + 2 * response[3];
+  if(reply + 26 > response + length) {
+    fprintf(stderr, "Forward_Open reply of connection %u too short\n", index);
+    return -1;
+  }
+  connection->o2t_connection_id = GetUint32(reply);
+  connection->t2o_connection_id = GetUint32(reply + 4);
+  connection->o2t_api_us = GetUint32(reply + 16);
+  connection->t2o_api_us = GetUint32(reply + 20);
+  connection->open = true;
+  return 0;
+}
+
+static void ForwardClose(unsigned int index, BenchConnection *connection) {
+  uint8_t request[100];
+  uint8_t *cursor = request;
+  PutConnectionManagerPath(&cursor, CIP_SERVICE_FORWARD_CLOSE);
+  *cursor++ = 0x0A;
+  *cursor++ = 0x0E;
+  PutUint16(&cursor, connection->connection_serial);
+  PutUint16(&cursor, ORIGINATOR_VENDOR_ID);
+  PutUint32(&cursor, ORIGINATOR_SERIAL_NUMBER);
+  PutConnectionPath(&cursor, true);
+
+  uint8_t response[200];
+  int length = SendConnectionManagerRequest(request,
+                                            (uint16_t) (cursor - request),
+                                            0,
+                                            response, sizeof(response) );
+  if(length < 4 || 0 != response[2]) {
+    PrintCipError("Forward_Close", index, response, length);
+  }
+  connection->open = false;
+}
+
+/* ----- implicit messaging ---------------------------------------------- */
+
+static void SendIoData(BenchConnection *connection, uint64_t now_realtime_ns) {
+  uint8_t frame[20 + MAX_IO_DATA_SIZE];
+  uint8_t *cursor = frame;
+  connection->o2t_sequence++;
+  connection->o2t_cip_sequence++;
+  PutUint16(&cursor, 2); /* item count */
+  PutUint16(&cursor, CPF_ITEM_SEQUENCED_ADDRESS);
+  PutUint16(&cursor, 8);
+  PutUint32(&cursor, connection->o2t_connection_id);
+  PutUint32(&cursor, connection->o2t_sequence);
+  PutUint16(&cursor, CPF_ITEM_CONNECTED_DATA);
+  PutUint16(&cursor, (uint16_t) (g_config.o2t_size + 2) );
+  PutUint16(&cursor, connection->o2t_cip_sequence);
+  memset(cursor, 0, g_config.o2t_size);
+  if(g_config.o2t_size >= 4) {
+    /* the stamp comes back in the echoed input data */
+    uint8_t *stamp = cursor;
+    PutUint32(&stamp, connection->o2t_sequence);
+    atomic_store_explicit(
+      &connection->stamp_sent_ns[connection->o2t_sequence % ECHO_STAMP_RING],
+      now_realtime_ns, memory_order_relaxed);
+  }
+  cursor += g_config.o2t_size;
+
+  if(sendto(g_udp_socket, frame, (size_t) (cursor - frame), 0,
+            (const struct sockaddr *) &g_target_address,
+            sizeof(g_target_address) ) < 0 && EINTR != errno) {
+    perror("sendto");
+  }
+  connection->sent++;
+}
+
+static void *SenderThread(void *argument) {
+  (void) argument;
+  uint64_t now = NowNs(CLOCK_MONOTONIC);
+  for(unsigned int i = 0; i < g_config.connections; i++) {
+    /* spread the connections over one RPI */
+    g_connections[i].next_send_ns = now +
+                                    (uint64_t) g_connections[i].o2t_api_us *
+                                    1000ULL * i / g_config.connections;
+  }
+
+  while(!atomic_load(&g_stop) ) {
+    uint64_t next = UINT64_MAX;
+    for(unsigned int i = 0; i < g_config.connections; i++) {
+      if(g_connections[i].open && g_connections[i].next_send_ns < next) {
+        next = g_connections[i].next_send_ns;
+      }
+    }
+    if(UINT64_MAX == next) {
+      break;
+    }
+    struct timespec deadline = {
+      .tv_sec = (time_t) (next / 1000000000ULL),
+      .tv_nsec = (long) (next % 1000000000ULL)
+    };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL);
+
+    now = NowNs(CLOCK_MONOTONIC);
+    uint64_t now_realtime = NowNs(CLOCK_REALTIME);
+    for(unsigned int i = 0; i < g_config.connections; i++) {
+      BenchConnection *connection = &g_connections[i];
+      if(!connection->open || connection->next_send_ns > now) {
+        continue;
+      }
+      SendIoData(connection, now_realtime);
+      uint64_t period = (uint64_t) connection->o2t_api_us * 1000ULL;
+      connection->next_send_ns += period;
+      if(connection->next_send_ns <= now) {
+        /* more than one RPI behind, skip instead of bursting */
+        uint64_t missed = (now - connection->next_send_ns) / period + 1;
+        connection->late_sends += missed;
+        connection->next_send_ns += missed * period;
+      }
+    }
+  }
+  return NULL;
+}
+
+static BenchConnection *FindConnection(uint32_t t2o_connection_id) {
+  for(unsigned int i = 0; i < g_config.connections; i++) {
+    if(g_connections[i].open &&
+       g_connections[i].t2o_connection_id == t2o_connection_id) {
+      return &g_connections[i];
+    }
+  }
+  return NULL;
+}
+
+static void AccountIoData(BenchConnection *connection,
+                          uint32_t sequence,
+                          const uint8_t *data,
+                          size_t data_length,
+                          uint64_t arrival_ns) {
+  if(!atomic_load_explicit(&g_measuring, memory_order_relaxed) ) {
+    return;
+  }
+  if(!connection->have_first) {
+    connection->have_first = true;
+    connection->first_sequence = sequence;
+    connection->highest_sequence = sequence;
+    connection->window = 1;
+    connection->received = 1;
+    connection->last_arrival_ns = arrival_ns;
+    return;
+  }
+
+  int32_t distance = (int32_t) (sequence - connection->highest_sequence);
+  if(distance > 0) {
+    if(1 == distance) {
+      uint64_t interval_us = (arrival_ns - connection->last_arrival_ns) / 1000U;
+      int64_t deviation = (int64_t) interval_us -
+                          (int64_t) connection->t2o_api_us;
+      HistogramRecord(&connection->interval, interval_us);
+      HistogramRecord(&connection->jitter,
+                      (uint64_t) (deviation < 0 ? -deviation : deviation) );
+    } else {
+      connection->gaps++;
+    }
+    connection->window = (distance >= 64) ? 1 :
+                         (connection->window << distance) | 1U;
+    connection->highest_sequence = sequence;
+    connection->last_arrival_ns = arrival_ns;
+    connection->received++;
+  } else if(-distance < 64) {
+    uint64_t bit = 1ULL << (unsigned int) -distance;
+    if(0 != (connection->window & bit) ) {
+      connection->duplicates++;
+      return;
+    }
+    connection->window |= bit;
+    connection->reordered++;
+    connection->received++;
+  } else {
+    connection->reordered++;
+    connection->received++;
+  }
+
+  if(g_config.echo && data_length >= 4) {
+    uint32_t stamp = GetUint32(data);
+    if(stamp != connection->last_stamp && 0 != stamp) {
+      connection->last_stamp = stamp;
+      uint64_t sent_ns = atomic_load_explicit(
+        &connection->stamp_sent_ns[stamp % ECHO_STAMP_RING],
+        memory_order_relaxed);
+      if(0 != sent_ns && arrival_ns > sent_ns) {
+        HistogramRecord(&connection->echo_latency,
+                        (arrival_ns - sent_ns) / 1000U);
+      }
+    }
+  }
+}
+
+static uint64_t ArrivalTimestamp(struct msghdr *header) {
+  for(struct cmsghdr *cmsg = CMSG_FIRSTHDR(header); NULL != cmsg;
+      cmsg = CMSG_NXTHDR(header, cmsg) ) {
+    if(SOL_SOCKET == cmsg->cmsg_level && SCM_TIMESTAMPNS == cmsg->cmsg_type) {
+      struct timespec stamp;
+      memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp) );
+      return (uint64_t) stamp.tv_sec * 1000000000ULL +
+             (uint64_t) stamp.tv_nsec;
+    }
+  }
+  return NowNs(CLOCK_REALTIME);
+}
+
+static void *ReceiverThread(void *argument) {
+  (void) argument;
+  static uint8_t buffers[RECEIVE_BATCH][1500];
+  static uint8_t controls[RECEIVE_BATCH][CMSG_SPACE(sizeof(struct timespec) )];
+  struct mmsghdr messages[RECEIVE_BATCH];
+  struct iovec iovecs[RECEIVE_BATCH];
+
+  while(!atomic_load(&g_stop) ) {
+    for(int i = 0; i < RECEIVE_BATCH; i++) {
+      iovecs[i].iov_base = buffers[i];
+      iovecs[i].iov_len = sizeof(buffers[i]);
+      memset(&messages[i], 0, sizeof(messages[i]) );
+      messages[i].msg_hdr.msg_iov = &iovecs[i];
+      messages[i].msg_hdr.msg_iovlen = 1;
+      messages[i].msg_hdr.msg_control = controls[i];
+      messages[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+    }
+    int count = recvmmsg(g_udp_socket, messages, RECEIVE_BATCH,
+                         MSG_WAITFORONE, NULL);
+    if(count < 0) {
+      if(EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno) {
+        perror("recvmmsg");
+      }
+      continue;
+    }
+
+    for(int i = 0; i < count; i++) {
+      const uint8_t *frame = buffers[i];
+      size_t length = messages[i].msg_len;
+      /* item count, sequenced address item, connected data item */
+      if(length < 22 || GetUint16(frame) < 2 ||
+         CPF_ITEM_SEQUENCED_ADDRESS != GetUint16(frame + 2) ||
+         CPF_ITEM_CONNECTED_DATA != GetUint16(frame + 14) ) {
+        continue;
+      }
+      BenchConnection *connection = FindConnection(GetUint32(frame + 6) );
+      uint16_t data_length = GetUint16(frame + 16);
+      if(NULL == connection || 18U + data_length > length ||
+         data_length < 2) {
+        continue;
+      }
+      /* skip the 16 bit sequence count */
+      AccountIoData(connection, GetUint32(frame + 10), frame + 20,
+                    data_length - 2U,
+                    ArrivalTimestamp(&messages[i].msg_hdr) );
+    }
+  }
+  return NULL;
+}
+
+/* ----- setup and report ------------------------------------------------ */
+
+static int OpenSockets(void) {
+  struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+  struct addrinfo *result = NULL;
+  if(0 != getaddrinfo(g_config.host, NULL, &hints, &result) ) {
+    fprintf(stderr, "cannot resolve %s\n", g_config.host);
+    return -1;
+  }
+  memcpy(&g_target_address, result->ai_addr, sizeof(g_target_address) );
+  freeaddrinfo(result);
+
+  struct sockaddr_in tcp_address = g_target_address;
+  tcp_address.sin_port = htons(g_config.port);
+  g_tcp_socket = socket(AF_INET, SOCK_STREAM, 0);
+  if(g_tcp_socket < 0 ||
+     0 != connect(g_tcp_socket, (struct sockaddr *) &tcp_address,
+                  sizeof(tcp_address) ) ) {
+    perror("connect");
+    return -1;
+  }
+  int option = 1;
+  setsockopt(g_tcp_socket, IPPROTO_TCP, TCP_NODELAY, &option, sizeof(option) );
+
+  g_udp_socket = socket(AF_INET, SOCK_DGRAM, 0);
+  struct sockaddr_in udp_address = {
+    .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_ANY), .sin_port = 0
+  };
+  if(g_udp_socket < 0 ||
+     0 != bind(g_udp_socket, (struct sockaddr *) &udp_address,
+               sizeof(udp_address) ) ) {
+    perror("bind");
+    return -1;
+  }
+  setsockopt(g_udp_socket, SOL_SOCKET, SO_TIMESTAMPNS, &option,
+             sizeof(option) );
+  int buffer_size = 4 * 1024 * 1024;
+  setsockopt(g_udp_socket, SOL_SOCKET, SO_RCVBUF, &buffer_size,
+             sizeof(buffer_size) );
+  /* lets the receiver thread notice g_stop */
+  struct timeval receive_timeout = { .tv_sec = 0, .tv_usec = 200000 };
+  setsockopt(g_udp_socket, SOL_SOCKET, SO_RCVTIMEO, &receive_timeout,
+             sizeof(receive_timeout) );
+
+  g_target_address.sin_port = htons(2222);
+  return 0;
+}
+
+static void PrintHistogram(const char *name, const Histogram *histogram) {
+  if(0 == histogram->count) {
+    printf("  %-18s no samples\n", name);
+    return;
+  }
+  printf("  %-18s n=%-9" PRIu64 " min=%-7" PRIu64 " p50=%-7" PRIu64
+         " p99=%-7" PRIu64 " p99.9=%-7" PRIu64 " max=%" PRIu64 " us\n",
+         name, histogram->count, histogram->min,
+         HistogramPercentile(histogram, 50.0),
+         HistogramPercentile(histogram, 99.0),
+         HistogramPercentile(histogram, 99.9),
+         histogram->max);
+}
+
+static uint64_t ExpectedPackets(const BenchConnection *connection) {
+  return connection->have_first ?
+         (uint64_t) (connection->highest_sequence -
+                     connection->first_sequence) + 1U : 0U;
+}
+
+static void Report(double measured_s) {
+  Histogram interval, jitter, echo_latency;
+  HistogramInit(&interval);
+  HistogramInit(&jitter);
+  HistogramInit(&echo_latency);
+  uint64_t sent = 0, late = 0, received = 0, expected = 0, gaps = 0;
+  uint64_t duplicates = 0, reordered = 0;
+  unsigned int opened = 0;
+
+  for(unsigned int i = 0; i < g_config.connections; i++) {
+    BenchConnection *connection = &g_connections[i];
+    if(0 == connection->o2t_api_us) {
+      continue; /* never opened */
+    }
+    opened++;
+    HistogramMerge(&interval, &connection->interval);
+    HistogramMerge(&jitter, &connection->jitter);
+    HistogramMerge(&echo_latency, &connection->echo_latency);
+    sent += connection->sent;
+    late += connection->late_sends;
+    received += connection->received;
+    expected += ExpectedPackets(connection);
+    gaps += connection->gaps;
+    duplicates += connection->duplicates;
+    reordered += connection->reordered;
+
+    if(g_config.per_connection) {
+      printf("connection %u: T->O id 0x%08" PRIx32 " API %" PRIu32
+             " us, received %" PRIu64 ", lost %" PRIu64 ", gaps %" PRIu64
+             "\n", i, connection->t2o_connection_id, connection->t2o_api_us,
+             connection->received,
+             ExpectedPackets(connection) - connection->received,
+             connection->gaps);
+      PrintHistogram("interval", &connection->interval);
+    }
+  }
+
+  uint64_t lost = expected > received ? expected - received : 0;
+  printf("\nconnections  %u of %u open, O->T RPI %" PRIu32 " us, T->O RPI %"
+         PRIu32 " us, %.1f s measured\n", opened, g_config.connections,
+         g_config.o2t_rpi_us, g_config.t2o_rpi_us, measured_s);
+  printf("O->T         sent %" PRIu64 ", late (skipped) %" PRIu64 "\n",
+         sent, late);
+  printf("T->O         received %" PRIu64 " (%.0f pkt/s), lost %" PRIu64
+         " (%.4f %%), gaps %" PRIu64 ", duplicates %" PRIu64
+         ", reordered %" PRIu64 "\n",
+         received, measured_s > 0 ? (double) received / measured_s : 0.0,
+         lost, expected > 0 ? 100.0 * (double) lost / (double) expected : 0.0,
+         gaps, duplicates, reordered);
+  PrintHistogram("T->O interval", &interval);
+  PrintHistogram("T->O jitter", &jitter);
+  if(g_config.echo) {
+    PrintHistogram("echo latency", &echo_latency);
+  }
+
+  /* one line for scripts */
+  printf("RESULT connections=%u rpi_us=%" PRIu32 " received=%" PRIu64
+         " lost=%" PRIu64 " gaps=%" PRIu64 " p50_us=%" PRIu64 " p99_us=%"
+         PRIu64 " p999_us=%" PRIu64 " jitter_p99_us=%" PRIu64 "\n",
+         opened, g_config.t2o_rpi_us, received, lost, gaps,
+         HistogramPercentile(&interval, 50.0),
+         HistogramPercentile(&interval, 99.0),
+         HistogramPercentile(&interval, 99.9),
+         HistogramPercentile(&jitter, 99.0) );
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [options] <target>\n"
+          "  -n, --connections N     class 1 connections to open (1)\n"
+          "  -r, --rpi US            O->T and T->O RPI in microseconds (10000)\n"
+          "      --o2t-rpi US        O->T RPI only\n"
+          "      --t2o-rpi US        T->O RPI only\n"
+          "  -d, --duration S        measurement time in seconds (10)\n"
+          "  -w, --warmup S          time excluded from the statistics (1)\n"
+          "      --o2t-point N       consumed connection point (150)\n"
+          "      --t2o-point N       produced connection point (100)\n"
+          "      --config-point N    configuration instance (151)\n"
+          "      --o2t-size N        O->T data size in bytes (32)\n"
+          "      --t2o-size N        T->O data size in bytes (32)\n"
+          "      --timeout-mult N    connection timeout multiplier index (2)\n"
+          "      --trigger T         production trigger: cyclic, cos or\n"
+          "                          application (cyclic)\n"
+          "  -e, --echo              measure echo latency, needs a target that\n"
+          "                          echoes output into input (host build)\n"
+          "  -p, --per-connection    print statistics per connection\n"
+          "      --port N            encapsulation TCP port (44818)\n",
+          program);
+}
+
+static int ParseArguments(int argc, char *argv[]) {
+  enum {
+    kOptionO2tRpi = 256, kOptionT2oRpi, kOptionO2tPoint, kOptionT2oPoint,
+    kOptionConfigPoint, kOptionO2tSize, kOptionT2oSize, kOptionTimeoutMult,
+    kOptionTrigger, kOptionPort
+  };
+  static const struct option options[] = {
+    { "connections", required_argument, NULL, 'n' },
+    { "rpi", required_argument, NULL, 'r' },
+    { "o2t-rpi", required_argument, NULL, kOptionO2tRpi },
+    { "t2o-rpi", required_argument, NULL, kOptionT2oRpi },
+    { "duration", required_argument, NULL, 'd' },
+    { "warmup", required_argument, NULL, 'w' },
+    { "o2t-point", required_argument, NULL, kOptionO2tPoint },
+    { "t2o-point", required_argument, NULL, kOptionT2oPoint },
+    { "config-point", required_argument, NULL, kOptionConfigPoint },
+    { "o2t-size", required_argument, NULL, kOptionO2tSize },
+    { "t2o-size", required_argument, NULL, kOptionT2oSize },
+    { "timeout-mult", required_argument, NULL, kOptionTimeoutMult },
+    { "trigger", required_argument, NULL, kOptionTrigger },
+    { "echo", no_argument, NULL, 'e' },
+    { "per-connection", no_argument, NULL, 'p' },
+    { "port", required_argument, NULL, kOptionPort },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int option;
+  while(-1 != (option = getopt_long(argc, argv, "n:r:d:w:eph", options,
+                                    NULL) ) ) {
+    unsigned long value = (NULL != optarg) ? strtoul(optarg, NULL, 0) : 0;
+    switch(option) {
+      case 'n': g_config.connections = (unsigned int) value; break;
+      case 'r':
+        g_config.o2t_rpi_us = g_config.t2o_rpi_us = (uint32_t) value;
+        break;
+      case kOptionO2tRpi: g_config.o2t_rpi_us = (uint32_t) value; break;
+      case kOptionT2oRpi: g_config.t2o_rpi_us = (uint32_t) value; break;
+      case 'd': g_config.duration_s = (unsigned int) value; break;
+      case 'w': g_config.warmup_s = (unsigned int) value; break;
+      case kOptionO2tPoint: g_config.o2t_point = (unsigned int) value; break;
+      case kOptionT2oPoint: g_config.t2o_point = (unsigned int) value; break;
+      case kOptionConfigPoint:
+        g_config.config_point = (unsigned int) value;
+        break;
+      case kOptionO2tSize: g_config.o2t_size = (unsigned int) value; break;
+      case kOptionT2oSize: g_config.t2o_size = (unsigned int) value; break;
+      case kOptionTimeoutMult:
+        g_config.timeout_multiplier = (unsigned int) value;
+        break;
+      case kOptionTrigger:
+        if(0 == strcmp(optarg, "cyclic") ) {
+          g_config.trigger = 0x00;
+        } else if(0 == strcmp(optarg, "cos") ) {
+          g_config.trigger = 0x10;
+        } else if(0 == strcmp(optarg, "application") ) {
+          g_config.trigger = 0x20;
+        } else {
+          return -1;
+        }
+        break;
+      case 'e': g_config.echo = true; break;
+      case 'p': g_config.per_connection = true; break;
+      case kOptionPort: g_config.port = (uint16_t) value; break;
+      default:
+        return -1;
+    }
+  }
+  if(optind != argc - 1 || 0 == g_config.connections ||
+     0 == g_config.o2t_rpi_us || 0 == g_config.t2o_rpi_us ||
+     g_config.o2t_size > MAX_IO_DATA_SIZE ||
+     g_config.t2o_size > MAX_IO_DATA_SIZE ||
+     g_config.timeout_multiplier > 7) {
+    return -1;
+  }
+  g_config.host = argv[optind];
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if(0 != ParseArguments(argc, argv) ) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action) );
+  action.sa_handler = HandleSignal;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+
+  g_connections = calloc(g_config.connections, sizeof(BenchConnection) );
+  if(NULL == g_connections || 0 != OpenSockets() ) {
+    return EXIT_FAILURE;
+  }
+
+  uint8_t register_data[4] = { 1, 0, 0, 0 }; /* protocol version 1 */
+  uint8_t reply[64];
+  if(EncapsulationTransaction(ENCAP_COMMAND_REGISTER_SESSION, register_data,
+                              sizeof(register_data), reply,
+                              sizeof(reply) ) < 0) {
+    return EXIT_FAILURE;
+  }
+
+  struct sockaddr_in local_udp;
+  socklen_t local_udp_length = sizeof(local_udp);
+  getsockname(g_udp_socket, (struct sockaddr *) &local_udp, &local_udp_length);
+
+  /* connection IDs and serial numbers unique per run */
+  srand( (unsigned int) NowNs(CLOCK_REALTIME) );
+  uint32_t id_base = ( (uint32_t) rand() << 16 ) ^ (uint32_t) rand();
+  uint16_t serial_base = (uint16_t) rand();
+  unsigned int opened = 0;
+  for(unsigned int i = 0; i < g_config.connections && !g_stop; i++) {
+    BenchConnection *connection = &g_connections[i];
+    HistogramInit(&connection->interval);
+    HistogramInit(&connection->jitter);
+    HistogramInit(&connection->echo_latency);
+    connection->connection_serial = (uint16_t) (serial_base + i);
+    connection->t2o_connection_id = id_base + i;
+    if(0 == ForwardOpen(i, connection, local_udp.sin_port) ) {
+      opened++;
+    }
+  }
+  printf("opened %u of %u connections\n", opened, g_config.connections);
+
+  pthread_t sender, receiver;
+  if(opened > 0) {
+    pthread_create(&receiver, NULL, ReceiverThread, NULL);
+    pthread_create(&sender, NULL, SenderThread, NULL);
+
+    struct timespec warmup = { .tv_sec = g_config.warmup_s, .tv_nsec = 0 };
+    while(0 != nanosleep(&warmup, &warmup) && !g_stop) {
+    }
+    uint64_t start = NowNs(CLOCK_MONOTONIC);
+    atomic_store(&g_measuring, true);
+    struct timespec duration = { .tv_sec = g_config.duration_s, .tv_nsec = 0 };
+    while(0 != nanosleep(&duration, &duration) && !g_stop) {
+    }
+    atomic_store(&g_measuring, false);
+    double measured_s = (double) (NowNs(CLOCK_MONOTONIC) - start) / 1e9;
+
+    atomic_store(&g_stop, true);
+    pthread_join(sender, NULL);
+    pthread_join(receiver, NULL);
+    Report(measured_s);
+  }
+
+  for(unsigned int i = 0; i < g_config.connections; i++) {
+    if(g_connections[i].open) {
+      ForwardClose(i, &g_connections[i]);
+    }
+  }
+  EncapsulationTransaction(ENCAP_COMMAND_UNREGISTER_SESSION, NULL, 0, NULL, 0);
+  close(g_tcp_socket);
+  close(g_udp_socket);
+  free(g_connections);
+  return opened == g_config.connections ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,81 @@
+#include <string.h>
+
+#include "histogram.h"
+
+enum {
+  kSubBuckets = 1 << HISTOGRAM_SUB_BUCKET_BITS
+};
+
+static unsigned int HistogramIndex(uint64_t value) {
+  if(value < 2 * kSubBuckets) {
+    return (unsigned int) value;
+  }
+  unsigned int msb = 63U - (unsigned int) __builtin_clzll(value);
+  unsigned int shift = msb - HISTOGRAM_SUB_BUCKET_BITS;
+  /* value >> shift lies in [kSubBuckets, 2 * kSubBuckets) */
+  return shift * kSubBuckets + (unsigned int) (value >> shift);
+}
+
+static uint64_t HistogramUpperBound(unsigned int index) {
+  if(index < 2 * kSubBuckets) {
+    return index;
+  }
+  unsigned int shift = index / kSubBuckets - 1U;
+  uint64_t mantissa = index - shift * kSubBuckets;
+  return ( (mantissa + 1U) << shift ) - 1U;
+}
+
+void HistogramInit(Histogram *histogram) {
+  memset(histogram, 0, sizeof(*histogram) );
+  histogram->min = UINT64_MAX;
+}
+
+void HistogramRecord(Histogram *histogram, uint64_t value) {
+  histogram->buckets[HistogramIndex(value)]++;
+  histogram->count++;
+  if(value < histogram->min) {
+    histogram->min = value;
+  }
+  if(value > histogram->max) {
+    histogram->max = value;
+  }
+}
+
+void HistogramMerge(Histogram *target, const Histogram *source) {
+  if(0 == source->count) {
+    return;
+  }
+  for(unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    target->buckets[i] += source->buckets[i];
+  }
+  target->count += source->count;
+  if(source->min < target->min) {
+    target->min = source->min;
+  }
+  if(source->max > target->max) {
+    target->max = source->max;
+  }
+}
+
+uint64_t HistogramPercentile(const Histogram *histogram, double percentile) {
+  if(0 == histogram->count) {
+    return 0;
+  }
+  /* rank of the value, rounded up */
+  uint64_t rank = (uint64_t) (percentile / 100.0 * (double) histogram->count);
+  if( (double) rank < percentile / 100.0 * (double) histogram->count ) {
+    rank++;
+  }
+  if(0 == rank) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for(unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    seen += histogram->buckets[i];
+    if(seen >= rank) {
+      uint64_t bound = HistogramUpperBound(i);
+      return bound > histogram->max ? histogram->max : bound;
+    }
+  }
+  return histogram->max;
+}
@@ -0,0 +1,41 @@
+#ifndef EIP_IO_BENCH_HISTOGRAM_H_
+#define EIP_IO_BENCH_HISTOGRAM_H_
+
+/** @file histogram.h
+ *  @brief Log-linear histogram of microsecond values
+ *
+ *  Values below 64 are counted exactly, larger values in 32 buckets per
+ *  power of two, i.e. with a relative error of at most 3 %. Memory use is
+ *  fixed, so every connection can have its own histograms.
+ */
+
+#include <stdint.h>
+
+#define HISTOGRAM_SUB_BUCKET_BITS 5
+#define HISTOGRAM_BUCKETS ( (65 - HISTOGRAM_SUB_BUCKET_BITS) << \
+                            HISTOGRAM_SUB_BUCKET_BITS )
+
+typedef struct {
+  uint64_t count;
+  uint64_t min;
+  uint64_t max;
+  uint32_t buckets[HISTOGRAM_BUCKETS];
+} Histogram;
+
+/** @brief Clears a histogram */
+void HistogramInit(Histogram *histogram);
+
+/** @brief Counts one value */
+void HistogramRecord(Histogram *histogram, uint64_t value);
+
+/** @brief Adds all values counted in @p source to @p target */
+void HistogramMerge(Histogram *target, const Histogram *source);
+
+/** @brief Returns the value below which @p percentile percent of the values
+ *  lie, 0 for an empty histogram
+ *
+ *  The result is the upper bound of the bucket, clamped to the maximum.
+ */
+uint64_t HistogramPercentile(const Histogram *histogram, double percentile);
+
+#endif /* EIP_IO_BENCH_HISTOGRAM_H_ */
@@ -0,0 +1,973 @@
+/** @file modbus_bench.c
+ *  @brief ModbusTCP load generator, latency benchmark and conformance check
+ *
+ *  Opens N connections and keeps up to the pipelining depth of requests
+ *  outstanding on each, drawn from a weighted mix of
+ *  - FC 03, read holding registers 100.. (output assembly 150),
+ *  - FC 04, read input registers 0.. (input assembly 100),
+ *  - FC 16, write the holding registers owned by the connection.
+ *
+ *  Every response is checked against its request (transaction, unit and
+ *  function code, lengths, echoed address and quantity). The holding
+ *  registers 100-115 are split among up to 16 connections, each writes only
+ *  its own and reads must return what it wrote last. Connections beyond 16
+ *  own none and read instead of writing. The addresses are those of the
+ *  default register map, MODBUS_REGISTER_MAP_DEFAULT in modbus_register_map.c.
+ *
+ *  Before the load, a separate connection runs conformance checks: exception
+ *  codes for unmapped addresses, invalid quantities and unsupported function
+ *  codes, write/read back, the 32 bit timestamp at input registers 200-201
+ *  and device identification. The original values of the holding registers
+ *  100-115 are written back at the end.
+ *
+ *  Works against the device or against tools/modbus_tcp_host.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+
+#include "histogram.h"
+
+#define MBAP_HEADER_LENGTH             7
+#define MAX_PDU_LENGTH                 253
+#define MAX_ADU_LENGTH                 (MBAP_HEADER_LENGTH + MAX_PDU_LENGTH)
+
+#define FC_READ_HOLDING_REGISTERS      0x03
+#define FC_READ_INPUT_REGISTERS        0x04
+#define FC_WRITE_MULTIPLE_REGISTERS    0x10
+#define FC_ENCAPSULATED_INTERFACE      0x2B
+#define MEI_READ_DEVICE_ID             0x0E
+
+#define EXCEPTION_ILLEGAL_FUNCTION     0x01
+#define EXCEPTION_ILLEGAL_DATA_ADDRESS 0x02
+#define EXCEPTION_ILLEGAL_DATA_VALUE   0x03
+
+/* Default register map */
+#define HOLDING_START                  100
+#define HOLDING_COUNT                  16
+#define INPUT_START                    0
+#define INPUT_COUNT                    16
+#define TIMESTAMP_START                200
+#define TIMESTAMP_LOW_REGISTER         14 /* assembly bytes 28-29 */
+#define TIMESTAMP_MAX_ADVANCE_US       1000000
+
+#define MAX_DEPTH                      64
+#define CONTROL_TIMEOUT_MS             2000
+#define DRAIN_TIMEOUT_MS               1000
+
+enum {
+  kWorkloadRead = 0,
+  kWorkloadInput,
+  kWorkloadWrite,
+  kWorkloadCount
+};
+
+typedef struct {
+  const char *host;
+  uint16_t port;
+  uint8_t unit;
+  unsigned int connections;
+  unsigned int depth;
+  unsigned int quantity;
+  unsigned int duration_s;
+  unsigned int warmup_s;
+  unsigned int mix[kWorkloadCount];
+  bool conformance;
+  bool check_values;
+  bool per_connection;
+} BenchConfig;
+
+typedef struct {
+  uint16_t transaction_id;
+  uint8_t workload;
+  uint16_t address;
+  uint16_t quantity;
+  bool check_window;
+  uint16_t window[HOLDING_COUNT]; /* expected values of the own registers */
+  uint64_t sent_ns;
+} PendingRequest;
+
+typedef struct {
+  int socket;
+  bool open;
+  uint16_t window_start;
+  uint16_t window_count;
+  bool window_known;
+  uint16_t window[HOLDING_COUNT];
+  uint16_t next_transaction_id;
+  uint32_t sequence;
+  uint64_t random;
+  PendingRequest pending[MAX_DEPTH];
+  unsigned int pending_head;
+  unsigned int pending_count;
+  uint8_t rx[MAX_DEPTH * MAX_ADU_LENGTH];
+  size_t rx_length;
+  uint8_t tx[MAX_DEPTH * MAX_ADU_LENGTH];
+  size_t tx_length;
+  uint64_t transactions[kWorkloadCount];
+  uint64_t exceptions;
+  uint64_t malformed;
+  uint64_t mismatches;
+  Histogram latency[kWorkloadCount];
+} BenchConnection;
+
+static BenchConfig g_config = {
+  .port = 502,
+  .unit = 1,
+  .connections = 1,
+  .depth = 1,
+  .quantity = 8,
+  .duration_s = 10,
+  .warmup_s = 1,
+  .mix = { 40, 40, 20 },
+  .conformance = true,
+  .check_values = true,
+};
+
+static const char *const kWorkloadNames[kWorkloadCount] = {
+  "FC03 read", "FC04 read", "FC16 write"
+};
+static const uint8_t kWorkloadFunctionCodes[kWorkloadCount] = {
+  FC_READ_HOLDING_REGISTERS, FC_READ_INPUT_REGISTERS,
+  FC_WRITE_MULTIPLE_REGISTERS
+};
+
+static BenchConnection *g_connections;
+static struct sockaddr_in g_target_address;
+static volatile sig_atomic_t g_stop;
+static bool g_measuring;
+static unsigned int g_conformance_failures;
+
+static uint64_t NowNs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+static void PutUint16(uint8_t **buffer, uint16_t value) {
+  (*buffer)[0] = (uint8_t) (value >> 8);
+  (*buffer)[1] = (uint8_t) value;
+  *buffer += 2;
+}
+
+static uint16_t GetUint16(const uint8_t *buffer) {
+  return (uint16_t) ( (buffer[0] << 8) | buffer[1] );
+}
+
+static void HandleSignal(int signal_number) {
+  (void) signal_number;
+  g_stop = 1;
+}
+
+/* xorshift64, one generator per connection */
+static uint32_t NextRandom(uint64_t *state) {
+  uint64_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  *state = x;
+  return (uint32_t) (x >> 32);
+}
+
+static int Connect(void) {
+  int socket_handle = socket(AF_INET, SOCK_STREAM, 0);
+  if(socket_handle < 0) {
+    perror("socket");
+    return -1;
+  }
+  int one = 1;
+  setsockopt(socket_handle, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one) );
+  if(0 != connect(socket_handle, (struct sockaddr *) &g_target_address,
+                  sizeof(g_target_address) ) ) {
+    perror("connect");
+    close(socket_handle);
+    return -1;
+  }
+  return socket_handle;
+}
+
+/* Writes the MBAP header for a PDU of pdu_length bytes */
+static void PutMbapHeader(uint8_t *frame, uint16_t transaction_id,
+                          uint8_t unit, size_t pdu_length) {
+  uint8_t *cursor = frame;
+  PutUint16(&cursor, transaction_id);
+  PutUint16(&cursor, 0); /* protocol identifier */
+  PutUint16(&cursor, (uint16_t) (pdu_length + 1) );
+  *cursor = unit;
+}
+
+/* Checks the MBAP header of a complete response frame, returns the PDU
+ * length or -1 */
+static int CheckMbapHeader(const uint8_t *frame, size_t frame_length,
+                           uint16_t transaction_id, uint8_t unit) {
+  if(GetUint16(frame) != transaction_id || 0 != GetUint16(frame + 2) ||
+     frame[6] != unit || frame_length < MBAP_HEADER_LENGTH + 1) {
+    return -1;
+  }
+  return (int) (frame_length - MBAP_HEADER_LENGTH);
+}
+
+/* Length of the frame at the start of buffer, 0 if incomplete, -1 if the
+ * header is invalid */
+static int FrameLength(const uint8_t *buffer, size_t length) {
+  if(length < 6) {
+    return 0;
+  }
+  uint16_t mbap_length = GetUint16(buffer + 4);
+  if(mbap_length < 2 || mbap_length > MAX_PDU_LENGTH + 1) {
+    return -1;
+  }
+  return length >= 6U + mbap_length ? 6 + mbap_length : 0;
+}
+
+/* ---- control connection: conformance checks and register backup ---- */
+
+static int g_control_socket = -1;
+static uint16_t g_control_transaction_id;
+
+/* Sends one request and waits for its response, returns the response PDU
+ * length or -1 on a transport or header error */
+static int ControlTransaction(uint8_t unit, const uint8_t *pdu,
+                              size_t pdu_length, uint8_t *response_pdu) {
+  uint8_t frame[MAX_ADU_LENGTH];
+  uint16_t transaction_id = ++g_control_transaction_id;
+  PutMbapHeader(frame, transaction_id, unit, pdu_length);
+  memcpy(frame + MBAP_HEADER_LENGTH, pdu, pdu_length);
+  if(send(g_control_socket, frame, MBAP_HEADER_LENGTH + pdu_length,
+          MSG_NOSIGNAL) != (ssize_t) (MBAP_HEADER_LENGTH + pdu_length) ) {
+    return -1;
+  }
+
+  size_t received = 0;
+  int frame_length = 0;
+  while(0 == (frame_length = FrameLength(frame, received) ) ) {
+    struct pollfd descriptor = { .fd = g_control_socket, .events = POLLIN };
+    if(poll(&descriptor, 1, CONTROL_TIMEOUT_MS) <= 0) {
+      return -1;
+    }
+    ssize_t result = recv(g_control_socket, frame + received,
+                          sizeof(frame) - received, 0);
+    if(result <= 0) {
+      return -1;
+    }
+    received += (size_t) result;
+  }
+  if(frame_length < 0 || (size_t) frame_length != received) {
+    return -1;
+  }
+  int response_length = CheckMbapHeader(frame, received, transaction_id, unit);
+  if(response_length > 0) {
+    memcpy(response_pdu, frame + MBAP_HEADER_LENGTH, (size_t) response_length);
+  }
+  return response_length;
+}
+
+static int ReadRegisters(uint8_t function_code, uint16_t address,
+                         uint16_t quantity, uint8_t *response) {
+  uint8_t request[5] = { function_code };
+  uint8_t *cursor = request + 1;
+  PutUint16(&cursor, address);
+  PutUint16(&cursor, quantity);
+  return ControlTransaction(g_config.unit, request, sizeof(request), response);
+}
+
+static int WriteRegisters(uint16_t address, uint16_t quantity,
+                          const uint16_t *values, uint8_t *response) {
+  uint8_t request[6 + 2 * HOLDING_COUNT] = { FC_WRITE_MULTIPLE_REGISTERS };
+  uint8_t *cursor = request + 1;
+  PutUint16(&cursor, address);
+  PutUint16(&cursor, quantity);
+  *cursor++ = (uint8_t) (2 * quantity);
+  for(uint16_t i = 0; i < quantity; i++) {
+    PutUint16(&cursor, values[i]);
+  }
+  return ControlTransaction(g_config.unit, request, (size_t) (cursor - request),
+                            response);
+}
+
+static void Check(const char *name, bool passed) {
+  printf("  %-48s %s\n", name, passed ? "pass" : "FAIL");
+  if(!passed) {
+    g_conformance_failures++;
+  }
+}
+
+static bool IsException(const uint8_t *response, int length,
+                        uint8_t function_code, uint8_t exception_code) {
+  return 2 == length && (function_code | 0x80) == response[0] &&
+         exception_code == response[1];
+}
+
+static bool IsRegisterResponse(const uint8_t *response, int length,
+                               uint8_t function_code, uint16_t quantity) {
+  return length == 2 + 2 * quantity && function_code == response[0] &&
+         2 * quantity == response[1];
+}
+
+static void RunConformance(void) {
+  uint8_t response[MAX_PDU_LENGTH];
+  int length;
+  printf("conformance\n");
+
+  length = ReadRegisters(FC_READ_HOLDING_REGISTERS, HOLDING_START,
+                         HOLDING_COUNT, response);
+  Check("FC03 holding registers 100-115",
+        IsRegisterResponse(response, length, FC_READ_HOLDING_REGISTERS,
+                           HOLDING_COUNT) );
+  length = ReadRegisters(FC_READ_INPUT_REGISTERS, INPUT_START, INPUT_COUNT,
+                         response);
+  Check("FC04 input registers 0-15",
+        IsRegisterResponse(response, length, FC_READ_INPUT_REGISTERS,
+                           INPUT_COUNT) );
+
+  if(g_config.mix[kWorkloadWrite] > 0) {
+    uint16_t pattern[HOLDING_COUNT];
+    for(unsigned int i = 0; i < HOLDING_COUNT; i++) {
+      pattern[i] = (uint16_t) (0xA500u + i * 0x0101u);
+    }
+    length = WriteRegisters(HOLDING_START, HOLDING_COUNT, pattern, response);
+    bool passed = 5 == length && FC_WRITE_MULTIPLE_REGISTERS == response[0] &&
+                  HOLDING_START == GetUint16(response + 1) &&
+                  HOLDING_COUNT == GetUint16(response + 3);
+    length = ReadRegisters(FC_READ_HOLDING_REGISTERS, HOLDING_START,
+                           HOLDING_COUNT, response);
+    passed = passed && IsRegisterResponse(response, length,
+                                          FC_READ_HOLDING_REGISTERS,
+                                          HOLDING_COUNT);
+    for(unsigned int i = 0; passed && i < HOLDING_COUNT; i++) {
+      passed = pattern[i] == GetUint16(response + 2 + 2 * i);
+    }
+    Check("FC16 write, FC03 read back", passed);
+  }
+
+  /* The sample stamp (microseconds) may advance between the two reads, a
+   * wrong word order would make it jump */
+  uint8_t registers[MAX_PDU_LENGTH];
+  int registers_length = ReadRegisters(FC_READ_INPUT_REGISTERS,
+                                       TIMESTAMP_LOW_REGISTER, 2, registers);
+  length = ReadRegisters(FC_READ_INPUT_REGISTERS, TIMESTAMP_START, 2,
+                         response);
+  bool timestamp_passed =
+    IsRegisterResponse(registers, registers_length, FC_READ_INPUT_REGISTERS,
+                       2) &&
+    IsRegisterResponse(response, length, FC_READ_INPUT_REGISTERS, 2);
+  if(timestamp_passed) {
+    uint32_t before = ( (uint32_t) GetUint16(registers + 4) << 16 ) |
+                      GetUint16(registers + 2);
+    uint32_t after = ( (uint32_t) GetUint16(response + 2) << 16 ) |
+                     GetUint16(response + 4);
+    timestamp_passed = after - before < TIMESTAMP_MAX_ADVANCE_US;
+  }
+  Check("FC04 uint32 200-201 = registers 15, 14", timestamp_passed);
+
+  length = ReadRegisters(FC_READ_HOLDING_REGISTERS,
+                         HOLDING_START + HOLDING_COUNT, 1, response);
+  Check("FC03 unmapped address -> exception 02",
+        IsException(response, length, FC_READ_HOLDING_REGISTERS,
+                    EXCEPTION_ILLEGAL_DATA_ADDRESS) );
+  length = ReadRegisters(FC_READ_HOLDING_REGISTERS, HOLDING_START,
+                         HOLDING_COUNT + 1, response);
+  Check("FC03 range past the mapping -> exception 02",
+        IsException(response, length, FC_READ_HOLDING_REGISTERS,
+                    EXCEPTION_ILLEGAL_DATA_ADDRESS) );
+  length = ReadRegisters(FC_READ_INPUT_REGISTERS, INPUT_COUNT, 1, response);
+  Check("FC04 unmapped address -> exception 02",
+        IsException(response, length, FC_READ_INPUT_REGISTERS,
+                    EXCEPTION_ILLEGAL_DATA_ADDRESS) );
+  length = ReadRegisters(FC_READ_HOLDING_REGISTERS, HOLDING_START, 0,
+                         response);
+  Check("FC03 quantity 0 -> exception 03",
+        IsException(response, length, FC_READ_HOLDING_REGISTERS,
+                    EXCEPTION_ILLEGAL_DATA_VALUE) );
+  length = ReadRegisters(FC_READ_INPUT_REGISTERS, INPUT_START, 126, response);
+  Check("FC04 quantity 126 -> exception 03",
+        IsException(response, length, FC_READ_INPUT_REGISTERS,
+                    EXCEPTION_ILLEGAL_DATA_VALUE) );
+
+  const uint8_t bad_byte_count[] = {
+    FC_WRITE_MULTIPLE_REGISTERS, 0, HOLDING_START, 0, 2, 3, 0, 0, 0, 0
+  };
+  length = ControlTransaction(g_config.unit, bad_byte_count,
+                              sizeof(bad_byte_count), response);
+  Check("FC16 byte count mismatch -> exception 03",
+        IsException(response, length, FC_WRITE_MULTIPLE_REGISTERS,
+                    EXCEPTION_ILLEGAL_DATA_VALUE) );
+
+  const uint8_t unsupported[] = { 0x07 };
+  length = ControlTransaction(g_config.unit, unsupported, sizeof(unsupported),
+                              response);
+  Check("FC07 unsupported -> exception 01",
+        IsException(response, length, 0x07, EXCEPTION_ILLEGAL_FUNCTION) );
+
+  const uint8_t device_id[] = {
+    FC_ENCAPSULATED_INTERFACE, MEI_READ_DEVICE_ID, 0x01, 0x00
+  };
+  length = ControlTransaction(g_config.unit, device_id, sizeof(device_id),
+                              response);
+  Check("FC43/14 basic device identification",
+        length >= 7 && FC_ENCAPSULATED_INTERFACE == response[0] &&
+        MEI_READ_DEVICE_ID == response[1] && 3 == response[6]);
+
+  /* The unit identifier is echoed, whatever its value */
+  const uint8_t read_one[] = {
+    FC_READ_HOLDING_REGISTERS, 0, HOLDING_START, 0, 1
+  };
+  length = ControlTransaction(0xFF, read_one, sizeof(read_one), response);
+  Check("unit identifier 0xFF echoed",
+        IsRegisterResponse(response, length, FC_READ_HOLDING_REGISTERS, 1) );
+}
+
+/* ---- load connections ---- */
+
+static void AssignWindows(void) {
+  unsigned int owners = g_config.connections < HOLDING_COUNT ?
+                        g_config.connections : HOLDING_COUNT;
+  uint16_t window_count = (uint16_t) (HOLDING_COUNT / owners);
+  for(unsigned int i = 0; i < g_config.connections; i++) {
+    BenchConnection *connection = &g_connections[i];
+    if(i < owners) {
+      connection->window_start = (uint16_t) (HOLDING_START + i * window_count);
+      connection->window_count = window_count;
+    }
+  }
+}
+
+static uint8_t PickWorkload(BenchConnection *connection) {
+  unsigned int total = g_config.mix[kWorkloadRead] +
+                       g_config.mix[kWorkloadInput] +
+                       g_config.mix[kWorkloadWrite];
+  unsigned int pick = NextRandom(&connection->random) % total;
+  uint8_t workload = kWorkloadRead;
+  while(pick >= g_config.mix[workload]) {
+    pick -= g_config.mix[workload];
+    workload++;
+  }
+  /* writes need own registers to be verified */
+  if(kWorkloadWrite == workload && 0 == connection->window_count) {
+    workload = kWorkloadRead;
+  }
+  return workload;
+}
+
+/* Appends the next request to the transmit buffer */
+static void QueueRequest(BenchConnection *connection) {
+  unsigned int slot = (connection->pending_head + connection->pending_count) %
+                      MAX_DEPTH;
+  PendingRequest *request = &connection->pending[slot];
+  request->workload = PickWorkload(connection);
+  request->transaction_id = connection->next_transaction_id++;
+  request->check_window = false;
+
+  uint8_t *frame = connection->tx + connection->tx_length;
+  uint8_t *cursor = frame + MBAP_HEADER_LENGTH;
+  *cursor++ = kWorkloadFunctionCodes[request->workload];
+  switch(request->workload) {
+    case kWorkloadRead:
+      request->address = HOLDING_START;
+      request->quantity = (uint16_t) g_config.quantity;
+      request->check_window = g_config.check_values &&
+                              connection->window_known;
+      memcpy(request->window, connection->window, sizeof(request->window) );
+      break;
+    case kWorkloadInput:
+      request->address = INPUT_START;
+      request->quantity = (uint16_t) g_config.quantity;
+      break;
+    default:
+      request->address = connection->window_start;
+      request->quantity = connection->window_count;
+      connection->sequence++;
+      for(uint16_t i = 0; i < connection->window_count; i++) {
+        connection->window[i] = (uint16_t) ( (connection->sequence << 4) ^
+                                             (connection->window_start << 8) ^
+                                             i );
+      }
+      connection->window_known = true;
+      break;
+  }
+  PutUint16(&cursor, request->address);
+  PutUint16(&cursor, request->quantity);
+  if(kWorkloadWrite == request->workload) {
+    *cursor++ = (uint8_t) (2 * request->quantity);
+    for(uint16_t i = 0; i < request->quantity; i++) {
+      PutUint16(&cursor, connection->window[i]);
+    }
+  }
+  size_t pdu_length = (size_t) (cursor - frame) - MBAP_HEADER_LENGTH;
+  PutMbapHeader(frame, request->transaction_id, g_config.unit, pdu_length);
+  connection->tx_length += MBAP_HEADER_LENGTH + pdu_length;
+  request->sent_ns = NowNs();
+  connection->pending_count++;
+}
+
+static void CloseConnection(BenchConnection *connection) {
+  if(connection->open) {
+    close(connection->socket);
+    connection->open = false;
+  }
+}
+
+static void FlushRequests(BenchConnection *connection) {
+  if(0 == connection->tx_length) {
+    return;
+  }
+  ssize_t sent = send(connection->socket, connection->tx,
+                      connection->tx_length, MSG_NOSIGNAL);
+  if(sent < 0) {
+    if(EAGAIN != errno && EWOULDBLOCK != errno) {
+      CloseConnection(connection);
+    }
+    return;
+  }
+  memmove(connection->tx, connection->tx + sent,
+          connection->tx_length - (size_t) sent);
+  connection->tx_length -= (size_t) sent;
+}
+
+/* Checks one response against the oldest outstanding request */
+static void AccountResponse(BenchConnection *connection, const uint8_t *frame,
+                            size_t frame_length) {
+  PendingRequest *request = &connection->pending[connection->pending_head];
+  connection->pending_head = (connection->pending_head + 1) % MAX_DEPTH;
+  connection->pending_count--;
+
+  const uint8_t function_code = kWorkloadFunctionCodes[request->workload];
+  int pdu_length = CheckMbapHeader(frame, frame_length,
+                                   request->transaction_id, g_config.unit);
+  const uint8_t *pdu = frame + MBAP_HEADER_LENGTH;
+  if(pdu_length < 0) {
+    connection->malformed++;
+    return;
+  }
+  if( (function_code | 0x80) == pdu[0] ) {
+    connection->exceptions++;
+    return;
+  }
+  if(kWorkloadWrite == request->workload) {
+    if(5 != pdu_length || function_code != pdu[0] ||
+       request->address != GetUint16(pdu + 1) ||
+       request->quantity != GetUint16(pdu + 3) ) {
+      connection->malformed++;
+      return;
+    }
+  } else if(!IsRegisterResponse(pdu, pdu_length, function_code,
+                                request->quantity) ) {
+    connection->malformed++;
+    return;
+  }
+
+  if(request->check_window) {
+    for(uint16_t i = 0; i < connection->window_count; i++) {
+      uint16_t address = (uint16_t) (connection->window_start + i);
+      if(address >= request->address + request->quantity) {
+        break;
+      }
+      uint16_t offset = (uint16_t) (address - request->address);
+      if(GetUint16(pdu + 2 + 2 * offset) != request->window[i]) {
+        connection->mismatches++;
+        break;
+      }
+    }
+  }
+
+  if(g_measuring) {
+    connection->transactions[request->workload]++;
+    HistogramRecord(&connection->latency[request->workload],
+                    (NowNs() - request->sent_ns) / 1000u);
+  }
+}
+
+static void ReceiveResponses(BenchConnection *connection) {
+  ssize_t result = recv(connection->socket,
+                        connection->rx + connection->rx_length,
+                        sizeof(connection->rx) - connection->rx_length, 0);
+  if(result <= 0) {
+    if(0 == result || (EAGAIN != errno && EWOULDBLOCK != errno) ) {
+      CloseConnection(connection);
+    }
+    return;
+  }
+  connection->rx_length += (size_t) result;
+
+  size_t consumed = 0;
+  int frame_length;
+  while(0 != (frame_length = FrameLength(connection->rx + consumed,
+                                         connection->rx_length - consumed) ) ) {
+    if(frame_length < 0 || 0 == connection->pending_count) {
+      /* the stream cannot be resynchronized */
+      connection->malformed++;
+      CloseConnection(connection);
+      return;
+    }
+    AccountResponse(connection, connection->rx + consumed,
+                    (size_t) frame_length);
+    consumed += (size_t) frame_length;
+  }
+  memmove(connection->rx, connection->rx + consumed,
+          connection->rx_length - consumed);
+  connection->rx_length -= consumed;
+}
+
+/* Returns the measured time in seconds */
+static double RunLoad(void) {
+  struct pollfd *descriptors = calloc(g_config.connections,
+                                      sizeof(struct pollfd) );
+  if(NULL == descriptors) {
+    return 0.0;
+  }
+  const uint64_t start_ns = NowNs();
+  const uint64_t measure_ns = start_ns + g_config.warmup_s * 1000000000ull;
+  const uint64_t end_ns = measure_ns + g_config.duration_s * 1000000000ull;
+  uint64_t drain_end_ns = 0;
+  uint64_t measured_start_ns = 0;
+  uint64_t measured_end_ns = 0;
+
+  for(;;) {
+    const uint64_t now_ns = NowNs();
+    if(!g_measuring && 0 == measured_start_ns && now_ns >= measure_ns) {
+      g_measuring = true;
+      measured_start_ns = now_ns;
+    }
+    bool issuing = !g_stop && now_ns < end_ns;
+    if(!issuing && 0 == drain_end_ns) {
+      g_measuring = false;
+      measured_end_ns = now_ns;
+      drain_end_ns = now_ns + DRAIN_TIMEOUT_MS * 1000000ull;
+    }
+    if(0 != drain_end_ns && now_ns >= drain_end_ns) {
+      break;
+    }
+
+    unsigned int active = 0;
+    for(unsigned int i = 0; i < g_config.connections; i++) {
+      BenchConnection *connection = &g_connections[i];
+      descriptors[i].fd = -1;
+      descriptors[i].events = 0;
+      if(!connection->open) {
+        continue;
+      }
+      while(issuing && connection->pending_count < g_config.depth) {
+        QueueRequest(connection);
+      }
+      FlushRequests(connection);
+      if(!connection->open ||
+         (!issuing && 0 == connection->pending_count) ) {
+        continue;
+      }
+      descriptors[i].fd = connection->socket;
+      descriptors[i].events = (short) (POLLIN |
+                                       (connection->tx_length > 0 ?
+                                        POLLOUT : 0) );
+      active++;
+    }
+    if(0 == active) {
+      break;
+    }
+
+    if(poll(descriptors, g_config.connections, 100) < 0 && EINTR != errno) {
+      perror("poll");
+      break;
+    }
+    for(unsigned int i = 0; i < g_config.connections; i++) {
+      if(descriptors[i].fd >= 0 &&
+         0 != (descriptors[i].revents & (POLLIN | POLLERR | POLLHUP) ) ) {
+        ReceiveResponses(&g_connections[i]);
+      }
+    }
+  }
+  free(descriptors);
+  if(0 == measured_end_ns) {
+    measured_end_ns = NowNs();
+  }
+  return measured_start_ns > 0 ?
+         (double) (measured_end_ns - measured_start_ns) / 1e9 : 0.0;
+}
+
+/* ---- report ---- */
+
+static void PrintHistogram(const char *name, const Histogram *histogram) {
+  if(0 == histogram->count) {
+    printf("  %-18s no samples\n", name);
+    return;
+  }
+  printf("  %-18s n=%-9" PRIu64 " min=%-7" PRIu64 " p50=%-7" PRIu64
+         " p99=%-7" PRIu64 " p99.9=%-7" PRIu64 " max=%" PRIu64 " us\n",
+         name, histogram->count, histogram->min,
+         HistogramPercentile(histogram, 50.0),
+         HistogramPercentile(histogram, 99.0),
+         HistogramPercentile(histogram, 99.9),
+         histogram->max);
+}
+
+static int Report(unsigned int opened, double measured_s) {
+  Histogram latency[kWorkloadCount], all;
+  HistogramInit(&all);
+  uint64_t transactions[kWorkloadCount] = { 0 };
+  uint64_t exceptions = 0, malformed = 0, mismatches = 0, total = 0;
+  unsigned int still_open = 0;
+
+  for(unsigned int w = 0; w < kWorkloadCount; w++) {
+    HistogramInit(&latency[w]);
+  }
+  for(unsigned int i = 0; i < g_config.connections; i++) {
+    BenchConnection *connection = &g_connections[i];
+    uint64_t connection_total = 0;
+    for(unsigned int w = 0; w < kWorkloadCount; w++) {
+      HistogramMerge(&latency[w], &connection->latency[w]);
+      transactions[w] += connection->transactions[w];
+      connection_total += connection->transactions[w];
+    }
+    total += connection_total;
+    exceptions += connection->exceptions;
+    malformed += connection->malformed;
+    mismatches += connection->mismatches;
+    if(connection->open) {
+      still_open++;
+    }
+    if(g_config.per_connection) {
+      Histogram connection_latency;
+      HistogramInit(&connection_latency);
+      for(unsigned int w = 0; w < kWorkloadCount; w++) {
+        HistogramMerge(&connection_latency, &connection->latency[w]);
+      }
+      char window[24] = "none";
+      if(connection->window_count > 0) {
+        snprintf(window, sizeof(window), "%u-%u", connection->window_start,
+                 connection->window_start + connection->window_count - 1U);
+      }
+      printf("connection %u: %" PRIu64 " transactions, registers %s,"
+             " exceptions %" PRIu64 ", malformed %" PRIu64 ", mismatches %"
+             PRIu64 "%s\n", i, connection_total, window,
+             connection->exceptions, connection->malformed,
+             connection->mismatches, connection->open ? "" : ", closed");
+      PrintHistogram("latency", &connection_latency);
+    }
+  }
+  for(unsigned int w = 0; w < kWorkloadCount; w++) {
+    HistogramMerge(&all, &latency[w]);
+  }
+
+  printf("\nconnections  %u of %u open (%u at the end), depth %u, %u "
+         "registers per read, %.1f s measured\n", opened,
+         g_config.connections, still_open, g_config.depth, g_config.quantity,
+         measured_s);
+  printf("transactions %" PRIu64 " (%.0f/s): FC03 %" PRIu64 ", FC04 %" PRIu64
+         ", FC16 %" PRIu64 "\n", total,
+         measured_s > 0 ? (double) total / measured_s : 0.0,
+         transactions[kWorkloadRead], transactions[kWorkloadInput],
+         transactions[kWorkloadWrite]);
+  printf("errors       exceptions %" PRIu64 ", malformed %" PRIu64
+         ", value mismatches %" PRIu64 ", conformance failures %u\n",
+         exceptions, malformed, mismatches, g_conformance_failures);
+  for(unsigned int w = 0; w < kWorkloadCount; w++) {
+    PrintHistogram(kWorkloadNames[w], &latency[w]);
+  }
+  PrintHistogram("all", &all);
+
+  /* one line for scripts */
+  printf("RESULT connections=%u depth=%u transactions=%" PRIu64 " tps=%.0f"
+         " p50_us=%" PRIu64 " p99_us=%" PRIu64 " p999_us=%" PRIu64
+         " exceptions=%" PRIu64 " malformed=%" PRIu64 " mismatches=%" PRIu64
+         " conformance_failures=%u\n", opened, g_config.depth, total,
+         measured_s > 0 ? (double) total / measured_s : 0.0,
+         HistogramPercentile(&all, 50.0), HistogramPercentile(&all, 99.0),
+         HistogramPercentile(&all, 99.9), exceptions, malformed, mismatches,
+         g_conformance_failures);
+
+  return 0 == exceptions && 0 == malformed && 0 == mismatches &&
+         0 == g_conformance_failures && opened == g_config.connections &&
+         still_open == opened ? 0 : -1;
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [options] <target>\n"
+          "  -n, --connections N     connections to open (1)\n"
+          "  -q, --depth N           requests in flight per connection, up\n"
+          "                          to %d (1)\n"
+          "  -c, --quantity N        registers per read, 1-16 (8)\n"
+          "  -m, --mix R,I,W         weights of FC03 reads, FC04 reads and\n"
+          "                          FC16 writes (40,40,20)\n"
+          "  -d, --duration S        measurement time in seconds (10)\n"
+          "  -w, --warmup S          time excluded from the statistics (1)\n"
+          "  -u, --unit N            unit identifier (1)\n"
+          "      --no-conformance    skip the conformance checks\n"
+          "      --no-values         do not verify read back values, e.g.\n"
+          "                          while a scanner writes assembly 150\n"
+          "  -p, --per-connection    print statistics per connection\n"
+          "      --port N            TCP port (502)\n",
+          program, MAX_DEPTH);
+}
+
+static int ParseArguments(int argc, char *argv[]) {
+  enum {
+    kOptionNoConformance = 256, kOptionNoValues, kOptionPort
+  };
+  static const struct option options[] = {
+    { "connections", required_argument, NULL, 'n' },
+    { "depth", required_argument, NULL, 'q' },
+    { "quantity", required_argument, NULL, 'c' },
+    { "mix", required_argument, NULL, 'm' },
+    { "duration", required_argument, NULL, 'd' },
+    { "warmup", required_argument, NULL, 'w' },
+    { "unit", required_argument, NULL, 'u' },
+    { "no-conformance", no_argument, NULL, kOptionNoConformance },
+    { "no-values", no_argument, NULL, kOptionNoValues },
+    { "per-connection", no_argument, NULL, 'p' },
+    { "port", required_argument, NULL, kOptionPort },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int option;
+  while(-1 != (option = getopt_long(argc, argv, "n:q:c:m:d:w:u:ph", options,
+                                    NULL) ) ) {
+    unsigned long value = (NULL != optarg) ? strtoul(optarg, NULL, 0) : 0;
+    switch(option) {
+      case 'n': g_config.connections = (unsigned int) value; break;
+      case 'q': g_config.depth = (unsigned int) value; break;
+      case 'c': g_config.quantity = (unsigned int) value; break;
+      case 'm':
+        if(3 != sscanf(optarg, "%u,%u,%u", &g_config.mix[kWorkloadRead],
+                       &g_config.mix[kWorkloadInput],
+                       &g_config.mix[kWorkloadWrite]) ) {
+          return -1;
+        }
+        break;
+      case 'd': g_config.duration_s = (unsigned int) value; break;
+      case 'w': g_config.warmup_s = (unsigned int) value; break;
+      case 'u': g_config.unit = (uint8_t) value; break;
+      case kOptionNoConformance: g_config.conformance = false; break;
+      case kOptionNoValues: g_config.check_values = false; break;
+      case 'p': g_config.per_connection = true; break;
+      case kOptionPort: g_config.port = (uint16_t) value; break;
+      default:
+        return -1;
+    }
+  }
+  if(optind != argc - 1 || 0 == g_config.connections ||
+     0 == g_config.depth || g_config.depth > MAX_DEPTH ||
+     0 == g_config.quantity || g_config.quantity > HOLDING_COUNT ||
+     0 == g_config.mix[kWorkloadRead] + g_config.mix[kWorkloadInput] +
+     g_config.mix[kWorkloadWrite]) {
+    return -1;
+  }
+  g_config.host = argv[optind];
+  return 0;
+}
+
+static int ResolveTarget(void) {
+  struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM };
+  struct addrinfo *result = NULL;
+  if(0 != getaddrinfo(g_config.host, NULL, &hints, &result) ) {
+    fprintf(stderr, "cannot resolve %s\n", g_config.host);
+    return -1;
+  }
+  memcpy(&g_target_address, result->ai_addr, sizeof(g_target_address) );
+  g_target_address.sin_port = htons(g_config.port);
+  freeaddrinfo(result);
+  return 0;
+}
+
+/* Hundreds of connections need more descriptors than some default limits */
+static void RaiseDescriptorLimit(void) {
+  struct rlimit limit;
+  if(0 == getrlimit(RLIMIT_NOFILE, &limit) && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  if(0 != ParseArguments(argc, argv) || 0 != ResolveTarget() ) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  struct sigaction action;
+  memset(&action, 0, sizeof(action) );
+  action.sa_handler = HandleSignal;
+  sigaction(SIGINT, &action, NULL);
+  sigaction(SIGTERM, &action, NULL);
+  RaiseDescriptorLimit();
+
+  g_connections = calloc(g_config.connections, sizeof(BenchConnection) );
+  g_control_socket = Connect();
+  if(NULL == g_connections || g_control_socket < 0) {
+    return EXIT_FAILURE;
+  }
+
+  /* holding registers to restore at the end */
+  uint8_t backup[MAX_PDU_LENGTH];
+  bool have_backup =
+    IsRegisterResponse(backup, ReadRegisters(FC_READ_HOLDING_REGISTERS,
+                                             HOLDING_START, HOLDING_COUNT,
+                                             backup),
+                       FC_READ_HOLDING_REGISTERS, HOLDING_COUNT);
+  if(g_config.conformance) {
+    RunConformance();
+  }
+
+  unsigned int opened = 0;
+  uint64_t seed = NowNs() | 1u;
+  for(unsigned int i = 0; i < g_config.connections && !g_stop; i++) {
+    BenchConnection *connection = &g_connections[i];
+    for(unsigned int w = 0; w < kWorkloadCount; w++) {
+      HistogramInit(&connection->latency[w]);
+    }
+    connection->random = seed + 0x9E3779B97F4A7C15ull * (i + 1);
+    connection->socket = Connect();
+    if(connection->socket < 0) {
+      continue;
+    }
+    fcntl(connection->socket, F_SETFL,
+          fcntl(connection->socket, F_GETFL) | O_NONBLOCK);
+    connection->open = true;
+    opened++;
+  }
+  printf("opened %u of %u connections\n", opened, g_config.connections);
+  AssignWindows();
+
+  int result = -1;
+  if(opened > 0) {
+    double measured_s = RunLoad();
+    result = Report(opened, measured_s);
+  }
+  for(unsigned int i = 0; i < g_config.connections; i++) {
+    CloseConnection(&g_connections[i]);
+  }
+
+  if(have_backup) {
+    uint16_t values[HOLDING_COUNT];
+    uint8_t response[MAX_PDU_LENGTH];
+    for(unsigned int i = 0; i < HOLDING_COUNT; i++) {
+      values[i] = GetUint16(backup + 2 + 2 * i);
+    }
+    if(5 != WriteRegisters(HOLDING_START, HOLDING_COUNT, values, response) ) {
+      fprintf(stderr, "could not restore holding registers %u-%u\n",
+              HOLDING_START, HOLDING_START + HOLDING_COUNT - 1);
+    }
+  }
+  close(g_control_socket);
+  free(g_connections);
+  return 0 == result ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,448 @@
+/** @file modbus_tcp_host.c
+ *  @brief ModbusTCP server of the firmware as a Linux program, for load tests
+ *
+ *  Runs the event loop core (modbus_server.c), the protocol and the register
+ *  map of components/modbus_tcp unchanged. The assemblies are plain memory of
+ *  the sizes of the sample application, input assembly 100 gets a sample
+ *  counter and timestamp at the firmware offsets on every loop iteration.
+ *  Writes to assemblies 150/151 can be applied with a delay, like the OpENer
+ *  thread applies them in the firmware.
+ *  NVS is kept in memory, so the register map starts from the default.
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+
+#include "modbus_register_map.h"
+#include "modbus_server.h"
+#include "nvs.h"
+
+#define INPUT_ASSEMBLY_NUM             100
+#define OUTPUT_ASSEMBLY_NUM            150
+#define CONFIG_ASSEMBLY_NUM            151
+#define INPUT_ASSEMBLY_SIZE            32
+#define OUTPUT_ASSEMBLY_SIZE           32
+#define CONFIG_ASSEMBLY_SIZE           10
+
+/* Sample counter and timestamp of the sample application */
+#define SAMPLE_COUNTER_OFFSET          27
+#define SAMPLE_TIMESTAMP_OFFSET        28
+
+#define POLL_INTERVAL_MS               100
+/* OPENER_ASSEMBLY_BUFFER_WRITE_QUEUE_LENGTH of the firmware */
+#define WRITE_QUEUE_LENGTH             4
+#define NVS_MAX_KEYS                   8
+#define NVS_MAX_BLOB                   512
+
+int g_host_log_level = 1;
+
+static struct {
+  uint16_t port;
+  uint16_t max_connections;
+  uint32_t idle_timeout_ms;
+  uint32_t evict_idle_ms;
+  unsigned int stats_interval_s;
+  unsigned int duration_s;
+  unsigned int client_lines;
+  unsigned int apply_delay_us;
+} g_config = {
+  .port = 5020,
+  .max_connections = 256,
+  .idle_timeout_ms = 60000,
+  .evict_idle_ms = 5000,
+  .stats_interval_s = 1,
+  .duration_s = 0,
+  .client_lines = 0,
+  .apply_delay_us = 0,
+};
+
+static volatile sig_atomic_t g_running = 1;
+
+/* Assemblies, the Modbus task is the only user here but the firmware API
+ * allows concurrent access */
+static pthread_mutex_t g_assembly_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t g_input_assembly[INPUT_ASSEMBLY_SIZE];
+static uint8_t g_output_assembly[OUTPUT_ASSEMBLY_SIZE];
+static uint8_t g_config_assembly[CONFIG_ASSEMBLY_SIZE];
+
+/* Queued writes to the assemblies received by OpENer, oldest first */
+static struct {
+  uint32_t instance;
+  uint16_t offset;
+  uint16_t length;
+  uint8_t data[OUTPUT_ASSEMBLY_SIZE];
+  uint64_t due_us;
+} g_write_queue[WRITE_QUEUE_LENGTH];
+static unsigned int g_write_queue_length;
+
+static uint64_t NowUs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t) now.tv_sec * 1000000u + (uint64_t) now.tv_nsec / 1000u;
+}
+
+static uint8_t *GetAssembly(uint32_t instance, uint16_t *size) {
+  switch(instance) {
+    case INPUT_ASSEMBLY_NUM:
+      *size = sizeof(g_input_assembly);
+      return g_input_assembly;
+    case OUTPUT_ASSEMBLY_NUM:
+      *size = sizeof(g_output_assembly);
+      return g_output_assembly;
+    case CONFIG_ASSEMBLY_NUM:
+      *size = sizeof(g_config_assembly);
+      return g_config_assembly;
+    default:
+      *size = 0;
+      return NULL;
+  }
+}
+
+/* Applies the queued writes that are due, called with g_assembly_mutex held */
+static void ApplyDueWrites(void) {
+  const uint64_t now_us = NowUs();
+  unsigned int applied = 0;
+  while(applied < g_write_queue_length &&
+        g_write_queue[applied].due_us <= now_us) {
+    uint16_t size = 0;
+    uint8_t *assembly = GetAssembly(g_write_queue[applied].instance, &size);
+    memcpy(assembly + g_write_queue[applied].offset,
+           g_write_queue[applied].data, g_write_queue[applied].length);
+    applied++;
+  }
+  g_write_queue_length -= applied;
+  memmove(&g_write_queue[0], &g_write_queue[applied],
+          g_write_queue_length * sizeof(g_write_queue[0]) );
+}
+
+uint16_t sample_application_get_assembly_size(uint32_t instance) {
+  uint16_t size = 0;
+  GetAssembly(instance, &size);
+  return size;
+}
+
+bool sample_application_read_assembly(uint32_t instance, uint16_t offset,
+                                      uint8_t *data, uint16_t length) {
+  uint16_t size = 0;
+  uint8_t *assembly = GetAssembly(instance, &size);
+  if(NULL == assembly || (uint32_t) offset + length > size) {
+    return false;
+  }
+  pthread_mutex_lock(&g_assembly_mutex);
+  ApplyDueWrites();
+  memcpy(data, assembly + offset, length);
+  pthread_mutex_unlock(&g_assembly_mutex);
+  return true;
+}
+
+bool sample_application_write_assembly(uint32_t instance, uint16_t offset,
+                                       const uint8_t *data, uint16_t length) {
+  uint16_t size = 0;
+  uint8_t *assembly = GetAssembly(instance, &size);
+  if(NULL == assembly || (uint32_t) offset + length > size) {
+    return false;
+  }
+  bool ok = true;
+  pthread_mutex_lock(&g_assembly_mutex);
+  if(INPUT_ASSEMBLY_NUM == instance || 0 == g_config.apply_delay_us) {
+    memcpy(assembly + offset, data, length);
+  } else if(g_write_queue_length < WRITE_QUEUE_LENGTH) {
+    g_write_queue[g_write_queue_length].instance = instance;
+    g_write_queue[g_write_queue_length].offset = offset;
+    g_write_queue[g_write_queue_length].length = length;
+    memcpy(g_write_queue[g_write_queue_length].data, data, length);
+    g_write_queue[g_write_queue_length].due_us =
+      NowUs() + g_config.apply_delay_us;
+    g_write_queue_length++;
+  } else {
+    ok = false; /* queue full, as in the firmware */
+  }
+  pthread_mutex_unlock(&g_assembly_mutex);
+  return ok;
+}
+
+bool sample_application_assembly_write_pending(uint32_t instance) {
+  bool pending = false;
+  pthread_mutex_lock(&g_assembly_mutex);
+  ApplyDueWrites();
+  for(unsigned int i = 0; i < g_write_queue_length; i++) {
+    pending = pending || instance == g_write_queue[i].instance;
+  }
+  pthread_mutex_unlock(&g_assembly_mutex);
+  return pending;
+}
+
+/* NVS in process memory */
+static struct {
+  char key[16];
+  uint8_t value[NVS_MAX_BLOB];
+  size_t length;
+  bool used;
+} g_nvs[NVS_MAX_KEYS];
+
+static int FindNvsKey(const char *key) {
+  for(int i = 0; i < NVS_MAX_KEYS; i++) {
+    if(g_nvs[i].used && 0 == strcmp(g_nvs[i].key, key) ) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode,
+                   nvs_handle_t *out_handle) {
+  (void) name;
+  (void) open_mode;
+  *out_handle = 1;
+  return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value,
+                       size_t *length) {
+  (void) handle;
+  int index = FindNvsKey(key);
+  if(index < 0) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  if(*length < g_nvs[index].length) {
+    return ESP_ERR_NVS_INVALID_LENGTH;
+  }
+  memcpy(out_value, g_nvs[index].value, g_nvs[index].length);
+  *length = g_nvs[index].length;
+  return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value,
+                       size_t length) {
+  (void) handle;
+  int index = FindNvsKey(key);
+  for(int i = 0; index < 0 && i < NVS_MAX_KEYS; i++) {
+    if(!g_nvs[i].used) {
+      index = i;
+    }
+  }
+  if(index < 0 || length > NVS_MAX_BLOB ||
+     strlen(key) >= sizeof(g_nvs[index].key) ) {
+    return ESP_FAIL;
+  }
+  snprintf(g_nvs[index].key, sizeof(g_nvs[index].key), "%s", key);
+  memcpy(g_nvs[index].value, value, length);
+  g_nvs[index].length = length;
+  g_nvs[index].used = true;
+  return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key) {
+  (void) handle;
+  int index = FindNvsKey(key);
+  if(index < 0) {
+    return ESP_ERR_NVS_NOT_FOUND;
+  }
+  g_nvs[index].used = false;
+  return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+  (void) handle;
+  return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle) {
+  (void) handle;
+}
+
+const char *esp_err_to_name(esp_err_t code) {
+  switch(code) {
+    case ESP_OK: return "ESP_OK";
+    case ESP_ERR_NVS_NOT_FOUND: return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_INVALID_LENGTH: return "ESP_ERR_NVS_INVALID_LENGTH";
+    default: return "ESP_FAIL";
+  }
+}
+
+/* Same layout as PublishSensorSample() of the sample application */
+static void PublishSample(uint8_t counter, uint32_t timestamp_us) {
+  uint8_t stamp[5] = {
+    counter, (uint8_t) timestamp_us, (uint8_t) (timestamp_us >> 8),
+    (uint8_t) (timestamp_us >> 16), (uint8_t) (timestamp_us >> 24)
+  };
+  sample_application_write_assembly(INPUT_ASSEMBLY_NUM, SAMPLE_COUNTER_OFFSET,
+                                    stamp, sizeof(stamp) );
+}
+
+static void PrintStats(void) {
+  modbus_server_stats_t stats;
+  if(!modbus_server_get_stats(&stats) ) {
+    return;
+  }
+  printf("clients %u/%u, %" PRIu32 " requests/s, requests %" PRIu64
+         ", accepted %" PRIu32 ", rejected %" PRIu32 ", evicted %" PRIu32
+         ", timed out %" PRIu32 ", protocol errors %" PRIu32 "\n",
+         stats.connections, stats.max_connections, stats.request_rate,
+         stats.requests, stats.accepted, stats.rejected, stats.evicted,
+         stats.timed_out, stats.protocol_errors);
+
+  if(0 == g_config.client_lines) {
+    return;
+  }
+  modbus_server_client_info_t *clients =
+    calloc(g_config.client_lines, sizeof(modbus_server_client_info_t) );
+  if(NULL == clients) {
+    return;
+  }
+  size_t count = modbus_server_get_clients(clients, g_config.client_lines);
+  for(size_t i = 0; i < count; i++) {
+    struct in_addr address = { .s_addr = clients[i].address };
+    printf("  %s:%u  %" PRIu32 " requests/s, requests %" PRIu32 ", idle %"
+           PRIu32 " ms, connected %" PRIu32 " s\n", inet_ntoa(address),
+           clients[i].port, clients[i].request_rate, clients[i].requests,
+           clients[i].idle_ms, clients[i].connected_ms / 1000);
+  }
+  free(clients);
+}
+
+static void StopOnSignal(int signal_number) {
+  (void) signal_number;
+  g_running = 0;
+}
+
+/* Hundreds of clients need more descriptors than some default limits */
+static void RaiseDescriptorLimit(void) {
+  struct rlimit limit;
+  if(0 == getrlimit(RLIMIT_NOFILE, &limit) && limit.rlim_cur < limit.rlim_max) {
+    limit.rlim_cur = limit.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &limit);
+  }
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -p, --port PORT         TCP port (5020)\n"
+          "  -c, --connections N     connection limit (256)\n"
+          "  -i, --idle-timeout MS   close clients without a request for MS,\n"
+          "                          0 never (60000)\n"
+          "  -e, --evict-idle MS     at the limit, a new connection takes the\n"
+          "                          slot of the least recently used client\n"
+          "                          idle at least MS (5000)\n"
+          "  -s, --stats S           statistics interval, 0 none (1)\n"
+          "  -l, --clients N         clients listed with the statistics (0)\n"
+          "  -d, --duration S        run time, 0 until interrupted (0)\n"
+          "  -a, --apply-delay US    apply writes to assemblies 150/151 after\n"
+          "                          US, like the OpENer thread (0)\n"
+          "  -v, --verbose           more log messages, repeatable\n",
+          program);
+}
+
+static int ParseArguments(int argc, char *argv[]) {
+  static const struct option options[] = {
+    { "port", required_argument, NULL, 'p' },
+    { "connections", required_argument, NULL, 'c' },
+    { "idle-timeout", required_argument, NULL, 'i' },
+    { "evict-idle", required_argument, NULL, 'e' },
+    { "stats", required_argument, NULL, 's' },
+    { "clients", required_argument, NULL, 'l' },
+    { "duration", required_argument, NULL, 'd' },
+    { "apply-delay", required_argument, NULL, 'a' },
+    { "verbose", no_argument, NULL, 'v' },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int option;
+  while(-1 != (option = getopt_long(argc, argv, "p:c:i:e:s:l:d:a:vh", options,
+                                    NULL) ) ) {
+    unsigned long value = (NULL != optarg) ? strtoul(optarg, NULL, 0) : 0;
+    switch(option) {
+      case 'p': g_config.port = (uint16_t) value; break;
+      case 'c': g_config.max_connections = (uint16_t) value; break;
+      case 'i': g_config.idle_timeout_ms = (uint32_t) value; break;
+      case 'e': g_config.evict_idle_ms = (uint32_t) value; break;
+      case 's': g_config.stats_interval_s = (unsigned int) value; break;
+      case 'l': g_config.client_lines = (unsigned int) value; break;
+      case 'd': g_config.duration_s = (unsigned int) value; break;
+      case 'a': g_config.apply_delay_us = (unsigned int) value; break;
+      case 'v': g_host_log_level++; break;
+      default:
+        return -1;
+    }
+  }
+  if(optind != argc || 0 == g_config.port || 0 == g_config.max_connections) {
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if(0 != ParseArguments(argc, argv) ) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  RaiseDescriptorLimit();
+  signal(SIGINT, StopOnSignal);
+  signal(SIGTERM, StopOnSignal);
+  signal(SIGPIPE, SIG_IGN);
+
+  modbus_register_map_load();
+  const modbus_server_config_t config = {
+    .port = g_config.port,
+    .max_connections = g_config.max_connections,
+    .idle_timeout_ms = g_config.idle_timeout_ms,
+    .evict_idle_ms = g_config.evict_idle_ms,
+  };
+  if(!modbus_server_open(&config) ) {
+    return EXIT_FAILURE;
+  }
+  printf("ModbusTCP server on port %u, %u connections, idle timeout %" PRIu32
+         " ms, eviction after %" PRIu32 " ms idle\n", config.port,
+         config.max_connections, config.idle_timeout_ms, config.evict_idle_ms);
+  fflush(stdout);
+
+  const uint64_t start_us = NowUs();
+  uint64_t next_stats_us = start_us + g_config.stats_interval_s * 1000000ull;
+  uint8_t counter = 0;
+  bool ok = true;
+  while(g_running) {
+    ok = modbus_server_poll(POLL_INTERVAL_MS);
+    if(!ok) {
+      break;
+    }
+    const uint64_t now_us = NowUs();
+    PublishSample(counter++, (uint32_t) now_us);
+    if(0 != g_config.stats_interval_s && now_us >= next_stats_us) {
+      PrintStats();
+      fflush(stdout);
+      next_stats_us += g_config.stats_interval_s * 1000000ull;
+    }
+    if(0 != g_config.duration_s &&
+       now_us - start_us >= g_config.duration_s * 1000000ull) {
+      break;
+    }
+  }
+
+  /* one line for scripts */
+  modbus_server_stats_t stats;
+  if(modbus_server_get_stats(&stats) ) {
+    printf("RESULT connections=%u accepted=%" PRIu32 " rejected=%" PRIu32
+           " evicted=%" PRIu32 " timed_out=%" PRIu32 " protocol_errors=%"
+           PRIu32 " requests=%" PRIu64 "\n", stats.connections,
+           stats.accepted, stats.rejected, stats.evicted, stats.timed_out,
+           stats.protocol_errors, stats.requests);
+  }
+  modbus_server_close();
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,25 @@
+/** @file esp_log.h
+ *  @brief ESP-IDF logging on stderr for the host build of the Modbus server
+ */
+
+#ifndef MODBUS_TCP_HOST_ESP_LOG_H_
+#define MODBUS_TCP_HOST_ESP_LOG_H_
+
+#include <stdio.h>
+
+/** @brief Messages up to this level are printed: 1 error, 2 warning, 3 info */
+extern int g_host_log_level;
+
+#define HOST_LOG(level, letter, tag, format, ...) \
+  do { \
+    if(g_host_log_level >= (level) ) { \
+      fprintf(stderr, letter " %s: " format "\n", tag, ## __VA_ARGS__); \
+    } \
+  } while(0)
+
+#define ESP_LOGE(tag, format, ...) HOST_LOG(1, "E", tag, format, ## __VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) HOST_LOG(2, "W", tag, format, ## __VA_ARGS__)
+#define ESP_LOGI(tag, format, ...) HOST_LOG(3, "I", tag, format, ## __VA_ARGS__)
+#define ESP_LOGD(tag, format, ...) HOST_LOG(4, "D", tag, format, ## __VA_ARGS__)
+
+#endif /* MODBUS_TCP_HOST_ESP_LOG_H_ */
@@ -0,0 +1,36 @@
+/** @file nvs.h
+ *  @brief ESP-IDF NVS API for the host build of the Modbus server, backed by
+ *         process memory (see modbus_tcp_host.c)
+ */
+
+#ifndef MODBUS_TCP_HOST_NVS_H_
+#define MODBUS_TCP_HOST_NVS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+  NVS_READONLY,
+  NVS_READWRITE
+} nvs_open_mode_t;
+
+#define ESP_OK                      0
+#define ESP_FAIL                    -1
+#define ESP_ERR_NVS_NOT_FOUND       0x1102
+#define ESP_ERR_NVS_INVALID_LENGTH  0x110c
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode,
+                   nvs_handle_t *out_handle);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value,
+                       size_t *length);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value,
+                       size_t length);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key);
+esp_err_t nvs_commit(nvs_handle_t handle);
+void nvs_close(nvs_handle_t handle);
+const char *esp_err_to_name(esp_err_t code);
+
+#endif /* MODBUS_TCP_HOST_NVS_H_ */
@@ -0,0 +1,10 @@
+/** @file nvs_flash.h
+ *  @brief ESP-IDF NVS flash API for the host build of the Modbus server
+ */
+
+#ifndef MODBUS_TCP_HOST_NVS_FLASH_H_
+#define MODBUS_TCP_HOST_NVS_FLASH_H_
+
+#include "nvs.h"
+
+#endif /* MODBUS_TCP_HOST_NVS_FLASH_H_ */
@@ -0,0 +1,309 @@
+/** @file vl53l1x_filter_bench.c
+ *  @brief VL53L1X processing pipeline on the host against a synthetic trace
+ *
+ *  Feeds vl53l1x_filter.c the results of a target that approaches the sensor
+ *  in steps and moves back, with gaussian ranging noise, single spikes and
+ *  results with a failed range status and low signal. Reports against the
+ *  true distance:
+ *  - RMS and p99 error of the raw and the published distance, and the RMS
+ *    error on the plateaus, which leaves out the delay after a step,
+ *  - switch point transitions of a raw comparison and of the pipeline,
+ *    the difference is chatter the PLC no longer has to debounce,
+ *  - delay until the published distance follows a step,
+ *  - time per result spent in vl53l1x_filter_update.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vl53l1x_filter.h"
+
+/* A step of the target is followed once the published distance is this
+ * close to the new distance */
+#define STEP_SETTLED_MM 20
+/* Results after a step that count as steady, longer than any window */
+#define STEADY_AFTER_RESULTS 25
+
+static struct {
+  unsigned int samples;
+  unsigned int period_ms;
+  unsigned int noise_mm;
+  unsigned int spike_permille;
+  unsigned int invalid_permille;
+  vl53l1x_config_t pipeline;
+} g_config = {
+  .samples = 100000,
+  .period_ms = 20,
+  .noise_mm = 15,
+  .spike_permille = 10,
+  .invalid_permille = 20,
+};
+
+static uint32_t g_random_state = 2463534242u;
+
+/** @brief xorshift32, the trace is the same on every run */
+static uint32_t Random(void) {
+  g_random_state ^= g_random_state << 13;
+  g_random_state ^= g_random_state >> 17;
+  g_random_state ^= g_random_state << 5;
+  return g_random_state;
+}
+
+/** @brief Approximately gaussian noise with the given sigma */
+static int32_t Noise(unsigned int sigma_mm) {
+  int32_t sum = 0;
+  for(int i = 0; i < 12; i++) {
+    sum += (int32_t) (Random() % 1001);
+  }
+  return (sum - 6000) * (int32_t) sigma_mm / 1000;
+}
+
+/** @brief True distance: plateaus of 2 s from 1500 mm down to 300 mm and
+ *  back up */
+static uint16_t TrueDistance(unsigned int sample) {
+  static const uint16_t kPlateaus[] = { 1500, 1100, 700, 300, 700, 1100 };
+  const unsigned int plateau_samples = 2000 / g_config.period_ms;
+  return kPlateaus[(sample / plateau_samples) %
+                   (sizeof(kPlateaus) / sizeof(kPlateaus[0]) )];
+}
+
+static void MakeResult(uint16_t true_mm, VL53L1X_Result_t *result) {
+  memset(result, 0, sizeof(*result) );
+  int32_t distance = true_mm + Noise(g_config.noise_mm);
+  result->Status = 0;
+  result->SigPerSPAD = (uint16_t) (200 + Random() % 100);
+  result->NumSPADs = 16;
+
+  const unsigned int roll = Random() % 1000;
+  if(roll < g_config.spike_permille) {
+    distance = (int32_t) (Random() % 4000);
+  } else if(roll < g_config.spike_permille + g_config.invalid_permille) {
+    /* sigma or signal fail, the distance is anything */
+    result->Status = 2;
+    result->SigPerSPAD = (uint16_t) (Random() % 20);
+    distance = (int32_t) (Random() % 4000);
+  }
+  result->Distance = (uint16_t) (distance < 0 ? 0 : distance);
+}
+
+static int CompareDouble(const void *a, const void *b) {
+  const double x = *(const double *) a;
+  const double y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+static int64_t NowNs(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+typedef struct {
+  double square_sum;
+  double steady_square_sum;
+  double *errors;
+  unsigned int transitions;
+  bool switch_on;
+} TraceStats;
+
+static void AddError(TraceStats *stats, unsigned int index, uint16_t mm,
+                     uint16_t true_mm, bool steady) {
+  const double error = (double) mm - (double) true_mm;
+  stats->square_sum += error * error;
+  if(steady) {
+    stats->steady_square_sum += error * error;
+  }
+  stats->errors[index] = fabs(error);
+}
+
+static void PrintStats(const char *name, TraceStats *stats,
+                       unsigned int steady_samples) {
+  qsort(stats->errors, g_config.samples, sizeof(double), CompareDouble);
+  printf("  %-10s rms=%6.1f mm  p99=%6.1f mm  steady rms=%5.1f mm  "
+         "switch transitions=%u\n", name,
+         sqrt(stats->square_sum / g_config.samples),
+         stats->errors[(size_t) (g_config.samples * 0.99)],
+         steady_samples ? sqrt(stats->steady_square_sum / steady_samples) : 0,
+         stats->transitions);
+}
+
+static int Run(void) {
+  vl53l1x_filter_t filter;
+  vl53l1x_filter_init(&filter, &g_config.pipeline);
+
+  TraceStats raw = { .errors = calloc(g_config.samples, sizeof(double) ) };
+  TraceStats published = {
+    .errors = calloc(g_config.samples, sizeof(double) )
+  };
+  if(NULL == raw.errors || NULL == published.errors) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+
+  const uint16_t switch_point = g_config.pipeline.switch_point_mm;
+  int64_t update_ns = 0;
+  uint64_t settle_sum = 0;
+  unsigned int steps = 0;
+  unsigned int settling = 0;
+  unsigned int since_step = STEADY_AFTER_RESULTS;
+  unsigned int steady_samples = 0;
+  uint16_t last_true_mm = TrueDistance(0);
+  vl53l1x_filter_output_t output = { 0 };
+
+  for(unsigned int i = 0; i < g_config.samples; i++) {
+    const uint16_t true_mm = TrueDistance(i);
+    VL53L1X_Result_t result;
+    MakeResult(true_mm, &result);
+
+    const int64_t start_ns = NowNs();
+    vl53l1x_filter_update(&filter, &result,
+                          (int64_t) i * g_config.period_ms * 1000, &output);
+    update_ns += NowNs() - start_ns;
+
+    if(true_mm != last_true_mm) {
+      last_true_mm = true_mm;
+      since_step = 0;
+      steps++;
+      settling = 1;
+    } else if(0 != settling) {
+      settling++;
+    }
+
+    const bool steady = since_step++ >= STEADY_AFTER_RESULTS;
+    steady_samples += steady;
+    AddError(&raw, i, result.Distance, true_mm, steady);
+    AddError(&published, i, output.distance_mm, true_mm, steady);
+
+    const bool raw_on = result.Distance <= switch_point;
+    if(0 != switch_point && raw_on != raw.switch_on) {
+      raw.transitions++;
+      raw.switch_on = raw_on;
+    }
+    const bool filtered_on = output.flags & VL53L1X_FILTER_FLAG_SWITCH;
+    if(filtered_on != published.switch_on) {
+      published.transitions++;
+      published.switch_on = filtered_on;
+    }
+
+    if(0 != settling &&
+       abs( (int) output.distance_mm - (int) true_mm) <= STEP_SETTLED_MM) {
+      settle_sum += settling;
+      settling = 0;
+    }
+  }
+
+  const vl53l1x_config_t *pipeline = &g_config.pipeline;
+  printf("%u results every %u ms, noise %u mm, %u%% spikes, %u%% invalid\n",
+         g_config.samples, g_config.period_ms, g_config.noise_mm,
+         g_config.spike_permille / 10, g_config.invalid_permille / 10);
+  printf("pipeline: reject status %u, min signal %u, max step %u mm, "
+         "median %u, average %u, ema %u/256, switch %u mm +%u\n",
+         pipeline->reject_invalid_status, pipeline->min_signal_per_spad,
+         pipeline->max_step_mm, pipeline->median_window,
+         pipeline->average_window, pipeline->ema_alpha,
+         pipeline->switch_point_mm, pipeline->switch_hysteresis_mm);
+  PrintStats("raw", &raw, steady_samples);
+  PrintStats("published", &published, steady_samples);
+  printf("  rejected   %" PRIu32 " results\n", output.rejected);
+  if(0 != steps) {
+    printf("  step delay %.1f results (%.0f ms) to within %d mm\n",
+           (double) settle_sum / steps,
+           (double) settle_sum / steps * g_config.period_ms, STEP_SETTLED_MM);
+  }
+  printf("  update     %.0f ns per result\n",
+         (double) update_ns / g_config.samples);
+
+  free(raw.errors);
+  free(published.errors);
+  return EXIT_SUCCESS;
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -n, --samples N         results in the trace (100000)\n"
+          "  -i, --period MS         time between results (20)\n"
+          "  -N, --noise MM          ranging noise sigma (15)\n"
+          "  -k, --spikes PERMILLE   results with a random distance (10)\n"
+          "  -x, --invalid PERMILLE  results with a failed status (20)\n"
+          "  -r, --reject-status     drop results with a status other than 0\n"
+          "  -S, --min-signal KCPS   drop results below this SigPerSPAD (0)\n"
+          "  -s, --max-step MM       drop single jumps larger than this (0)\n"
+          "  -M, --median N          median window (0)\n"
+          "  -A, --average N         moving average window (0)\n"
+          "  -E, --ema ALPHA         EMA weight of a new result in 1/256 (0)\n"
+          "  -t, --switch MM         switch point (0)\n"
+          "  -H, --hysteresis MM     switch hysteresis (10)\n",
+          program);
+}
+
+static int ParseArguments(int argc, char *argv[]) {
+  static const struct option options[] = {
+    { "samples", required_argument, NULL, 'n' },
+    { "period", required_argument, NULL, 'i' },
+    { "noise", required_argument, NULL, 'N' },
+    { "spikes", required_argument, NULL, 'k' },
+    { "invalid", required_argument, NULL, 'x' },
+    { "reject-status", no_argument, NULL, 'r' },
+    { "min-signal", required_argument, NULL, 'S' },
+    { "max-step", required_argument, NULL, 's' },
+    { "median", required_argument, NULL, 'M' },
+    { "average", required_argument, NULL, 'A' },
+    { "ema", required_argument, NULL, 'E' },
+    { "switch", required_argument, NULL, 't' },
+    { "hysteresis", required_argument, NULL, 'H' },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  vl53l1x_config_t *pipeline = &g_config.pipeline;
+  pipeline->switch_hysteresis_mm = 10;
+
+  int option;
+  while(-1 != (option = getopt_long(argc, argv, "n:i:N:k:x:rS:s:M:A:E:t:H:h",
+                                    options, NULL) ) ) {
+    unsigned long value = (NULL != optarg) ? strtoul(optarg, NULL, 0) : 0;
+    switch(option) {
+      case 'n': g_config.samples = (unsigned int) value; break;
+      case 'i': g_config.period_ms = (unsigned int) value; break;
+      case 'N': g_config.noise_mm = (unsigned int) value; break;
+      case 'k': g_config.spike_permille = (unsigned int) value; break;
+      case 'x': g_config.invalid_permille = (unsigned int) value; break;
+      case 'r': pipeline->reject_invalid_status = 1; break;
+      case 'S': pipeline->min_signal_per_spad = (uint16_t) value; break;
+      case 's': pipeline->max_step_mm = (uint16_t) value; break;
+      case 'M': pipeline->median_window = (uint8_t) value; break;
+      case 'A': pipeline->average_window = (uint8_t) value; break;
+      case 'E': pipeline->ema_alpha = (uint8_t) value; break;
+      case 't': pipeline->switch_point_mm = (uint16_t) value; break;
+      case 'H': pipeline->switch_hysteresis_mm = (uint16_t) value; break;
+      default:
+        return -1;
+    }
+  }
+  if(optind != argc || 0 == g_config.samples || 0 == g_config.period_ms ||
+     g_config.period_ms > 2000 ||
+     g_config.spike_permille + g_config.invalid_permille > 1000 ||
+     pipeline->median_window > VL53L1X_CONFIG_FILTER_WINDOW_MAX ||
+     pipeline->average_window > VL53L1X_CONFIG_FILTER_WINDOW_MAX) {
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if(0 != ParseArguments(argc, argv) ) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  return Run();
+}
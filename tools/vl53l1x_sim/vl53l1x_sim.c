@@ -0,0 +1,489 @@
+/** @file vl53l1x_sim.c
+ *  @brief VL53L1X acquisition loop on the host against the ULD platform mock
+ *
+ *  Runs the unmodified ULD against vl53l1_platform_mock.c and reads ranging
+ *  results the way the sensor task of the ESP32 port does:
+ *  - irq: waits for the GPIO1 data ready signal,
+ *  - poll: polls VL53L1X_CheckForDataReady every poll period, with -a only
+ *    from shortly before the next result is due, like vl53l1x_array.c,
+ *  - fixed: reads the result registers every poll period without checking
+ *    for new data, the behaviour before data ready acquisition.
+ *
+ *  Every sample gets a sequence number and a timestamp as published in input
+ *  assembly 100. The RESULT__STREAM_COUNT register of the mock tells which
+ *  sensor result was read, so the tool reports duplicated (stale) and missed
+ *  results and the delay from the end of a ranging to its publication.
+ *
+ *  With more than one sensor (-n) the tool follows vl53l1x_array.c instead:
+ *  the sensors are brought up one at a time through XSHUT and moved to
+ *  addresses from 0x30, then the ranging groups (-g) take turns while one
+ *  loop polls the data ready flags of the group. Each sensor reports its own
+ *  distance, so a result read from the wrong sensor is counted as crossed.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "VL53L1X_api.h"
+#include "vl53l1_platform_mock.h"
+#include "histogram.h"
+
+#define SENSOR_DEV               VL53L1_MOCK_DEFAULT_ADDRESS
+#define RESULT__STREAM_COUNT     0x008B
+
+/* Array layout of vl53l1x_array.h */
+#define ARRAY_MAX_SENSORS        VL53L1_MOCK_MAX_DEVICES
+#define ARRAY_BASE_ADDRESS       0x30
+
+typedef enum {
+  kModeIrq,
+  kModePoll,
+  kModeFixed
+} AcquisitionMode;
+
+static struct {
+  AcquisitionMode mode;
+  unsigned int poll_period_ms;
+  unsigned int inter_measurement_ms;
+  unsigned int duration_s;
+  unsigned int work_us;
+  unsigned int sensors;
+  unsigned int groups;
+  bool early_wait;
+} g_config = {
+  .mode = kModeIrq,
+  .poll_period_ms = 2,
+  .inter_measurement_ms = 20,
+  .duration_s = 3,
+  .work_us = 0,
+  .sensors = 1,
+  .groups = 0,
+  .early_wait = false,
+};
+
+/* Polling resumes period / this divisor plus a poll period before the next
+ * result, VL53L1X_ARRAY_POLL_EARLY_DIV */
+#define POLL_EARLY_DIV           8
+
+static void SleepUs(int64_t duration_us) {
+  struct timespec duration = {
+    .tv_sec = duration_us / 1000000,
+    .tv_nsec = (duration_us % 1000000) * 1000,
+  };
+  nanosleep(&duration, NULL);
+}
+
+/** @brief Waits for the next result like the sensor task
+ *
+ *  @return true with the time the result was detected, false on timeout
+ */
+static bool WaitDataReady(int64_t timeout_us, int64_t *ready_us) {
+  if(kModeIrq == g_config.mode) {
+    return VL53L1_MockWaitGpio1(SENSOR_DEV, timeout_us, ready_us);
+  }
+
+  if(kModeFixed == g_config.mode) {
+    SleepUs( (int64_t) g_config.poll_period_ms * 1000);
+    *ready_us = VL53L1_MockNowUs();
+    return true;
+  }
+
+  const int64_t deadline_us = VL53L1_MockNowUs() + timeout_us;
+  while(true) {
+    uint8_t ready = 0;
+    if(0 != VL53L1X_CheckForDataReady(SENSOR_DEV, &ready) ) {
+      return false;
+    }
+    const int64_t now_us = VL53L1_MockNowUs();
+    if(ready) {
+      *ready_us = now_us;
+      return true;
+    }
+    if(now_us >= deadline_us) {
+      return false;
+    }
+    SleepUs( (int64_t) g_config.poll_period_ms * 1000);
+  }
+}
+
+static void PrintHistogram(const char *name, const Histogram *histogram) {
+  if(0 == histogram->count) {
+    printf("  %-18s no samples\n", name);
+    return;
+  }
+  printf("  %-18s n=%-9" PRIu64 " min=%-7" PRIu64 " p50=%-7" PRIu64
+         " p99=%-7" PRIu64 " max=%" PRIu64 " us\n",
+         name, histogram->count, histogram->min,
+         HistogramPercentile(histogram, 50.0),
+         HistogramPercentile(histogram, 99.0),
+         histogram->max);
+}
+
+/** @brief Longest ULD timing budget that fits the inter-measurement period */
+static uint16_t TimingBudget(void) {
+  static const uint16_t kTimingBudgets[] = { 500, 200, 100, 50, 33, 20, 15 };
+  for(size_t i = 0; i < sizeof(kTimingBudgets) / sizeof(kTimingBudgets[0]);
+      i++) {
+    if(kTimingBudgets[i] <= g_config.inter_measurement_ms) {
+      return kTimingBudgets[i];
+    }
+  }
+  return 15;
+}
+
+static int Run(void) {
+  const uint16_t timing_budget = TimingBudget();
+
+  VL53L1X_ERROR status = VL53L1X_SensorInit(SENSOR_DEV);
+  status |= VL53L1X_SetTimingBudgetInMs(SENSOR_DEV, timing_budget);
+  status |= VL53L1X_SetInterMeasurementInMs(SENSOR_DEV,
+                                            g_config.inter_measurement_ms);
+  status |= VL53L1X_SetInterruptPolarity(SENSOR_DEV, 1);
+  status |= VL53L1X_StartRanging(SENSOR_DEV);
+  if(0 != status) {
+    fprintf(stderr, "sensor initialization failed: %d\n", status);
+    return EXIT_FAILURE;
+  }
+
+  Histogram latency, interval;
+  HistogramInit(&latency);
+  HistogramInit(&interval);
+  VL53L1_MockStats_t before;
+  VL53L1_MockGetStats(0, &before);
+
+  uint32_t sequence = 0;
+  uint64_t duplicates = 0, missed = 0, timeouts = 0;
+  uint8_t last_stream_count = 0;
+  int64_t last_timestamp_us = 0;
+  const int64_t timeout_us = 2 * (int64_t) g_config.inter_measurement_ms *
+                             1000;
+  const int64_t end_us = VL53L1_MockNowUs() +
+                         (int64_t) g_config.duration_s * 1000000;
+
+  while(VL53L1_MockNowUs() < end_us) {
+    if(g_config.early_wait && 0 != last_timestamp_us) {
+      const int64_t period_us = (int64_t) g_config.inter_measurement_ms * 1000;
+      const int64_t early_us = last_timestamp_us + period_us -
+                               period_us / POLL_EARLY_DIV -
+                               (int64_t) g_config.poll_period_ms * 1000;
+      const int64_t now_us = VL53L1_MockNowUs();
+      if(early_us > now_us) {
+        SleepUs(early_us - now_us);
+      }
+    }
+    int64_t timestamp_us = 0;
+    if(!WaitDataReady(timeout_us, &timestamp_us) ) {
+      timeouts++;
+      continue;
+    }
+
+    VL53L1X_Result_t result;
+    uint8_t stream_count = 0;
+    status = VL53L1X_GetResult(SENSOR_DEV, &result);
+    status |= VL53L1_RdByte(SENSOR_DEV, RESULT__STREAM_COUNT, &stream_count);
+    status |= VL53L1X_ClearInterrupt(SENSOR_DEV);
+    if(0 != status) {
+      fprintf(stderr, "reading the result failed: %d\n", status);
+      return EXIT_FAILURE;
+    }
+    VL53L1_MockStats_t stats;
+    VL53L1_MockGetStats(0, &stats);
+    const int64_t published_us = VL53L1_MockNowUs();
+    sequence++;
+
+    if(1 < sequence) {
+      const uint8_t step = (uint8_t) (stream_count - last_stream_count);
+      if(0 == step) {
+        duplicates++;
+      } else {
+        missed += step - 1U;
+        HistogramRecord(&interval,
+                        (uint64_t) (timestamp_us - last_timestamp_us) );
+      }
+    }
+    if(1 == sequence || stream_count != last_stream_count) {
+      HistogramRecord(&latency,
+                      (uint64_t) (published_us - stats.last_ready_us) );
+    }
+    last_stream_count = stream_count;
+    last_timestamp_us = timestamp_us;
+
+    if(0 != g_config.work_us) {
+      SleepUs(g_config.work_us);
+    }
+  }
+
+  VL53L1_MockStats_t after;
+  VL53L1_MockGetStats(0, &after);
+  const uint32_t transactions = after.transactions - before.transactions;
+
+  static const char *const kModeNames[] = { "irq", "poll", "fixed" };
+  printf("mode %s%s, inter-measurement %u ms, timing budget %u ms, "
+         "poll period %u ms\n",
+         kModeNames[g_config.mode], g_config.early_wait ? " (early wait)" : "",
+         g_config.inter_measurement_ms, (unsigned) timing_budget,
+         g_config.poll_period_ms);
+  PrintHistogram("ready->publish", &latency);
+  PrintHistogram("sample interval", &interval);
+  printf("  samples %" PRIu32 ", sensor results %" PRIu32 ", duplicated %"
+         PRIu64 ", missed %" PRIu64 ", overruns %" PRIu32 ", timeouts %"
+         PRIu64 "\n", sequence, after.results - before.results, duplicates,
+         missed, after.overruns - before.overruns, timeouts);
+  printf("  I2C transactions %" PRIu32 " (%.1f per sample)\n", transactions,
+         0 != sequence ? (double) transactions / sequence : 0.0);
+
+  /* one line for scripts */
+  printf("RESULT mode=%s samples=%" PRIu32 " duplicated=%" PRIu64
+         " missed=%" PRIu64 " latency_p50_us=%" PRIu64 " latency_max_us=%"
+         PRIu64 " transactions=%" PRIu32 "\n",
+         kModeNames[g_config.mode], sequence, duplicates, missed,
+         HistogramPercentile(&latency, 50.0), latency.max, transactions);
+  return EXIT_SUCCESS;
+}
+
+/** @brief Brings the sensors up one at a time like vl53l1x_array_init */
+static int BringUpArray(uint16_t timing_budget) {
+  VL53L1_MockReset( (uint8_t) g_config.sensors);
+  for(unsigned int i = 0; i < g_config.sensors; i++) {
+    VL53L1_MockSetShutdown( (uint8_t) i, true);
+  }
+
+  for(unsigned int i = 0; i < g_config.sensors; i++) {
+    const uint8_t address = (uint8_t) (ARRAY_BASE_ADDRESS + i);
+    VL53L1_MockSetShutdown( (uint8_t) i, false);
+    VL53L1_MockSetDistance( (uint8_t) i, (uint16_t) (100 * (i + 1) ) );
+
+    /* only the released sensor answers at the default address */
+    VL53L1X_ERROR status = VL53L1X_SensorInit(SENSOR_DEV);
+    status |= VL53L1X_SetTimingBudgetInMs(SENSOR_DEV, timing_budget);
+    status |= VL53L1X_SetInterMeasurementInMs(SENSOR_DEV,
+                                              g_config.inter_measurement_ms);
+    status |= VL53L1X_SetInterruptPolarity(SENSOR_DEV, 0);
+    status |= VL53L1X_SetI2CAddress(SENSOR_DEV, address);
+    if(0 != status || address != VL53L1_MockGetAddress( (uint8_t) i) ) {
+      fprintf(stderr, "sensor %u failed to come up at 0x%02X\n", i,
+              (unsigned) address);
+      return -1;
+    }
+    if(1 == g_config.groups &&
+       0 != VL53L1X_StartRanging(address) ) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/** @brief Ranges the groups in turn like vl53l1x_array_service */
+static int RunArray(void) {
+  const uint16_t timing_budget = TimingBudget();
+  const unsigned int groups = g_config.groups;
+  if(0 != BringUpArray(timing_budget) ) {
+    return EXIT_FAILURE;
+  }
+
+  Histogram interval, latency;
+  HistogramInit(&interval);
+  HistogramInit(&latency);
+  int64_t last_sample_us[ARRAY_MAX_SENSORS] = { 0 };
+  uint64_t samples[ARRAY_MAX_SENSORS] = { 0 };
+  uint64_t crossed = 0, timeouts = 0, rounds = 0;
+  uint32_t transactions = 0;
+  VL53L1_MockStats_t stats;
+  for(unsigned int i = 0; i < g_config.sensors; i++) {
+    VL53L1_MockGetStats( (uint8_t) i, &stats);
+    transactions -= stats.transactions;
+  }
+
+  const int64_t timeout_us = 2 * (int64_t) g_config.inter_measurement_ms *
+                             1000;
+  const int64_t end_us = VL53L1_MockNowUs() +
+                         (int64_t) g_config.duration_s * 1000000;
+  unsigned int group = 0;
+
+  while(VL53L1_MockNowUs() < end_us) {
+    bool pending[ARRAY_MAX_SENSORS] = { false };
+    const int64_t due_us = VL53L1_MockNowUs() + timeout_us;
+    for(unsigned int i = group; i < g_config.sensors; i += groups) {
+      const uint16_t dev = (uint16_t) (ARRAY_BASE_ADDRESS + i);
+      pending[i] = true;
+      VL53L1X_ClearInterrupt(dev);
+      if(1 < groups) {
+        VL53L1X_StartRanging(dev);
+      }
+    }
+
+    unsigned int left = 0;
+    for(unsigned int i = group; i < g_config.sensors; i += groups) {
+      left++;
+    }
+    /* a continuously ranging array never completes its only group */
+    const unsigned int wanted = (1 < groups) ? left : UINT32_MAX;
+    unsigned int read = 0;
+    while(read < wanted && VL53L1_MockNowUs() < end_us) {
+      bool read_any = false;
+      for(unsigned int i = group; i < g_config.sensors; i += groups) {
+        const uint16_t dev = (uint16_t) (ARRAY_BASE_ADDRESS + i);
+        uint8_t tio_status = 0;
+        if(!pending[i] || 0 != VL53L1_RdByte(dev, 0x0031, &tio_status) ||
+           0 != (tio_status & 0x01) ) {
+          continue;   /* active low: bit 0 clear is data ready */
+        }
+        VL53L1X_Result_t result;
+        VL53L1X_GetResult(dev, &result);
+        VL53L1X_ClearInterrupt(dev);
+        VL53L1_MockGetStats( (uint8_t) i, &stats);
+        const int64_t now_us = VL53L1_MockNowUs();
+        HistogramRecord(&latency, (uint64_t) (now_us - stats.last_ready_us) );
+        if(0 != samples[i]) {
+          HistogramRecord(&interval, (uint64_t) (now_us - last_sample_us[i]) );
+        }
+        if(result.Distance != 100 * (i + 1) ) {
+          crossed++;
+        }
+        last_sample_us[i] = now_us;
+        samples[i]++;
+        pending[i] = (1 == groups);
+        read_any = true;
+        read++;
+        if(0 != g_config.work_us) {
+          SleepUs(g_config.work_us);
+        }
+      }
+      if(read_any) {
+        continue;
+      }
+      if(1 < groups && VL53L1_MockNowUs() >= due_us) {
+        timeouts += wanted - read;
+        break;
+      }
+      SleepUs( (int64_t) g_config.poll_period_ms * 1000);
+    }
+
+    if(1 < groups) {
+      for(unsigned int i = group; i < g_config.sensors; i += groups) {
+        VL53L1X_StopRanging( (uint16_t) (ARRAY_BASE_ADDRESS + i) );
+      }
+    }
+    group = (group + 1) % groups;
+    if(0 == group) {
+      rounds++;
+    }
+  }
+
+  uint64_t total = 0, fewest = UINT64_MAX;
+  uint32_t overruns = 0;
+  for(unsigned int i = 0; i < g_config.sensors; i++) {
+    VL53L1_MockGetStats( (uint8_t) i, &stats);
+    transactions += stats.transactions;
+    overruns += stats.overruns;
+    total += samples[i];
+    if(samples[i] < fewest) {
+      fewest = samples[i];
+    }
+  }
+
+  printf("array of %u sensors, %u ranging group(s), inter-measurement %u ms, "
+         "timing budget %u ms, poll period %u ms\n",
+         g_config.sensors, groups, g_config.inter_measurement_ms,
+         (unsigned) timing_budget, g_config.poll_period_ms);
+  PrintHistogram("ready->publish", &latency);
+  PrintHistogram("sensor interval", &interval);
+  printf("  samples %" PRIu64 " (fewest per sensor %" PRIu64 "), rounds %"
+         PRIu64 ", crossed %" PRIu64 ", timeouts %" PRIu64 ", overruns %"
+         PRIu32 "\n", total, fewest, rounds, crossed, timeouts, overruns);
+  printf("  I2C transactions %" PRIu32 " (%.1f per sample)\n", transactions,
+         0 != total ? (double) transactions / total : 0.0);
+
+  /* one line for scripts */
+  printf("RESULT mode=array sensors=%u groups=%u samples=%" PRIu64
+         " crossed=%" PRIu64 " timeouts=%" PRIu64 " interval_p50_us=%" PRIu64
+         " transactions=%" PRIu32 "\n", g_config.sensors, groups, total,
+         crossed, timeouts, HistogramPercentile(&interval, 50.0),
+         transactions);
+  return (0 == crossed && 0 != fewest) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void Usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -m, --mode M            irq, poll or fixed (irq)\n"
+          "  -p, --poll-period MS    poll period of poll and fixed mode (2)\n"
+          "  -i, --inter-measurement MS\n"
+          "                          sensor inter-measurement period (20)\n"
+          "  -d, --duration S        acquisition time in seconds (3)\n"
+          "  -w, --work US           processing time per sample (0)\n"
+          "  -n, --sensors N         sensors brought up through XSHUT (1)\n"
+          "  -g, --groups G          ranging groups of an array, 0 ranges one\n"
+          "                          sensor at a time (0)\n"
+          "  -a, --early-wait        poll mode polls only from shortly before\n"
+          "                          the next result is due\n",
+          program);
+}
+
+static int ParseArguments(int argc, char *argv[]) {
+  static const struct option options[] = {
+    { "mode", required_argument, NULL, 'm' },
+    { "poll-period", required_argument, NULL, 'p' },
+    { "inter-measurement", required_argument, NULL, 'i' },
+    { "duration", required_argument, NULL, 'd' },
+    { "work", required_argument, NULL, 'w' },
+    { "sensors", required_argument, NULL, 'n' },
+    { "groups", required_argument, NULL, 'g' },
+    { "early-wait", no_argument, NULL, 'a' },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int option;
+  while(-1 != (option = getopt_long(argc, argv, "m:p:i:d:w:n:g:ah", options,
+                                    NULL) ) ) {
+    unsigned long value = (NULL != optarg) ? strtoul(optarg, NULL, 0) : 0;
+    switch(option) {
+      case 'm':
+        if(0 == strcmp(optarg, "irq") ) {
+          g_config.mode = kModeIrq;
+        } else if(0 == strcmp(optarg, "poll") ) {
+          g_config.mode = kModePoll;
+        } else if(0 == strcmp(optarg, "fixed") ) {
+          g_config.mode = kModeFixed;
+        } else {
+          return -1;
+        }
+        break;
+      case 'p': g_config.poll_period_ms = (unsigned int) value; break;
+      case 'i': g_config.inter_measurement_ms = (unsigned int) value; break;
+      case 'd': g_config.duration_s = (unsigned int) value; break;
+      case 'w': g_config.work_us = (unsigned int) value; break;
+      case 'n': g_config.sensors = (unsigned int) value; break;
+      case 'g': g_config.groups = (unsigned int) value; break;
+      case 'a': g_config.early_wait = true; break;
+      default:
+        return -1;
+    }
+  }
+  if(optind != argc || 0 == g_config.poll_period_ms ||
+     g_config.inter_measurement_ms < 15 || 0 == g_config.sensors ||
+     g_config.sensors > ARRAY_MAX_SENSORS) {
+    return -1;
+  }
+  if(0 == g_config.groups || g_config.groups > g_config.sensors) {
+    g_config.groups = g_config.sensors;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  if(0 != ParseArguments(argc, argv) ) {
+    Usage(argv[0]);
+    return EXIT_FAILURE;
+  }
+  return (1 < g_config.sensors) ? RunArray() : Run();
+}